@@ -0,0 +1,158 @@
+// Microbenchmark: 多個 thread 同時配置/釋放 Block
+// 1) 直接呼叫配置器: 每個 thread 配 64 個 Block 再全部釋放
+//    own group: 每個 thread 的 goal 在不同的配置群組   one group: 全部擠在同一個群組 (等於以前只有一把鎖)
+// 2) 透過 libmyfs: 每個 thread 在自己的目錄寫 64 KiB 的檔案再 truncate 成 0,
+//    locality = 檔案的 Block 落在目錄 home group 的比例
+// 依 thread 數列出 blocks/sec,最後檢查 Block 的帳是否一致
+// Usage: bench_alloc [ms_per_round] [max_threads]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_ms(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+#include "myfs.h"
+#include "fs.h"
+#include "bitmap.h"
+#include "inode.h"
+#include "utils.h"
+
+#define BATCH 64
+#define FILE_SIZE (64 * 1024)
+#define MAX_THREADS 64
+
+typedef struct
+{
+    int id;
+    int mode;          // 0 = own group, 1 = one group, 2 = libmyfs
+    uint64_t ns;
+    long long blocks;
+    long long home, placed; // mode 2: 落在 home group 的 Block 數 / 全部
+    int errors;
+} Worker;
+
+static int stop;
+
+static void *raw_worker(void *arg)
+{
+    Worker *w = arg;
+    int goal = w->mode == 0 ? (w->id % ag_count()) * AG_BLOCKS : 0;
+    int got[BATCH];
+    uint64_t t0 = now_ns();
+    while(!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        int n = 0;
+        for(; n < BATCH; n++)
+        {
+            got[n] = alloc_block(n ? got[n - 1] + 1 : goal);
+            if(got[n] < 0) { w->errors++; break; }
+        }
+        for(int k = 0; k < n; k++) free_block(got[k]);
+        w->blocks += n;
+    }
+    w->ns = now_ns() - t0;
+    return NULL;
+}
+
+static void *fs_worker(void *arg)
+{
+    Worker *w = arg;
+    char dir[32], path[64];
+    sprintf(dir, "/a%d", w->id);
+    sprintf(path, "%s/data", dir);
+    myfs_stat_t dst;
+    myfs_stat(dir, &dst);
+    int home = ag_goal(dst.ino) / AG_BLOCKS;
+    char *buf = malloc(FILE_SIZE);
+    memset(buf, 'a' + w->id % 26, FILE_SIZE);
+    int fd = myfs_open(path, MYFS_O_RDWR | MYFS_O_CREAT);
+    myfs_stat_t st;
+    myfs_fstat(fd, &st);
+    uint64_t t0 = now_ns();
+    while(!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        if(myfs_pwrite(fd, buf, FILE_SIZE, 0) != FILE_SIZE) { w->errors++; break; }
+        // 這個檔案只有自己在改,直接看 Inode 裡的 Block 位置
+        for(int b = 0; b < FILE_SIZE / BLOCK_SIZE; b++) if(inode_table[st.ino].blocks[b] / AG_BLOCKS == home) w->home++;
+        w->placed += FILE_SIZE / BLOCK_SIZE;
+        myfs_ftruncate(fd, 0);
+        w->blocks += FILE_SIZE / BLOCK_SIZE;
+    }
+    w->ns = now_ns() - t0;
+    myfs_close(fd);
+    free(buf);
+    return NULL;
+}
+
+// Bitmap 裡使用中的 Block 數 = 各配置群組的計數加總 = 所有檔案的 Block 數總和
+static int check_blocks()
+{
+    int bits = 0, owned = 0;
+    for(int b = 0; b < sb->total_blocks; b++) if(get_bit(b)) bits++;
+    for(int i = 0; i < sb->total_inodes; i++)
+        if(inode_table[i].is_used && !inode_table[i].is_dir) owned += FILE_BLOCKS(inode_table[i].size);
+    if(bits != blocks_used() || bits != owned)
+    {
+        printf("  block accounting mismatch: bitmap %d, used_blocks %d, owned by files %d\n", bits, blocks_used(), owned);
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    int ms = argc > 1 ? atoi(argv[1]) : 300;
+    int maxt = argc > 2 ? atoi(argv[2]) : (cpu_count() > 8 ? cpu_count() : 8);
+    if(maxt > MAX_THREADS) maxt = MAX_THREADS;
+
+    if(myfs_format("bench_alloc.img", 64 * 1024 * 1024, "") != MYFS_OK)
+    {
+        fprintf(stderr, "format failed\n"); return 1;
+    }
+    char dir[32];
+    for(int i = 0; i < maxt; i++) { sprintf(dir, "/a%d", i); myfs_mkdir(dir); }
+
+    printf("%d CPUs, %d blocks in %d groups, %d ms per round\n", cpu_count(), sb->total_blocks, ag_count(), ms);
+    const char *names[] = { "alloc/free, own group", "alloc/free, one group", "write + truncate" };
+    int ok = 1;
+    for(int mode = 0; mode < 3; mode++)
+    {
+        printf("%s:\n", names[mode]);
+        for(int nt = 1; nt <= maxt; nt *= 2)
+        {
+            Worker w[MAX_THREADS];
+            pthread_t th[MAX_THREADS];
+            __atomic_store_n(&stop, 0, __ATOMIC_RELAXED);
+            for(int i = 0; i < nt; i++)
+            {
+                memset(&w[i], 0, sizeof(w[i]));
+                w[i].id = i; w[i].mode = mode;
+                pthread_create(&th[i], NULL, mode == 2 ? fs_worker : raw_worker, &w[i]);
+            }
+            sleep_ms(ms);
+            __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+            long long blocks = 0, home = 0, placed = 0; int errors = 0;
+            double secs = 0;
+            for(int i = 0; i < nt; i++)
+            {
+                pthread_join(th[i], NULL);
+                blocks += w[i].blocks; errors += w[i].errors;
+                home += w[i].home; placed += w[i].placed;
+                if(w[i].ns / 1e9 > secs) secs = w[i].ns / 1e9;
+            }
+            int blocks_ok = check_blocks();
+            printf("  %2d threads: %10.0f blocks/sec (%d errors)", nt, blocks / secs, errors);
+            if(mode == 2) printf(", locality %.1f%%", placed ? 100.0 * home / placed : 0.0);
+            printf("%s\n", blocks_ok ? "" : " CORRUPTED");
+            ok &= errors == 0 && blocks_ok;
+        }
+    }
+    myfs_unmount();
+    printf("consistency: %s\n", ok ? "ok" : "FAILED");
+    return !ok;
+}
@@ -0,0 +1,164 @@
+// Benchmark: out-of-core 模式 (Block 快取比映像檔小很多) 的命中率和吞吐量
+// 映像檔塞滿 128 KiB 的檔案,用很小的快取重新掛載,然後:
+//   seq:    每個檔案從頭讀到尾 (16 KiB 一次,會觸發預讀)
+//   random: 隨機 4 KiB pread,散在整個映像檔
+//   hot:    90% 的讀取落在 1% 的檔案 (放得進快取)
+//   write:  隨機 4 KiB pwrite (換出時寫回),最後 sync 再重新掛載檢查內容
+// 映像檔本身通常在 OS 的 page cache 裡,miss 的成本是一次 pread 系統呼叫
+// Usage: bench_cache [image_MiB] [cache_KiB] [ms_per_phase]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "myfs.h"
+#include "bcache.h"
+#include "utils.h"
+
+#define IMG "bench_cache.img"
+#define FILE_SIZE (128 * 1024)
+#define CHUNK (16 * 1024)
+#define IO 4096
+
+#define FD_SLOTS 32 // 同時開著的檔案 (MYFS_MAX_OPEN 有上限): 用到才開,direct-mapped
+
+static int nfiles;
+static int fd_file[FD_SLOTS], fd_of[FD_SLOTS];
+
+static unsigned rnd(unsigned *s) { *s ^= *s << 13; *s ^= *s >> 17; *s ^= *s << 5; return *s; }
+
+static char file_byte(int f, int i) { return (char)(f * 131 + i / 7); }
+
+static void report(const char *name, long long ops, long long bytes, uint64_t ns)
+{
+    BcStats st;
+    bc_stats(&st);
+    long long lookups = st.hits + st.misses;
+    double secs = ns / 1e9;
+    printf("  %-7s %9.0f ops/sec %8.1f MiB/s  hit rate %5.1f%%  %lld prefetched (%lld used)  %lld reads  %lld evictions (%lld dirty)\n",
+           name, ops / secs, bytes / secs / 1048576.0, lookups ? 100.0 * st.hits / lookups : 0.0,
+           st.prefetched, st.prefetch_hits, st.reads, st.evictions, st.writebacks);
+    bc_stats_reset();
+}
+
+static int file_fd(int f)
+{
+    int k = f % FD_SLOTS;
+    if(fd_file[k] == f) return fd_of[k];
+    if(fd_file[k] >= 0) myfs_close(fd_of[k]);
+    char path[32];
+    sprintf(path, "/d%d/f%05d", f % 16, f);
+    fd_file[k] = f;
+    return fd_of[k] = myfs_open(path, MYFS_O_RDWR);
+}
+
+static void close_all()
+{
+    for(int k = 0; k < FD_SLOTS; k++) if(fd_file[k] >= 0) myfs_close(fd_of[k]);
+    memset(fd_file, -1, sizeof(fd_file));
+}
+
+int main(int argc, char **argv)
+{
+    int img_mb = argc > 1 ? atoi(argv[1]) : 64;
+    int cache_kb = argc > 2 ? atoi(argv[2]) : 1024;
+    int ms = argc > 3 ? atoi(argv[3]) : 500;
+    uint64_t budget = (uint64_t)ms * 1000000;
+
+    // 建立映像檔 (用 out-of-core 模式建,不用整個放在記憶體)
+    myfs_set_cache(cache_kb * 1024 / BLOCK_SIZE);
+    if(myfs_format(IMG, (long long)img_mb * 1024 * 1024, "bench") != MYFS_OK) { fprintf(stderr, "format failed\n"); return 1; }
+    char path[32], *buf = malloc(FILE_SIZE);
+    for(int d = 0; d < 16; d++) { sprintf(path, "/d%d", d); myfs_mkdir(path); }
+    nfiles = (int)((long long)img_mb * 1024 * 1024 * 9 / 10 / FILE_SIZE);
+    uint64_t t0 = now_ns();
+    for(int f = 0; f < nfiles; f++)
+    {
+        for(int i = 0; i < FILE_SIZE; i++) buf[i] = file_byte(f, i);
+        sprintf(path, "/d%d/f%05d", f % 16, f);
+        int fd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_CREAT);
+        if(fd < 0 || myfs_write(fd, buf, FILE_SIZE) != FILE_SIZE) { nfiles = f; if(fd >= 0) myfs_close(fd); break; }
+        myfs_close(fd);
+    }
+    myfs_sync();
+    uint64_t fill_ns = now_ns() - t0;
+    myfs_unmount();
+
+    printf("%d MiB image, %d files of %d KiB, cache %d KiB (%.1f%% of the data), %d ms per phase\n",
+           img_mb, nfiles, FILE_SIZE / 1024, cache_kb, 100.0 * cache_kb / (nfiles * (FILE_SIZE / 1024.0)), ms);
+    printf("  fill    %9.1f MiB/s (write + sync)\n", (double)nfiles * FILE_SIZE / (fill_ns / 1e9) / 1048576.0);
+    if(myfs_mount(IMG, "bench") != MYFS_OK) { fprintf(stderr, "mount failed\n"); return 1; }
+    memset(fd_file, -1, sizeof(fd_file));
+    unsigned seed = 2463534242u;
+    int errors = 0;
+
+    // seq: 一個檔案接一個檔案讀完
+    long long ops = 0, bytes = 0;
+    t0 = now_ns();
+    for(int f = 0; now_ns() - t0 < budget; f = (f + 1) % nfiles)
+    {
+        for(int off = 0; off < FILE_SIZE; off += CHUNK)
+        {
+            if(myfs_pread(file_fd(f), buf, CHUNK, off) != CHUNK || buf[0] != file_byte(f, off)) errors++;
+            ops++; bytes += CHUNK;
+        }
+    }
+    report("seq", ops, bytes, now_ns() - t0);
+
+    // random: 整個映像檔隨機 4 KiB
+    ops = 0;
+    t0 = now_ns();
+    while(now_ns() - t0 < budget)
+    {
+        for(int k = 0; k < 256; k++, ops++)
+        {
+            int f = rnd(&seed) % nfiles, off = (rnd(&seed) % (FILE_SIZE / IO)) * IO;
+            if(myfs_pread(file_fd(f), buf, IO, off) != IO || buf[IO - 1] != file_byte(f, off + IO - 1)) errors++;
+        }
+    }
+    report("random", ops, ops * IO, now_ns() - t0);
+
+    // hot: 90% 在前 1% 的檔案
+    int hot = nfiles / 100 > 0 ? nfiles / 100 : 1;
+    ops = 0;
+    t0 = now_ns();
+    while(now_ns() - t0 < budget)
+    {
+        for(int k = 0; k < 256; k++, ops++)
+        {
+            int f = rnd(&seed) % 10 ? (int)(rnd(&seed) % hot) : (int)(rnd(&seed) % nfiles);
+            int off = (rnd(&seed) % (FILE_SIZE / IO)) * IO;
+            if(myfs_pread(file_fd(f), buf, IO, off) != IO || buf[0] != file_byte(f, off)) errors++;
+        }
+    }
+    report("hot", ops, ops * IO, now_ns() - t0);
+
+    // write: 隨機改寫 4 KiB (內容 = 檔案編號 + 位置,之後可以檢查)
+    ops = 0;
+    t0 = now_ns();
+    while(now_ns() - t0 < budget)
+    {
+        for(int k = 0; k < 256; k++, ops++)
+        {
+            int f = rnd(&seed) % nfiles, off = (rnd(&seed) % (FILE_SIZE / IO)) * IO;
+            for(int i = 0; i < IO; i += 512) buf[i] = file_byte(f, off + i);
+            if(myfs_pwrite(file_fd(f), buf, IO, off) != IO) errors++;
+        }
+    }
+    report("write", ops, ops * IO, now_ns() - t0);
+    close_all();
+    myfs_sync();
+    myfs_unmount();
+
+    // 重新掛載 (整個讀進記憶體) 檢查: 每 512 bytes 的第一個 byte 不管有沒有被改寫都一樣
+    myfs_set_cache(0);
+    int ok = errors == 0 && myfs_mount(IMG, "bench") == MYFS_OK;
+    for(int f = 0; ok && f < nfiles; f++)
+    {
+        if(myfs_pread(file_fd(f), buf, FILE_SIZE, 0) != FILE_SIZE) ok = 0;
+        for(int i = 0; ok && i < FILE_SIZE; i += 512) if(buf[i] != file_byte(f, i)) ok = 0;
+    }
+    close_all();
+    myfs_unmount();
+    free(buf);
+    printf("data check: %s\n", ok ? "ok" : "FAILED");
+    return !ok;
+}
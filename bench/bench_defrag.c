@@ -0,0 +1,79 @@
+// Microbenchmark: 分段磁碟重組
+// 2000 個檔案輪流 append (每次 1 KiB),每個檔案的 Block 都散在整個磁碟上,再刪掉一部分製造空洞
+// 用 --budget 分段執行,量每段的最長停頓、總共搬了多少,並確認內容沒有被改壞
+// Usage: bench_defrag [files] [budget_ms]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "myfs.h"
+#include "defrag.h"
+#include "utils.h"
+
+static uint64_t checksum(const char *path)
+{
+    char buf[4096]; int n; uint64_t h = 1469598103934665603ull;
+    int fd = myfs_open(path, MYFS_O_RDONLY);
+    while((n = myfs_read(fd, buf, sizeof(buf))) > 0)
+        for(int i = 0; i < n; i++) { h ^= (unsigned char)buf[i]; h *= 1099511628211ull; }
+    myfs_close(fd);
+    return h;
+}
+
+static void print_frag(const char *label)
+{
+    FragReport r;
+    frag_report(&r);
+    printf("%s %d/%d files fragmented, %.2f extents/file, %d free runs (largest %d)\n",
+           label, r.fragmented, r.files, r.files ? (double)r.extents / r.files : 0.0, r.free_runs, r.largest_free);
+}
+
+int main(int argc, char **argv)
+{
+    int files = argc > 1 ? atoi(argv[1]) : 2000;
+    double budget_ms = argc > 2 ? atof(argv[2]) : 5;
+    int chunks = 8; // 每個檔案 8 KiB
+
+    if(myfs_format("bench_defrag.img", files * chunks * 1024 * 2 + 4 * 1024 * 1024, "") != MYFS_OK)
+    {
+        fprintf(stderr, "format failed\n"); return 1;
+    }
+    char path[64], chunk[1024];
+    for(int c = 0; c < chunks; c++)
+        for(int f = 0; f < files; f++)
+        {
+            sprintf(path, "/f%05d", f);
+            int fd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_CREAT | MYFS_O_APPEND);
+            memset(chunk, 'a' + (f + c) % 26, sizeof(chunk));
+            myfs_write(fd, chunk, sizeof(chunk));
+            myfs_close(fd);
+        }
+    for(int f = 0; f < files; f += 3) { sprintf(path, "/f%05d", f); myfs_unlink(path); }
+
+    uint64_t *sum = malloc(sizeof(uint64_t) * files);
+    for(int f = 1; f < files; f++) if(f % 3) { sprintf(path, "/f%05d", f); sum[f] = checksum(path); }
+
+    print_frag("before:");
+    DefragStats st;
+    int slices = 0, moved = 0, blocks = 0;
+    uint64_t worst = 0, total = 0;
+    do
+    {
+        uint64_t t0 = now_ns();
+        defrag_step((int64_t)(budget_ms * 1e6), 0, &st);
+        uint64_t dt = now_ns() - t0;
+        if(dt > worst) worst = dt;
+        total += dt; slices++;
+        moved += st.moved_files; blocks += st.moved_blocks;
+    } while(!st.done);
+    printf("budget %.1f ms: %d slices, worst %.2f ms, total %.1f ms, %d files / %d blocks moved (%.0f MiB/s)\n",
+           budget_ms, slices, worst / 1e6, total / 1e6, moved, blocks, blocks / 1024.0 / (total / 1e9));
+    print_frag("after: ");
+
+    int bad = 0;
+    for(int f = 1; f < files; f++) if(f % 3) { sprintf(path, "/f%05d", f); if(checksum(path) != sum[f]) bad++; }
+    printf("content check: %s\n", bad ? "CORRUPTED" : "ok");
+
+    myfs_unmount();
+    free(sum);
+    return bad != 0;
+}
@@ -0,0 +1,123 @@
+// Microbenchmark: find
+// 大量空檔案 (預設 200000 個,分在 1000 個目錄),比較:
+// 舊做法 (每個目錄重掃整個 Inode Table + strstr) vs Name Index (名稱條件) vs 平行掃描 (只有其他條件)
+// Usage: bench_find [files] [rounds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "myfs.h"
+#include "fs.h"
+#include "inode.h"
+#include "find.h"
+#include "path.h"
+#include "utils.h"
+
+// 舊的 find: 每個目錄都掃一次整個 Inode Table
+static int old_find(int dir_id, const char *target)
+{
+    int hits = 0;
+    for(int i = 0; i < sb->total_inodes; i++)
+    {
+        if(inode_table[i].is_used && inode_table[i].parent_id == dir_id)
+        {
+            if(dir_id == 0 && i == 0) continue;
+            if(strstr(inode_table[i].name, target)) hits++;
+            if(inode_table[i].is_dir) hits += old_find(i, target);
+        }
+    }
+    return hits;
+}
+
+static double find_ms(const FindQuery *q, int threads, int rounds, int *hits)
+{
+    uint64_t t0 = now_ns();
+    for(int r = 0; r < rounds; r++)
+    {
+        int *ids;
+        *hits = find_run(0, q, threads, &ids);
+        free(ids);
+    }
+    return (now_ns() - t0) / 1e6 / rounds;
+}
+
+int main(int argc, char **argv)
+{
+    int nfiles = argc > 1 ? atoi(argv[1]) : 200000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    int ndirs = nfiles / 200 ? nfiles / 200 : 1;
+    // 每個 Inode 配 BLOCKS_PER_INODE 個 Block,映像檔大小照檔案數算
+    long long size = (long long)(nfiles + ndirs + 16) * (BLOCK_SIZE * BLOCKS_PER_INODE + sizeof(Inode)) + sizeof(Superblock);
+    if(myfs_format("bench_find.img", size, "") != MYFS_OK)
+    {
+        fprintf(stderr, "format failed\n"); return 1;
+    }
+
+    // 直接用 inode_create 建立 (跳過路徑解析,不然建立本身就是 O(N^2))
+    char name[MAX_FILENAME];
+    int cursor = 1;
+    uint64_t t0 = now_ns();
+    for(int d = 0; d < ndirs; d++)
+    {
+        sprintf(name, "dir%04d", d);
+        int dir = inode_create(0, name, 1, cursor);
+        cursor = dir + 1;
+        for(int f = 0; f < nfiles / ndirs; f++)
+        {
+            sprintf(name, "f%07d.%s", d * (nfiles / ndirs) + f, f % 10 ? "log" : "txt");
+            cursor = inode_create(dir, name, 0, cursor) + 1;
+            inode_table[cursor - 1].size = (f * 37) % 5000; // 只用來測 -size,不配 Block
+        }
+    }
+    uint64_t t1 = now_ns();
+    printf("%d files in %d dirs (%d inodes), created in %.0f ms\n", sb->used_inodes - 1 - ndirs, ndirs,
+           sb->total_inodes, (t1 - t0) / 1e6);
+
+    FindQuery q;
+    int hits;
+    find_query_init(&q);
+    q.name = "f0123450.txt";
+    t0 = now_ns();
+    int *ids; hits = find_run(0, &q, 1, &ids); free(ids); // 第一次查詢: 排序整個 Name Index
+    t1 = now_ns();
+    printf("name index first build (sort): %.1f ms\n", (t1 - t0) / 1e6);
+
+    t0 = now_ns();
+    int old_hits = old_find(0, "f0123456");
+    t1 = now_ns();
+    printf("%-34s %10s %10s\n", "query", "ms", "hits");
+    printf("%-34s %10.3f %10d\n", "old recursive strstr", (t1 - t0) / 1e6, old_hits);
+
+    const char *names[] = { "f0123450.txt", "f01234*", "*99.log", NULL };
+    for(int k = 0; k < 4; k++)
+    {
+        find_query_init(&q);
+        q.name = names[k];
+        if(!names[k]) { q.type = 'f'; q.min_size = 4990; } // 只有條件沒有名稱
+        int maxw = cpu_count() > 4 ? cpu_count() : 4;
+        for(int w = 1; w <= maxw; w *= 2)
+        {
+            double ms = find_ms(&q, w, rounds, &hits);
+            char label[64];
+            if(names[k]) snprintf(label, sizeof(label), "-name %s", names[k]);
+            else snprintf(label, sizeof(label), "-type f -size +4989c (%d workers)", w);
+            printf("%-34s %10.3f %10d\n", label, ms, hits);
+            if(names[k]) break; // 查 Name Index,跟 worker 數無關
+        }
+    }
+
+    // 改名之後 (還沒合併進排序陣列的) 查詢
+    for(int i = 0; i < 1000; i++)
+    {
+        int idx = ndirs + 1 + i * 97 % (nfiles - 1);
+        if(!inode_table[idx].is_used || inode_table[idx].is_dir) continue;
+        dcache_invalidate(idx);
+        inode_table[idx].name[0] = 'g';
+    }
+    find_query_init(&q);
+    q.name = "g00*";
+    double ms = find_ms(&q, 1, rounds, &hits);
+    printf("%-34s %10.3f %10d\n", "-name g00* after 1000 renames", ms, hits);
+
+    myfs_unmount();
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Microbenchmark: grep 的掃描速度 (GiB/s)
+// 1) 在 Block 上直接掃描 (grep_inode) vs 舊做法 (讀出整個檔案 + strtok/strstr)
+// 2) 子字串 kernel 本身 (find_substr vs strstr) 在大 buffer 上的速度
+// 3) grep -E: 有必要字串 (prefilter) / 沒有必要字串 (每行都跑 DFA) / 會讓 backtracking 爆炸的 pattern
+// 4) grep -r: 4000 個檔案的目錄樹,worker 數量 1, 2, 4, ... (到 CPU 核心數,至少到 4)
+// Usage: bench_grep [keyword] [iterations]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "myfs.h"
+#include "search.h"
+#include "utils.h"
+
+// 產生類似 log 的內容,每 500 行一個 ERROR
+static int make_log(char *buf, int size)
+{
+    int n = 0, line = 0;
+    while(n < size - 80)
+    {
+        if(line % 500 == 499) n += sprintf(buf + n, "2024-05-01 12:%02d:%02d ERROR request %d failed: timeout\n", line / 60 % 60, line % 60, line);
+        else n += sprintf(buf + n, "2024-05-01 12:%02d:%02d INFO  request %d served in %d ms\n", line / 60 % 60, line % 60, line, line % 97);
+        line++;
+    }
+    return n;
+}
+
+// 舊的 grep: 整個檔案讀出來再逐行 strstr
+static int old_grep(int fd, const char *key, int size)
+{
+    char *buf = malloc(size + 1);
+    int n = myfs_pread(fd, buf, size, 0);
+    buf[n] = 0;
+    int hits = 0;
+    for(char *line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) if(strstr(line, key)) hits++;
+    free(buf);
+    return hits;
+}
+
+static double gibs(double bytes, uint64_t ns) { return bytes / (1024.0 * 1024 * 1024) / (ns / 1e9); }
+
+int main(int argc, char **argv)
+{
+    const char *key = argc > 1 ? argv[1] : "ERROR";
+    int iters = argc > 2 ? atoi(argv[2]) : 20000;
+    int fsize = 128 * 1024; // 單檔上限
+
+    if(myfs_format("bench_grep.img", 64 * 1024 * 1024, "") != MYFS_OK)
+    {
+        fprintf(stderr, "format failed\n"); return 1;
+    }
+
+    char *log = malloc(fsize);
+    int len = make_log(log, fsize);
+    int fd = myfs_open("/app.log", MYFS_O_RDWR | MYFS_O_CREAT);
+    if(myfs_write(fd, log, len) != len)
+    {
+        fprintf(stderr, "write failed\n"); return 1;
+    }
+    myfs_stat_t st; myfs_fstat(fd, &st);
+
+    // 1) 檔案掃描
+    int hits = 0;
+    uint64_t t0 = now_ns();
+    for(int i = 0; i < iters; i++) hits = grep_inode(st.ino, key, GREP_COUNT, NULL, NULL);
+    uint64_t t1 = now_ns();
+    int old_hits = 0;
+    int old_iters = iters / 10 ? iters / 10 : 1;
+    for(int i = 0; i < old_iters; i++) old_hits = old_grep(fd, key, len);
+    uint64_t t2 = now_ns();
+
+    printf("file  %d bytes, key \"%s\": %d lines\n", len, key, hits);
+    printf("  grep_inode (in place) : %.2f GiB/s\n", gibs((double)len * iters, t1 - t0));
+    printf("  read + strtok/strstr  : %.2f GiB/s (%d lines)\n", gibs((double)len * old_iters, t2 - t1), old_hits);
+
+    // 2) Kernel: 64 MiB 的 buffer,key 只出現在最後
+    int big = 64 * 1024 * 1024;
+    char *hay = malloc(big + 1);
+    for(int off = 0; off < big; off += len) memcpy(hay + off, log, (big - off < len) ? big - off : len);
+    for(int i = 0; i < big; i++) if(hay[i] == key[0]) hay[i] = '_'; // 把原本的候選位置拿掉
+    int m = strlen(key);
+    memcpy(hay + big - m, key, m);
+    hay[big] = 0;
+
+    t0 = now_ns();
+    const char *p = find_substr(hay, big, key, m);
+    t1 = now_ns();
+    const char *q = strstr(hay, key);
+    t2 = now_ns();
+    printf("kernel 64 MiB buffer:\n");
+    printf("  find_substr : %.2f GiB/s%s\n", gibs(big, t1 - t0), p == hay + big - m ? "" : " (WRONG)");
+    printf("  strstr      : %.2f GiB/s%s\n", gibs(big, t2 - t1), q == hay + big - m ? "" : " (WRONG)");
+
+    // 3) regex
+    const char *pats[] = { "request [0-9]+ failed", "(ERROR|FATAL) request", "(a|aa)*(a*)*(b|c)" };
+    char *aaa = malloc(len);
+    memset(aaa, 'a', len); // 一整行的 'a',最後沒有 'b'
+    for(int k = 0; k < 3; k++)
+    {
+        const char *hay2 = (k == 2) ? aaa : log;
+        int rounds = iters / 10 ? iters / 10 : 1;
+        int r = 0;
+        t0 = now_ns();
+        for(int i = 0; i < rounds; i++) r = grep_memory(hay2, len, pats[k], GREP_REGEX | GREP_COUNT, NULL, NULL);
+        t1 = now_ns();
+        printf("regex \"%s\"%s: %.2f GiB/s (%d lines)\n", pats[k], k == 2 ? " on 128 KiB of 'a'" : "",
+               gibs((double)len * rounds, t1 - t0), r);
+    }
+    free(aaa);
+
+    // 4) 目錄樹: 40 個目錄 x 100 個檔案,每個檔案 8 KiB
+    char path[64];
+    long long tree_bytes = 0;
+    for(int d = 0; d < 40; d++)
+    {
+        sprintf(path, "/d%02d", d); myfs_mkdir(path);
+        for(int f = 0; f < 100; f++)
+        {
+            sprintf(path, "/d%02d/f%03d.log", d, f);
+            int tfd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_CREAT);
+            int off = (d * 100 + f) * 97 % (len - 8192);
+            tree_bytes += myfs_write(tfd, log + off, 8192);
+            myfs_close(tfd);
+        }
+    }
+    int maxw = cpu_count() > 4 ? cpu_count() : 4;
+    printf("tree  40 dirs x 100 files, %.1f MiB (%d CPUs):\n", tree_bytes / 1048576.0, cpu_count());
+    for(int w = 1; w <= maxw; w *= 2)
+    {
+        GrepResult *res; int nres = 0, total = 0;
+        int rounds = 20;
+        t0 = now_ns();
+        for(int r = 0; r < rounds; r++)
+        {
+            nres = grep_tree(0, key, 0, w, &res);
+            total = 0;
+            for(int k = 0; k < nres; k++) total += res[k].matches;
+            grep_tree_free(res, nres);
+        }
+        t1 = now_ns();
+        printf("  %2d workers: %.2f GiB/s, %.2f ms per grep -r (%d files, %d lines)\n",
+               w, gibs((double)tree_bytes * rounds, t1 - t0), (t1 - t0) / 1e6 / rounds, nres, total);
+    }
+
+    myfs_close(fd);
+    myfs_unmount();
+    free(log); free(hay);
+    return 0;
+}
@@ -0,0 +1,133 @@
+// Microbenchmark: Trigram 索引
+// 4000 個 8 KiB 的 log 檔 (每個檔案有自己的服務名稱和字彙),比較 grep -r 有/沒有索引的延遲,
+// 以及索引的大小、建立時間、寫入時多花的成本
+// Usage: bench_index [files] [rounds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "myfs.h"
+#include "search.h"
+#include "trigram.h"
+#include "utils.h"
+
+static const char *levels[] = { "INFO ", "INFO ", "INFO ", "DEBUG", "WARN " };
+
+static unsigned rnd(unsigned *s) { *s = *s * 1103515245 + 12345; return *s >> 16; }
+
+// 隨機產生一個像英文單字的字
+static void make_word(char *w, unsigned *seed)
+{
+    static const char *cons = "bcdfghklmnprstvz", *vow = "aeiou";
+    int syl = 2 + rnd(seed) % 3, n = 0;
+    for(int i = 0; i < syl; i++)
+    {
+        w[n++] = cons[rnd(seed) % 16];
+        w[n++] = vow[rnd(seed) % 5];
+    }
+    w[n] = 0;
+}
+
+static int make_file(char *buf, int size, int id, char vocab[][16], int nvocab)
+{
+    unsigned seed = id * 2654435761u;
+    int n = 0, line = 0;
+    while(n < size - 120)
+    {
+        n += sprintf(buf + n, "12:%02d:%02d %s svc%04d", line / 60 % 60, line % 60, levels[rnd(&seed) % 5], id);
+        for(int k = 0; k < 5; k++) n += sprintf(buf + n, " %s", vocab[(id * 7 + rnd(&seed) % 40) % nvocab]);
+        buf[n++] = '\n';
+        line++;
+    }
+    if(id % 100 == 42) n += sprintf(buf + n, "12:59:59 ERROR svc%04d checksum mismatch\n", id); // 1% 的檔案
+    return n;
+}
+
+static double grep_ms(const char *key, int flags, int rounds, int *files, int *lines)
+{
+    uint64_t t0 = now_ns();
+    for(int r = 0; r < rounds; r++)
+    {
+        GrepResult *res;
+        int n = grep_tree(0, key, flags, 1, &res);
+        *files = 0; *lines = 0;
+        for(int k = 0; k < n; k++) if(res[k].matches) { (*files)++; *lines += res[k].matches; }
+        grep_tree_free(res, n);
+    }
+    return (now_ns() - t0) / 1e6 / rounds;
+}
+
+// 用 O_TRUNC 重寫所有檔案 (有索引時多了 hash 的時間)
+static double rewrite_ms(char *buf, int fsize, int nfiles, char vocab[][16])
+{
+    char path[64];
+    uint64_t t0 = now_ns();
+    for(int i = 0; i < nfiles; i++)
+    {
+        sprintf(path, "/d%02d/f%04d.log", i / 100, i);
+        int fd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_TRUNC);
+        int len = make_file(buf, fsize, i, vocab, 2000);
+        myfs_write(fd, buf, len);
+        myfs_close(fd);
+    }
+    return (now_ns() - t0) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+    int nfiles = argc > 1 ? atoi(argv[1]) : 4000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    if(myfs_format("bench_index.img", 64 * 1024 * 1024, "") != MYFS_OK)
+    {
+        fprintf(stderr, "format failed\n"); return 1;
+    }
+
+    char vocab[2000][16];
+    unsigned seed = 1;
+    for(int i = 0; i < 2000; i++) make_word(vocab[i], &seed);
+
+    int fsize = 8192;
+    char *buf = malloc(fsize + 128);
+    char path[64];
+    long long bytes = 0;
+    for(int i = 0; i < nfiles; i++)
+    {
+        if(i % 100 == 0) { sprintf(path, "/d%02d", i / 100); myfs_mkdir(path); }
+        sprintf(path, "/d%02d/f%04d.log", i / 100, i);
+        int fd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_CREAT);
+        int len = make_file(buf, fsize, i, vocab, 2000);
+        if(myfs_write(fd, buf, len) != len) { fprintf(stderr, "write failed\n"); return 1; }
+        bytes += len;
+        myfs_close(fd);
+    }
+
+    double rw_plain = rewrite_ms(buf, fsize, nfiles, vocab);
+    uint64_t t0 = now_ns();
+    tri_enable();
+    uint64_t t1 = now_ns();
+    double rw_index = rewrite_ms(buf, fsize, nfiles, vocab);
+
+    int files; long long ibytes; double fill;
+    tri_stats(&files, &ibytes, &fill);
+    printf("%d files, %.1f MiB of data\n", files, bytes / 1048576.0);
+    printf("index: %lld bytes (%.1f%% of data), %.1f%% bits set, built in %.1f ms\n",
+           ibytes, 100.0 * ibytes / bytes, fill, (t1 - t0) / 1e6);
+    printf("rewrite all files (O_TRUNC): %.1f ms without index, %.1f ms with index\n", rw_plain, rw_index);
+
+    const char *keys[] = { "checksum mismatch", "svc0042", "zzqx", "(ERROR|FATAL) svc[0-9]+ checksum", "INFO" };
+    int kflags[] = { 0, 0, 0, GREP_REGEX, 0 };
+    printf("%-36s %12s %12s %8s %s\n", "grep -r", "scan ms", "index ms", "speedup", "files/lines");
+    for(int k = 0; k < 5; k++)
+    {
+        int f1, l1, f2, l2;
+        tri_disable();
+        double scan = grep_ms(keys[k], kflags[k], rounds, &f1, &l1);
+        tri_enable();
+        double idx = grep_ms(keys[k], kflags[k], rounds, &f2, &l2);
+        printf("%-36s %12.3f %12.3f %7.1fx %d/%d%s\n", keys[k], scan, idx, scan / idx, f2, l2,
+               (f1 == f2 && l1 == l2) ? "" : " (MISMATCH)");
+    }
+
+    myfs_unmount();
+    free(buf);
+    return 0;
+}
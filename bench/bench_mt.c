@@ -0,0 +1,198 @@
+// Stress benchmark: 多個 thread 同時呼叫 libmyfs
+// 每個 thread 有自己的 session (目前目錄 = /tN),混合:
+//   50% pread 共用的檔案 (內容固定,檢查讀到的資料)   20% pwrite 自己的檔案
+//   15% stat 共用的檔案                               10% open/close 自己目錄下的檔案 (相對路徑)
+//    5% 建立 + 寫入 + 刪除暫存檔
+// 依 thread 數列出 ops/sec,最後檢查每個檔案的內容和 Block 的帳是否一致
+// Usage: bench_mt [ms_per_round] [max_threads]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_ms(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+#include "myfs.h"
+#include "fs.h"
+#include "bitmap.h"
+#include "inode.h"
+#include "utils.h"
+
+#define SHARED 32      // 共用檔案數
+#define SHARED_SIZE (16 * 1024)
+#define OWN_SIZE (8 * 1024)
+#define MAX_THREADS 64
+
+typedef struct
+{
+    int id;
+    uint64_t ns;
+    long long ops;
+    int errors;
+    unsigned seed;
+} Worker;
+
+static int stop;
+
+static unsigned rnd(unsigned *s) { *s ^= *s << 13; *s ^= *s >> 17; *s ^= *s << 5; return *s; }
+
+// 共用檔案 f 在 offset i 的內容
+static char shared_byte(int f, int i) { return (char)(f * 7 + i * 13); }
+
+static void *worker(void *arg)
+{
+    Worker *w = arg;
+    myfs_session_t *s = myfs_session_new();
+    myfs_session_use(s);
+    char dir[32], path[64], buf[256], own_name[32];
+    sprintf(dir, "/t%d", w->id);
+    myfs_mkdir(dir);
+    myfs_chdir(dir);
+    sprintf(own_name, "own");
+    int own = myfs_open(own_name, MYFS_O_RDWR | MYFS_O_CREAT); // 相對於 session 的目錄
+    int sfd[2];
+    for(int k = 0; k < 2; k++)
+    {
+        sprintf(path, "/shared/f%02d", (w->id * 2 + k) % SHARED);
+        sfd[k] = myfs_open(path, MYFS_O_RDONLY);
+    }
+    char pattern = (char)('A' + w->id % 26);
+    memset(buf, pattern, sizeof(buf));
+
+    uint64_t t0 = now_ns();
+    long long ops = 0;
+    while(!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        unsigned r = rnd(&w->seed) % 100;
+        if(r < 50)
+        {
+            int k = rnd(&w->seed) & 1, off = rnd(&w->seed) % (SHARED_SIZE - 256);
+            char rb[256];
+            int f = (w->id * 2 + k) % SHARED;
+            if(myfs_pread(sfd[k], rb, 256, off) != 256 || rb[0] != shared_byte(f, off) || rb[255] != shared_byte(f, off + 255)) w->errors++;
+        }
+        else if(r < 70)
+        {
+            int off = rnd(&w->seed) % (OWN_SIZE - 256);
+            if(myfs_pwrite(own, buf, 256, off) != 256) w->errors++;
+        }
+        else if(r < 85)
+        {
+            myfs_stat_t st;
+            sprintf(path, "/shared/f%02d", rnd(&w->seed) % SHARED);
+            if(myfs_stat(path, &st) != MYFS_OK || st.size != SHARED_SIZE) w->errors++;
+        }
+        else if(r < 95)
+        {
+            int fd = myfs_open(own_name, MYFS_O_RDONLY);
+            if(fd < 0) w->errors++; else myfs_close(fd);
+        }
+        else
+        {
+            sprintf(path, "tmp%u", rnd(&w->seed) % 8);
+            int fd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_CREAT);
+            if(fd >= 0)
+            {
+                myfs_write(fd, buf, 256 + rnd(&w->seed) % 2048);
+                myfs_close(fd);
+                myfs_unlink(path);
+            }
+            else if(fd != MYFS_EMFILE) w->errors++;
+        }
+        ops++;
+    }
+    w->ns = now_ns() - t0;
+    w->ops = ops;
+    myfs_close(own); myfs_close(sfd[0]); myfs_close(sfd[1]);
+    myfs_session_use(NULL);
+    myfs_session_free(s);
+    return NULL;
+}
+
+// 自己的檔案只可能有 0 (沒寫過的洞) 或自己的 pattern
+static int check_own(int id)
+{
+    char path[32], buf[OWN_SIZE];
+    sprintf(path, "/t%d/own", id);
+    int fd = myfs_open(path, MYFS_O_RDONLY);
+    int n = myfs_read(fd, buf, OWN_SIZE);
+    myfs_close(fd);
+    for(int i = 0; i < n; i++) if(buf[i] != 0 && buf[i] != (char)('A' + id % 26)) return 0;
+    return 1;
+}
+
+// Bitmap 裡使用中的 Block 數 = 各配置群組的計數加總 = 所有檔案的 Block 數總和
+static int check_blocks()
+{
+    int bits = 0, owned = 0;
+    for(int b = 0; b < sb->total_blocks; b++) if(get_bit(b)) bits++;
+    for(int i = 0; i < sb->total_inodes; i++)
+        if(inode_table[i].is_used && !inode_table[i].is_dir) owned += FILE_BLOCKS(inode_table[i].size);
+    if(bits != blocks_used() || bits != owned)
+    {
+        printf("  block accounting mismatch: bitmap %d, used_blocks %d, owned by files %d\n", bits, blocks_used(), owned);
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    int ms = argc > 1 ? atoi(argv[1]) : 300;
+    int maxt = argc > 2 ? atoi(argv[2]) : (cpu_count() > 8 ? cpu_count() : 8);
+    if(maxt > MAX_THREADS) maxt = MAX_THREADS;
+
+    if(myfs_format("bench_mt.img", 32 * 1024 * 1024, "") != MYFS_OK)
+    {
+        fprintf(stderr, "format failed\n"); return 1;
+    }
+    myfs_mkdir("/shared");
+    char path[64], *data = malloc(SHARED_SIZE);
+    for(int f = 0; f < SHARED; f++)
+    {
+        for(int i = 0; i < SHARED_SIZE; i++) data[i] = shared_byte(f, i);
+        sprintf(path, "/shared/f%02d", f);
+        int fd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_CREAT);
+        myfs_write(fd, data, SHARED_SIZE);
+        myfs_close(fd);
+    }
+    free(data);
+
+    printf("%d CPUs, %d ms per round\n", cpu_count(), ms);
+    int ok = 1;
+    for(int nt = 1; nt <= maxt; nt *= 2)
+    {
+        Worker w[MAX_THREADS];
+        pthread_t th[MAX_THREADS];
+        __atomic_store_n(&stop, 0, __ATOMIC_RELAXED);
+        for(int i = 0; i < nt; i++)
+        {
+            memset(&w[i], 0, sizeof(w[i]));
+            w[i].id = i; w[i].seed = 2463534242u + i * 7919;
+            pthread_create(&th[i], NULL, worker, &w[i]);
+        }
+        sleep_ms(ms);
+        __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+        long long ops = 0; int errors = 0;
+        double secs = 0;
+        for(int i = 0; i < nt; i++)
+        {
+            pthread_join(th[i], NULL);
+            ops += w[i].ops; errors += w[i].errors;
+            if(w[i].ns / 1e9 > secs) secs = w[i].ns / 1e9;
+        }
+        int own_ok = 1;
+        for(int i = 0; i < nt; i++) own_ok &= check_own(i);
+        int blocks_ok = check_blocks();
+        printf("  %2d threads: %9.0f ops/sec (%lld ops, %d errors)%s\n", nt, ops / secs, ops, errors,
+               own_ok && blocks_ok ? "" : " CORRUPTED");
+        ok &= errors == 0 && own_ok && blocks_ok;
+    }
+    myfs_unmount();
+    printf("consistency: %s\n", ok ? "ok" : "FAILED");
+    return !ok;
+}
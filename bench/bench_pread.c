@@ -0,0 +1,54 @@
+// Microbenchmark: 小塊隨機 pread
+// Usage: bench_pread [read_size] [iterations]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "myfs.h"
+#include "utils.h"
+
+int main(int argc, char **argv)
+{
+    int rsize = argc > 1 ? atoi(argv[1]) : 64;
+    int iters = argc > 2 ? atoi(argv[2]) : 5000000;
+    int fsize = 128 * 1024;
+
+    if(myfs_format("bench_pread.img", 4 * 1024 * 1024, "") != MYFS_OK)
+    {
+        fprintf(stderr, "format failed\n"); return 1;
+    }
+
+    // 準備一個寫滿的檔案
+    int fd = myfs_open("/data.bin", MYFS_O_RDWR | MYFS_O_CREAT);
+    char *fill = malloc(fsize);
+    for(int i = 0; i < fsize; i++) fill[i] = (char)(i * 31);
+    if(myfs_write(fd, fill, fsize) != fsize)
+    {
+        fprintf(stderr, "write failed\n"); return 1;
+    }
+
+    // 事先產生隨機 offset,避免把亂數時間算進去
+    int *offs = malloc(sizeof(int) * 4096);
+    srand(42);
+    for(int i = 0; i < 4096; i++) offs[i] = rand() % (fsize - rsize + 1);
+
+    char *buf = malloc(rsize);
+    unsigned long sum = 0;
+    for(int i = 0; i < 10000; i++) myfs_pread(fd, buf, rsize, offs[i & 4095]); // warmup
+
+    uint64_t t0 = now_ns();
+    for(int i = 0; i < iters; i++)
+    {
+        int n = myfs_pread(fd, buf, rsize, offs[i & 4095]);
+        sum += (unsigned char)buf[n - 1];
+    }
+    uint64_t t1 = now_ns();
+
+    double ns = (double)(t1 - t0) / iters;
+    printf("pread size=%d iters=%d: %.1f ns/op, %.2f Mops/s, %.1f MB/s (checksum %lu)\n",
+           rsize, iters, ns, 1e3 / ns, rsize * 1e3 / ns, sum);
+
+    myfs_close(fd);
+    myfs_unmount();
+    free(fill); free(offs); free(buf);
+    return 0;
+}
@@ -0,0 +1,166 @@
+// Benchmark: myfs serve (Unix domain socket) 的吞吐量
+// server 在同一個 process 的 thread 裡跑,每個 client thread 有自己的連線,隨機 pread 4 KiB:
+//   single: 一個請求一次來回    batch: 一次送 16 個 (OP_BATCH)
+// 依 client 數列出 ops/sec 和每次來回的平均時間,並檢查讀到的資料
+// Usage: bench_serve [ms_per_round] [max_clients]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_ms(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+#include "myfs.h"
+#include "myfs_client.h"
+#include "server.h"
+#include "utils.h"
+
+#define SOCK "bench_serve.sock"
+#define FILES 16
+#define FILE_SIZE (64 * 1024)
+#define IO 4096
+#define BATCH 16
+#define MAX_CLIENTS 64
+
+typedef struct
+{
+    int id;
+    int batch;
+    uint64_t ns;
+    long long ops, trips;
+    int errors;
+    unsigned seed;
+} Client;
+
+static int stop;
+
+static unsigned rnd(unsigned *s) { *s ^= *s << 13; *s ^= *s >> 17; *s ^= *s << 5; return *s; }
+
+static char file_byte(int f, int i) { return (char)(f * 31 + i * 7); }
+
+static int check(int f, int off, const char *buf)
+{
+    for(int i = 0; i < IO; i += 512) if(buf[i] != file_byte(f, off + i)) return 0;
+    return 1;
+}
+
+static void *serve_thread(void *arg)
+{
+    (void)arg;
+    myfs_serve(SOCK, 4);
+    return NULL;
+}
+
+static void *client(void *arg)
+{
+    Client *w = arg;
+    myfsc_t *c = myfsc_connect(SOCK);
+    if(!c) { w->errors++; return NULL; }
+    int fds[FILES];
+    char path[32];
+    for(int f = 0; f < FILES; f++)
+    {
+        sprintf(path, "/f%02d", f);
+        fds[f] = myfsc_open(c, path, MYFS_O_RDONLY);
+    }
+    char *buf = malloc(IO * BATCH);
+    myfsc_op_t ops[BATCH];
+    int file[BATCH];
+    uint64_t t0 = now_ns();
+    while(!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        int n = w->batch ? BATCH : 1;
+        for(int k = 0; k < n; k++)
+        {
+            file[k] = rnd(&w->seed) % FILES;
+            memset(&ops[k], 0, sizeof(ops[k]));
+            ops[k].op = OP_READ; ops[k].fd = fds[file[k]];
+            ops[k].off = (rnd(&w->seed) % (FILE_SIZE / IO)) * IO;
+            ops[k].n = IO; ops[k].out = buf + k * IO;
+        }
+        if(w->batch) { if(myfsc_batch(c, ops, n) < 0) { w->errors++; break; } }
+        else ops[0].status = myfsc_pread(c, ops[0].fd, buf, IO, ops[0].off);
+        for(int k = 0; k < n; k++)
+            if(ops[k].status != IO || !check(file[k], ops[k].off, buf + k * IO)) w->errors++;
+        w->ops += n;
+        w->trips++;
+    }
+    w->ns = now_ns() - t0;
+    for(int f = 0; f < FILES; f++) myfsc_close(c, fds[f]);
+    myfsc_disconnect(c);
+    free(buf);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int ms = argc > 1 ? atoi(argv[1]) : 300;
+    int maxc = argc > 2 ? atoi(argv[2]) : (cpu_count() > 8 ? cpu_count() : 8);
+    if(maxc > MAX_CLIENTS) maxc = MAX_CLIENTS;
+
+    if(myfs_format("bench_serve.img", 8 * 1024 * 1024, "") != MYFS_OK)
+    {
+        fprintf(stderr, "format failed\n"); return 1;
+    }
+    char path[32], *data = malloc(FILE_SIZE);
+    for(int f = 0; f < FILES; f++)
+    {
+        for(int i = 0; i < FILE_SIZE; i++) data[i] = file_byte(f, i);
+        sprintf(path, "/f%02d", f);
+        int fd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_CREAT);
+        myfs_write(fd, data, FILE_SIZE);
+        myfs_close(fd);
+    }
+    free(data);
+
+    pthread_t srv;
+    pthread_create(&srv, NULL, serve_thread, NULL);
+    myfsc_t *probe = NULL;
+    for(int i = 0; i < 100 && !(probe = myfsc_connect(SOCK)); i++) sleep_ms(10); // 等 server 開始 listen
+    if(!probe)
+    {
+        fprintf(stderr, "cannot connect to server (Linux only)\n"); return 1;
+    }
+    myfsc_disconnect(probe);
+
+    printf("%d CPUs, %d ms per round, %d-byte reads\n", cpu_count(), ms, IO);
+    int ok = 1;
+    for(int batch = 0; batch < 2; batch++)
+    {
+        printf("%s:\n", batch ? "batch of 16" : "single");
+        for(int nc = 1; nc <= maxc; nc *= 2)
+        {
+            Client w[MAX_CLIENTS];
+            pthread_t th[MAX_CLIENTS];
+            __atomic_store_n(&stop, 0, __ATOMIC_RELAXED);
+            for(int i = 0; i < nc; i++)
+            {
+                memset(&w[i], 0, sizeof(w[i]));
+                w[i].id = i; w[i].batch = batch; w[i].seed = 2463534242u + i * 7919;
+                pthread_create(&th[i], NULL, client, &w[i]);
+            }
+            sleep_ms(ms);
+            __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+            long long ops = 0, trips = 0; int errors = 0;
+            double secs = 0;
+            for(int i = 0; i < nc; i++)
+            {
+                pthread_join(th[i], NULL);
+                ops += w[i].ops; trips += w[i].trips; errors += w[i].errors;
+                if(w[i].ns / 1e9 > secs) secs = w[i].ns / 1e9;
+            }
+            printf("  %2d clients: %9.0f ops/sec, %6.1f us per round trip (%d errors)\n",
+                   nc, ops / secs, trips ? secs * 1e6 * nc / trips : 0.0, errors);
+            ok &= errors == 0;
+        }
+    }
+    myfs_serve_stop();
+    pthread_join(srv, NULL);
+    myfs_unmount();
+    printf("data check: %s\n", ok ? "ok" : "FAILED");
+    return !ok;
+}
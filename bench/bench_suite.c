@@ -0,0 +1,408 @@
+// Benchmark suite: 核心操作的吞吐量,調 Block 大小、配置器之類的東西時用來抓退步
+// 每個項目: 準備 (不計時) -> warmup 次 -> reps 次量測,報告 ops/sec 的中位數 / 最小 / 最大 / 標準差、MiB/s、ns/op
+//   alloc    alloc_block + free_block (沿著前一個 Block 往後配)
+//   lookup   myfs_lookup 隨機路徑 (/dNN/fNNNNN)
+//   create   建立 1 KiB 的小檔案再刪掉 (一個 op = 一個檔案)
+//   put      寫 128 KiB 的檔案 (整個檔案一次 myfs_write)
+//   get      讀 128 KiB 的檔案
+//   cat      文字檔 open + 4 KiB 一次讀完 + close
+//   grep     grep_tree 整棵樹找一個不存在的字 (一個 op = 一個檔案)
+//   tree     myfs_readdir 遞迴走過整棵樹 (一個 op = 一個目錄項)
+//   defrag   檔案輪流 append 造成碎片,再 defrag 到完 (一個 op = 搬一個 Block)
+//   save     myfs_sync (整個映像檔寫出)
+//   load     myfs_mount (整個映像檔讀進來)
+// Usage: bench_suite [--size MiB] [--inodes N] [--files N] [--reps N] [--warmup N]
+//                    [--format text|csv|json] [--only name,name...] [--list]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "myfs.h"
+#include "fs.h"
+#include "bitmap.h"
+#include "defrag.h"
+#include "search.h"
+#include "utils.h"
+
+#define IMG "bench_suite.img"
+#define BIG (128 * 1024) // 單檔上限
+#define TEXT 4096
+#define FANOUT 32
+#define MAX_REPS 1000
+
+static int size_mb = 64, inodes = 0, nfiles = 2000, reps = 5, warmup = 1;
+static const char *format = "text", *only = NULL;
+static char *buf;
+static int nbig;          // put / get 的檔案數
+static int *blocks;       // alloc 用
+static char (*paths)[32]; // nfiles 個檔案的路徑
+
+static unsigned rnd(unsigned *s) { *s ^= *s << 13; *s ^= *s >> 17; *s ^= *s << 5; return *s; }
+
+static void fresh()
+{
+    myfs_unmount();
+    myfs_set_inodes(inodes);
+    if(myfs_format(IMG, (long long)size_mb * 1024 * 1024, "") != MYFS_OK) { fprintf(stderr, "format failed\n"); exit(1); }
+}
+
+static void make_dirs()
+{
+    char path[16];
+    for(int d = 0; d < FANOUT; d++) { sprintf(path, "/d%02d", d); myfs_mkdir(path); }
+}
+
+static int write_file(const char *path, const char *data, int n)
+{
+    int fd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_CREAT | MYFS_O_TRUNC);
+    if(fd < 0) return fd;
+    int r = myfs_write(fd, data, n);
+    myfs_close(fd);
+    return r;
+}
+
+// 文字檔: 一行一行的假單字 (grep 要逐行掃)
+static void text_file(char *out, int n, unsigned seed)
+{
+    static const char *words[] = { "block", "inode", "cache", "write", "read", "alloc", "tree", "error", "fs", "dump" };
+    int k = 0;
+    while(k < n - 1)
+    {
+        const char *w = words[rnd(&seed) % 10];
+        int len = (int)strlen(w);
+        if(k + len + 1 >= n) break;
+        memcpy(out + k, w, len);
+        k += len;
+        out[k++] = rnd(&seed) % 8 ? ' ' : '\n';
+    }
+    while(k < n) out[k++] = '\n';
+}
+
+// nfiles 個檔案分散在 FANOUT 個目錄 (size = 0: 空檔案)
+static void make_files(int size, int text)
+{
+    make_dirs();
+    for(int f = 0; f < nfiles; f++)
+    {
+        if(text) text_file(buf, size, f + 1);
+        if(write_file(paths[f], buf, size) < 0) { fprintf(stderr, "%s: %s\n", paths[f], "image full (use --size or --files)"); exit(1); }
+    }
+}
+
+// ---- 各項目: setup 在所有量測之前做一次,prep 在每一次量測之前做 (都不計時) ----
+
+static void alloc_setup() { fresh(); }
+static long long alloc_blocks_run(long long *bytes)
+{
+    int n = sb->total_blocks / 2;
+    for(int i = 0; i < n; i++) blocks[i] = alloc_block(i ? blocks[i - 1] + 1 : 0);
+    for(int i = 0; i < n; i++) free_block(blocks[i]);
+    *bytes = 0;
+    return n;
+}
+
+static void lookup_setup() { fresh(); make_files(0, 0); }
+static long long lookup_run(long long *bytes)
+{
+    unsigned seed = 12345;
+    int n = 200000, bad = 0;
+    for(int i = 0; i < n; i++) if(myfs_lookup(paths[rnd(&seed) % nfiles]) < 0) bad++;
+    if(bad) fprintf(stderr, "lookup: %d misses\n", bad);
+    *bytes = 0;
+    return n;
+}
+
+static void create_setup() { fresh(); make_dirs(); memset(buf, 'c', 1024); }
+static long long create_run(long long *bytes)
+{
+    for(int f = 0; f < nfiles; f++) write_file(paths[f], buf, 1024);
+    for(int f = 0; f < nfiles; f++) myfs_unlink(paths[f]);
+    *bytes = (long long)nfiles * 1024;
+    return nfiles;
+}
+
+static void big_path(char *path, int i) { sprintf(path, "/big%04d", i); }
+static void put_setup() { fresh(); memset(buf, 'p', BIG); }
+static void put_prep()
+{
+    char path[32];
+    for(int i = 0; i < nbig; i++) { big_path(path, i); myfs_unlink(path); }
+}
+static long long put_run(long long *bytes)
+{
+    char path[32];
+    for(int i = 0; i < nbig; i++) { big_path(path, i); write_file(path, buf, BIG); }
+    *bytes = (long long)nbig * BIG;
+    return nbig;
+}
+
+static void get_setup() { put_setup(); long long b; put_run(&b); }
+static long long get_run(long long *bytes)
+{
+    char path[32];
+    for(int i = 0; i < nbig; i++)
+    {
+        big_path(path, i);
+        int fd = myfs_open(path, MYFS_O_RDONLY);
+        myfs_pread(fd, buf, BIG, 0);
+        myfs_close(fd);
+    }
+    *bytes = (long long)nbig * BIG;
+    return nbig;
+}
+
+static void text_setup() { fresh(); make_files(TEXT, 1); }
+static long long cat_run(long long *bytes)
+{
+    long long total = 0;
+    for(int f = 0; f < nfiles; f++)
+    {
+        int fd = myfs_open(paths[f], MYFS_O_RDONLY), n;
+        while((n = myfs_read(fd, buf, 4096)) > 0) total += n;
+        myfs_close(fd);
+    }
+    *bytes = total;
+    return nfiles;
+}
+
+static long long grep_run(long long *bytes)
+{
+    GrepResult *res;
+    int n = grep_tree(0, "zzqx", GREP_COUNT, 1, &res);
+    grep_tree_free(res, n);
+    *bytes = (long long)nfiles * TEXT;
+    return n;
+}
+
+static void tree_setup() { fresh(); make_files(0, 0); }
+static long long walk(const char *dir)
+{
+    myfs_dirent_t ent;
+    int cookie = 0;
+    long long n = 0;
+    char path[64];
+    while(myfs_readdir(dir, &cookie, &ent) == 1)
+    {
+        n++;
+        if(!ent.is_dir) continue;
+        snprintf(path, sizeof(path), "%s/%s", strcmp(dir, "/") ? dir : "", ent.name);
+        n += walk(path);
+    }
+    return n;
+}
+static long long tree_run(long long *bytes) { *bytes = 0; return walk("/"); }
+
+// 每個檔案 8 KiB,輪流 append 1 KiB,Block 散在整個磁碟上
+static void defrag_setup() { fresh(); make_dirs(); }
+static void defrag_prep()
+{
+    for(int f = 0; f < nfiles; f++) myfs_unlink(paths[f]);
+    for(int c = 0; c < 8; c++)
+        for(int f = 0; f < nfiles; f++)
+        {
+            int fd = myfs_open(paths[f], MYFS_O_WRONLY | MYFS_O_CREAT | MYFS_O_APPEND);
+            memset(buf, 'a' + (f + c) % 26, 1024);
+            myfs_write(fd, buf, 1024);
+            myfs_close(fd);
+        }
+    for(int f = 0; f < nfiles; f += 3) myfs_unlink(paths[f]); // 留一些空洞
+}
+static long long defrag_run(long long *bytes)
+{
+    DefragStats st;
+    long long moved = 0;
+    do { defrag_step(0, 0, &st); moved += st.moved_blocks; } while(!st.done);
+    *bytes = moved * BLOCK_SIZE;
+    return moved;
+}
+
+// 映像檔一半是資料
+static void save_setup()
+{
+    fresh();
+    memset(buf, 's', BIG);
+    char path[32];
+    for(int i = 0; i < nbig; i++) { big_path(path, i); write_file(path, buf, BIG); }
+}
+static long long save_run(long long *bytes)
+{
+    if(myfs_sync() != MYFS_OK) fprintf(stderr, "save failed\n");
+    *bytes = (long long)size_mb * 1024 * 1024;
+    return 1;
+}
+static void load_setup() { save_setup(); myfs_sync(); }
+static long long load_run(long long *bytes)
+{
+    if(myfs_mount(IMG, "") != MYFS_OK) fprintf(stderr, "load failed\n");
+    *bytes = (long long)size_mb * 1024 * 1024;
+    return 1;
+}
+
+typedef struct
+{
+    const char *name, *unit;
+    void (*setup)();
+    void (*prep)();
+    long long (*run)(long long *bytes); // 回傳 op 數
+} Bench;
+
+static const Bench benches[] =
+{
+    { "alloc",  "block",  alloc_setup,  NULL,        alloc_blocks_run },
+    { "lookup", "lookup", lookup_setup, NULL,        lookup_run },
+    { "create", "file",   create_setup, NULL,        create_run },
+    { "put",    "file",   put_setup,    put_prep,    put_run },
+    { "get",    "file",   get_setup,    NULL,        get_run },
+    { "cat",    "file",   text_setup,   NULL,        cat_run },
+    { "grep",   "file",   text_setup,   NULL,        grep_run },
+    { "tree",   "entry",  tree_setup,   NULL,        tree_run },
+    { "defrag", "block",  defrag_setup, defrag_prep, defrag_run },
+    { "save",   "image",  save_setup,   NULL,        save_run },
+    { "load",   "image",  load_setup,   NULL,        load_run },
+};
+#define NUM_BENCHES (int)(sizeof(benches) / sizeof(benches[0]))
+
+typedef struct
+{
+    const Bench *b;
+    long long ops, bytes;   // 每次量測
+    double med, min, max, sd; // ops/sec
+    double mib, ns_op;      // 中位數那次的 MiB/s、ns/op
+} Result;
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int selected(const char *name)
+{
+    if(!only) return 1;
+    int len = (int)strlen(name);
+    for(const char *p = only; *p; )
+    {
+        const char *e = strchr(p, ',');
+        int n = e ? (int)(e - p) : (int)strlen(p);
+        if(n == len && strncmp(p, name, n) == 0) return 1;
+        if(!e) break;
+        p = e + 1;
+    }
+    return 0;
+}
+
+static void measure(const Bench *b, Result *r)
+{
+    static double rate[MAX_REPS];
+    b->setup();
+    for(int w = 0; w < warmup; w++)
+    {
+        if(b->prep) b->prep();
+        b->run(&r->bytes);
+    }
+    double sum = 0, sq = 0;
+    for(int i = 0; i < reps; i++)
+    {
+        if(b->prep) b->prep();
+        uint64_t t0 = now_ns();
+        r->ops = b->run(&r->bytes);
+        double secs = (now_ns() - t0) / 1e9;
+        rate[i] = secs > 0 ? r->ops / secs : 0;
+        sum += rate[i]; sq += rate[i] * rate[i];
+    }
+    qsort(rate, reps, sizeof(double), cmp_double);
+    r->b = b;
+    r->med = reps % 2 ? rate[reps / 2] : (rate[reps / 2 - 1] + rate[reps / 2]) / 2;
+    r->min = rate[0];
+    r->max = rate[reps - 1];
+    double mean = sum / reps;
+    r->sd = reps > 1 ? sqrt(fmax(0, (sq - reps * mean * mean) / (reps - 1))) : 0;
+    r->ns_op = r->med > 0 ? 1e9 / r->med : 0;
+    r->mib = r->ops && r->med > 0 ? (double)r->bytes / r->ops * r->med / 1048576.0 : 0;
+}
+
+static void print_result(const Result *r, int first)
+{
+    if(strcmp(format, "csv") == 0)
+        printf("%s,%s,%lld,%lld,%.1f,%.1f,%.1f,%.1f,%.2f,%.1f\n", r->b->name, r->b->unit, r->ops, r->bytes,
+               r->med, r->min, r->max, r->sd, r->mib, r->ns_op);
+    else if(strcmp(format, "json") == 0)
+        printf("%s    {\"name\":\"%s\",\"unit\":\"%s\",\"ops\":%lld,\"bytes\":%lld,\"ops_per_sec\":{\"median\":%.1f,\"min\":%.1f,\"max\":%.1f,\"stddev\":%.1f},\"mib_per_sec\":%.2f,\"ns_per_op\":%.1f}",
+               first ? "" : ",\n", r->b->name, r->b->unit, r->ops, r->bytes, r->med, r->min, r->max, r->sd, r->mib, r->ns_op);
+    else
+    {
+        printf("  %-7s %13.0f %-7s %6.1f%% %12.1f", r->b->name, r->med, r->b->unit, r->med > 0 ? 100 * r->sd / r->med : 0.0, r->ns_op);
+        if(r->mib > 0) printf(" %10.1f", r->mib);
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [--size MiB] [--inodes N] [--files N] [--reps N] [--warmup N]\n"
+           "          [--format text|csv|json] [--only name,name...] [--list]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--size") == 0 && i + 1 < argc) size_mb = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--inodes") == 0 && i + 1 < argc) inodes = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--files") == 0 && i + 1 < argc) nfiles = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--reps") == 0 && i + 1 < argc) reps = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--format") == 0 && i + 1 < argc) format = argv[++i];
+        else if(strcmp(argv[i], "--only") == 0 && i + 1 < argc) only = argv[++i];
+        else if(strcmp(argv[i], "--list") == 0)
+        {
+            for(int b = 0; b < NUM_BENCHES; b++) printf("%s\n", benches[b].name);
+            return 0;
+        }
+        else { usage(argv[0]); return 1; }
+    }
+    if(size_mb < 1 || size_mb > 2047 || nfiles < 1 || reps < 1 || reps > MAX_REPS || warmup < 0 ||
+       (strcmp(format, "text") && strcmp(format, "csv") && strcmp(format, "json")))
+    {
+        usage(argv[0]); return 1;
+    }
+
+    // 映像檔的大小決定 put / get / save 用幾個大檔案 (一半的空間)
+    nbig = (int)((long long)size_mb * 1024 * 1024 / 2 / BIG);
+    if(nbig < 1) nbig = 1;
+    buf = malloc(BIG);
+    blocks = malloc(sizeof(int) * (size_t)size_mb * 1024);
+    paths = malloc(sizeof(*paths) * nfiles);
+    for(int f = 0; f < nfiles; f++) sprintf(paths[f], "/d%02d/f%05d", f % FANOUT, f);
+
+    fresh();
+    int total_inodes = sb->total_inodes, total_blocks = sb->total_blocks;
+    if(strcmp(format, "csv") == 0)
+        printf("name,unit,ops,bytes,ops_per_sec_median,ops_per_sec_min,ops_per_sec_max,ops_per_sec_stddev,mib_per_sec,ns_per_op\n");
+    else if(strcmp(format, "json") == 0)
+        printf("{\"config\":{\"size_mib\":%d,\"block_size\":%d,\"blocks\":%d,\"inodes\":%d,\"files\":%d,\"reps\":%d,\"warmup\":%d},\n  \"results\":[\n",
+               size_mb, BLOCK_SIZE, total_blocks, total_inodes, nfiles, reps, warmup);
+    else
+    {
+        printf("%d MiB image, %d blocks of %d bytes, %d inodes, %d files, %d reps (+%d warmup)\n",
+               size_mb, total_blocks, BLOCK_SIZE, total_inodes, nfiles, reps, warmup);
+        printf("  %-7s %13s %-7s %7s %12s %10s\n", "bench", "ops/sec", "(per)", "stddev", "ns/op", "MiB/s");
+    }
+
+    int first = 1;
+    for(int b = 0; b < NUM_BENCHES; b++)
+    {
+        if(!selected(benches[b].name)) continue;
+        Result r;
+        memset(&r, 0, sizeof(r));
+        measure(&benches[b], &r);
+        print_result(&r, first);
+        first = 0;
+    }
+    if(strcmp(format, "json") == 0) printf("\n  ]}\n");
+    myfs_unmount();
+    remove(IMG);
+    free(buf); free(blocks); free(paths);
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Microbenchmark: sync (Host 檔案 -> VFS 檔案,只重寫有變的 Block)
+// 128 KiB 的檔案每輪改一個 byte 再 sync,跟整個重寫 (O_TRUNC + write) 比較時間和寫入的 Block 數
+// 並確認: put 之後同一秒內改過、大小不變的檔案不會被當成沒變; 前面插入整數個 Block 只改指標
+// Usage: bench_sync [rounds]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utime.h>
+#include "myfs.h"
+#include "hostsync.h"
+#include "utils.h"
+
+#define HOST "bench_sync.host"
+#define SIZE (128 * 1024)
+
+static unsigned char data[SIZE + 4096];
+
+static void write_host(int n)
+{
+    FILE *fp = fopen(HOST, "wb");
+    fwrite(data, 1, n, fp);
+    fclose(fp);
+}
+
+// VFS 的內容要跟 data 的前 n bytes 一樣
+static int same_as_host(const char *path, int n)
+{
+    static unsigned char buf[SIZE + 4096];
+    int fd = myfs_open(path, MYFS_O_RDONLY);
+    int got = myfs_pread(fd, buf, sizeof(buf), 0);
+    myfs_close(fd);
+    return got == n && memcmp(buf, data, n) == 0;
+}
+
+static int fail(const char *what)
+{
+    fprintf(stderr, "FAILED: %s\n", what);
+    remove(HOST);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    if(myfs_format("bench_sync.img", 16 * 1024 * 1024, "") != MYFS_OK) { fprintf(stderr, "format failed\n"); return 1; }
+    srand(1);
+    for(int i = 0; i < SIZE; i++) data[i] = rand();
+    SyncStats st;
+
+    // put: VFS 的 mtime 是匯入的時間,接著馬上改 Host 檔案 (同一秒、同樣大小)
+    write_host(SIZE);
+    int fd = myfs_open("/f", MYFS_O_WRONLY | MYFS_O_CREAT | MYFS_O_TRUNC);
+    myfs_write(fd, data, SIZE);
+    myfs_close(fd);
+    data[SIZE / 2] ^= 0xff;
+    write_host(SIZE);
+    if(host_sync(HOST, "/f", &st) != MYFS_OK || st.skipped || st.written != 1 || !same_as_host("/f", SIZE))
+        return fail("edit right after put was skipped");
+
+    // mtime 是以前的: 第一次比對內容,之後大小和 mtime 都沒變就跳過
+    struct utimbuf old = { 1000000000, 1000000000 };
+    utime(HOST, &old);
+    if(host_sync(HOST, "/f", &st) != MYFS_OK || st.skipped || st.written) return fail("resync of an unchanged file");
+    if(host_sync(HOST, "/f", &st) != MYFS_OK || !st.skipped) return fail("unchanged file was not skipped");
+
+    // 同一秒內改了又 sync,不能被當成沒變
+    data[100] ^= 0xff;
+    write_host(SIZE);
+    if(host_sync(HOST, "/f", &st) != MYFS_OK || st.skipped || !same_as_host("/f", SIZE)) return fail("edit in the same second");
+    data[200] ^= 0xff;
+    write_host(SIZE);
+    if(host_sync(HOST, "/f", &st) != MYFS_OK || st.skipped || !same_as_host("/f", SIZE)) return fail("second edit in the same second");
+
+    // 前面插入 1 KiB: 後面的 Block 只改指標
+    memmove(data + 1024, data, SIZE - 1024);
+    for(int i = 0; i < 1024; i++) data[i] = rand();
+    write_host(SIZE);
+    if(host_sync(HOST, "/f", &st) != MYFS_OK || st.moved != SIZE / 1024 - 1 || st.written != 1 || !same_as_host("/f", SIZE))
+        return fail("block-aligned insert");
+
+    // 每輪改一個 byte
+    long long written = 0;
+    uint64_t t0 = now_ns();
+    for(int r = 0; r < rounds; r++)
+    {
+        data[(r * 7919) % SIZE] ^= 0x5a;
+        write_host(SIZE);
+        if(host_sync(HOST, "/f", &st) != MYFS_OK) return fail("sync");
+        written += st.written;
+    }
+    double t_sync = (now_ns() - t0) / 1e9;
+    if(!same_as_host("/f", SIZE)) return fail("content after sync rounds");
+
+    // 對照: 每輪整個重寫
+    t0 = now_ns();
+    for(int r = 0; r < rounds; r++)
+    {
+        data[(r * 7919) % SIZE] ^= 0x5a;
+        write_host(SIZE);
+        FILE *fp = fopen(HOST, "rb");
+        static unsigned char buf[SIZE];
+        fread(buf, 1, SIZE, fp);
+        fclose(fp);
+        fd = myfs_open("/g", MYFS_O_WRONLY | MYFS_O_CREAT | MYFS_O_TRUNC);
+        myfs_write(fd, buf, SIZE);
+        myfs_close(fd);
+    }
+    double t_full = (now_ns() - t0) / 1e9;
+
+    printf("%d rounds of a 1-byte edit in a %d KiB file\n", rounds, SIZE / 1024);
+    printf("  sync:         %8.1f us/round, %.2f blocks written/round\n", t_sync * 1e6 / rounds, (double)written / rounds);
+    printf("  full rewrite: %8.1f us/round, %d blocks written/round\n", t_full * 1e6 / rounds, SIZE / 1024);
+    printf("checks: ok\n");
+    remove(HOST);
+    myfs_unmount();
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Benchmark: 背景 writeback 對前景寫入的影響
+// 幾個 thread 一直 pwrite 4 KiB 到自己的檔案,比較三種存檔方式:
+//   none: 不存檔          sync: 每隔一段時間 myfs_sync (整個映像檔,寫的時候全部停住)
+//   writeback: 背景 checkpoint (只寫變動的部分,寫 Block 時前景照常)
+// 列出 ops/sec、單次寫入最長被擋多久,以及 writeback 寫了多少、凍結多久、COW 幾次
+// Usage: bench_writeback [ms_per_round] [interval_ms] [threads]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#define sleep_ms(ms) Sleep(ms)
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#endif
+#include "myfs.h"
+#include "writeback.h"
+#include "utils.h"
+
+#define IMG "bench_writeback.img"
+#define IO 4096
+#define FILE_SIZE (128 * 1024) // 單檔上限
+#define MAX_THREADS 16
+
+typedef struct
+{
+    int id;
+    long long ops;
+    uint64_t max_ns;
+    int errors;
+    unsigned seed;
+} Worker;
+
+static int stop;
+
+static unsigned rnd(unsigned *s) { *s ^= *s << 13; *s ^= *s >> 17; *s ^= *s << 5; return *s; }
+
+static void *writer(void *arg)
+{
+    Worker *w = arg;
+    char path[32], buf[IO];
+    sprintf(path, "/w%02d", w->id);
+    int fd = myfs_open(path, MYFS_O_RDWR);
+    if(fd < 0) { w->errors++; return NULL; }
+    while(!__atomic_load_n(&stop, __ATOMIC_RELAXED))
+    {
+        memset(buf, (int)(w->ops & 0xff), IO);
+        uint64_t t0 = now_ns();
+        if(myfs_pwrite(fd, buf, IO, (rnd(&w->seed) % (FILE_SIZE / IO)) * IO) != IO) w->errors++;
+        uint64_t d = now_ns() - t0;
+        if(d > w->max_ns) w->max_ns = d;
+        w->ops++;
+    }
+    myfs_close(fd);
+    return NULL;
+}
+
+// mode: 0 = none, 1 = sync, 2 = writeback
+static int round_run(int mode, int ms, int iv, int nt)
+{
+    Worker w[MAX_THREADS];
+    pthread_t th[MAX_THREADS];
+    if(mode == 2) myfs_writeback(iv, 0);
+    __atomic_store_n(&stop, 0, __ATOMIC_RELAXED);
+    for(int i = 0; i < nt; i++)
+    {
+        memset(&w[i], 0, sizeof(w[i]));
+        w[i].id = i; w[i].seed = 2463534242u + i * 7919;
+        pthread_create(&th[i], NULL, writer, &w[i]);
+    }
+    uint64_t t0 = now_ns(), syncs = 0, sync_ns = 0;
+    while(now_ns() - t0 < (uint64_t)ms * 1000000)
+    {
+        sleep_ms(iv);
+        if(mode != 1) continue;
+        uint64_t s0 = now_ns();
+        myfs_sync();
+        sync_ns += now_ns() - s0; syncs++;
+    }
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    long long ops = 0; uint64_t max_ns = 0; int errors = 0;
+    for(int i = 0; i < nt; i++)
+    {
+        pthread_join(th[i], NULL);
+        ops += w[i].ops; errors += w[i].errors;
+        if(w[i].max_ns > max_ns) max_ns = w[i].max_ns;
+    }
+    double secs = (now_ns() - t0) / 1e9;
+    static const char *names[] = { "none", "sync", "writeback" };
+    printf("  %-10s %9.0f writes/sec, max write %8.2f ms", names[mode], ops / secs, max_ns / 1e6);
+    if(mode == 1) printf(", %llu syncs (%.2f ms each)", (unsigned long long)syncs, syncs ? sync_ns / 1e6 / syncs : 0.0);
+    printf("\n");
+    if(mode == 2)
+    {
+        WbStats st;
+        wb_stats(&st);
+        myfs_writeback(0, 0);
+        printf("             %lld checkpoints, %.1f MiB written, %.2f ms per checkpoint, freeze max %.3f ms, %lld COW copies, lag %.0f ms\n",
+               st.checkpoints, st.bytes / 1048576.0, st.checkpoints ? st.last_ms : 0.0, st.max_freeze_ms, st.cow_copies, st.lag_ms);
+    }
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    int ms = argc > 1 ? atoi(argv[1]) : 1000;
+    int iv = argc > 2 ? atoi(argv[2]) : 50;
+    int nt = argc > 3 ? atoi(argv[3]) : 4;
+    if(iv <= 0) iv = 50;
+    if(nt < 1) nt = 1;
+    if(nt > MAX_THREADS) nt = MAX_THREADS;
+
+    if(myfs_format(IMG, 32 * 1024 * 1024, "bench") != MYFS_OK)
+    {
+        fprintf(stderr, "format failed\n"); return 1;
+    }
+    char path[32], *data = calloc(1, FILE_SIZE);
+    for(int i = 0; i < nt; i++)
+    {
+        sprintf(path, "/w%02d", i);
+        int fd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_CREAT);
+        myfs_write(fd, data, FILE_SIZE);
+        myfs_close(fd);
+    }
+    free(data);
+    myfs_sync();
+
+    printf("%d CPUs, %d threads, %d ms per round, save every %d ms, 32 MiB image\n", cpu_count(), nt, ms, iv);
+    int errors = 0;
+    for(int mode = 0; mode < 3; mode++) errors += round_run(mode, ms, iv, nt);
+
+    // checkpoint 之後映像檔要跟記憶體一樣
+    myfs_writeback(0, 0);
+    wb_checkpoint();
+    char *disk = malloc(FILE_SIZE);
+    int fds[MAX_THREADS];
+    for(int i = 0; i < nt; i++)
+    {
+        sprintf(path, "/w%02d", i);
+        fds[i] = myfs_open(path, MYFS_O_RDONLY);
+    }
+    char *snap = malloc((size_t)FILE_SIZE * nt);
+    for(int i = 0; i < nt; i++) myfs_pread(fds[i], snap + (size_t)i * FILE_SIZE, FILE_SIZE, 0);
+    for(int i = 0; i < nt; i++) myfs_close(fds[i]);
+    myfs_unmount();
+    int ok = errors == 0 && myfs_mount(IMG, "bench") == MYFS_OK;
+    for(int i = 0; ok && i < nt; i++)
+    {
+        sprintf(path, "/w%02d", i);
+        int fd = myfs_open(path, MYFS_O_RDONLY);
+        ok = fd >= 0 && myfs_pread(fd, disk, FILE_SIZE, 0) == FILE_SIZE && memcmp(disk, snap + (size_t)i * FILE_SIZE, FILE_SIZE) == 0;
+        myfs_close(fd);
+    }
+    myfs_unmount();
+    free(disk); free(snap);
+    printf("image check: %s\n", ok ? "ok" : "FAILED");
+    return !ok;
+}
@@ -0,0 +1,18 @@
+#ifndef BACKUP_H
+#define BACKUP_H
+#include <stdint.h>
+
+// 增量/差異備份 (delta): 只匯出 generation 比 since 新的 Inode 和 Block,加上整個 Bitmap
+// since = 0 時匯出全部 (完整備份,可以套用到任何相同大小的映像檔)
+// restore 把 delta 套用到目前的映像檔上,映像檔必須是同一個檔案系統,generation 介於 since 和 until 之間
+typedef struct
+{
+    uint32_t since, until; // delta 涵蓋 (since, until] 的修改
+    int inodes, blocks;    // 筆數
+    long long bytes;       // delta 檔案大小
+} BackupStats;
+
+int backup_export(const char *host_path, uint32_t since, BackupStats *st); // MYFS_OK 或錯誤碼
+int backup_restore(const char *host_path, BackupStats *st);               // MYFS_EINVAL = 不能套用到這個映像檔
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+#include "fs.h"
+
+// 區塊快取 (out-of-core 模式): 映像檔比記憶體大的時候,只有 Superblock、Inode Table、Bitmap 常駐,
+// 資料 Block 用 pread/pwrite 直接讀寫映像檔,記憶體裡最多留 slots 個 (CLOCK 置換)
+// 這個模式下 data_blocks == NULL; 一般模式整個映像檔在記憶體,blk_get 直接回傳 data_blocks 裡的位置
+// 被換出去的髒 Block 當場寫回映像檔,save_fs / checkpoint 時把剩下的寫回 (bc_flush)
+// 注意: 映像檔就是資料本身,沒存檔就結束的話,已經寫回的 Block 會比 Inode Table 新
+
+#define BLK_READ  0 // 只讀
+#define BLK_WRITE 1 // 會修改
+#define BLK_NEW   2 // 整個 Block 都會被覆寫 (不用先從映像檔讀進來)
+
+typedef struct
+{
+    int slots, used, dirty;
+    long long hits, misses;
+    long long fresh;                   // BLK_NEW: 不用讀的 miss
+    long long prefetched, prefetch_hits;
+    long long evictions, writebacks;   // writebacks = 換出時是髒的
+    long long flushed;                 // bc_flush 寫回的 Block
+    long long read_bytes, write_bytes; // 映像檔的 I/O
+    long long reads, writes;           // pread / pwrite 次數 (連續的 Block 一次讀寫)
+} BcStats;
+
+void bc_configure(int slots);   // 下次 load / format 開始生效,0 = 整個映像檔放在記憶體
+int bc_configured();
+// fs.c 用: 打開映像檔 (create = 新建並把長度設成 length),要在 sb 設好之後呼叫
+int bc_open(const char *path, int create, long long length);
+void bc_close();
+int bc_flush();                 // 寫回所有髒的 Block,回傳寫回的數量,-1 = I/O 錯誤
+
+char *bc_get(int bid, int mode);
+void bc_put(int bid, int mode);
+void bc_readahead(const int *bids, int n);              // 先讀進來 (連續的 Block 一次 pread)
+void bc_sequential(int ino, const int *bids, int nblocks, int first, int last); // 讀檔時呼叫: 循序讀就往後預讀
+void bc_stats(BcStats *st);
+void bc_stats_reset();
+
+// 存取 Block 內容: 用完要 blk_put (mode 一樣),這段期間 Block 不會被換出
+static inline char *blk_get(int bid, int mode) { return data_blocks ? data_blocks[bid].data : bc_get(bid, mode); }
+static inline void blk_put(int bid, int mode) { if(!data_blocks) bc_put(bid, mode); }
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef BIO_H
+#define BIO_H
+
+// 批次 I/O: 一次交出一批 pread / pwrite,最多 depth 個同時在跑,全部做完才回來
+// 後端: io_uring (Linux,直接用系統呼叫,不需要 liburing); 不能用的時候改用 thread pool 做 pread / pwrite
+// 每個 thread 有自己的 io_uring,不用互相等
+
+#define BIO_AUTO    0 // io_uring,不行就 thread pool
+#define BIO_URING   1
+#define BIO_THREADS 2
+#define BIO_SYNC    3 // 呼叫的 thread 自己一個一個做 (depth 沒有作用)
+
+typedef struct
+{
+    int write;
+    void *buf;
+    int len;
+    long long pos;
+    int res;       // 做完: 讀寫的 bytes,< 0 = 錯誤
+} BioReq;
+
+int bio_configure(int backend, int depth); // 回傳實際用的後端 (io_uring 不能用就是 BIO_THREADS)
+int bio_backend();
+int bio_depth();
+const char *bio_name(int backend);
+int bio_parse(const char *name);           // "uring" / "threads" / "sync" / "auto",-1 = 不認得
+int bio_run(int fd, BioReq *reqs, int n);  // 回傳沒有完整讀寫的數量 (讀到檔尾也算)
+void bio_shutdown();                       // 停掉 thread pool
+
+// 單一個 pread / pwrite (Windows 沒有,用 seek + read/write 代替)
+long long bio_pread(int fd, void *buf, long long n, long long pos);
+long long bio_pwrite(int fd, const void *buf, long long n, long long pos);
+
+#endif
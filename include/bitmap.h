@@ -5,11 +5,23 @@
 extern Superblock *sb;
 extern uint8_t *block_bitmap; 
 
+// 配置群組的大小 (8 MiB),必須是 8 的倍數
+#define AG_BLOCKS 8192
+
 // Bit Operation
 void set_bit(int i); // which is occupied
 void clear_bit(int i); // which is released
 int get_bit(int i);
-int find_free_block(); 
+
+int alloc_block(int goal); // 從 goal 附近配一個 Block (goal 所在的群組優先),-1 = 沒有空間
+int find_free_block();     // 不指定位置
 void free_block(int block_id);
+int alloc_run(int n);      // 連續 n 個空 Block (磁碟重組用),-1 = 沒有夠長的空段
+int claim_block(int block_id); // 配置指定的空 Block,成功回傳 1
+int ag_goal(int dir_id);   // 目錄的 home group 的第一個 Block (目錄裡新檔案的 goal)
+int ag_count();
+int blocks_used();         // 使用中的 Block 數 (各群組加總)
+void alloc_reset();        // Bitmap 整個換掉後 (load, format, restore) 要呼叫,重算各群組
+void alloc_free();
 
-#endif
\ No newline at end of file
+#endif
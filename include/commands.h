@@ -1,9 +1,12 @@
 #ifndef COMMANDS_H
 #define COMMANDS_H
+#include <stdint.h>
+#include "find.h"
+#include "workload.h"
 
 // Basic Command
-void cmd_ls();
-void cmd_ll();
+void cmd_ls(char *path, int sort, int offset, int limit); // sort: MYFS_SORT_*, limit < 0 = 全部
+void cmd_ll(char *path, int sort, int offset, int limit);
 void cmd_mkdir(char *name);
 void cmd_cd(char *name);
 void cmd_touch(char *name);
@@ -15,30 +18,45 @@ void cmd_cp(char *src, char *dest);
 void cmd_cat(char *name);
 void cmd_pwd();
 
+// Multi-operand (一次處理多個檔案)
+void cmd_mkdir_list(int n, char **names);
+void cmd_touch_list(int n, char **names);
+void cmd_rm_list(int n, char **names);
+void cmd_mv_into(int n, char **srcs, char *dir);
+void cmd_cp_into(int n, char **srcs, char *dir);
+
 // Exchange with host
 void cmd_put(char *host_filename);
 void cmd_get(char *fs_filename);
+void cmd_sync(char *host_path, char *vfs_path);
+void cmd_backup(uint32_t since, char *host_path);
+void cmd_restore(char *host_path);
 
 // Extend Command
 void cmd_append(char *name, char *text);
 void cmd_nano(char *name);
-void cmd_grep(char *keyword, char *filename);
+void cmd_grep(int flags, char *keyword, int nfiles, char **files);
 
 // Advanced Command
-void cmd_tree();
+void cmd_tree(char *path);
 void cmd_stat(char *name);
-void cmd_find(char *name);
+void cmd_find(char *dir, FindQuery *q, char *newer);
 void cmd_encrypt(char *filename, char *key);
 void cmd_chmod(char *mode, char *name);
 void cmd_status();
-void cmd_defrag();
+void cmd_index(char *mode);
+void cmd_defrag(int64_t budget_ns, int max_blocks); // <= 0 = 不限
+void cmd_writeback(int off, int interval_ms, int dirty_blocks); // 都是 0 = 顯示狀態
 void cmd_help();
 
 // Visualization
-void cmd_diskmap();
+void cmd_diskmap(int json, int reset);
+void cmd_stats(int json, int reset, int on); // on = 1 / 0 開關,-1 = 顯示
+void cmd_replay_report(const char *trace, const WlReport *rep, int json); // myfs replay 的結果
 void cmd_hexdump(char *name);
 void cmd_run(char *name);
 
-void import_host_file(char *host_path, char *vfs_name);
+int import_host_file(char *host_path, char *vfs_name);
+int write_file_data(char *vfs_name, const char *data, int len, int append);
 
 #endif
\ No newline at end of file
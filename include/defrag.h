@@ -0,0 +1,42 @@
+#ifndef DEFRAG_H
+#define DEFRAG_H
+#include <stdint.h>
+
+// 磁碟重組 (原地,可分段執行)
+// 只搬有碎片的檔案 (Block 不連續): 找一段夠長的連續空 Block (first fit),整個檔案搬過去再釋放舊的
+// 每次呼叫處理到時間或 Block 數用完為止,下次從上次停下的 Inode 繼續
+
+#define FRAG_BUCKETS 8 // 長度的分布: 1, 2-3, 4-7, ..., 128 以上 (2 的次方分組)
+
+typedef struct
+{
+    int files;        // 有資料的檔案
+    int fragmented;   // 超過一個 extent 的檔案
+    int extents;      // 所有檔案的 extent (連續 Block 段) 總數
+    int free_blocks;
+    int free_runs;    // 空 Block 分成幾段
+    int largest_free; // 最長的連續空段
+    int max_extents;
+    int ext_hist[FRAG_BUCKETS];         // 檔案數,依 extent 數分組
+    int free_hist[FRAG_BUCKETS];        // 空段數,依長度分組
+    int free_hist_blocks[FRAG_BUCKETS]; // 各組空段的 Block 總數
+} FragReport;
+
+typedef struct
+{
+    int moved_files, moved_blocks;
+    int skipped;      // 找不到夠長的空段,這一輪先跳過
+    int over_budget;  // 比 max_blocks 還大,跳過 (搬移量不會超過 max_blocks)
+    int cursor;       // 下次從這個 Inode 開始
+    int done;         // 1 = 這一輪已經掃完全部的 Inode (cursor 回到 0)
+} DefragStats;
+
+void frag_report(FragReport *r);
+int file_extents(int idx); // 檔案有幾個 extent (0 = 沒有資料)
+int frag_bucket(int n);    // n (>= 1) 屬於第幾組
+
+// budget_ns <= 0: 不限時間; max_blocks <= 0: 不限搬移的 Block 數 (有限制時 moved_blocks 不會超過它)
+void defrag_step(int64_t budget_ns, int max_blocks, DefragStats *st);
+void defrag_reset(); // load / format 後呼叫 (從頭開始)
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#define MAX_ARGS 64
+#define CMD_EXIT 1 // handler 回傳這個代表要離開 shell
+
+// 指令處理函式: argv[0] 是指令名稱
+typedef int (*cmd_handler)(int argc, char **argv);
+
+typedef struct
+{
+    const char *name;
+    int min_args;      // 不含指令本身
+    int max_args;      // -1 = 不限
+    cmd_handler fn;
+    const char *usage;
+} CommandEntry;
+
+extern int batch_mode; // 非互動模式 (nano 等需要 terminal 的指令不能用)
+
+int split_args(char *line, char **argv, int max); // 切割參數,支援 "..." 引號
+const CommandEntry *lookup_command(const char *name);
+int dispatch_line(char *line);                    // 切割 + 查表 + 執行,回傳 CMD_EXIT 代表離開
+
+// --record: 執行過的指令換成 trace (格式見 workload.h) 附加到檔案,回傳 0 = 成功
+int record_open(const char *path);
+void record_write(const char *file, int len, int append); // 重導向 (> / >>) 寫入的檔案
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef FIND_H
+#define FIND_H
+#include <time.h>
+
+// find 的搜尋條件,沒設定的欄位不限制
+typedef struct
+{
+    const char *name;  // glob (* ? [...]),NULL = 不限
+    int type;          // 'f' / 'd',0 = 不限
+    long long min_size, max_size; // 檔案大小範圍 (bytes,含端點),max_size < 0 = 不限
+    time_t newer;      // mtime 要比這個晚,0 = 不限
+} FindQuery;
+
+void find_query_init(FindQuery *q);
+
+// Shell-style glob: * 任意字串, ? 任一字元, [abc] [a-z] [!x] 字元集合
+int glob_match(const char *pat, const char *s);
+
+// 找出 dir 底下 (不含 dir 本身) 所有符合的 Inode,依路徑排序
+// 有名稱條件時查 Name Index,否則 nthreads 個 worker 平行掃描 Inode Table
+// 回傳個數,*out 用完要 free
+int find_run(int dir, const FindQuery *q, int nthreads, int **out);
+
+#endif
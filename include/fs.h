@@ -2,17 +2,43 @@
 #define FS_H
 #include "fs_defs.h"
 #include <stdint.h>
+#include <stdio.h>
+
+// 映像檔 (和 backup 檔) 的位置一律用 64-bit: 可以超過 2 GiB,Windows 的 long 只有 32-bit
+#ifdef _WIN32
+#define fseek64(fp, pos, whence) _fseeki64(fp, pos, whence)
+#define ftell64(fp) _ftelli64(fp)
+#else
+#define fseek64(fp, pos, whence) fseeko(fp, (off_t)(pos), whence) // 32-bit 平台靠 -D_FILE_OFFSET_BITS=64
+#define ftell64(fp) ((long long)ftello(fp))
+#endif
 
 extern Superblock *sb;
 extern Inode *inode_table;
 extern DiskBlock *data_blocks;
 extern uint8_t *block_bitmap;
 
-extern int current_dir_id;
-extern char current_path[256];
+// 目前目錄屬於 session: 每個 thread 可以用 myfs_session_use 綁定自己的 session,沒綁定的用預設的 (shell 用這個)
+// current_dir_id / current_path 是目前 thread 的 session 的欄位
+struct myfs_session
+{
+    int cwd;
+    char path[256];
+};
+typedef struct myfs_session Session;
+extern Session default_session;
+extern __thread Session *cur_session;
+static inline Session *session_cur() { return cur_session ? cur_session : &default_session; }
+#define current_dir_id (session_cur()->cwd)
+#define current_path   (session_cur()->path)
+extern char image_path[256];               // 映像檔路徑 (預設 my_fs.dump)
+extern int format_inodes;                  // format_fs 的 Inode 數,0 = 依大小 (每 BLOCKS_PER_INODE 個 Block 一個)
 
-void init_fs(int size, int load_from_file); // create or read
-void save_fs(const char *filename);         // 存檔 (Dump)
-void defrag_system();                       // 磁碟重組
+void init_fs(long long size, int load_from_file); // create or read (shell 用,失敗會結束程式)
+int load_fs(const char *path);              // 讀取映像檔,回傳 MYFS_OK 或錯誤碼
+int format_fs(long long size);              // 建立新分割區,回傳 MYFS_OK 或錯誤碼 (太大 MYFS_EFBIG)
+long long fs_total_size(void);              // 分割區大小 (bytes)
+void free_fs();
+int save_fs(const char *filename);          // 存檔 (Dump)
 
 #endif
\ No newline at end of file
@@ -6,9 +6,11 @@
 
 #define MAX_CMD_LEN 256
 #define MAX_FILENAME 32
-#define MAX_FILES 100 // Inode 數量
+#define MIN_INODES 100 // Inode 數量下限 (舊的映像檔固定是 100 個)
+#define BLOCKS_PER_INODE 4 // 新分割區每 4 個 Block 配一個 Inode
 #define BLOCK_SIZE 1024
 #define MAX_BLOCKS_PER_FILE 128 // 最大檔案大小 128KB
+#define FS_MAX_BLOCKS (1 << 30) // 分割區最多 2^30 個 Block (1 TiB),Block 編號和 Bitmap 的計算都是 int
 
 // Superblock,global info.
 typedef struct 
@@ -32,8 +34,13 @@ typedef struct
     int parent_id; // 目錄結構
     int size;
     int blocks[MAX_BLOCKS_PER_FILE]; // 儲存data block的索引列表
-    time_t created_at; // 建立時間 (not used)
+    // 時間戳記: 1970 年起的秒數 (uint32 到 2106 年),0 = 舊映像檔沒有記錄
+    // 以前這裡是一個 8-byte 的 time_t 加上前後的對齊空間,四個 uint32 剛好放得下,Inode 大小不變 (舊映像檔可以直接讀)
+    uint32_t crtime; // 建立時間
+    uint32_t mtime;  // 內容最後修改時間
+    uint32_t ctime;  // Inode 最後修改時間 (內容、名稱、位置、權限)
     int permission; // 權限設定(like chmod)
+    uint32_t atime;  // 最後讀取時間 (relatime: 見 inode_accessed)
 } Inode;
 
 // DiskBlock,data block
@@ -0,0 +1,35 @@
+#ifndef GEN_H
+#define GEN_H
+#include <stdio.h>
+#include <stdint.h>
+
+// Generation number: shell 每執行一個指令 (library 每次 myfs_sync) 加一
+// 每個 Inode 和 Block 記錄最後一次被修改時的 generation,backup --since 只要匯出比較新的部分
+extern uint32_t fs_generation;
+extern uint64_t fs_id;       // 檔案系統的身分 (format 時隨機產生),restore 時確認 delta 屬於同一個檔案系統
+extern uint32_t *inode_gen;  // sb->total_inodes 個
+extern uint32_t *block_gen;  // sb->total_blocks 個
+
+void gen_reset(); // format / load 之後呼叫 (全部歸 0,generation 從 1 開始)
+void gen_free();
+void gen_bump();
+
+// 讀取時更新 atime 也會呼叫 (同一個 Inode 可能同時被多個 thread 讀),用 atomic 寫入
+static inline void gen_inode(int idx) { __atomic_store_n(&inode_gen[idx], fs_generation, __ATOMIC_RELAXED); } // Inode 被修改
+// writeback 用: gen_checkpoint 是最近一次 checkpoint 凍結時的 generation,之後才變髒的 Block 算進 gen_dirty
+extern uint32_t gen_checkpoint;
+extern int gen_dirty;
+
+// Block 內容被修改
+static inline void gen_block(int bid)
+{
+    if(block_gen[bid] <= __atomic_load_n(&gen_checkpoint, __ATOMIC_RELAXED)) __atomic_fetch_add(&gen_dirty, 1, __ATOMIC_RELAXED);
+    block_gen[bid] = fs_generation;
+}
+
+// 映像檔: 接在 Bitmap 後面的可選區段,舊的映像檔沒有這段就當作全部都是 generation 0
+#define GEN_SECTION "GEN1"
+void gen_save(FILE *fp);
+int gen_load(FILE *fp); // 標籤已經讀過了,壞掉時回傳 -1
+
+#endif
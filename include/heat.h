@@ -0,0 +1,17 @@
+#ifndef HEAT_H
+#define HEAT_H
+#include <stdint.h>
+
+// 每個 Block 的讀寫次數 (diskmap 的 heatmap 用),只記在記憶體,從 mount 開始算
+// 檔案內容的讀寫 (read/write/grep/cp/sync) 才算,defrag、backup 這類維護動作不算
+// 同一個檔案可以被多個 thread 同時讀 (libmyfs),讀取的計數器用 atomic 加
+extern uint32_t *block_reads;
+extern uint32_t *block_writes;
+
+void heat_reset(); // format / load 之後呼叫,diskmap --reset 也會清掉
+void heat_free();
+
+static inline void heat_read(int bid)  { __atomic_fetch_add(&block_reads[bid], 1, __ATOMIC_RELAXED); }
+static inline void heat_write(int bid) { block_writes[bid]++; } // 寫入時拿著 Inode 的 write lock
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef HOSTSYNC_H
+#define HOSTSYNC_H
+#include <stdint.h>
+
+// sync: 把 Host 的檔案同步到 VFS,只重寫內容有變的 Block
+// 大小和 mtime 都跟上次同步時一樣就直接跳過 (同步完 VFS 檔案的 mtime 會設成 Host 檔案的 mtime)
+// 只有 sync 自己寫進去的 mtime 才算數 (put 蓋的是匯入的時間,同一秒內改過的 Host 檔案會被當成沒變)
+// 每個舊 Block 算一個 weak hash (Adler-32) + strong hash (64-bit),新內容逐個 Block 比對:
+// 同位置沒變的不動,搬到別的位置的只改 Block 指標,其他的才寫入 (優先重用沒用到的舊 Block)
+// 限制: 新內容只在 Block 邊界上比對,不像 rsync 逐 byte 滾動 weak hash; 檔案是對齊的 Block 指標陣列,
+// 對不齊的相同內容沒辦法只改指標,還是要重寫,所以插入/刪除不是 1 KiB 的倍數時,後面的 Block 全部重寫
+typedef struct
+{
+    int skipped;   // 大小和 mtime 都相同,沒有比對內容
+    int size;      // 同步後的檔案大小
+    int blocks;    // 檔案的 Block 數
+    int unchanged; // 原地不動的 Block
+    int moved;     // 只改指標的 Block
+    int written;   // 重寫的 Block
+    int freed;     // 多出來而釋放的 Block
+} SyncStats;
+
+int host_sync(const char *host_path, const char *vfs_path, SyncStats *st); // MYFS_OK 或錯誤碼
+
+// 每個 Inode 上次 sync 寫進去的 Host mtime (0 = 沒有,一定比對內容),只記在記憶體
+// 內容被其他方式改過 (inode_modified) 或 Inode 重新建立就清掉
+// Host mtime 跟 sync 同一秒 (或更新) 時不記: 那一秒之內再改,大小和 mtime 都可能不變
+extern uint32_t *sync_mtime;
+void sync_reset(); // format / load / restore 之後呼叫
+void sync_free();
+static inline void sync_forget(int idx) { if(sync_mtime) sync_mtime[idx] = 0; }
+
+#endif
@@ -7,8 +7,24 @@ extern Superblock *sb;
 
 // Inode Operation
 int find_free_inode(); 
-int find_inode_by_name(char *name, int dir_id); // 在指定目錄下找檔名
+int find_free_inode_from(int start); // 從 start 往後找 (一次建立多個檔案時用)
+int find_inode_by_name(const char *name, int dir_id); // 在指定目錄下找檔名
 int check_permission(int inode_idx, int mode); 
 void recursive_delete(int inode_idx); // 遞迴刪除 (針對目錄,for rm -r)
 
+// 檔案擁有的 Block 數一律由 size 決定
+#define FILE_BLOCKS(sz) (((sz)+BLOCK_SIZE-1)/BLOCK_SIZE)
+#define MAX_FILE_SIZE (MAX_BLOCKS_PER_FILE*BLOCK_SIZE)
+
+// 檔案內容存取 (直接在 Block 與呼叫者的 buffer 間複製)
+int inode_create(int parent_id, const char *name, int is_dir, int start); // 回傳 Inode 編號,-1 = 沒有空 Inode
+int inode_read(int idx, void *buf, int n, int off);        // 回傳讀到的 bytes
+int inode_write(int idx, const void *buf, int n, int off); // 回傳寫入的 bytes,-1 = 空間不足
+int inode_truncate(int idx, int size);                     // -1 = 空間不足
+
+// 時間戳記
+void inode_modified(int idx); // 內容改變: mtime = ctime = now (inode_write / inode_truncate 會呼叫)
+void inode_changed(int idx);  // 只有 Inode 改變 (改名、搬移、chmod): ctime = now
+void inode_accessed(int idx); // 讀取 (relatime): atime 比 mtime/ctime 舊或超過一天才更新,平常的讀取不會動到 Inode
+
 #endif
\ No newline at end of file
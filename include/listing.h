@@ -0,0 +1,15 @@
+#ifndef LISTING_H
+#define LISTING_H
+
+// 排序過的目錄列表 (ls 用),可以分頁
+// 每個 (目錄, 排序方式) 排好的結果會被快取,目錄版本號沒變時翻頁只要 O(page)
+#define LS_BY_NAME 0
+#define LS_BY_SIZE 1 // 大的在前
+#define LS_BY_TIME 2 // mtime 新的在前
+#define LS_REVERSE 0x10
+
+// 把 dir 排序後的第 offset 筆開始、最多 limit 筆 Inode 編號放進 out (limit < 0 = 全部)
+// 回傳放了幾筆,*total 是目錄裡的總數 (out 為 NULL 時只回傳總數)
+int dir_list(int dir, int sort, int offset, int limit, int *out, int *total);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef LOCK_H
+#define LOCK_H
+
+// libmyfs 的鎖 (shell 本身是單執行緒,只有 myfs_* API 會拿這些鎖)
+// ns_lock:    命名空間 (路徑解析、建立、刪除、改名、chmod),解析路徑拿 read,改變命名空間拿 write
+// Inode 的鎖: 檔案內容與大小,讀取拿 read,寫入/截斷/刪除拿 write
+// 內部的小鎖: Block 配置 (bitmap.c)、Dentry cache、路徑 cache、ls 的排序快取,各自在模組裡
+// 順序: ns_lock -> Inode 的鎖 -> 內部的小鎖,反過來拿會 deadlock
+
+void locks_reset(); // format / load 之後呼叫 (依 Inode 數配置)
+void locks_free();
+
+void ns_rdlock();
+void ns_wrlock();
+void ns_unlock();
+
+void inode_rdlock(int idx);
+void inode_wrlock(int idx);
+void inode_unlock(int idx);
+int fd_lock_inode(int fd, int write); // libmyfs 的 fd 所在的 Inode 上鎖 (myfs.c),回傳 Inode 編號或 MYFS_EBADF,用 inode_unlock 解開
+
+// shell 的指令直接改內部資料,不拿上面的鎖; 背景 writeback 凍結時用這把鎖跟整個指令錯開
+// 順序: cmd_lock -> ns_lock -> ...
+void cmd_lock();
+void cmd_unlock();
+int cmd_trylock();   // 拿到回傳 1
+
+// 存檔時整個檔案系統都不能動 (ns_lock + 全部 Inode 的 write lock)
+void locks_all();
+void unlock_all();
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef MYFS_H
+#define MYFS_H
+
+// libmyfs: 給其他程式直接呼叫的檔案系統 API (不經過 shell,不印任何東西)
+// 所有函式失敗時回傳負的錯誤碼 (MYFS_E*),路徑可為絕對 (/a/b) 或相對於目前目錄
+// 可以從多個 thread 同時呼叫 (mount/format/unmount 除外): 讀取可以平行,寫不同檔案也可以平行
+// 同一個 fd 給多個 thread 用時,read/write 的 offset 誰先誰後不保證 (跟 POSIX 一樣,要固定位置請用 pread/pwrite)
+
+// Error codes
+#define MYFS_OK            0
+#define MYFS_ENOENT       -2   // 找不到檔案或目錄
+#define MYFS_EIO          -5   // Host 端讀寫失敗
+#define MYFS_EBADF        -9   // 無效的 file handle
+#define MYFS_ENOMEM      -12   // 記憶體不足
+#define MYFS_EACCES      -13   // 權限不足 / 密碼錯誤
+#define MYFS_EEXIST      -17   // 已存在
+#define MYFS_ENOTDIR     -20   // 路徑中間不是目錄
+#define MYFS_EISDIR      -21   // 是目錄
+#define MYFS_EINVAL      -22   // 參數錯誤
+#define MYFS_EMFILE      -24   // 開啟的檔案太多
+#define MYFS_EFBIG       -27   // 超過單檔上限
+#define MYFS_ENOSPC      -28   // 沒有空的 Block / Inode
+#define MYFS_ENAMETOOLONG -36  // 檔名太長
+#define MYFS_ENOTEMPTY   -39   // 目錄不是空的
+
+// open flags
+#define MYFS_O_RDONLY  0x0
+#define MYFS_O_WRONLY  0x1
+#define MYFS_O_RDWR    0x2
+#define MYFS_O_ACCMODE 0x3
+#define MYFS_O_CREAT   0x40
+#define MYFS_O_EXCL    0x80
+#define MYFS_O_TRUNC   0x200
+#define MYFS_O_APPEND  0x400
+
+// lseek whence
+#define MYFS_SEEK_SET 0
+#define MYFS_SEEK_CUR 1
+#define MYFS_SEEK_END 2
+
+// myfs_listdir 的排序方式
+#define MYFS_SORT_NAME    0
+#define MYFS_SORT_SIZE    1    // 大的在前
+#define MYFS_SORT_TIME    2    // 新的在前
+#define MYFS_SORT_REVERSE 0x10
+
+#define MYFS_MAX_OPEN 65536 // 同時開啟的檔案數 (fd 表用到才配置)
+#define MYFS_NAME_MAX 32
+
+typedef struct
+{
+    int ino;
+    int is_dir;
+    int size;
+    int blocks;      // 佔用的 Block 數
+    int permission;  // 4=R 2=W 1=X
+    int parent;
+    long long mtime, ctime, atime, crtime; // 1970 年起的秒數,0 = 沒有記錄 (舊映像檔)
+} myfs_stat_t;
+
+typedef struct
+{
+    int ino;
+    int is_dir;
+    int size;
+    int permission;
+    long long mtime;
+    char name[MYFS_NAME_MAX];
+} myfs_dirent_t;
+
+// 掛載 / 建立 / 存檔
+int myfs_mount(const char *image, const char *password);
+int myfs_format(const char *image, long long size, const char *password); // size 是 bytes,超過 1 TiB 或記憶體放不下回傳 MYFS_EFBIG
+int myfs_sync(void);      // 寫回映像檔
+void myfs_unmount(void);  // 不存檔直接卸載 (要存檔先呼叫 myfs_sync)
+// 背景 writeback: 每 interval_ms 毫秒或髒的 Block 超過 dirty_blocks 個就把變動的部分寫回映像檔 (0 = 不用這個條件)
+// 兩個都是 0 = 停止; 寫回時其他 thread 照常讀寫,不用等 I/O
+int myfs_writeback(int interval_ms, int dirty_blocks);
+// Block 快取 (out-of-core): 之後 mount / format 的映像檔只有 metadata 放在記憶體,
+// 資料 Block 用到才從映像檔讀,最多留 blocks 個 (映像檔可以比記憶體大); 0 = 整個讀進記憶體 (預設)
+void myfs_set_cache(int blocks);
+// 快取預讀 / 寫回和 writeback 的批次 I/O: backend = "uring" / "threads" / "sync" / "auto" (NULL = 不改),
+// depth = 同時在跑的 I/O 數 (0 = 不改); 不認得的 backend 回傳 MYFS_EINVAL
+int myfs_set_io(const char *backend, int depth);
+// 之後 format 的 Inode 數 (0 = 依大小,每 4 個 Block 一個); Inode 太多放不下 Block 時 format 回傳 MYFS_EINVAL
+void myfs_set_inodes(int count);
+// 延遲統計 (每個操作的直方圖,shell 的 stats 指令): 預設關閉,打開後每個事件多幾 ns
+void myfs_set_stats(int on);
+
+// 檔案 I/O (資料直接複製到呼叫者的 buffer)
+int myfs_open(const char *path, int flags);
+int myfs_close(int fd);
+int myfs_read(int fd, void *buf, int n);
+int myfs_write(int fd, const void *buf, int n);
+int myfs_pread(int fd, void *buf, int n, int offset);
+int myfs_pwrite(int fd, const void *buf, int n, int offset);
+int myfs_lseek(int fd, int offset, int whence);
+int myfs_ftruncate(int fd, int size);
+
+// Metadata
+int myfs_lookup(const char *path); // 回傳 Inode 編號
+int myfs_stat(const char *path, myfs_stat_t *st);
+int myfs_fstat(int fd, myfs_stat_t *st);
+int myfs_readdir(const char *path, int *cookie, myfs_dirent_t *ent); // 1 = 有下一筆, 0 = 結束 (cookie 從 0 開始)
+// 排序後的一頁: 第 offset 筆開始最多 limit 筆,回傳筆數,*total = 目錄裡的總數 (排序結果有快取,翻頁不會重新排序)
+int myfs_listdir(const char *path, int sort, int offset, int limit, myfs_dirent_t *ents, int *total);
+int myfs_mkdir(const char *path);
+int myfs_unlink(const char *path);
+int myfs_rmdir(const char *path);
+int myfs_rename(const char *src, const char *dest);
+int myfs_chmod(const char *path, int mode);
+
+// 目前目錄 (相對路徑的起點),屬於目前 thread 綁定的 session
+int myfs_chdir(const char *path);
+int myfs_getcwd(char *buf, int size);
+
+// Session: 各自的目前目錄 (多個 thread/client 同時使用時,每個都要有自己的 session)
+// 沒有綁定 session 的 thread 共用預設的 session
+typedef struct myfs_session myfs_session_t;
+myfs_session_t *myfs_session_new(void);        // 目前目錄是 /
+void myfs_session_free(myfs_session_t *s);
+void myfs_session_use(myfs_session_t *s);      // 綁定到目前的 thread,NULL = 改回預設的 session
+
+const char *myfs_strerror(int err);
+
+#endif
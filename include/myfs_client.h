@@ -0,0 +1,39 @@
+#ifndef MYFS_CLIENT_H
+#define MYFS_CLIENT_H
+
+// myfs serve 的 client: 每個函式送一個請求、等一個回應,回傳值跟 libmyfs 相同 (失敗是負的 MYFS_E*)
+// 一個連線不能同時給多個 thread 使用 (每個 thread 自己 connect)
+// 路徑相對於這個連線自己的目前目錄 (一開始是 /),fd 只在這個連線裡有效
+#include "myfs.h"
+#include "proto.h"
+
+typedef struct myfsc myfsc_t;
+
+myfsc_t *myfsc_connect(const char *socket_path); // 失敗回傳 NULL
+void myfsc_disconnect(myfsc_t *c);
+
+int myfsc_lookup(myfsc_t *c, const char *path);
+int myfsc_stat(myfsc_t *c, const char *path, myfs_stat_t *st);
+int myfsc_open(myfsc_t *c, const char *path, int flags);
+int myfsc_close(myfsc_t *c, int fd);
+int myfsc_pread(myfsc_t *c, int fd, void *buf, int n, int offset);
+int myfsc_pwrite(myfsc_t *c, int fd, const void *buf, int n, int offset);
+int myfsc_listdir(myfsc_t *c, const char *path, int offset, int limit, myfs_dirent_t *ents, int *total); // 依檔名排序
+int myfsc_mkdir(myfsc_t *c, const char *path);
+int myfsc_unlink(myfsc_t *c, const char *path);
+int myfsc_sync(myfsc_t *c);
+
+// 一次送出好幾個請求 (一次來回),每個的結果放在 status
+typedef struct
+{
+    int op;            // OP_LOOKUP ... OP_SYNC (不能是 OP_BATCH)
+    int fd, off, n;    // OP_OPEN: n = flags; OP_READ: 最多讀 n bytes; OP_WRITE: 寫 n bytes; OP_READDIR: 最多 n 筆
+    const char *path;
+    const void *data;  // OP_WRITE 的資料
+    void *out;         // OP_READ: n bytes; OP_STAT: myfs_stat_t; OP_READDIR: n 個 myfs_dirent_t
+    int status;
+} myfsc_op_t;
+
+int myfsc_batch(myfsc_t *c, myfsc_op_t *ops, int count); // MYFS_OK 或連線錯誤
+
+#endif
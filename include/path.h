@@ -0,0 +1,35 @@
+#ifndef PATH_H
+#define PATH_H
+#include "fs_defs.h"
+
+#define MAX_PATH_LEN 1024
+
+// Dentry cache: (parent, name) -> Inode,查詢時不用每層都掃整個 Inode Table
+void dcache_reset();                              // load / format 後呼叫
+int dcache_lookup(int parent_id, const char *name); // -1 = 不在 cache
+void dcache_insert(int parent_id, const char *name, int idx);
+void dcache_invalidate(int idx);                  // mv / rm 時呼叫
+
+// 路徑解析 (/a/b/c, ../x, ./y),base 是相對路徑的起點
+// 回傳 Inode 編號;最後一層不存在時回傳 MYFS_ENOENT 並填 parent/leaf (給建立檔案用)
+int path_resolve(const char *path, int base, int *parent, char *leaf);
+
+// Name index: 所有檔名排序後的索引 (find 用),查詢檔名或檔名開頭不用掃整個 Inode Table
+// 建立/改名/刪除只把 Inode 記到待處理清單,待處理的太多時才合併進排序好的陣列
+void names_touch(int idx); // Inode 的名稱、位置或使用狀態改變 (inode_create, dcache_invalidate 會呼叫)
+// 對每個名稱符合 glob 的 Inode 呼叫 cb (不保證順序,其他條件呼叫者自己確認)
+// glob 有固定開頭時只看排序陣列中的那一段,否則掃過整個索引 (比掃 Inode Table 緊湊很多)
+void names_glob(const char *pat, void (*cb)(void *ctx, int idx), void *ctx);
+
+// 目錄的版本號 (快取的目錄列表用來判斷是否過期)
+// dir_changed: 子項目新增/刪除/改名/搬入; dir_data_changed: 子檔案的大小或時間改變
+void dir_changed(int dir);
+void dir_data_changed(int dir);
+unsigned dir_gen(int dir);
+unsigned dir_data_gen(int dir);
+
+// Inode -> 完整路徑 (有 cache,目錄被搬移/刪除時整批失效)
+// 多執行緒時: 回傳的字串在命名空間改變之前有效 (呼叫者拿著 ns_lock)
+const char *inode_path(int idx);
+
+#endif
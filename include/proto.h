@@ -0,0 +1,44 @@
+#ifndef PROTO_H
+#define PROTO_H
+#include <stdint.h>
+
+// myfs serve 的傳輸格式 (Unix domain socket,只給同一台機器用,所以直接用本機的 byte order 和 struct)
+// 每個請求: MsgReq + len bytes 的 payload; 每個回應: MsgResp + len bytes 的 payload
+// 同一個連線的回應照請求的順序回來,tag 原樣帶回 (client 用來對應)
+
+#define PROTO_MAGIC 0x4D594653u   // "MYFS",連線後 client 先送 4 bytes
+#define PROTO_MAX_PAYLOAD (256 * 1024)
+
+// op: payload / 回應
+#define OP_LOOKUP  1  // path            -> status = Inode 編號
+#define OP_STAT    2  // path            -> myfs_stat_t
+#define OP_OPEN    3  // path, n = flags -> status = fd (關連線時自動關掉)
+#define OP_CLOSE   4  // fd
+#define OP_READ    5  // fd, off, n      -> 讀到的資料 (pread)
+#define OP_WRITE   6  // fd, off, data   -> status = 寫入的 bytes (pwrite)
+#define OP_READDIR 7  // path, off = 第幾筆開始, n = 最多幾筆 -> int total + myfs_dirent_t[] (依檔名排序)
+#define OP_MKDIR   8  // path
+#define OP_UNLINK  9  // path
+#define OP_SYNC   10  // 寫回映像檔
+#define OP_BATCH  11  // payload = 好幾個請求 (不能再包 BATCH) -> 依序的回應,一次來回
+#define OP_MAX    11
+
+typedef struct
+{
+    uint32_t len;  // payload 長度
+    uint32_t tag;
+    uint16_t op;
+    uint16_t flags; // 保留,填 0
+    int32_t fd;
+    int32_t off;
+    int32_t n;
+} MsgReq;
+
+typedef struct
+{
+    uint32_t len;
+    uint32_t tag;
+    int32_t status; // >= 0 成功,< 0 是 MYFS_E* 錯誤碼
+} MsgResp;
+
+#endif
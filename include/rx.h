@@ -0,0 +1,27 @@
+#ifndef RX_H
+#define RX_H
+
+// 簡單的 Regular Expression 引擎 (grep -E 用)
+// 支援: 字元 . [...] [^...] \d \w \s (大寫為反向),* + ? {m,n},| (),^ $
+// Pattern 先編成 NFA,比對時才逐步建立 DFA (狀態數有上限,滿了就清掉重建),
+// 每個字元只查一次表,不會 backtracking,最差也是線性時間
+// 同一個 Regex 不能同時給多個 thread 使用 (DFA cache 會被修改)
+
+#define RX_MATCHED -1 // rx_step / rx_begin: 這一行已經確定符合
+
+typedef struct Regex Regex;
+
+Regex *rx_compile(const char *pattern, char *err, int errlen); // 失敗回傳 NULL,err 放錯誤訊息
+void rx_free(Regex *rx);
+
+// 每個符合的字串都一定包含的字串 (給 prefilter 先用 find_substr 跳過不可能的區域),沒有時 *len = 0
+const char *rx_literal(const Regex *rx, int *len);
+
+// 逐段餵一行的資料 (一行可以分好幾次餵,不含 '\n')
+int rx_begin(Regex *rx);                                // 行首的狀態
+int rx_step(Regex *rx, int state, const char *p, int n); // 回傳新的狀態
+int rx_end(Regex *rx, int state);                       // 行尾: 1 = 符合
+
+int rx_match(Regex *rx, const char *line, int n);       // 整行一次比對
+
+#endif
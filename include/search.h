@@ -0,0 +1,37 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#define GREP_COUNT   0x1 // -c: 只計算符合的行數,不輸出
+#define GREP_LINENO  0x2 // -n: 計算行號
+#define GREP_RECURSE 0x4 // -r: 搜尋整個目錄樹 (shell 用)
+#define GREP_REGEX   0x8 // -E: key 是 regular expression (見 rx.h)
+
+// 每找到一行就呼叫一次 (line 不含 '\n',只在呼叫期間有效)
+typedef void (*grep_line_cb)(void *ctx, int lineno, const char *line, int len);
+
+// 在一段記憶體中找子字串 (SSE2 首尾字元過濾,沒有 SSE2 時用 Boyer-Moore-Horspool)
+const char *find_substr(const char *hay, int n, const char *needle, int m);
+
+// 直接在 Block 上逐段掃描檔案 (不複製整個檔案),回傳符合的行數 (regex 編譯失敗回傳 -1)
+int grep_inode(int idx, const char *key, int flags, grep_line_cb cb, void *ctx);
+// 同上,掃描一段連續記憶體 (Pipe 的輸入)
+int grep_memory(const char *buf, int len, const char *key, int flags, grep_line_cb cb, void *ctx);
+
+
+// grep -r 的結果: 每個檔案一筆,依路徑排序
+typedef struct
+{
+    int ino;
+    int flags;
+    char *path;
+    int matches; // 符合的行數
+    char *out;   // 已格式化好的輸出 ("path:[lineno:]line\n"),GREP_COUNT 時是空的
+    int len, cap;
+} GrepResult;
+
+// 遞迴搜尋 dir 底下所有可讀的檔案,nthreads 個 worker 平行掃描 (work stealing)
+// 回傳檔案數,*res 用完要呼叫 grep_tree_free
+int grep_tree(int dir, const char *key, int flags, int nthreads, GrepResult **res);
+void grep_tree_free(GrepResult *res, int n);
+
+#endif
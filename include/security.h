@@ -2,7 +2,12 @@
 #define SECURITY_H
 
 // 加密/解密 (Use XOR)
-void xor_cipher(void *data, int size, const char *key);
+void xor_cipher(void *data, long long size, const char *key);
+// 只處理大 buffer 中的一段: pos = 這段在原本 buffer 裡的位置 (金鑰從這裡接著用)
+void xor_cipher_at(void *data, int size, const char *key, long long pos);
+// 非互動模式時由命令列帶入的密碼 (NULL = 從 terminal 詢問)
+extern const char *preset_password;
+
 // Check Password
 int check_password(const char *stored_pwd);
 // Set Password
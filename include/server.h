@@ -0,0 +1,12 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+// myfs serve: 把已掛載的映像檔透過 Unix domain socket 提供給多個 client (格式見 proto.h)
+// 一個 epoll 的 event loop 負責 accept 和等資料,有資料的連線交給 worker pool 處理
+// 每個連線有自己的 session (目前目錄) 和自己開的 fd,斷線時自動關掉
+// 只支援 Linux,其他平台回傳 MYFS_EINVAL
+
+int myfs_serve(const char *socket_path, int workers); // 直到 myfs_serve_stop 才回傳 (不會自動存檔); socket_path 已經是別的檔案回傳 MYFS_EEXIST
+void myfs_serve_stop(void);                           // 可以在 signal handler 裡呼叫
+
+#endif
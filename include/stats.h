@@ -0,0 +1,115 @@
+#ifndef STATS_H
+#define STATS_H
+#include <stdint.h>
+#include "utils.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// 延遲統計: 每個操作 (shell 指令、server 請求、核心函式) 一個 HDR 式的直方圖 + 次數 / 總時間 / 最大值 / bytes
+// 直方圖: 2 的次方分段,每段再切 8 格 (誤差 < 12.5%),值是 TSC tick (x86) 或 ns,報表時換成 ns
+// 每個 thread 寫自己的一份 (不用 lock、不用 atomic 指令),stats_snapshot 時加總
+// 關掉時每個事件只多一次判斷 stats_on; 讀時鐘本身要 7~25 ns (VM 比較慢),所以很短的核心操作
+// 用 stats_begin_sampled: 次數和 bytes 每次都算,時間每 ST_SAMPLE 次量一次 (平均約幾 ns)
+
+#define ST_SUB_BITS 3
+#define ST_BUCKETS ((40 - ST_SUB_BITS + 1) << ST_SUB_BITS) // 到 2^40 tick,再大的算在最後一格
+#define ST_MAX_OPS 96
+#define ST_SAMPLE 16 // 2 的次方
+
+// 固定的核心操作,指令和請求用 stats_register 接在後面
+enum
+{
+    ST_LOOKUP,      // find_inode_by_name
+    ST_ALLOC,       // alloc_block (find_free_block)
+    ST_BLOCK_READ,  // inode_read 的 Block 複製
+    ST_BLOCK_WRITE, // inode_write 的 Block 複製
+    ST_SAVE,        // save_fs
+    ST_LOAD,        // load_fs
+    ST_FIXED
+};
+
+typedef struct
+{
+    uint64_t count, bytes;
+    uint64_t timed, sum, max; // 有量時間的次數 (抽樣) 和它們的總和 / 最大值
+    uint64_t hist[ST_BUCKETS];
+} StOp;
+
+typedef struct StShard
+{
+    StOp ops[ST_MAX_OPS];
+    struct StShard *next;
+    unsigned seq;       // 抽樣用
+    int free;           // thread 結束了,可以給新的 thread 用 (數字保留)
+} StShard;
+
+typedef struct
+{
+    const char *name;
+    long long count, bytes, timed;
+    double total_ns, mean_ns, p50_ns, p90_ns, p99_ns, p999_ns, max_ns;
+} StatsRow;
+
+extern int stats_on;
+extern __thread StShard *st_shard;
+
+void stats_enable(int on);
+int stats_register(const char *name);        // 同名回傳同一個編號,滿了回傳 -1
+int stats_snapshot(StatsRow *rows, int max); // 有記錄的操作 (依編號),回傳筆數
+void stats_reset();
+StShard *stats_shard_new();
+
+// 時間來源: x86 用 TSC (幾個 ns),其他用單調時鐘
+static inline uint64_t st_clock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return now_ns();
+#endif
+}
+
+static inline int st_bucket(uint64_t v)
+{
+    if(v < (1u << ST_SUB_BITS)) return (int)v;
+    int e = 63 - __builtin_clzll(v); // 最高位元
+    int b = ((e - ST_SUB_BITS + 1) << ST_SUB_BITS) + (int)((v >> (e - ST_SUB_BITS)) & ((1u << ST_SUB_BITS) - 1));
+    return b < ST_BUCKETS ? b : ST_BUCKETS - 1;
+}
+
+// 只有自己的 thread 會寫,用 relaxed load / store 讓 stats_snapshot 同時讀也沒問題 (不會產生 lock 指令)
+#define ST_ADD(x, v) __atomic_store_n(&(x), __atomic_load_n(&(x), __ATOMIC_RELAXED) + (v), __ATOMIC_RELAXED)
+
+static inline StShard *st_self() { return st_shard ? st_shard : stats_shard_new(); }
+
+// timed = 0: 只算次數 (沒抽到)
+static inline void stats_record(int op, int timed, uint64_t ticks, uint64_t bytes)
+{
+    if(op < 0) return;
+    StOp *o = &st_self()->ops[op];
+    ST_ADD(o->count, 1);
+    ST_ADD(o->bytes, bytes);
+    if(!timed) return;
+    ST_ADD(o->timed, 1);
+    ST_ADD(o->sum, ticks);
+    ST_ADD(o->hist[st_bucket(ticks)], 1);
+    if(ticks > __atomic_load_n(&o->max, __ATOMIC_RELAXED)) __atomic_store_n(&o->max, ticks, __ATOMIC_RELAXED);
+}
+
+// 用法: uint64_t t = stats_begin(); ... stats_end(ST_xxx, t, bytes);
+// 回傳值: 0 = 沒開,1 = 只算次數,其他 = 開始的時間
+static inline uint64_t stats_begin() { return __atomic_load_n(&stats_on, __ATOMIC_RELAXED) ? st_clock() : 0; }
+static inline uint64_t stats_begin_sampled()
+{
+    if(!__atomic_load_n(&stats_on, __ATOMIC_RELAXED)) return 0;
+    StShard *s = st_self();
+    return (s->seq++ & (ST_SAMPLE - 1)) ? 1 : st_clock(); // 第一次一定量
+}
+static inline void stats_end(int op, uint64_t t0, uint64_t bytes)
+{
+    if(t0 > 1) stats_record(op, 1, st_clock() - t0, bytes);
+    else if(t0) stats_record(op, 0, 0, bytes);
+}
+
+#endif
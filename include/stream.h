@@ -0,0 +1,27 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+// 記憶體中的輸出緩衝 (for Redirection, Pipeline)
+typedef struct
+{
+    char *data;
+    int len;
+    int cap;
+} Stream;
+
+void stream_init(Stream *s);
+void stream_free(Stream *s);
+void stream_write(Stream *s, const void *buf, int n);
+void stream_printf(Stream *s, const char *fmt, ...);
+
+// 指令輸出: 預設寫到 stdout,capture 時寫進 Stream
+void out_capture(Stream *s); // NULL = 還原成 stdout
+void out_discard(int on);    // 1 = 丟掉原本要印到 stdout 的輸出 (batch --quiet)
+void out_printf(const char *fmt, ...);
+void out_write(const void *buf, int n);
+
+// Pipeline 的輸入 (上一個指令的輸出),沒有 pipe 時為 NULL
+extern const char *pipe_in;
+extern int pipe_in_len;
+
+#endif
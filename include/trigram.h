@@ -0,0 +1,26 @@
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+#include <stdio.h>
+
+// Trigram 索引 (可選,預設關閉): 每個檔案一個固定大小的 signature,
+// 檔案內容裡出現過的每個 3-byte 字串 hash 到其中一個 bit
+// 只會加 bit 不會清 bit (覆寫/縮小檔案後舊的 bit 還在),所以一定是實際內容的超集合:
+// signature 裡缺任何一個 key 的 trigram,這個檔案就一定不含 key,grep 可以整個跳過
+#define TRI_SIG_BYTES 512 // 每個檔案 4096 bits
+
+int tri_enabled();
+void tri_enable();  // 建立索引並掃過現有的所有檔案
+void tri_disable();
+void tri_clear(int idx);                 // 檔案清空/刪除
+void tri_add(int idx, int from, int to); // 把檔案 [from, to) 的內容加進索引 (inode_write 之後呼叫)
+int tri_may_contain(int idx, const char *key, int m); // 0 = 一定不含 key; 沒有索引或 key 太短時回傳 1
+
+// 索引大小 (只算使用中的檔案) 與平均填滿比例 (%)
+void tri_stats(int *files, long long *bytes, double *fill);
+
+// 映像檔: 接在 Bitmap 後面的可選區段,舊的映像檔沒有這段就當作沒有索引
+#define TRI_SECTION "TRI1"
+void tri_save(FILE *fp, const char *password);
+int tri_load(FILE *fp, const char *password); // 標籤已經讀過了,壞掉時回傳 -1 (索引關閉)
+
+#endif
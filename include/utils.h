@@ -9,7 +9,11 @@
 #define C_OK      "\033[1;32m" // 綠色 (成功訊息)
 #define C_WARN    "\033[1;33m" // 黃色 (警告)
 
+#include <stdint.h>
+
 // 跨平台
 void create_host_dir(const char *path);
+uint64_t now_ns(); // 單調時鐘 (奈秒),用來量測指令耗時
+int cpu_count();   // CPU 核心數
 
 #endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+#include <stdio.h>
+#include "stats.h"
+
+// 合成工作負載: 產生指令 trace (wl_generate),再透過 libmyfs 全速重播 (wl_replay),可以 N 個 session 同時跑
+// Trace 是文字檔,一行一個操作,引號外 # 開頭的 token 到行尾是註解,路徑可以是絕對或相對 (相對於該 session 的 cd),有空白的用 "..." 包起來
+//   [@S] op args...     S = session 編號 (沒寫 = 0),重播時 session S % N 負責
+//   mkdir <dir>   rmdir <dir>   cd <dir>   touch <file>   rm <path> (目錄整個刪掉,跟 shell 一樣)   mv <src> <dest>
+//   write <file> <bytes>    建立 / 截斷後寫入      append <file> <bytes>   read <file>   整個讀完
+//   stat <path>   ls <dir>
+//   barrier                 所有 session 都到了才繼續,量測 (時間、次數、延遲) 從這裡重新開始
+// 重播只看大小不看內容; mkdir 已存在不算錯誤 (setup 可以重複)
+
+enum { WL_MKDIR, WL_RMDIR, WL_CD, WL_TOUCH, WL_RM, WL_MV, WL_WRITE, WL_APPEND, WL_READ, WL_STAT, WL_LS, WL_BARRIER, WL_OPS };
+
+// wl_generate 的讀寫比例 (權重)
+enum { WL_MIX_READ, WL_MIX_WRITE, WL_MIX_APPEND, WL_MIX_CREATE, WL_MIX_RM, WL_MIX_STAT, WL_MIX_LS, WL_MIX };
+
+// 檔案大小的分布
+enum { WL_SIZE_FIXED, WL_SIZE_UNIFORM, WL_SIZE_LOGNORMAL };
+
+typedef struct
+{
+    int ops;              // setup 之後的操作數
+    int files;            // 共用的檔案 (setup 建立,不會被刪)
+    int fanout, depth;    // 目錄樹: 每層 fanout 個,depth 層,檔案放在最底層
+    int sessions;         // 操作輪流分給 @0 ~ @sessions-1
+    int size_kind;        // WL_SIZE_*
+    double size_a, size_b; // fixed: a; uniform: a ~ b; lognormal: 中位數 a,sigma b
+    int mix[WL_MIX];      // 權重
+    double zipf;          // 熱門程度的偏斜 (0 = 平均),挑共用檔案用
+    unsigned seed;
+} WlGenOpts;
+
+void wl_gen_defaults(WlGenOpts *o);
+int wl_parse_sizes(const char *spec, WlGenOpts *o); // fixed:4K | uniform:1K-64K | lognormal:8K,1.5
+int wl_parse_mix(const char *spec, WlGenOpts *o);   // read=50,write=10,... (沒寫的 = 0)
+int wl_generate(const WlGenOpts *o, FILE *out);     // 回傳 MYFS_OK 或錯誤碼
+
+typedef struct
+{
+    int sessions;
+    long long ops, errors, bytes;  // 最後一個 barrier 之後
+    double secs;
+    int first_error_line, first_error; // 第一個失敗的行號和錯誤碼 (0 = 沒有)
+    int nrows;
+    StatsRow rows[WL_OPS];         // 每種操作的次數 / 延遲 (有做過的,依 WL_* 順序)
+} WlReport;
+
+// 在目前掛載的映像檔上重播,會重設延遲統計 (stats_reset) 並打開
+int wl_replay(const char *trace, int sessions, WlReport *rep);
+
+#endif
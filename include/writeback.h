@@ -0,0 +1,49 @@
+#ifndef WRITEBACK_H
+#define WRITEBACK_H
+#include <stdint.h>
+
+// 背景 writeback: 每隔一段時間 (或髒的 Block 超過門檻) 做一次 checkpoint,只把變動的部分寫回映像檔
+// 1) 凍結 (很短): 跟 shell 指令和 libmyfs 錯開,複製 Superblock、變動的 Inode、Bitmap,寫尾端的區段,
+//    把要寫的 Block 標成 pending,generation 加一
+// 2) 寫入 (不凍結): 指令照常執行; 要修改 pending 的 Block 之前先呼叫 wb_cow 把舊內容複製一份 (copy-on-write),
+//    所以寫到映像檔的一定是凍結那一刻的內容,前景不用等 I/O
+// 哪些 Block / Inode 變了: 用 generation (gen.h),比上次 checkpoint 新的就要寫
+// 每次 checkpoint 都是原地覆寫,中途當機的話那段期間修改的檔案可能只寫了一部分
+
+typedef struct
+{
+    int running;
+    int interval_ms, dirty_limit;  // 觸發條件 (0 = 不用這個條件)
+    long long checkpoints;
+    long long bytes, blocks, inodes; // 累計寫入
+    long long last_bytes;
+    long long cow_copies;          // 寫入中被修改而先複製的 Block
+    double last_ms;                // 上一次 checkpoint 的總時間
+    double last_freeze_ms, max_freeze_ms; // 前景被擋住的時間
+    double lag_ms;                 // 還沒寫回的修改最久可能是多久以前 (0 = 映像檔是最新的)
+    uint32_t gens_behind;          // 目前的 generation - 映像檔的 generation
+    int dirty_blocks;              // 上次 checkpoint 之後變髒的 Block
+} WbStats;
+
+int wb_start(int interval_ms, int dirty_limit); // 已經在跑就換成新的設定
+void wb_stop();
+int wb_checkpoint();          // 馬上做一次 (不需要背景 thread),回傳 MYFS_OK 或錯誤碼
+void wb_stats(WbStats *st);
+
+// fs.c 用
+void wb_reset(int full);      // load (full = 0) / format (full = 1) 之後: 映像檔已經是最新的 / 下次要全部寫
+void wb_free();
+void wb_invalidate();         // 記憶體整個被換掉 (restore): 下次 checkpoint 全部寫
+void wb_image_lock();         // save_fs 寫整個映像檔時跟 checkpoint 錯開
+void wb_image_unlock();
+void wb_saved();              // save_fs 寫完了: 映像檔是最新的
+
+// 修改 Block 內容之前呼叫 (資料還沒寫到映像檔就先複製舊的)
+extern uint8_t *wb_pending;
+void wb_cow_slow(int bid);
+static inline void wb_cow(int bid)
+{
+    if(wb_pending && __atomic_load_n(&wb_pending[bid], __ATOMIC_ACQUIRE)) wb_cow_slow(bid);
+}
+
+#endif
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "backup.h"
+#include "fs.h"
+#include "inode.h"
+#include "bitmap.h"
+#include "gen.h"
+#include "writeback.h"
+#include "bcache.h"
+#include "path.h"
+#include "trigram.h"
+#include "security.h"
+#include "myfs.h"
+#include "defrag.h"
+#include "hostsync.h"
+
+// Delta 檔案格式:
+//   DeltaHeader
+//   n_inodes 筆 (int Inode 編號, Inode)      -- 有密碼時用 XOR 加密,跟映像檔一樣
+//   n_blocks 筆 (int Block 編號, DiskBlock)
+//   Bitmap (整個,20 GiB 的映像檔也只有 2.5 MB)
+//   "END1"
+#define DELTA_MAGIC "MYFSDLT1"
+#define DELTA_END   "END1"
+
+typedef struct
+{
+    char magic[8];
+    uint64_t fs_id;
+    uint32_t since, until;
+    int total_inodes, total_blocks; // 映像檔大小要一樣才能套用
+    int used_inodes, used_blocks;
+    int n_inodes, n_blocks;
+} DeltaHeader;
+
+int backup_export(const char *host_path, uint32_t since, BackupStats *st)
+{
+    DeltaHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DELTA_MAGIC, 8);
+    h.fs_id = fs_id; h.since = since; h.until = fs_generation;
+    h.total_inodes = sb->total_inodes; h.total_blocks = sb->total_blocks;
+    h.used_inodes = sb->used_inodes; h.used_blocks = blocks_used();
+
+    // since = 0: 全部的 Inode (包含沒用到的,才能完整蓋掉目標) 和所有使用中的 Block
+    for(int i = 0; i < sb->total_inodes; i++) if(since == 0 || inode_gen[i] > since) h.n_inodes++;
+    for(int b = 0; b < sb->total_blocks; b++) if(get_bit(b) && (since == 0 || block_gen[b] > since)) h.n_blocks++;
+
+    FILE *fp = fopen(host_path, "wb");
+    if(!fp) return MYFS_EIO;
+    fwrite(&h, sizeof(h), 1, fp);
+
+    Inode ino;
+    for(int i = 0; i < sb->total_inodes; i++)
+    {
+        if(since != 0 && inode_gen[i] <= since) continue;
+        ino = inode_table[i];
+        xor_cipher(&ino, sizeof(Inode), sb->password);
+        fwrite(&i, sizeof(int), 1, fp);
+        fwrite(&ino, sizeof(Inode), 1, fp);
+    }
+    DiskBlock blk;
+    for(int b = 0; b < sb->total_blocks; b++)
+    {
+        if(!get_bit(b) || (since != 0 && block_gen[b] <= since)) continue;
+        memcpy(blk.data, blk_get(b, BLK_READ), BLOCK_SIZE);
+        blk_put(b, BLK_READ);
+        xor_cipher(&blk, sizeof(DiskBlock), sb->password);
+        fwrite(&b, sizeof(int), 1, fp);
+        fwrite(&blk, sizeof(DiskBlock), 1, fp);
+    }
+    fwrite(block_bitmap, 1, (sb->total_blocks + 7) / 8, fp);
+    fwrite(DELTA_END, 1, 4, fp);
+    int bad = ferror(fp);
+    st->bytes = ftell64(fp);
+    if(fclose(fp) != 0 || bad) return MYFS_EIO;
+
+    st->since = h.since; st->until = h.until;
+    st->inodes = h.n_inodes; st->blocks = h.n_blocks;
+    return MYFS_OK;
+}
+
+// 第一遍: 只檢查格式 (編號範圍、結尾),確定整個檔案都完整之後才開始改映像檔
+static int delta_check(FILE *fp, const DeltaHeader *h)
+{
+    int idx;
+    for(int k = 0; k < h->n_inodes; k++)
+    {
+        if(fread(&idx, sizeof(int), 1, fp) != 1 || idx < 0 || idx >= h->total_inodes) return -1;
+        if(fseek64(fp, sizeof(Inode), SEEK_CUR) != 0) return -1;
+    }
+    for(int k = 0; k < h->n_blocks; k++)
+    {
+        if(fread(&idx, sizeof(int), 1, fp) != 1 || idx < 0 || idx >= h->total_blocks) return -1;
+        if(fseek64(fp, sizeof(DiskBlock), SEEK_CUR) != 0) return -1;
+    }
+    char end[4];
+    if(fseek64(fp, (h->total_blocks + 7) / 8, SEEK_CUR) != 0) return -1;
+    if(fread(end, 1, 4, fp) != 4 || memcmp(end, DELTA_END, 4) != 0) return -1;
+    return 0;
+}
+
+int backup_restore(const char *host_path, BackupStats *st)
+{
+    FILE *fp = fopen(host_path, "rb");
+    if(!fp) return MYFS_ENOENT;
+    DeltaHeader h;
+    if(fread(&h, sizeof(h), 1, fp) != 1 || memcmp(h.magic, DELTA_MAGIC, 8) != 0) { fclose(fp); return MYFS_EIO; }
+    st->since = h.since; st->until = h.until;
+    st->inodes = h.n_inodes; st->blocks = h.n_blocks;
+
+    // 必須是同一個檔案系統 (完整備份除外),而且目前的狀態介於 since 和 until 之間
+    if(h.total_inodes != sb->total_inodes || h.total_blocks != sb->total_blocks ||
+       (h.since != 0 && (h.fs_id != fs_id || fs_generation < h.since || fs_generation > h.until)))
+    {
+        fclose(fp); return MYFS_EINVAL;
+    }
+    long long start = ftell64(fp);
+    if(delta_check(fp, &h) < 0) { fclose(fp); return MYFS_EIO; }
+    st->bytes = ftell64(fp);
+
+    // 第二遍: 套用
+    fseek64(fp, start, SEEK_SET);
+    int *restored = malloc(sizeof(int) * (h.n_inodes ? h.n_inodes : 1));
+    int idx;
+    for(int k = 0; k < h.n_inodes; k++)
+    {
+        fread(&idx, sizeof(int), 1, fp);
+        fread(&inode_table[idx], sizeof(Inode), 1, fp);
+        xor_cipher(&inode_table[idx], sizeof(Inode), sb->password);
+        inode_gen[idx] = h.until;
+        restored[k] = idx;
+    }
+    for(int k = 0; k < h.n_blocks; k++)
+    {
+        fread(&idx, sizeof(int), 1, fp);
+        wb_cow(idx);
+        char *p = blk_get(idx, BLK_NEW);
+        fread(p, BLOCK_SIZE, 1, fp);
+        xor_cipher(p, BLOCK_SIZE, sb->password);
+        blk_put(idx, BLK_NEW);
+        block_gen[idx] = h.until;
+    }
+    fread(block_bitmap, 1, (sb->total_blocks + 7) / 8, fp);
+    fclose(fp);
+
+    sb->used_inodes = h.used_inodes; sb->used_blocks = h.used_blocks;
+    fs_id = h.fs_id;
+    fs_generation = h.until;
+
+    // 快取全部重建,Trigram 索引只要重算被換掉的檔案
+    alloc_reset();
+    wb_invalidate(); // generation 倒回 until 了,下次 checkpoint 全部重寫
+    dcache_reset();
+    defrag_reset();
+    sync_reset(); // 換回來的 Inode 不一定是上次 sync 寫的
+    for(int k = 0; k < h.n_inodes; k++)
+    {
+        tri_clear(restored[k]);
+        if(inode_table[restored[k]].is_used && !inode_table[restored[k]].is_dir)
+            tri_add(restored[k], 0, inode_table[restored[k]].size);
+    }
+    free(restored);
+    current_dir_id = 0; strcpy(current_path, "/");
+    return MYFS_OK;
+}
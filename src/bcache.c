@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "bcache.h"
+#include "security.h"
+#include "bio.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define OPEN_FLAGS (O_RDWR | O_BINARY)
+#define ftruncate(fd, len) _chsize_s(fd, len)
+#else
+#include <unistd.h>
+#define OPEN_FLAGS O_RDWR
+#endif
+
+#define RA_MIN 4     // 循序讀第一次預讀的 Block 數
+#define RA_MAX 64    // 一次最多預讀/寫回幾個連續的 Block
+#define BATCH 256    // 預讀/寫回一次交給 bio_run 的 Block 數 (分成好幾段連續的 I/O 同時做)
+#define MIN_SLOTS 64 // 同時被 pin 住的 Block 不會超過這個數
+
+typedef struct
+{
+    int bid;      // -1 = 空的
+    int pins, wpins;
+    uint8_t ref;  // CLOCK: 最近用過
+    uint8_t dirty;
+    uint8_t busy; // 正在讀寫映像檔,要等
+    uint8_t pre;  // 預讀進來,還沒被用過
+} Slot;
+
+static int want_slots;      // bc_configure 設定,下次 load / format 生效
+static int fd = -1;
+static int nslots, hand, waiters;
+static Slot *slots;
+static char *mem;
+static int *where;          // Block -> slot,-1 = 不在快取
+static long long base;      // Data Blocks 在映像檔裡的起點
+static int *ra_next, *ra_end, *ra_win; // 每個 Inode 的循序讀狀態
+static BcStats st;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ready = PTHREAD_COND_INITIALIZER;
+
+#define SLOT_MEM(s) (mem + (size_t)(s) * BLOCK_SIZE)
+#define BLOCK_POS(b) (base + (long long)(b) * BLOCK_SIZE)
+
+void bc_configure(int n) { want_slots = n > 0 && n < MIN_SLOTS ? MIN_SLOTS : n; }
+int bc_configured() { return want_slots; }
+
+int bc_open(const char *path, int create, long long length)
+{
+    bc_close();
+    fd = open(path, OPEN_FLAGS | (create ? O_CREAT | O_TRUNC : 0), 0644);
+    if(fd < 0) return -1;
+    if(create && ftruncate(fd, length) != 0) { close(fd); fd = -1; return -1; }
+    nslots = want_slots < sb->total_blocks ? want_slots : sb->total_blocks;
+    if(nslots < 1) nslots = 1;
+    slots = malloc(sizeof(Slot) * nslots);
+    mem = malloc((size_t)nslots * BLOCK_SIZE);
+    where = malloc(sizeof(int) * sb->total_blocks);
+    ra_next = calloc(sb->total_inodes, sizeof(int));
+    ra_end = calloc(sb->total_inodes, sizeof(int));
+    ra_win = calloc(sb->total_inodes, sizeof(int));
+    for(int i = 0; i < nslots; i++) { memset(&slots[i], 0, sizeof(Slot)); slots[i].bid = -1; }
+    for(int b = 0; b < sb->total_blocks; b++) where[b] = -1;
+    base = sizeof(Superblock) + (long long)sb->total_inodes * sizeof(Inode);
+    hand = 0;
+    bc_stats_reset();
+    return 0;
+}
+
+void bc_close()
+{
+    if(fd >= 0) close(fd);
+    fd = -1;
+    free(slots); free(mem); free(where); free(ra_next); free(ra_end); free(ra_win);
+    slots = NULL; mem = NULL; where = NULL; ra_next = NULL; ra_end = NULL; ra_win = NULL;
+    nslots = 0;
+}
+
+// 一個 Block 讀進 dst 並解密 (映像檔比較短的部分補 0)
+static void read_block(int bid, char *dst)
+{
+    long long r = bio_pread(fd, dst, BLOCK_SIZE, BLOCK_POS(bid));
+    if(r < 0) r = 0;
+    if(r < BLOCK_SIZE) memset(dst + r, 0, BLOCK_SIZE - r);
+    xor_cipher_at(dst, BLOCK_SIZE, sb->password, (long long)bid * BLOCK_SIZE);
+}
+
+// slot[0..n) (Block 編號遞增) 切成連續、最多 RA_MAX 個 Block 的段,每段一個 BioReq,資料放在 buf
+static int build_runs(const int *slot, int n, char *buf, BioReq *reqs, int write)
+{
+    int nreq = 0;
+    for(int k = 0; k < n; )
+    {
+        int len = 1;
+        while(k + len < n && len < RA_MAX && slots[slot[k + len]].bid == slots[slot[k]].bid + len) len++;
+        reqs[nreq].write = write;
+        reqs[nreq].buf = buf + (size_t)k * BLOCK_SIZE;
+        reqs[nreq].len = len * BLOCK_SIZE;
+        reqs[nreq].pos = BLOCK_POS(slots[slot[k]].bid);
+        nreq++;
+        k += len;
+    }
+    return nreq;
+}
+
+static int cmp_slot_bid(const void *a, const void *b)
+{
+    return slots[*(const int *)a].bid - slots[*(const int *)b].bid;
+}
+
+// CLOCK: 找一個沒被 pin 住、最近沒用過的 slot 並把原本的 Block 換出去 (拿著 lock),-1 = 全部都被 pin 住
+static int victim()
+{
+    for(int k = 0; k < 3 * nslots; k++)
+    {
+        int s = hand;
+        if(++hand == nslots) hand = 0;
+        Slot *sl = &slots[s];
+        if(sl->pins || sl->busy) continue;
+        if(sl->ref) { sl->ref = 0; continue; }
+        if(sl->bid >= 0)
+        {
+            // 髒的 Block 直接在這裡寫回 (等 I/O 的時候別人不能拿到舊的內容)
+            if(sl->dirty)
+            {
+                char tmp[BLOCK_SIZE];
+                memcpy(tmp, SLOT_MEM(s), BLOCK_SIZE);
+                xor_cipher_at(tmp, BLOCK_SIZE, sb->password, (long long)sl->bid * BLOCK_SIZE);
+                bio_pwrite(fd, tmp, BLOCK_SIZE, BLOCK_POS(sl->bid));
+                st.writebacks++; st.writes++; st.write_bytes += BLOCK_SIZE;
+            }
+            where[sl->bid] = -1;
+            st.evictions++;
+        }
+        sl->bid = -1; sl->dirty = 0; sl->pre = 0;
+        return s;
+    }
+    return -1;
+}
+
+static void wait_ready()
+{
+    waiters++;
+    pthread_cond_wait(&ready, &lock);
+    waiters--;
+}
+
+char *bc_get(int bid, int mode)
+{
+    pthread_mutex_lock(&lock);
+    for(;;)
+    {
+        int s = where[bid];
+        if(s >= 0)
+        {
+            Slot *sl = &slots[s];
+            if(sl->busy) { wait_ready(); continue; }
+            sl->pins++; sl->ref = 1;
+            if(mode != BLK_READ) sl->wpins++;
+            if(sl->pre) { sl->pre = 0; st.prefetch_hits++; }
+            st.hits++;
+            pthread_mutex_unlock(&lock);
+            return SLOT_MEM(s);
+        }
+        s = victim();
+        if(s < 0) { wait_ready(); continue; }
+        Slot *sl = &slots[s];
+        sl->bid = bid; sl->pins = 1; sl->wpins = mode != BLK_READ; sl->ref = 1;
+        where[bid] = s;
+        if(mode == BLK_NEW) { st.fresh++; pthread_mutex_unlock(&lock); return SLOT_MEM(s); }
+        sl->busy = 1;
+        st.misses++; st.reads++; st.read_bytes += BLOCK_SIZE;
+        pthread_mutex_unlock(&lock);
+
+        read_block(bid, SLOT_MEM(s));
+
+        pthread_mutex_lock(&lock);
+        sl->busy = 0;
+        if(waiters) pthread_cond_broadcast(&ready);
+        pthread_mutex_unlock(&lock);
+        return SLOT_MEM(s);
+    }
+}
+
+void bc_put(int bid, int mode)
+{
+    pthread_mutex_lock(&lock);
+    Slot *sl = &slots[where[bid]];
+    if(mode != BLK_READ) { sl->dirty = 1; sl->wpins--; }
+    if(--sl->pins == 0 && waiters) pthread_cond_broadcast(&ready);
+    pthread_mutex_unlock(&lock);
+}
+
+void bc_readahead(const int *bids, int n)
+{
+    if(n > nslots / 4) n = nslots / 4; // 不要把整個快取換掉
+    if(n > BATCH) n = BATCH;
+    if(n <= 0) return;
+    // 先把所有還不在快取裡的 Block 佔好 slot (標成 busy),再一起交給 bio_run
+    int *run = malloc(sizeof(int) * n);
+    int len = 0;
+    pthread_mutex_lock(&lock);
+    for(int i = 0; i < n; i++)
+    {
+        if(where[bids[i]] >= 0) continue;
+        int s = victim();
+        if(s < 0) break;
+        Slot *sl = &slots[s];
+        sl->bid = bids[i]; sl->pins = 0; sl->wpins = 0; sl->ref = 0; sl->busy = 1; sl->pre = 1;
+        where[bids[i]] = s;
+        run[len++] = s;
+    }
+    pthread_mutex_unlock(&lock);
+    if(!len) { free(run); return; }
+
+    // busy 的 slot 別人不會動,不拿 lock 也可以讀 bid
+    qsort(run, len, sizeof(int), cmp_slot_bid);
+    char *buf = malloc((size_t)len * BLOCK_SIZE);
+    BioReq reqs[BATCH];
+    int nreq = build_runs(run, len, buf, reqs, 0);
+    bio_run(fd, reqs, nreq);
+    for(int q = 0; q < nreq; q++)
+    {
+        int got = reqs[q].res > 0 ? reqs[q].res : 0;
+        if(got < reqs[q].len) memset((char *)reqs[q].buf + got, 0, reqs[q].len - got);
+    }
+    for(int k = 0; k < len; k++)
+    {
+        char *src = buf + (size_t)k * BLOCK_SIZE;
+        xor_cipher_at(src, BLOCK_SIZE, sb->password, (long long)slots[run[k]].bid * BLOCK_SIZE);
+        memcpy(SLOT_MEM(run[k]), src, BLOCK_SIZE);
+    }
+
+    pthread_mutex_lock(&lock);
+    for(int k = 0; k < len; k++) slots[run[k]].busy = 0;
+    st.prefetched += len; st.reads += nreq; st.read_bytes += (long long)len * BLOCK_SIZE;
+    if(waiters) pthread_cond_broadcast(&ready);
+    pthread_mutex_unlock(&lock);
+    free(buf);
+    free(run);
+}
+
+// 檔案的第 first..last 個 Block 要被讀: 接著上次讀到的地方 (或從頭開始) 就當作循序讀,
+// 預讀的量每次加倍到 RA_MAX; 跳著讀就停止預讀
+void bc_sequential(int ino, const int *bids, int nblocks, int first, int last)
+{
+    if(!ra_next) return;
+    int next = __atomic_load_n(&ra_next[ino], __ATOMIC_RELAXED);
+    int end = __atomic_load_n(&ra_end[ino], __ATOMIC_RELAXED);
+    int win = __atomic_load_n(&ra_win[ino], __ATOMIC_RELAXED);
+    if(first + 1 == next && last < next) return; // 同一個 Block 分好幾次讀
+    __atomic_store_n(&ra_next[ino], last + 1, __ATOMIC_RELAXED);
+    if(first != next && first + 1 != next)
+    {
+        if(first != 0)
+        {
+            __atomic_store_n(&ra_win[ino], 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&ra_end[ino], 0, __ATOMIC_RELAXED);
+            return;
+        }
+        win = 0; end = 0; // 從頭重新讀
+    }
+    win = win ? (win * 2 > RA_MAX ? RA_MAX : win * 2) : RA_MIN;
+    __atomic_store_n(&ra_win[ino], win, __ATOMIC_RELAXED);
+    // 已經預讀到夠前面就先不讀 (剩不到半個視窗才補)
+    if(end - (last + 1) >= win / 2) return;
+    int from = end > first ? end : first;
+    int to = last + 1 + win;
+    if(to > nblocks) to = nblocks;
+    if(from >= to) return;
+    __atomic_store_n(&ra_end[ino], to, __ATOMIC_RELAXED);
+    bc_readahead(bids + from, to - from);
+}
+
+int bc_flush()
+{
+    if(fd < 0) return 0;
+    int batch[BATCH], total = 0, err = 0;
+    BioReq reqs[BATCH];
+    char *buf = malloc((size_t)BATCH * BLOCK_SIZE);
+    for(int start = 0; start < nslots; )
+    {
+        // 一次拿一批髒的 Block (正在被修改的下次再寫),寫的時候標成 busy,別人要等
+        pthread_mutex_lock(&lock);
+        int n = 0;
+        for(; start < nslots && n < BATCH; start++)
+        {
+            Slot *sl = &slots[start];
+            if(sl->bid < 0 || !sl->dirty || sl->busy || sl->wpins) continue;
+            sl->busy = 1; sl->dirty = 0;
+            batch[n++] = start;
+        }
+        pthread_mutex_unlock(&lock);
+        if(!n) continue;
+
+        // 照 Block 編號排好,連續的合成一段,各段同時交給 bio_run
+        qsort(batch, n, sizeof(int), cmp_slot_bid);
+        for(int k = 0; k < n; k++)
+        {
+            char *dst = buf + (size_t)k * BLOCK_SIZE;
+            memcpy(dst, SLOT_MEM(batch[k]), BLOCK_SIZE);
+            xor_cipher_at(dst, BLOCK_SIZE, sb->password, (long long)slots[batch[k]].bid * BLOCK_SIZE);
+        }
+        int nreq = build_runs(batch, n, buf, reqs, 1);
+        if(bio_run(fd, reqs, nreq)) err = 1;
+
+        pthread_mutex_lock(&lock);
+        for(int k = 0; k < n; k++) slots[batch[k]].busy = 0;
+        st.flushed += n; st.writes += nreq; st.write_bytes += (long long)n * BLOCK_SIZE;
+        if(waiters) pthread_cond_broadcast(&ready);
+        pthread_mutex_unlock(&lock);
+        total += n;
+    }
+    free(buf);
+    return err ? -1 : total;
+}
+
+void bc_stats(BcStats *out)
+{
+    pthread_mutex_lock(&lock);
+    *out = st;
+    out->slots = nslots;
+    out->used = out->dirty = 0;
+    for(int i = 0; i < nslots; i++)
+    {
+        if(slots[i].bid >= 0) out->used++;
+        if(slots[i].dirty) out->dirty++;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void bc_stats_reset()
+{
+    pthread_mutex_lock(&lock);
+    memset(&st, 0, sizeof(st));
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "bio.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <stdio.h>
+// Windows 沒有 pread/pwrite: 用一把鎖把 seek + read/write 包起來
+static pthread_mutex_t io_lock = PTHREAD_MUTEX_INITIALIZER;
+long long bio_pread(int fd, void *buf, long long n, long long pos)
+{
+    pthread_mutex_lock(&io_lock);
+    long long r = _lseeki64(fd, pos, SEEK_SET) == pos ? _read(fd, buf, (unsigned)n) : -1;
+    pthread_mutex_unlock(&io_lock);
+    return r;
+}
+long long bio_pwrite(int fd, const void *buf, long long n, long long pos)
+{
+    pthread_mutex_lock(&io_lock);
+    long long r = _lseeki64(fd, pos, SEEK_SET) == pos ? _write(fd, buf, (unsigned)n) : -1;
+    pthread_mutex_unlock(&io_lock);
+    return r;
+}
+#else
+#include <unistd.h>
+long long bio_pread(int fd, void *buf, long long n, long long pos) { return pread(fd, buf, n, pos); }
+long long bio_pwrite(int fd, const void *buf, long long n, long long pos) { return pwrite(fd, buf, n, pos); }
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_URING 1
+#endif
+#endif
+
+#define MAX_DEPTH 256
+
+static int backend = -1; // -1 = 還沒設定 (第一次用的時候 BIO_AUTO)
+static int depth = 32;
+static int config_gen;   // 設定改了,每個 thread 的 io_uring 要重建
+static pthread_mutex_t config_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// 沒做完的部分 (短讀寫、io_uring 回報錯誤) 用一般的 pread / pwrite 補
+static void finish_sync(int fd, BioReq *r, int done)
+{
+    while(done < r->len)
+    {
+        long long k = r->write ? bio_pwrite(fd, (char *)r->buf + done, r->len - done, r->pos + done)
+                               : bio_pread(fd, (char *)r->buf + done, r->len - done, r->pos + done);
+        if(k < 0 && errno == EINTR) continue;
+        if(k <= 0) { r->res = done ? done : (k < 0 ? -errno : 0); return; }
+        done += (int)k;
+    }
+    r->res = done;
+}
+
+// ---- io_uring (只用 READ / WRITE 兩種 opcode,Linux 5.6+) ----
+
+#ifdef HAVE_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+typedef struct
+{
+    int fd, gen, entries;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size, sqe_size;
+} Ring;
+
+static pthread_key_t ring_key;
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+
+static void ring_free(void *p)
+{
+    Ring *r = p;
+    if(!r) return;
+    munmap(r->sqes, r->sqe_size);
+    if(r->cq_ptr != r->sq_ptr) munmap(r->cq_ptr, r->cq_size);
+    munmap(r->sq_ptr, r->sq_size);
+    close(r->fd);
+    free(r);
+}
+
+static void ring_key_init() { pthread_key_create(&ring_key, ring_free); }
+
+static Ring *ring_new(int entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if(fd < 0) return NULL;
+    Ring *r = calloc(1, sizeof(Ring));
+    r->fd = fd;
+    r->entries = p.sq_entries;
+    r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if(p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if(r->cq_size > r->sq_size) r->sq_size = r->cq_size;
+        r->cq_size = r->sq_size;
+    }
+    r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(r->sq_ptr == MAP_FAILED) { close(fd); free(r); return NULL; }
+    if(p.features & IORING_FEAT_SINGLE_MMAP) r->cq_ptr = r->sq_ptr;
+    else
+    {
+        r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if(r->cq_ptr == MAP_FAILED) { munmap(r->sq_ptr, r->sq_size); close(fd); free(r); return NULL; }
+    }
+    r->sqe_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqe_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(r->sqes == MAP_FAILED)
+    {
+        if(r->cq_ptr != r->sq_ptr) munmap(r->cq_ptr, r->cq_size);
+        munmap(r->sq_ptr, r->sq_size); close(fd); free(r); return NULL;
+    }
+    char *sq = r->sq_ptr, *cq = r->cq_ptr;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return r;
+}
+
+// 這個 thread 的 io_uring (設定改過就重建)
+static Ring *ring_get()
+{
+    pthread_once(&ring_once, ring_key_init);
+    Ring *r = pthread_getspecific(ring_key);
+    int gen = __atomic_load_n(&config_gen, __ATOMIC_ACQUIRE);
+    if(r && r->gen == gen) return r;
+    ring_free(r);
+    r = ring_new(depth);
+    if(r) r->gen = gen;
+    pthread_setspecific(ring_key, r);
+    return r;
+}
+
+static int uring_probe()
+{
+    Ring *r = ring_new(4);
+    if(!r) return 0;
+    ring_free(r);
+    return 1;
+}
+
+static void uring_run(int fd, BioReq *reqs, int n)
+{
+    Ring *r = ring_get();
+    if(!r) { for(int i = 0; i < n; i++) finish_sync(fd, &reqs[i], 0); return; }
+    int next = 0, inflight = 0, done = 0;
+    int limit = depth < r->entries ? depth : r->entries;
+    unsigned tail = *r->sq_tail;
+    while(done < n)
+    {
+        // 補滿到 depth 個
+        while(next < n && inflight < limit)
+        {
+            BioReq *q = &reqs[next];
+            unsigned idx = tail & *r->sq_mask;
+            struct io_uring_sqe *sqe = &r->sqes[idx];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = q->write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe->fd = fd;
+            sqe->addr = (unsigned long)q->buf;
+            sqe->len = q->len;
+            sqe->off = q->pos;
+            sqe->user_data = next;
+            r->sq_array[idx] = idx;
+            tail++;
+            next++; inflight++;
+        }
+        __atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+        unsigned pending = tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+        int k = (int)syscall(__NR_io_uring_enter, r->fd, pending, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if(k < 0 && pending && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            // 核心不收: 還沒送出去的 (一定是最後 pending 個) 收回來改成同步做
+            tail -= pending;
+            __atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+            for(int i = next - (int)pending; i < next; i++) { finish_sync(fd, &reqs[i], 0); done++; }
+            inflight -= pending;
+        }
+        // 收完成的
+        unsigned head = *r->cq_head;
+        while(head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+            BioReq *q = &reqs[cqe->user_data];
+            int res = cqe->res;
+            head++;
+            __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+            if(res == q->len) q->res = res;
+            else finish_sync(fd, q, res > 0 ? res : 0);
+            inflight--; done++;
+        }
+    }
+}
+#endif
+
+// ---- thread pool: depth 個 thread 各自做 pread / pwrite ----
+
+typedef struct Job
+{
+    struct Job *next;
+    int fd;
+    BioReq *req;
+    int *left;
+} Job;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER, pool_done = PTHREAD_COND_INITIALIZER;
+static Job *queue_head, *queue_tail;
+static pthread_t *workers;
+static int nworkers, pool_stop;
+
+static void *worker(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&pool_lock);
+    for(;;)
+    {
+        while(!queue_head && !pool_stop) pthread_cond_wait(&pool_work, &pool_lock);
+        if(!queue_head) break;
+        Job *j = queue_head;
+        queue_head = j->next;
+        if(!queue_head) queue_tail = NULL;
+        pthread_mutex_unlock(&pool_lock);
+        finish_sync(j->fd, j->req, 0);
+        pthread_mutex_lock(&pool_lock);
+        if(--*j->left == 0) pthread_cond_broadcast(&pool_done);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+static void pool_run(int fd, BioReq *reqs, int n)
+{
+    Job *jobs = malloc(sizeof(Job) * n);
+    int left = n;
+    pthread_mutex_lock(&pool_lock);
+    if(!nworkers)
+    {
+        workers = malloc(sizeof(pthread_t) * depth);
+        pool_stop = 0;
+        for(; nworkers < depth; nworkers++)
+            if(pthread_create(&workers[nworkers], NULL, worker, NULL) != 0) break;
+    }
+    if(!nworkers)
+    {
+        pthread_mutex_unlock(&pool_lock);
+        for(int i = 0; i < n; i++) finish_sync(fd, &reqs[i], 0);
+        free(jobs);
+        return;
+    }
+    for(int i = 0; i < n; i++)
+    {
+        jobs[i].next = NULL; jobs[i].fd = fd; jobs[i].req = &reqs[i]; jobs[i].left = &left;
+        if(queue_tail) queue_tail->next = &jobs[i]; else queue_head = &jobs[i];
+        queue_tail = &jobs[i];
+    }
+    pthread_cond_broadcast(&pool_work);
+    while(left) pthread_cond_wait(&pool_done, &pool_lock);
+    pthread_mutex_unlock(&pool_lock);
+    free(jobs);
+}
+
+void bio_shutdown()
+{
+    pthread_mutex_lock(&pool_lock);
+    pool_stop = 1;
+    pthread_cond_broadcast(&pool_work);
+    int n = nworkers;
+    pthread_mutex_unlock(&pool_lock);
+    for(int i = 0; i < n; i++) pthread_join(workers[i], NULL);
+    pthread_mutex_lock(&pool_lock);
+    free(workers);
+    workers = NULL; nworkers = 0;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+// ----
+
+int bio_configure(int b, int d)
+{
+    pthread_mutex_lock(&config_lock);
+    bio_shutdown(); // thread 數跟著 depth
+    if(d > 0) depth = d > MAX_DEPTH ? MAX_DEPTH : d;
+#ifdef HAVE_URING
+    if(b == BIO_AUTO || b == BIO_URING) b = uring_probe() ? BIO_URING : BIO_THREADS;
+#else
+    if(b == BIO_AUTO || b == BIO_URING) b = BIO_THREADS;
+#endif
+    __atomic_store_n(&backend, b, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&config_gen, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&config_lock);
+    return b;
+}
+
+int bio_backend()
+{
+    int b = __atomic_load_n(&backend, __ATOMIC_ACQUIRE);
+    return b < 0 ? bio_configure(BIO_AUTO, 0) : b;
+}
+
+int bio_depth() { return depth; }
+
+const char *bio_name(int b)
+{
+    static const char *names[] = { "auto", "io_uring", "threads", "sync" };
+    return b >= 0 && b <= BIO_SYNC ? names[b] : "?";
+}
+
+int bio_parse(const char *name)
+{
+    if(strcmp(name, "auto") == 0) return BIO_AUTO;
+    if(strcmp(name, "uring") == 0 || strcmp(name, "io_uring") == 0) return BIO_URING;
+    if(strcmp(name, "threads") == 0) return BIO_THREADS;
+    if(strcmp(name, "sync") == 0) return BIO_SYNC;
+    return -1;
+}
+
+int bio_run(int fd, BioReq *reqs, int n)
+{
+    if(n <= 0) return 0;
+    int b = bio_backend();
+    if(n == 1 || b == BIO_SYNC) for(int i = 0; i < n; i++) finish_sync(fd, &reqs[i], 0);
+#ifdef HAVE_URING
+    else if(b == BIO_URING) uring_run(fd, reqs, n);
+#endif
+    else pool_run(fd, reqs, n);
+    int bad = 0;
+    for(int i = 0; i < n; i++) if(reqs[i].res != reqs[i].len) bad++;
+    return bad;
+}
@@ -1,5 +1,27 @@
 #include "bitmap.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "stats.h"
+
+// 配置群組 (Allocation Group): Block 空間每 AG_BLOCKS 個切成一組,各自有 Bitmap 的一段、計數、hint 和鎖
+// 寫不同目錄的 thread 通常落在不同群組,不會搶同一把鎖; 磁碟格式不變 (還是同一個 Bitmap)
+typedef struct 
+{
+    pthread_mutex_t lock;
+    int start, end;  // 負責 [start, end) 的 Block
+    int used;        // 群組內使用中的 Block 數 (不拿鎖也可以讀,用 atomic)
+    // 群組內所有小於 hint 的 Block 都已被使用,找空 Block 時從這裡開始掃
+    int hint;
+    // alloc_run 用: run_hint[n] 之前沒有連續 n 個空 Block
+    // 釋放 Block 時看它接起來的空段有多長,只調整變長的那幾個 n
+    int run_hint[MAX_BLOCKS_PER_FILE+1];
+    char pad[64];    // 相鄰群組的鎖不要落在同一條 cache line
+} AllocGroup;
+
+static AllocGroup *groups;
+static int ngroups;
 
 // Bitwise Operation
 // 1 byte = 8 bits,所以一個 char 變數可以紀錄 8 個 Blocks 的狀態
@@ -23,29 +45,185 @@ int get_bit(int i)
     return block_bitmap[i/8] & (1 << (i%8)); 
 }
 
-// 尋找第一個可用的Block
+static AllocGroup *group_of(int block_id) { return &groups[block_id / AG_BLOCKS]; }
+
+static int group_size(AllocGroup *g) { return g->end - g->start; }
+
+// 群組內從 from 開始第一個空 Block,沒有回傳 -1
+static int group_scan(AllocGroup *g, int from) 
+{
+    for(int i=from; i<g->end; i++) 
+    {
+        // 整個 byte 都滿了就直接跳過 8 個
+        if(i%8 == 0 && block_bitmap[i/8] == 0xFF) { i += 7; continue; }
+        if(get_bit(i) == 0) return i;
+    }
+    return -1;
+}
+
+static void group_take(AllocGroup *g, int b, int n) 
+{
+    for(int k=b; k<b+n; k++) set_bit(k);
+    __atomic_fetch_add(&g->used, n, __ATOMIC_RELAXED);
+}
+
+// 在群組 g 裡配一個 Block,優先用 goal 之後的 (接在檔案前一個 Block 後面)
+static int group_alloc(AllocGroup *g, int goal) 
+{
+    pthread_mutex_lock(&g->lock);
+    int b=-1;
+    if(goal > g->hint && goal < g->end) b=group_scan(g, goal);
+    if(b < 0) 
+    {
+        b=group_scan(g, g->hint);
+        g->hint = b < 0 ? g->end : b+1;
+    }
+    if(b >= 0) group_take(g, b, 1);
+    pthread_mutex_unlock(&g->lock);
+    return b;
+}
+
+// goal 所在的群組先找,滿了再往後面的群組找 (繞一圈)
+int alloc_block(int goal) 
+{
+    if(ngroups == 0) return -1;
+    uint64_t t0 = stats_begin_sampled();
+    int g0 = (goal >= 0 && goal < sb->total_blocks) ? goal / AG_BLOCKS : 0, b = -1;
+    for(int k=0; k<ngroups && b < 0; k++) 
+    {
+        AllocGroup *g=&groups[(g0+k) % ngroups];
+        if(__atomic_load_n(&g->used, __ATOMIC_RELAXED) >= group_size(g)) continue;
+        b=group_alloc(g, k == 0 ? goal : g->start);
+    }
+    stats_end(ST_ALLOC, t0, 0);
+    return b;
+}
+
 int find_free_block() 
 {
-    for(int i=0; i<sb->total_blocks; i++) 
+    return alloc_block(-1);
+}
+
+// 目錄的 home group: 目錄編號打散到各群組,同一個目錄的檔案放在一起
+int ag_goal(int dir_id) 
+{
+    if(ngroups == 0) return 0;
+    return groups[(int)((uint32_t)dir_id * 2654435761u % (uint32_t)ngroups)].start;
+}
+
+// 在群組 g 裡找第一段連續 n 個空 Block (first fit)
+static int group_run(AllocGroup *g, int n) 
+{
+    int start=-1;
+    int from = g->run_hint[n] > g->hint ? g->run_hint[n] : g->hint;
+    for(int i=from; i<g->end; i++) 
     {
-        if(get_bit(i) == 0) 
+        if(i%8 == 0 && block_bitmap[i/8] == 0xFF) { i += 7; start=-1; continue; }
+        if(get_bit(i)) { start=-1; continue; }
+        if(start == -1) start=i;
+        if(i-start+1 == n) 
         {
-            set_bit(i);
-            sb->used_blocks++;
-            return i;           // 讓 Inode 去紀錄
+            group_take(g, start, n);
+            if(start == g->hint) g->hint = i+1;
+            g->run_hint[n] = i+1;
+            return start;
         }
     }
+    g->run_hint[n] = g->end;
+    return -1;
+}
+
+// 尋找第一段連續 n 個空 Block 並全部配置,回傳開頭,沒有夠長的空段回傳 -1
+// 空段不會跨群組 (n 最多 MAX_BLOCKS_PER_FILE,遠小於一個群組)
+int alloc_run(int n) 
+{
+    if(n <= 0 || n > MAX_BLOCKS_PER_FILE) return -1;
+    for(int k=0; k<ngroups; k++) 
+    {
+        AllocGroup *g=&groups[k];
+        if(__atomic_load_n(&g->used, __ATOMIC_RELAXED) + n > group_size(g)) continue;
+        pthread_mutex_lock(&g->lock);
+        int b=group_run(g, n);
+        pthread_mutex_unlock(&g->lock);
+        if(b >= 0) return b;
+    }
     return -1;
 }
 
+// 指定的 Block 如果是空的就配置它 (磁碟重組失敗時把原本的 Block 拿回來),成功回傳 1
+int claim_block(int block_id) 
+{
+    if(block_id < 0 || block_id >= sb->total_blocks) return 0;
+    AllocGroup *g=group_of(block_id);
+    pthread_mutex_lock(&g->lock);
+    int ok = !get_bit(block_id);
+    if(ok) group_take(g, block_id, 1);
+    pthread_mutex_unlock(&g->lock);
+    return ok;
+}
+
 void free_block(int block_id) 
 {
     // 防呆
     if(block_id < 0 || block_id >= sb->total_blocks) return;
-
+    AllocGroup *g=group_of(block_id);
+    pthread_mutex_lock(&g->lock);
     if(get_bit(block_id)) 
     { 
         clear_bit(block_id);
-        sb->used_blocks--;
+        __atomic_fetch_sub(&g->used, 1, __ATOMIC_RELAXED);
+        if(block_id < g->hint) g->hint = block_id;
+
+        // 包含 block_id 的空段 (最多看 MAX_BLOCKS_PER_FILE 個,不超出群組)
+        int lo=block_id, hi=block_id;
+        while(lo > g->start && hi-lo+1 < MAX_BLOCKS_PER_FILE && !get_bit(lo-1)) lo--;
+        while(hi+1 < g->end && hi-lo+1 < MAX_BLOCKS_PER_FILE && !get_bit(hi+1)) hi++;
+        for(int k=1; k<=hi-lo+1; k++) 
+        {
+            int s=block_id-k+1 > lo ? block_id-k+1 : lo; // 長度 k 且包含 block_id 的空段最早從這裡開始
+            if(g->run_hint[k] > s) g->run_hint[k] = s;
+        }
     }
-}
\ No newline at end of file
+    pthread_mutex_unlock(&g->lock);
+}
+
+// 使用中的 Block 數 = 各群組加總
+int blocks_used() 
+{
+    int n=0;
+    for(int k=0; k<ngroups; k++) n += __atomic_load_n(&groups[k].used, __ATOMIC_RELAXED);
+    return n;
+}
+
+int ag_count() 
+{
+    return ngroups;
+}
+
+void alloc_free() 
+{
+    for(int k=0; k<ngroups; k++) pthread_mutex_destroy(&groups[k].lock);
+    free(groups);
+    groups = NULL; ngroups = 0;
+}
+
+// 依照目前的 Bitmap 重建各群組 (Bitmap 整個換掉後: load, format, restore)
+void alloc_reset() 
+{
+    alloc_free();
+    if(!sb || sb->total_blocks <= 0) return;
+    ngroups = (sb->total_blocks + AG_BLOCKS - 1) / AG_BLOCKS;
+    groups = (AllocGroup*)calloc(ngroups, sizeof(AllocGroup));
+    for(int k=0; k<ngroups; k++) 
+    {
+        AllocGroup *g=&groups[k];
+        pthread_mutex_init(&g->lock, NULL);
+        g->start = k*AG_BLOCKS;
+        g->end = g->start+AG_BLOCKS < sb->total_blocks ? g->start+AG_BLOCKS : sb->total_blocks;
+        g->hint = g->start;
+        for(int n=0; n<=MAX_BLOCKS_PER_FILE; n++) g->run_hint[n] = g->start;
+        // AG_BLOCKS 是 8 的倍數,群組的開頭一定對齊 byte; 最後一個 byte 多出來的 bit 不會被設定
+        for(int i=g->start/8; i<(g->end+7)/8; i++) g->used += __builtin_popcount(block_bitmap[i]);
+    }
+    sb->used_blocks = blocks_used();
+}
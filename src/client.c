@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <string.h>
+#include "myfs_client.h"
+
+#ifdef _WIN32
+// Windows 沒有 Unix domain socket (server 也只有 Linux 版)
+static int sock_connect(const char *path) { (void)path; return -1; }
+static int sock_send(int s, const void *p, int n) { (void)s; (void)p; (void)n; return -1; }
+static int sock_recv(int s, void *p, int n) { (void)s; (void)p; (void)n; return -1; }
+static void sock_close(int s) { (void)s; }
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static int sock_connect(const char *path)
+{
+    struct sockaddr_un addr;
+    if(strlen(path) >= sizeof(addr.sun_path)) return -1;
+    int s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(s < 0) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if(connect(s, (struct sockaddr *)&addr, sizeof(addr)) < 0) { close(s); return -1; }
+    return s;
+}
+
+static int sock_send(int s, const void *p, int n)
+{
+    while(n > 0)
+    {
+        ssize_t k = send(s, p, n, MSG_NOSIGNAL);
+        if(k < 0 && errno == EINTR) continue;
+        if(k <= 0) return -1;
+        p = (const char *)p + k; n -= k;
+    }
+    return 0;
+}
+
+static int sock_recv(int s, void *p, int n)
+{
+    while(n > 0)
+    {
+        ssize_t k = recv(s, p, n, 0);
+        if(k < 0 && errno == EINTR) continue;
+        if(k <= 0) return -1;
+        p = (char *)p + k; n -= k;
+    }
+    return 0;
+}
+
+static void sock_close(int s) { close(s); }
+#endif
+
+struct myfsc
+{
+    int sock;
+    uint32_t tag;
+    char *out; int out_cap;   // 要送出的請求
+    char *in; int in_cap;     // 收到的回應 payload
+};
+
+static char *grow(char **p, int *cap, int n)
+{
+    if(n > *cap)
+    {
+        *cap = n > 2 * *cap ? n : 2 * *cap;
+        *p = realloc(*p, *cap);
+    }
+    return *p;
+}
+
+myfsc_t *myfsc_connect(const char *socket_path)
+{
+    int s = sock_connect(socket_path);
+    if(s < 0) return NULL;
+    uint32_t magic = PROTO_MAGIC;
+    if(sock_send(s, &magic, 4) < 0) { sock_close(s); return NULL; }
+    myfsc_t *c = calloc(1, sizeof(myfsc_t));
+    c->sock = s;
+    return c;
+}
+
+void myfsc_disconnect(myfsc_t *c)
+{
+    if(!c) return;
+    sock_close(c->sock);
+    free(c->out); free(c->in);
+    free(c);
+}
+
+// 送一個請求並等回應,回應的 payload 放在 c->in (*len bytes),回傳 status
+static int call(myfsc_t *c, int op, int fd, int off, int n, const void *payload, int plen, int *len)
+{
+    if(plen > PROTO_MAX_PAYLOAD) return MYFS_EINVAL;
+    MsgReq r = { (uint32_t)plen, ++c->tag, (uint16_t)op, 0, fd, off, n };
+    grow(&c->out, &c->out_cap, sizeof(r) + plen);
+    memcpy(c->out, &r, sizeof(r));
+    if(plen) memcpy(c->out + sizeof(r), payload, plen);
+    MsgResp resp;
+    if(sock_send(c->sock, c->out, sizeof(r) + plen) < 0 || sock_recv(c->sock, &resp, sizeof(resp)) < 0) return MYFS_EIO;
+    grow(&c->in, &c->in_cap, resp.len + 1);
+    if(sock_recv(c->sock, c->in, resp.len) < 0 || resp.tag != r.tag) return MYFS_EIO;
+    if(len) *len = resp.len;
+    return resp.status;
+}
+
+static int call_path(myfsc_t *c, int op, const char *path, int off, int n, int *len)
+{
+    return call(c, op, 0, off, n, path, (int)strlen(path), len);
+}
+
+int myfsc_lookup(myfsc_t *c, const char *path) { return call_path(c, OP_LOOKUP, path, 0, 0, NULL); }
+int myfsc_mkdir(myfsc_t *c, const char *path)  { return call_path(c, OP_MKDIR, path, 0, 0, NULL); }
+int myfsc_unlink(myfsc_t *c, const char *path) { return call_path(c, OP_UNLINK, path, 0, 0, NULL); }
+int myfsc_open(myfsc_t *c, const char *path, int flags) { return call_path(c, OP_OPEN, path, 0, flags, NULL); }
+int myfsc_close(myfsc_t *c, int fd) { return call(c, OP_CLOSE, fd, 0, 0, NULL, 0, NULL); }
+int myfsc_sync(myfsc_t *c) { return call(c, OP_SYNC, 0, 0, 0, NULL, 0, NULL); }
+
+int myfsc_stat(myfsc_t *c, const char *path, myfs_stat_t *st)
+{
+    int len = 0;
+    int r = call_path(c, OP_STAT, path, 0, 0, &len);
+    if(r >= 0 && len == sizeof(*st)) memcpy(st, c->in, sizeof(*st));
+    return r;
+}
+
+int myfsc_pread(myfsc_t *c, int fd, void *buf, int n, int offset)
+{
+    int len = 0;
+    int r = call(c, OP_READ, fd, offset, n, NULL, 0, &len);
+    if(r > 0) memcpy(buf, c->in, len < n ? len : n);
+    return r;
+}
+
+int myfsc_pwrite(myfsc_t *c, int fd, const void *buf, int n, int offset)
+{
+    return call(c, OP_WRITE, fd, offset, n, buf, n, NULL);
+}
+
+int myfsc_listdir(myfsc_t *c, const char *path, int offset, int limit, myfs_dirent_t *ents, int *total)
+{
+    int len = 0;
+    int r = call_path(c, OP_READDIR, path, offset, limit, &len);
+    if(r < 0) return r;
+    if(total) memcpy(total, c->in, sizeof(int));
+    memcpy(ents, c->in + sizeof(int), r * sizeof(myfs_dirent_t));
+    return r;
+}
+
+int myfsc_batch(myfsc_t *c, myfsc_op_t *ops, int count)
+{
+    // 子請求一個接一個放進 payload
+    char *payload = NULL; int cap = 0, plen = 0;
+    for(int i = 0; i < count; i++)
+    {
+        const void *p = ops[i].op == OP_WRITE ? ops[i].data : ops[i].path;
+        int len = ops[i].op == OP_WRITE ? ops[i].n : (p ? (int)strlen(p) : 0);
+        MsgReq r = { (uint32_t)len, (uint32_t)i, (uint16_t)ops[i].op, 0, ops[i].fd, ops[i].off, ops[i].n };
+        grow(&payload, &cap, plen + sizeof(r) + len);
+        memcpy(payload + plen, &r, sizeof(r));
+        if(len) memcpy(payload + plen + sizeof(r), p, len);
+        plen += sizeof(r) + len;
+    }
+    int len = 0;
+    int r = call(c, OP_BATCH, 0, 0, 0, payload, plen, &len);
+    free(payload);
+    if(r < 0) return r;
+
+    // 回應也是一個接一個
+    int pos = 0;
+    for(int i = 0; i < count; i++)
+    {
+        if(i >= r || pos + (int)sizeof(MsgResp) > len) { ops[i].status = MYFS_EINVAL; continue; }
+        MsgResp s;
+        memcpy(&s, c->in + pos, sizeof(s));
+        const char *d = c->in + pos + sizeof(s);
+        ops[i].status = s.status;
+        if(s.status >= 0 && ops[i].out)
+        {
+            if(ops[i].op == OP_READ) memcpy(ops[i].out, d, (int)s.len < ops[i].n ? (int)s.len : ops[i].n);
+            else if(ops[i].op == OP_STAT && s.len == sizeof(myfs_stat_t)) memcpy(ops[i].out, d, s.len);
+            else if(ops[i].op == OP_READDIR) memcpy(ops[i].out, d + sizeof(int), s.status * sizeof(myfs_dirent_t));
+        }
+        pos += sizeof(s) + s.len;
+    }
+    return MYFS_OK;
+}
@@ -10,119 +10,270 @@
 #include "utils.h"
 #include "editor.h"
 #include "security.h"
+#include "stream.h"
+#include "myfs.h"
+#include "path.h"
+#include "search.h"
+#include "rx.h"
+#include "trigram.h"
+#include "find.h"
+#include "gen.h"
+#include "backup.h"
+#include "hostsync.h"
+#include "defrag.h"
+#include "heat.h"
+#include "writeback.h"
+#include "bcache.h"
+#include "bio.h"
+#include "stats.h"
+
+// 印出 libmyfs 的錯誤訊息
+static void report(const char *name, int err) 
+{
+    out_printf(C_ERR "%s: %s\n" C_RESET, name, myfs_strerror(err));
+}
+
+// 讀出整個檔案 (hexdump 用),呼叫者負責 free
+static char *read_whole(char *name, int *len) 
+{
+    int fd = myfs_open(name, MYFS_O_RDONLY);
+    if(fd < 0) { report(name, fd); return NULL; }
+    myfs_stat_t st; myfs_fstat(fd, &st);
+    char *buf = malloc(st.size+1);
+    int n = myfs_read(fd, buf, st.size);
+    myfs_close(fd);
+    if(n < 0) n = 0;
+    buf[n] = 0; *len = n;
+    return buf;
+}
 
-// 匯檔 (for Put, Redirection)
-void import_host_file(char *host_path, char *vfs_name) 
+// 匯檔 (for Put),回傳寫入的 bytes
+int import_host_file(char *host_path, char *vfs_name) 
 {
     // 開 Host 的檔案
     FILE *fp = fopen(host_path, "rb");
-    if(!fp) return;
-
-    // 計算檔案大小
-    fseek(fp,0,SEEK_END); int sz=ftell(fp); fseek(fp,0,SEEK_SET);
+    if(!fp) return MYFS_EIO;
 
     // 是否已有同名檔案 (若有則覆寫)
-    int old = find_inode_by_name(vfs_name, current_dir_id);
-    if(old!=-1) 
+    int fd = myfs_open(vfs_name, MYFS_O_WRONLY|MYFS_O_CREAT|MYFS_O_TRUNC);
+    if(fd < 0) { fclose(fp); return fd; }
+
+    // 一次搬一個 Block 的量,直接寫進 VFS
+    char buf[BLOCK_SIZE]; size_t n; int total = 0;
+    while((n = fread(buf, 1, sizeof(buf), fp)) > 0) 
     {
-        // 若有,先釋出舊檔佔用的 Blocks
-        int obs = (inode_table[old].size+BLOCK_SIZE-1)/BLOCK_SIZE;
-        for(int b=0; b<obs; b++) free_block(inode_table[old].blocks[b]);
-        inode_table[old].size=0; sb->used_inodes--;
+        int w = myfs_write(fd, buf, (int)n);
+        if(w < 0) { total = w; break; }
+        total += w;
+        if(w < (int)n) { total = MYFS_EFBIG; break; }
     }
+    myfs_close(fd);
+    fclose(fp);
+    return total;
+}
 
-    // 取得一個新的 Inode (若有舊檔就用舊的 ID)
-    int idx = (old!=-1)?old:find_free_inode();
-    if(idx==-1){fclose(fp);return;}
-    
-    inode_table[idx].is_used=1; inode_table[idx].is_dir=0; inode_table[idx].permission=7;
-    strcpy(inode_table[idx].name, vfs_name); inode_table[idx].parent_id=current_dir_id;
-    inode_table[idx].size=sz;
-    
-    // 計算需要多少個 Blocks,並寫入data
-    int needs=(sz+BLOCK_SIZE-1)/BLOCK_SIZE;
+// 把記憶體中的資料直接寫進 VFS 檔案 (for Redirection >, >>)
+// append=1 時接在檔尾,只補滿最後一個 Block 再配新的,不用重讀整個檔案
+int write_file_data(char *vfs_name, const char *data, int len, int append) 
+{
+    int fd = myfs_open(vfs_name, MYFS_O_WRONLY|MYFS_O_CREAT|(append ? MYFS_O_APPEND : MYFS_O_TRUNC));
+    if(fd < 0) 
+    { 
+        printf(C_ERR "Error: %s: %s\n" C_RESET, vfs_name, myfs_strerror(fd)); return -1; 
+    }
+    int w = myfs_write(fd, data, len);
+    myfs_close(fd);
+    if(w < 0) 
+    {
+        printf(C_ERR "Error: %s\n" C_RESET, myfs_strerror(w)); return -1;
+    }
+    if(w < len) printf(C_WARN "Warning: output truncated to %d bytes.\n" C_RESET, w);
+    return w;
+}
 
-    for(int i=0; i<needs; i++) 
+// 時間戳記轉成字串 (0 = 舊映像檔沒有記錄)
+static const char *fmt_time(long long t, const char *fmt, char *buf, int size) 
+{
+    if(t==0) return "-";
+    time_t tt=(time_t)t;
+    strftime(buf, size, fmt, localtime(&tt));
+    return buf;
+}
+
+// 排序後逐頁讀出目錄 (一次 256 筆),limit < 0 = 全部
+static void list_dir(char *path, int sort, int offset, int limit, int longfmt) 
+{
+    myfs_dirent_t ents[256];
+    int total=0, shown=0, r;
+    if(!path) path=".";
+    if(longfmt) 
     {
-        int bid=find_free_block(); 
-        inode_table[idx].blocks[i]=bid;
-        fread(data_blocks[bid].data, 1, BLOCK_SIZE, fp);
+        out_printf("%-6s %-6s %-6s %-16s %s\n", "Mode", "Type", "Size", "Modified", "Name");
+        out_printf("---------------------------------------------------------\n");
     }
-    if(old==-1) sb->used_inodes++; // if is new
-    fclose(fp);
+    do 
+    {
+        int want=256;
+        if(limit>=0 && limit-shown<want) want=limit-shown;
+        r=myfs_listdir(path, sort, offset+shown, want, ents, &total);
+        if(r<0) { report(path, r); return; }
+        for(int k=0; k<r; k++) 
+        {
+            myfs_dirent_t *e=&ents[k];
+            char tb[32];
+            if(longfmt) out_printf("%-6d %-6s %-6d %-16s %s%s%s\n", e->permission, e->is_dir ? "DIR" : "FILE", e->size,
+                                   fmt_time(e->mtime, "%Y-%m-%d %H:%M", tb, sizeof(tb)), e->is_dir?C_DIR:C_FILE, e->name, C_RESET);
+            else out_printf("%s%s%s  ", e->is_dir?C_DIR:C_FILE, e->name, C_RESET);
+        }
+        shown+=r;
+    } while(r>0 && (limit<0 || shown<limit));
+    if(!longfmt && shown) out_printf("\n");
+    // 分頁時告訴使用者下一頁從哪裡開始
+    if(limit>=0 && offset+shown<total) 
+        out_printf("-- %d-%d of %d (next: --offset %d)\n", offset+1, offset+shown, total, offset+shown);
 }
 
-// funtion: ls
-void cmd_ls() 
+// funtion: ls [dir]
+void cmd_ls(char *path, int sort, int offset, int limit) 
 {
-    int f=0;
+    list_dir(path, sort, offset, limit, 0);
+}
 
-    for(int i=0; i<MAX_FILES; i++) 
+// funtion: ls -l [dir]
+void cmd_ll(char *path, int sort, int offset, int limit) 
+{
+    list_dir(path, sort, offset, limit, 1);
+}
+
+// 取出路徑最後一層的名稱
+static char *base_name(char *path) 
+{
+    char *p = strrchr(path, '/');
+    return p ? p+1 : path;
+}
+
+// 找出多個名稱對應的 Inode (ids[k] = -1 代表找不到)
+// 含 '/' 的路徑走 Dentry Cache 解析,目前目錄下的單純檔名則一起掃一次 Inode Table
+static void lookup_names(int n, char **names, int *ids) 
+{
+    int left = 0;
+    for(int k=0; k<n; k++) 
     {
-        // 顯示已使用且父目錄是當前目錄的檔
-        if(inode_table[i].is_used && inode_table[i].parent_id==current_dir_id) 
+        ids[k] = -1;
+        if(strchr(names[k], '/') || strcmp(names[k], "..")==0 || strcmp(names[k], ".")==0) 
+        {
+            int r = path_resolve(names[k], current_dir_id, NULL, NULL);
+            ids[k] = (r < 0) ? -2 : r; // -2 = 解析過但找不到
+        }
+        else 
         {
-            if(current_dir_id==0 && i==0) continue; // 跳過自己
-            printf("%s%s%s  ", inode_table[i].is_dir?C_DIR:C_FILE, inode_table[i].name, C_RESET);
-            f=1;
+            int hit = dcache_lookup(current_dir_id, names[k]);
+            if(hit != -1) ids[k] = hit; else left++;
         }
     }
-    if(f) printf("\n");
+    for(int i=0; i<sb->total_inodes && left>0; i++) 
+    {
+        if(!inode_table[i].is_used || inode_table[i].parent_id!=current_dir_id) continue;
+        if(current_dir_id==0 && i==0) continue;
+        for(int k=0; k<n; k++) 
+        {
+            if(ids[k]==-1 && strcmp(inode_table[i].name, names[k])==0) 
+            { 
+                ids[k]=i; left--;
+                dcache_insert(current_dir_id, names[k], i);
+                break; 
+            }
+        }
+    }
+    for(int k=0; k<n; k++) if(ids[k]==-2) ids[k]=-1;
 }
 
-// funtion: ls -l
-void cmd_ll() 
+// funtion: mkdir a b c / touch a b c
+// 一次掃描確認哪些已存在,再從同一個游標往後配置 Inode (路徑則逐一建立)
+static void create_list(int n, char **names, int is_dir) 
 {
-    printf("%-6s %-6s %-6s %s\n", "Mode", "Type", "Size", "Name");
-    printf("----------------------------------------\n");
-
-    for(int i=0; i<MAX_FILES; i++) 
+    int *ids = malloc(sizeof(int)*n);
+    lookup_names(n, names, ids);
+    int cursor = 0;
+    for(int k=0; k<n; k++) 
     {
-        if(inode_table[i].is_used && inode_table[i].parent_id==current_dir_id) 
+        if(ids[k]!=-1) 
+        {
+            if(is_dir) out_printf(C_ERR "'%s' already exists.\n" C_RESET, names[k]);
+            continue; 
+        }
+        if(strchr(names[k], '/')) 
         {
-            if(current_dir_id==0 && i==0) continue;
-            
-            char *type = inode_table[i].is_dir ? "DIR" : "FILE";
-            
-            printf("%-6d %-6s %-6d %s%s%s\n", 
-                   inode_table[i].permission, 
-                   type, 
-                   inode_table[i].size, 
-                   inode_table[i].is_dir?C_DIR:C_FILE,
-                   inode_table[i].name,
-                   C_RESET);
+            if(is_dir) cmd_mkdir(names[k]); else cmd_touch(names[k]);
+            continue;
+        }
+        int idx = inode_create(current_dir_id, names[k], is_dir, cursor);
+        if(idx==-1) 
+        { 
+            out_printf(C_ERR "Error: No free inodes.\n" C_RESET); break; 
         }
+        cursor = idx+1;
+        // 同一批裡重複的名字只建立一次
+        for(int j=k+1; j<n; j++) if(strcmp(names[j], names[k])==0) ids[j]=idx;
     }
+    free(ids);
+}
+
+void cmd_mkdir_list(int n, char **names) 
+{ 
+    create_list(n, names, 1); 
+}
+
+void cmd_touch_list(int n, char **names) 
+{ 
+    create_list(n, names, 0); 
 }
 
 // funtion: mkdir
 void cmd_mkdir(char *name) 
 {
-    int idx=find_free_inode(); if(idx==-1) return; // 找空的 Inode
-    // 設定屬性 (is_dir=1)
-    inode_table[idx].is_used=1; inode_table[idx].is_dir=1; inode_table[idx].permission=7;
-    strcpy(inode_table[idx].name, name); inode_table[idx].parent_id=current_dir_id;
-    sb->used_inodes++;
+    int r=myfs_mkdir(name);
+    if(r<0) report(name, r);
+}
+
+// 跟 coreutils 一樣拒絕刪 . / .. / 根目錄,以及包含目前目錄的目錄 (刪掉之後 cwd 會指到已釋放的 Inode)
+static int rm_refused(const char *name, int idx)
+{
+    const char *base = base_name((char *)name);
+    if(strcmp(base, ".")==0 || strcmp(base, "..")==0) 
+    {
+        out_printf(C_ERR "rm: refusing to remove '.' or '..' directory: skipping '%s'\n" C_RESET, name); return 1;
+    }
+    if(idx==0) 
+    { 
+        out_printf(C_ERR "rm: it is dangerous to operate recursively on '/'\n" C_RESET); return 1; 
+    }
+    for(int p=current_dir_id; p!=0; p=inode_table[p].parent_id) if(p==idx) 
+    {
+        out_printf(C_ERR "rm: refusing to remove '%s': it contains the current directory\n" C_RESET, name); return 1;
+    }
+    return 0;
 }
 
 // funtion: rm -r
 void cmd_rm_r(char *name) 
 {
-    int idx=find_inode_by_name(name, current_dir_id);
-    if(idx==-1) 
+    int idx=path_resolve(name, current_dir_id, NULL, NULL);
+    if(idx<0) 
     { 
-        printf(C_ERR "Not found.\n" C_RESET); return; 
+        out_printf(C_ERR "Not found.\n" C_RESET); return; 
     }
+    if(rm_refused(name, idx)) return;
 
     // !!權限檢查!! 必須有 Write權限才能刪
     if ( !(inode_table[idx].permission & 2) ) 
     {
-        printf(C_ERR "Error: Permission denied (Write protected).\n" C_RESET);
+        out_printf(C_ERR "Error: Permission denied (Write protected).\n" C_RESET);
         return;
     }
 
     recursive_delete(idx);
-    printf("Removed '%s'.\n", name);
+    out_printf("Removed '%s'.\n", name);
 }
 
 // funtion: rm
@@ -131,337 +282,409 @@ void cmd_rm(char *name)
     cmd_rm_r(name); 
 }
 
+// funtion: rm a b c,一次掃描找出所有目標再逐一釋放
+void cmd_rm_list(int n, char **names) 
+{
+    int *ids = malloc(sizeof(int)*n);
+    lookup_names(n, names, ids);
+    for(int k=0; k<n; k++) 
+    {
+        int idx = ids[k];
+        if(idx<0 || !inode_table[idx].is_used) 
+        { 
+            out_printf(C_ERR "'%s': Not found.\n" C_RESET, names[k]); continue; 
+        }
+        if(rm_refused(names[k], idx)) continue;
+        // !!權限檢查!! 必須有 Write權限才能刪
+        if ( !(inode_table[idx].permission & 2) ) 
+        {
+            out_printf(C_ERR "'%s': Permission denied (Write protected).\n" C_RESET, names[k]);
+            continue;
+        }
+        recursive_delete(idx);
+        out_printf("Removed '%s'.\n", names[k]);
+    }
+    free(ids);
+}
+
 // funtion: mv
 void cmd_mv(char *src, char *dest) 
 {
-    int s=find_inode_by_name(src, current_dir_id); if(s==-1) return;
-    int d=find_inode_by_name(dest, current_dir_id);
-    
-    // 如果target是一個已存在的目錄,則將檔案移進去 (改 parent_id)
-    if(d!=-1 && inode_table[d].is_dir) 
-    {
-        inode_table[s].parent_id=d;
-    } 
-    else 
-    {
-        strcpy(inode_table[s].name, dest);
+    // 如果target是一個已存在的目錄,則將檔案移進去 (改 parent_id),否則改名
+    int r=myfs_rename(src, dest);
+    if(r<0) report(src, r);
+}
+
+// 解析目標目錄,不是目錄就印錯誤並回傳 -1
+static int resolve_dir(char *dir) 
+{
+    int d=path_resolve(dir, current_dir_id, NULL, NULL);
+    if(d<0 || !inode_table[d].is_dir) 
+    { 
+        out_printf(C_ERR "'%s' is not a directory.\n" C_RESET, dir); return -1; 
     }
+    return d;
 }
 
-// funtion: cp
-void cmd_cp(char *src, char *dest) 
+// funtion: mv a b c dir,一次掃描找出所有來源
+void cmd_mv_into(int n, char **srcs, char *dir) 
 {
-    int s=find_inode_by_name(src, current_dir_id); if(s==-1 || inode_table[s].is_dir) return;
-    int d=find_free_inode(); if(d==-1) return;
+    int d=resolve_dir(dir); if(d<0) return;
+    int *ids = malloc(sizeof(int)*n);
+    lookup_names(n, srcs, ids);
+    for(int k=0; k<n; k++) 
+    {
+        if(ids[k]<=0) { out_printf(C_ERR "'%s': Not found.\n" C_RESET, srcs[k]); continue; }
+        if(ids[k]==d || inode_table[ids[k]].parent_id==d) continue;
+        if(find_inode_by_name(inode_table[ids[k]].name, d)!=-1) 
+        { 
+            out_printf(C_ERR "'%s': File exists in '%s'.\n" C_RESET, srcs[k], dir); continue; 
+        }
+        // 不能把目錄搬進自己底下
+        int loop=0;
+        for(int p=d; p!=0; p=inode_table[p].parent_id) if(p==ids[k]) loop=1;
+        if(loop) { out_printf(C_ERR "'%s': Cannot move into itself.\n" C_RESET, srcs[k]); continue; }
+        dcache_invalidate(ids[k]);
+        inode_table[ids[k]].parent_id=d;
+        inode_changed(ids[k]);
+        dir_changed(d);
+    }
+    free(ids);
+}
 
-    // 複製屬性
-    inode_table[d]=inode_table[s]; inode_table[d].id=d;
-    strcpy(inode_table[d].name, dest);
+// 複製一個檔案到 dest_dir 底下,新 Inode 從 *cursor 開始找
+static int copy_file(int s, int dest_dir, char *dest_name, int *cursor) 
+{
+    int d=inode_create(dest_dir, dest_name, 0, *cursor); if(d==-1) return -1;
+    *cursor = d+1;
+    inode_table[d].permission=inode_table[s].permission;
 
-    // 複製資料
-    int blks=(inode_table[s].size+BLOCK_SIZE-1)/BLOCK_SIZE;
-    for(int i=0; i<blks; i++) 
+    // 複製資料: 一次一個 Block,直接從來源 Block 寫進新檔案
+    for(int off=0; off<inode_table[s].size; off+=BLOCK_SIZE) 
     {
-        int nb=find_free_block();
-        inode_table[d].blocks[i]=nb;
-        memcpy(data_blocks[nb].data, data_blocks[inode_table[s].blocks[i]].data, BLOCK_SIZE);
+        int cp=inode_table[s].size-off; if(cp>BLOCK_SIZE) cp=BLOCK_SIZE;
+        int bid=inode_table[s].blocks[off/BLOCK_SIZE];
+        heat_read(bid);
+        int w=inode_write(d, blk_get(bid, BLK_READ), cp, off);
+        blk_put(bid, BLK_READ);
+        if(w < cp) 
+        { 
+            out_printf(C_ERR "Error: Disk full (partial copy).\n" C_RESET); break; 
+        }
     }
-    sb->used_inodes++;
+    return d;
 }
 
-// funtion: put
-void cmd_put(char *host_filename) 
+void cmd_cp(char *src, char *dest) 
 {
-    FILE *f = fopen(host_filename, "rb");
-    if (f == NULL) 
+    int s=path_resolve(src, current_dir_id, NULL, NULL);
+    if(s<0 || inode_table[s].is_dir) 
+    { 
+        out_printf(C_ERR "'%s': Not a file.\n" C_RESET, src); return; 
+    }
+    int cursor=0;
+
+    // 目標是已存在的目錄就複製到裡面 (同 mv),已存在的檔案則覆蓋
+    int parent; char leaf[MAX_FILENAME];
+    int d=path_resolve(dest, current_dir_id, &parent, leaf);
+    if(d>=0 && inode_table[d].is_dir) 
     {
-        printf("Error: Host file '%s' not found.\n", host_filename);
-        return;
+        parent=d; strcpy(leaf, base_name(src));
+        d=find_inode_by_name(leaf, parent);
     }
+    else if(d<0 && parent<0) { report(dest, d); return; }
 
-    // 計算檔案大小
-    fseek(f, 0, SEEK_END);
-    int filesize = ftell(f);
-    fseek(f, 0, SEEK_SET);
+    if(d>=0) 
+    {
+        if(d==s) return;
+        if(inode_table[d].is_dir || !(inode_table[d].permission & 2)) 
+        { 
+            report(dest, inode_table[d].is_dir ? MYFS_EISDIR : MYFS_EACCES); return; 
+        }
+        recursive_delete(d);
+    }
+    if(copy_file(s, parent, leaf, &cursor)==-1) out_printf(C_ERR "Error: No free inodes.\n" C_RESET);
+}
 
-    // 找空 Inode
-    int idx = find_free_inode();
-    if (idx == -1) 
+// funtion: cp f1 f2 dir,一次掃描找出來源,Inode/Block 都用同一個游標連續配置
+void cmd_cp_into(int n, char **srcs, char *dir) 
+{
+    int d=resolve_dir(dir); if(d<0) return;
+    int *ids = malloc(sizeof(int)*n);
+    lookup_names(n, srcs, ids);
+    int cursor=0;
+    for(int k=0; k<n; k++) 
     {
-        printf("Error: No free inodes in VFS.\n");
-        fclose(f);
-        return;
+        if(ids[k]==-1 || inode_table[ids[k]].is_dir) 
+        { 
+            out_printf(C_ERR "'%s': Not a file.\n" C_RESET, srcs[k]); continue; 
+        }
+        if(find_inode_by_name(base_name(srcs[k]), d)!=-1) 
+        { 
+            out_printf(C_ERR "'%s': File exists in '%s'.\n" C_RESET, srcs[k], dir); continue; 
+        }
+        if(copy_file(ids[k], d, base_name(srcs[k]), &cursor)==-1) 
+        { 
+            out_printf(C_ERR "Error: No free inodes.\n" C_RESET); break; 
+        }
     }
+    free(ids);
+}
 
+// funtion: put
+void cmd_put(char *host_filename) 
+{
     // 去除路徑,只留檔名
     char *vfs_name = strrchr(host_filename, '/');
     if (!vfs_name) vfs_name = strrchr(host_filename, '\\');
     if (vfs_name) vfs_name++;
     else vfs_name = host_filename;
 
-    inode_table[idx].is_used = 1;
-    inode_table[idx].is_dir = 0;
-    inode_table[idx].size = filesize;
-    inode_table[idx].parent_id = current_dir_id;
-    inode_table[idx].permission = 7;
-    strncpy(inode_table[idx].name, vfs_name, 31);
-    inode_table[idx].name[31] = '\0';
-
-    // 分配 Block 並寫入data
-    int blocks_needed = (filesize + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    char buffer[BLOCK_SIZE];
-
-    for (int i = 0; i < blocks_needed; i++) 
+    int r = import_host_file(host_filename, vfs_name);
+    if (r == MYFS_EIO) 
     {
-        int bid = find_free_block();
-        if (bid == -1) 
-        {
-            printf("Error: Disk full (partial write).\n");
-            break;
-        }
-        inode_table[idx].blocks[i] = bid;
-        
-        memset(buffer, 0, BLOCK_SIZE);
-        fread(buffer, 1, BLOCK_SIZE, f);
-        memcpy(data_blocks[bid].data, buffer, BLOCK_SIZE);
+        out_printf("Error: Host file '%s' not found.\n", host_filename);
+        return;
     }
+    if (r < 0) { report(vfs_name, r); return; }
+    out_printf("Put '%s' done. (Size: %d bytes)\n", vfs_name, r);
+}
 
-    sb->used_inodes++;
-    fclose(f);
-    printf("Put '%s' done. (Size: %d bytes)\n", vfs_name, filesize);
+// funtion: sync (Host 檔案 -> VFS 檔案,只重寫有變的 Block)
+void cmd_sync(char *host_path, char *vfs_path)
+{
+    SyncStats st;
+    uint64_t t0 = now_ns();
+    int r = host_sync(host_path, vfs_path, &st);
+    if (r == MYFS_ENOENT) { out_printf("Error: Host file '%s' not found.\n", host_path); return; }
+    if (r < 0) { report(vfs_path, r); return; }
+    if (st.skipped) { out_printf("'%s' is up to date (same size and mtime).\n", vfs_path); return; }
+    out_printf("Synced '%s' -> '%s' (%d bytes, %.2f ms)\n", host_path, vfs_path, st.size, (now_ns() - t0) / 1e6);
+    out_printf("  %d blocks: %d unchanged, %d moved, %d written, %d freed\n",
+               st.blocks, st.unchanged, st.moved, st.written, st.freed);
 }
 
 // funtion: get
 void cmd_get(char *fs_filename) 
 {
-    int idx=find_inode_by_name(fs_filename, current_dir_id);
-    if(idx==-1 || inode_table[idx].is_dir) return;
-
-    // !!權限檢查!! 必須有 Read 權限
-    if ( !(inode_table[idx].permission & 4) ) 
-    {
-        printf(C_ERR "Error: Permission denied (Read protected).\n" C_RESET);
-        return;
-    }
+    // !!權限檢查!! 必須有 Read 權限 (myfs_open 會檢查)
+    int fd=myfs_open(fs_filename, MYFS_O_RDONLY);
+    if(fd<0) { report(fs_filename, fd); return; }
 
     create_host_dir("dump"); 
-    char path[512]; snprintf(path, 512, "dump/%s", fs_filename);
+    char *base=strrchr(fs_filename, '/'); base = base ? base+1 : fs_filename;
+    char path[512]; snprintf(path, 512, "dump/%s", base);
     
-    FILE *fp=fopen(path, "wb"); if(!fp) return;
-    int rem=inode_table[idx].size; int b=0;
+    FILE *fp=fopen(path, "wb"); if(!fp) { myfs_close(fd); return; }
     
     // 寫出資料到 Host 檔案
-    while(rem>0) 
-    {
-        int cp=(rem>BLOCK_SIZE)?BLOCK_SIZE:rem;
-        fwrite(data_blocks[inode_table[idx].blocks[b]].data, 1, cp, fp);
-        rem-=cp; b++;
-    }
+    char buf[BLOCK_SIZE]; int n;
+    while((n=myfs_read(fd, buf, sizeof(buf))) > 0) fwrite(buf, 1, n, fp);
     fclose(fp);
-    printf("Saved to %s\n", path);
+    myfs_close(fd);
+    out_printf("Saved to %s\n", path);
 }
 
 // funtion: cat
 void cmd_cat(char *name) 
 {
-    int idx=find_inode_by_name(name, current_dir_id);
-    if(idx==-1) 
+    // 沒給檔名時讀 Pipe 的輸入 (ex: ls | cat > list.txt)
+    if(!name) 
     {
-        printf(C_ERR "File not found.\n" C_RESET);
-        return;
-    }
-    if(inode_table[idx].is_dir) {
-        printf(C_ERR "Is a directory.\n" C_RESET);
+        if(pipe_in) out_write(pipe_in, pipe_in_len);
         return;
     }
 
-    // !!權限檢查!! 必須有 Read權限
-    if ( !(inode_table[idx].permission & 4) ) 
-    { 
-        printf(C_ERR "Error: Permission denied (Read protected).\n" C_RESET);
+    // !!權限檢查!! 必須有 Read權限 (myfs_open 會檢查)
+    int fd=myfs_open(name, MYFS_O_RDONLY);
+    if(fd<0) 
+    {
+        if(fd==MYFS_ENOENT) out_printf(C_ERR "File not found.\n" C_RESET);
+        else if(fd==MYFS_EISDIR) out_printf(C_ERR "Is a directory.\n" C_RESET);
+        else out_printf(C_ERR "Error: Permission denied (Read protected).\n" C_RESET);
         return;
     }
 
     // 讀取 Block 資料
-    int rem=inode_table[idx].size; int b=0;
-    while(rem>0) 
-    {
-        int cp=(rem>BLOCK_SIZE)?BLOCK_SIZE:rem;
-        fwrite(data_blocks[inode_table[idx].blocks[b]].data, 1, cp, stdout);
-        rem-=cp; b++;
-    }
-    printf("\n");
+    char buf[BLOCK_SIZE*4]; int n;
+    while((n=myfs_read(fd, buf, sizeof(buf))) > 0) out_write(buf, n);
+    myfs_close(fd);
+    out_printf("\n");
 }
 
 // funtion: tree
 void print_tree_rec(int dir_id, int depth) 
 {
-    for(int i=0; i<MAX_FILES; i++) 
+    for(int i=0; i<sb->total_inodes; i++) 
     {
         if(inode_table[i].is_used && inode_table[i].parent_id==dir_id) 
         {
             if(dir_id==0 && i==0) continue;
             // 根據深度印縮排
-            for(int k=0; k<depth; k++) printf("  ");
-            printf("|-- %s%s%s\n", inode_table[i].is_dir?C_DIR:C_FILE, inode_table[i].name, C_RESET);
+            for(int k=0; k<depth; k++) out_printf("  ");
+            out_printf("|-- %s%s%s\n", inode_table[i].is_dir?C_DIR:C_FILE, inode_table[i].name, C_RESET);
             // 如果是目錄,遞迴呼叫
             if(inode_table[i].is_dir) print_tree_rec(i, depth+1);
         }
     }
 }
 
-void cmd_tree() 
+void cmd_tree(char *path) 
 { 
-    printf(".\n"); print_tree_rec(current_dir_id, 0); 
+    int dir=current_dir_id;
+    if(path && (dir=resolve_dir(path))<0) return;
+    out_printf("%s\n", path ? inode_path(dir) : "."); print_tree_rec(dir, 0); 
 }
 
 // funtion: chmod
 void cmd_chmod(char *mode, char *name) 
 {
-    int idx=find_inode_by_name(name, current_dir_id);
-    if(idx!=-1) 
-    {
-        // only owner permission
-        inode_table[idx].permission=atoi(mode);
-        printf("Changed permission of '%s' to %d\n", name, inode_table[idx].permission);
-    } 
-    else 
-    {
-        printf(C_ERR "File not found.\n" C_RESET);
-    }
+    // only owner permission
+    int r=myfs_chmod(name, atoi(mode));
+    if(r==MYFS_ENOENT) out_printf(C_ERR "File not found.\n" C_RESET);
+    else if(r<0) report(name, r);
+    else out_printf("Changed permission of '%s' to %d\n", name, atoi(mode));
 }
 
 // funtion: pwd
 void cmd_pwd() 
 { 
-    printf("%s\n", current_path); 
+    out_printf("%s\n", current_path); 
 }
 
 // funtion: touch
 void cmd_touch(char *name) 
 {
-    if(find_inode_by_name(name, current_dir_id)!=-1) return; 
-    int idx=find_free_inode(); if(idx==-1) return;
-    
-    inode_table[idx].is_used=1; inode_table[idx].is_dir=0; inode_table[idx].permission=7;
-    strcpy(inode_table[idx].name, name); inode_table[idx].parent_id=current_dir_id;
-    inode_table[idx].size=0; sb->used_inodes++;
-    
-    // 預先分配一個 Block
-    int bid=find_free_block(); inode_table[idx].blocks[0]=bid;
+    int fd=myfs_open(name, MYFS_O_WRONLY|MYFS_O_CREAT);
+    if(fd>=0) myfs_close(fd);
 }
 
 // funtion: rmdir
 void cmd_rmdir(char *name) 
 {
-    int idx=find_inode_by_name(name, current_dir_id);
-    if(idx==-1 || !inode_table[idx].is_dir) return;
-    
-    for(int i=0; i<MAX_FILES; i++) if(inode_table[i].is_used && inode_table[i].parent_id==idx) 
-    {
-        printf(C_ERR "Dir not empty.\n" C_RESET); return;
-    }
-    inode_table[idx].is_used=0; sb->used_inodes--;
+    int r=myfs_rmdir(name);
+    if(r==MYFS_ENOTEMPTY) out_printf(C_ERR "Dir not empty.\n" C_RESET);
+    else if(r<0) report(name, r);
 }
 
 // funtion: append
 void cmd_append(char *name, char *text) 
 {
-    int idx=find_inode_by_name(name, current_dir_id);
-    if(idx==-1) 
-    { 
-        cmd_touch(name); idx=find_inode_by_name(name, current_dir_id); 
-    }
-    if(inode_table[idx].is_dir) return;
+    // 接在檔尾寫入,Block 滿了自動要新的 Block (不存在就建立)
+    if(write_file_data(name, text, strlen(text), 1) >= 0) out_printf("Appended.\n");
+}
 
-    // !!權限檢查!! 必須有 Write 權限
-    if ( !(inode_table[idx].permission & 2) ) 
-    {
-        printf(C_ERR "Error: Permission denied (Write protected).\n" C_RESET);
-        return;
-    }
+// grep 的輸出 (多個檔案時每行前面加檔名)
+typedef struct { const char *prefix; int flags; } GrepOut;
 
-    int len=strlen(text);
-    int offset = inode_table[idx].size;
-    
-    // 一一寫入,若 Block 滿了自動要新的 Block
-    for(int i=0; i<len; i++) 
-    {
-        int pos = offset+i;
-        int b_idx = pos/BLOCK_SIZE;
-        int b_off = pos%BLOCK_SIZE;
-        if(inode_table[idx].blocks[b_idx]==0) inode_table[idx].blocks[b_idx]=find_free_block();
-        data_blocks[inode_table[idx].blocks[b_idx]].data[b_off]=text[i];
-    }
-    inode_table[idx].size+=len;
-    printf("Appended.\n");
+static void grep_print(void *ctx, int lineno, const char *line, int len)
+{
+    GrepOut *g=ctx;
+    if(g->prefix) out_printf("%s:", g->prefix);
+    if(g->flags & GREP_LINENO) out_printf("%d:", lineno);
+    out_write(line, len); out_write("\n", 1);
 }
 
 // funtion: grep
-void cmd_grep(char *key, char *fname) 
+void cmd_grep(int flags, char *key, int nfiles, char **files) 
 {
-    int idx=find_inode_by_name(fname, current_dir_id);
-    if(idx==-1 || inode_table[idx].is_dir) return;
+    GrepOut g={ NULL, flags };
+    char *here=".";
+    if(nfiles==0 && (flags & GREP_RECURSE)) { nfiles=1; files=&here; } // grep -r 預設搜尋目前目錄
 
-    // !!權限檢查!! 必須有 Read 權限
-    if ( !(inode_table[idx].permission & 4) ) 
-    { 
-        printf(C_ERR "Permission denied.\n" C_RESET); return; 
+    // grep -E: 先確認 pattern 編得過
+    if(flags & GREP_REGEX)
+    {
+        char err[128];
+        Regex *rx=rx_compile(key, err, sizeof(err));
+        if(!rx) { out_printf(C_ERR "grep: bad pattern: %s\n" C_RESET, err); return; }
+        rx_free(rx);
     }
 
-    // 讀整個檔案到 buffer
-    char *buf=malloc(inode_table[idx].size+1);
-    int rem=inode_table[idx].size; int p=0; int b=0;
-    while(rem>0) 
+    // 沒給檔名時搜尋 Pipe 的輸入 (ex: cat log | grep ERROR)
+    if(nfiles==0) 
     {
-        int cp=(rem>BLOCK_SIZE)?BLOCK_SIZE:rem;
-        memcpy(buf+p, data_blocks[inode_table[idx].blocks[b]].data, cp);
-        p+=cp; rem-=cp; b++;
+        if(!pipe_in) return;
+        int n=grep_memory(pipe_in, pipe_in_len, key, flags, grep_print, &g);
+        if(flags & GREP_COUNT) out_printf("%d\n", n);
+        return;
+    }
+
+    for(int i=0; i<nfiles; i++)
+    {
+        myfs_stat_t st;
+        int r=myfs_stat(files[i], &st);
+        if(r<0) { report(files[i], r); continue; }
+
+        // grep -r <dir>: 整個目錄樹交給 worker pool,輸出依路徑排序
+        if(st.is_dir)
+        {
+            if(!(flags & GREP_RECURSE)) { report(files[i], MYFS_EISDIR); continue; }
+            GrepResult *res;
+            int n=grep_tree(st.ino, key, flags & ~GREP_RECURSE, cpu_count(), &res);
+            for(int k=0; k<n; k++)
+            {
+                if(flags & GREP_COUNT) out_printf("%s:%d\n", res[k].path, res[k].matches);
+                else out_write(res[k].out, res[k].len);
+            }
+            grep_tree_free(res, n);
+            continue;
+        }
+
+        // !!權限檢查!! 必須有 Read 權限 (myfs_open 會檢查),之後直接在 Block 上掃描
+        int fd=myfs_open(files[i], MYFS_O_RDONLY);
+        if(fd<0) { report(files[i], fd); continue; }
+        myfs_close(fd);
+
+        g.prefix=(nfiles>1 || (flags & GREP_RECURSE)) ? files[i] : NULL;
+        int n=grep_inode(st.ino, key, flags, grep_print, &g);
+        if(flags & GREP_COUNT)
+        {
+            if(g.prefix) out_printf("%s:", g.prefix);
+            out_printf("%d\n", n);
+        }
     }
-    buf[p]=0;
-    
-    // 逐行搜尋key word
-    char *line=strtok(buf, "\n");
-    while(line) { if(strstr(line, key)) printf("%s\n", line); line=strtok(NULL, "\n"); }
-    free(buf);
 }
 
 // funtion: stat
 void cmd_stat(char *name) 
 {
-    int idx=find_inode_by_name(name, current_dir_id);
-    if(idx==-1) 
+    myfs_stat_t st;
+    if(myfs_stat(name, &st) < 0) 
     { 
-        printf(C_ERR "File not found.\n" C_RESET); return; 
+        out_printf(C_ERR "File not found.\n" C_RESET); return; 
     }
-    printf("File: %s\nSize: %d\nInode: %d\nType: %s\nMode: %d\n", 
-           inode_table[idx].name, inode_table[idx].size, idx, 
-           inode_table[idx].is_dir?"DIR":"FILE", inode_table[idx].permission);
+    out_printf("File: %s\nSize: %d\nInode: %d\nType: %s\nMode: %d\n", 
+           inode_table[st.ino].name, st.size, st.ino, 
+           st.is_dir?"DIR":"FILE", st.permission);
+    char tb[32];
+    const char *tf="%Y-%m-%d %H:%M:%S";
+    out_printf("Access: %s\n", fmt_time(st.atime, tf, tb, sizeof(tb)));
+    out_printf("Modify: %s\n", fmt_time(st.mtime, tf, tb, sizeof(tb)));
+    out_printf("Change: %s\n", fmt_time(st.ctime, tf, tb, sizeof(tb)));
+    out_printf("Birth:  %s\n", fmt_time(st.crtime, tf, tb, sizeof(tb)));
 }
 
-// funtion: find
-void recursive_find(int dir_id, char *target, char *path) 
-{
-    for(int i=0; i<MAX_FILES; i++) 
+// funtion: find (dir 底下符合 q 的檔案,newer 是 -newer 的參考檔案)
+void cmd_find(char *dir, FindQuery *q, char *newer) 
+{ 
+    myfs_stat_t st;
+    int r=myfs_stat(dir, &st);
+    if(r<0) { report(dir, r); return; }
+    if(!st.is_dir) { report(dir, MYFS_ENOTDIR); return; }
+    if(newer)
     {
-        if(inode_table[i].is_used && inode_table[i].parent_id==dir_id) 
-        {
-            if(dir_id==0 && i==0) continue;
-            char newp[256];
-            // 組合完整路徑
-            if(strcmp(path,"/")==0) snprintf(newp, 256, "/%s", inode_table[i].name);
-            else snprintf(newp, 256, "%s/%s", path, inode_table[i].name);
-            
-            // 比對檔名
-            if(strstr(inode_table[i].name, target)) printf("%s%s%s\n", inode_table[i].is_dir?C_DIR:C_FILE, newp, C_RESET);
-            if(inode_table[i].is_dir) recursive_find(i, target, newp);
-        }
+        myfs_stat_t ref;
+        r=myfs_stat(newer, &ref);
+        if(r<0) { report(newer, r); return; }
+        q->newer=inode_table[ref.ino].mtime;
     }
-}
 
-void cmd_find(char *name) 
-{ 
-    recursive_find(0, name, "/"); 
+    int *ids;
+    int n=find_run(st.ino, q, cpu_count(), &ids);
+    for(int k=0; k<n; k++) 
+        out_printf("%s%s%s\n", inode_table[ids[k]].is_dir?C_DIR:C_FILE, inode_path(ids[k]), C_RESET);
+    free(ids);
 }
 
 // funtion: encrypt/decrypt
@@ -469,113 +692,435 @@ void cmd_encrypt(char *filename, char *key)
 {
     if (!key || strlen(key) == 0) 
     {
-        printf("Error: Password required.\n");
+        out_printf("Error: Password required.\n");
         return;
     }
 
-    int idx = find_inode_by_name(filename, current_dir_id);
-    if (idx == -1) 
+    int fd = myfs_open(filename, MYFS_O_RDWR);
+    if (fd == MYFS_ENOENT) { out_printf("Error: File '%s' not found.\n", filename); return; }
+    if (fd == MYFS_EISDIR) { out_printf("Error: Cannot encrypt directory.\n"); return; }
+    // !!權限檢查!! 需要 Write 權限
+    if (fd < 0) { out_printf("Error: Permission denied (Write protected).\n"); return; }
+
+    // 每個 Block 各自從 key 的開頭做 XOR
+    char buf[BLOCK_SIZE]; int n, off = 0;
+    while ((n = myfs_pread(fd, buf, BLOCK_SIZE, off)) > 0) 
     {
-        printf("Error: File '%s' not found.\n", filename);
-        return;
+        xor_cipher(buf, n, key);
+        myfs_pwrite(fd, buf, n, off);
+        off += n;
     }
-    if (inode_table[idx].is_dir) 
+    myfs_close(fd);
+
+    out_printf("File '%s' encrypted/decrypted with key '%s'.\n", filename, key);
+}
+
+// funtion: status
+void cmd_status() 
+{
+    out_printf("\n" "\033[7m" " SYSTEM STATUS " "\033[0m" "\n");
+    out_printf("Total Size:   %lld bytes\n", fs_total_size());
+    int used = blocks_used();
+    out_printf("Blocks:       %d/%d used\n", used, sb->total_blocks);
+    out_printf("Alloc groups: %d (%d blocks each)\n", ag_count(), AG_BLOCKS);
+    
+    // 進度條實作
+    float usage = (float)used / sb->total_blocks * 100.0;
+    out_printf("Usage: %.1f%%\n[", usage);
+    int bar = 40; int fill = (int)((usage/100.0)*bar);
+    for(int i=0; i<bar; i++) out_printf(i<fill?C_OK "#" C_RESET:".");
+    out_printf("]\nInodes:       %d/%d used\n", sb->used_inodes, sb->total_inodes);
+    out_printf("Generation:   %u\n", fs_generation);
+    if(!data_blocks)
     {
-        printf("Error: Cannot encrypt directory.\n");
-        return;
+        BcStats bc;
+        bc_stats(&bc);
+        long long lookups = bc.hits + bc.misses;
+        out_printf("Block cache:  %d/%d slots (%d KiB), %d dirty\n", bc.used, bc.slots, bc.slots * (BLOCK_SIZE / 1024), bc.dirty);
+        out_printf("Cache hits:   %.1f%% (%lld hits, %lld misses, %lld new), %lld prefetched (%lld used)\n",
+                   lookups ? 100.0 * bc.hits / lookups : 0.0, bc.hits, bc.misses, bc.fresh, bc.prefetched, bc.prefetch_hits);
+        out_printf("Cache I/O:    %lld reads (%lld KiB), %lld writes (%lld KiB), %lld evictions (%lld dirty)\n",
+                   bc.reads, bc.read_bytes / 1024, bc.writes, bc.write_bytes / 1024, bc.evictions, bc.writebacks);
+        out_printf("Batched I/O:  %s, depth %d\n", bio_name(bio_backend()), bio_depth());
     }
+}
 
-    // !!權限檢查!! 需要 Write 權限
-    if ( !(inode_table[idx].permission & 2) ) 
+// funtion: backup (since = 0 是完整備份)
+void cmd_backup(uint32_t since, char *host_path)
+{
+    if(since > fs_generation)
     {
-        printf("Error: Permission denied (Write protected).\n");
+        out_printf(C_ERR "backup: generation %u is in the future (current %u)\n" C_RESET, since, fs_generation);
         return;
     }
+    BackupStats st;
+    uint64_t t0 = now_ns();
+    int err = backup_export(host_path, since, &st);
+    if(err < 0) { report(host_path, err); return; }
+    out_printf(C_OK "%s backup written to '%s'" C_RESET " (generations %u..%u, %.1f ms)\n",
+               since ? "Incremental" : "Full", host_path, st.since, st.until, (now_ns() - t0) / 1e6);
+    out_printf("  %d inodes, %d blocks, %lld bytes\n", st.inodes, st.blocks, st.bytes);
+    out_printf("  Next: backup --since %u <file>\n", st.until);
+    gen_bump(); // 之後的修改一定比 until 新
+}
 
-    for (int i = 0; i < MAX_BLOCKS_PER_FILE; i++) 
+// funtion: restore (把 backup 產生的 delta 套用到目前的映像檔)
+void cmd_restore(char *host_path)
+{
+    BackupStats st;
+    uint32_t cur = fs_generation;
+    int err = backup_restore(host_path, &st);
+    if(err == MYFS_EINVAL)
     {
-        int bid = inode_table[idx].blocks[i];
-        if (bid == 0) continue;
+        out_printf(C_ERR "restore: '%s' (generations %u..%u) does not apply to this image (generation %u)\n" C_RESET,
+                   host_path, st.since, st.until, cur);
+        return;
+    }
+    if(err < 0) { report(host_path, err); return; }
+    out_printf(C_OK "Restored '%s'" C_RESET " (generations %u..%u): %d inodes, %d blocks.\n",
+               host_path, st.since, st.until, st.inodes, st.blocks);
+    gen_bump();
+}
 
-        xor_cipher(data_blocks[bid].data, BLOCK_SIZE, key);
+// funtion: index (Trigram 索引: on/off/status)
+void cmd_index(char *mode)
+{
+    if(mode && strcmp(mode, "on") == 0)
+    {
+        uint64_t t0 = now_ns();
+        tri_enable();
+        out_printf(C_OK "Trigram index enabled" C_RESET " (built in %.1f ms).\n", (now_ns() - t0) / 1e6);
+    }
+    else if(mode && strcmp(mode, "off") == 0)
+    {
+        tri_disable();
+        out_printf(C_OK "Trigram index removed.\n" C_RESET);
     }
+    else if(mode && strcmp(mode, "status") != 0)
+    {
+        out_printf(C_ERR "Usage: index [on|off|status]\n" C_RESET);
+        return;
+    }
+    if(!tri_enabled()) { out_printf("Trigram index: off\n"); return; }
+
+    int files; long long bytes; double fill;
+    tri_stats(&files, &bytes, &fill);
+    long long data = (long long)blocks_used() * BLOCK_SIZE;
+    out_printf("Trigram index: on\n");
+    out_printf("Files:        %d (%d bytes each)\n", files, TRI_SIG_BYTES);
+    out_printf("Index size:   %lld bytes (%.1f%% of used data, %.1f%% of image)\n",
+               bytes, data ? 100.0 * bytes / data : 0.0, 100.0 * bytes / fs_total_size());
+    out_printf("Avg fill:     %.1f%% of bits set\n", fill);
+}
 
-    printf("File '%s' encrypted/decrypted with key '%s'.\n", filename, key);
+static void print_frag(const char *label)
+{
+    FragReport r;
+    frag_report(&r);
+    out_printf("%s %d/%d files fragmented, %.2f extents/file, free space in %d runs (largest %d blocks)\n",
+               label, r.fragmented, r.files, r.files ? (double)r.extents / r.files : 0.0, r.free_runs, r.largest_free);
 }
 
-// funtion: status
-void cmd_status() 
+// funtion: defrag (budget_ns / max_blocks <= 0 = 不限,做完整輪)
+void cmd_defrag(int64_t budget_ns, int max_blocks)
 {
-    printf("\n" "\033[7m" " SYSTEM STATUS " "\033[0m" "\n");
-    printf("Total Size:   %d bytes\n", sb->total_size);
-    printf("Blocks:       %d/%d used\n", sb->used_blocks, sb->total_blocks);
-    
-    // 進度條實作
-    float usage = (float)sb->used_blocks / sb->total_blocks * 100.0;
-    printf("Usage: %.1f%%\n[", usage);
-    int bar = 40; int fill = (int)((usage/100.0)*bar);
-    for(int i=0; i<bar; i++) printf(i<fill?C_OK "#" C_RESET:".");
-    printf("]\nInodes:       %d/%d used\n", sb->used_inodes, sb->total_inodes);
+    print_frag("Before:");
+    DefragStats st;
+    uint64_t t0 = now_ns();
+    defrag_step(budget_ns, max_blocks, &st);
+    out_printf("Moved %d files (%d blocks) in %.2f ms", st.moved_files, st.moved_blocks, (now_ns() - t0) / 1e6);
+    if(st.skipped) out_printf(", %d skipped (no free run large enough)", st.skipped);
+    if(st.over_budget) out_printf(", %d skipped (larger than --blocks %d)", st.over_budget, max_blocks);
+    out_printf("\n");
+    print_frag("After: ");
+    if(st.done) out_printf(C_OK "Defrag pass complete.\n" C_RESET);
+    else out_printf("Paused at inode %d/%d; run defrag again to continue.\n", st.cursor, sb->total_inodes);
 }
 
-// funtion: diskmap
-void cmd_diskmap() 
+#define MAP_COLS 64
+#define MAP_ROWS 16
+#define MAP_TOP  5 // 列出最破碎的幾個檔案
+
+// JSON 字串 (路徑可能有 " 或 \)
+static void json_str(Stream *s, const char *str)
 {
-    printf("\n--- Disk Block Map ---\n");
-    printf("Legend: " C_OK "[#]" C_RESET " Used  " "\033[1;30m" "[ ]" C_RESET " Free\n\n");
-    int limit = sb->total_blocks > 400 ? 400 : sb->total_blocks;
-    for(int i=0; i<limit; i++) 
+    stream_write(s, "\"", 1);
+    for(; *str; str++)
     {
-        // 讀取 Bitmap,顯示區塊使用狀態
-        if(get_bit(i)) printf(C_OK "[#]" C_RESET);
-        else printf("\033[1;30m[ ]\033[0m");
-        if((i+1)%32==0) printf("\n"); 
+        if(*str == '"' || *str == '\\') stream_printf(s, "\\%c", *str);
+        else if((unsigned char)*str < 32) stream_printf(s, "\\u%04x", *str);
+        else stream_write(s, str, 1);
     }
-    printf("\n");
+    stream_write(s, "\"", 1);
 }
 
-// funtion: hexdump
-void cmd_hexdump(char *name) 
+static void json_ints(Stream *s, const char *key, const int *v, int n)
 {
-    int idx=find_inode_by_name(name, current_dir_id);
-    if(idx==-1 || inode_table[idx].is_dir) return;
+    stream_printf(s, "\"%s\":[", key);
+    for(int i = 0; i < n; i++) stream_printf(s, i ? ",%d" : "%d", v[i]);
+    stream_write(s, "]", 1);
+}
 
-    // !!權限檢查!! 必須有 Read (4) 權限
-    if ( !(inode_table[idx].permission & 4) ) 
-    { 
-        printf(C_ERR "Permission denied.\n" C_RESET); return; 
+// funtion: diskmap (整個映像檔縮成 64x16 的格子: 字元 = 使用率,顏色 = 讀寫次數)
+void cmd_diskmap(int json, int reset)
+{
+    if(reset)
+    {
+        heat_reset();
+        out_printf(C_OK "Block read/write counters cleared.\n" C_RESET);
+        return;
+    }
+
+    // 每格涵蓋 per 個 Block
+    int total = sb->total_blocks;
+    int cells = total < MAP_COLS * MAP_ROWS ? total : MAP_COLS * MAP_ROWS;
+    int per = (total + cells - 1) / cells;
+    cells = (total + per - 1) / per;
+    int *used = calloc(cells, sizeof(int));
+    long long *reads = calloc(cells, sizeof(long long)), *writes = calloc(cells, sizeof(long long));
+    long long max_heat = 0, all_reads = 0, all_writes = 0;
+    for(int b = 0; b < total; b++)
+    {
+        int c = b / per;
+        if(get_bit(b)) used[c]++;
+        reads[c] += block_reads[b]; writes[c] += block_writes[b];
+    }
+    for(int c = 0; c < cells; c++)
+    {
+        if(reads[c] + writes[c] > max_heat) max_heat = reads[c] + writes[c];
+        all_reads += reads[c]; all_writes += writes[c];
+    }
+
+    FragReport r;
+    frag_report(&r);
+    int top[MAP_TOP], top_ext[MAP_TOP], ntop = 0;
+    for(int i = 0; i < sb->total_inodes; i++)
+    {
+        int ext = file_extents(i);
+        if(ext <= 1) continue;
+        int k = ntop < MAP_TOP ? ntop++ : MAP_TOP;
+        while(k > 0 && top_ext[k - 1] < ext)
+        {
+            if(k < MAP_TOP) { top[k] = top[k - 1]; top_ext[k] = top_ext[k - 1]; }
+            k--;
+        }
+        if(k < MAP_TOP) { top[k] = i; top_ext[k] = ext; }
+    }
+
+    Stream out;
+    stream_init(&out);
+    if(json)
+    {
+        stream_printf(&out, "{\"total_blocks\":%d,\"used_blocks\":%d,\"blocks_per_cell\":%d,\"cols\":%d,",
+                      total, blocks_used(), per, MAP_COLS);
+        json_ints(&out, "used", used, cells);
+        stream_printf(&out, ",\"reads\":[");
+        for(int c = 0; c < cells; c++) stream_printf(&out, c ? ",%lld" : "%lld", reads[c]);
+        stream_printf(&out, "],\"writes\":[");
+        for(int c = 0; c < cells; c++) stream_printf(&out, c ? ",%lld" : "%lld", writes[c]);
+        stream_printf(&out, "],\"files\":%d,\"fragmented_files\":%d,\"extents\":%d,\"max_extents\":%d,",
+                      r.files, r.fragmented, r.extents, r.max_extents);
+        json_ints(&out, "extent_hist", r.ext_hist, FRAG_BUCKETS);
+        stream_printf(&out, ",\"free_blocks\":%d,\"free_runs\":%d,\"largest_free_run\":%d,",
+                      r.free_blocks, r.free_runs, r.largest_free);
+        json_ints(&out, "free_run_hist", r.free_hist, FRAG_BUCKETS);
+        stream_printf(&out, ",");
+        json_ints(&out, "free_run_hist_blocks", r.free_hist_blocks, FRAG_BUCKETS);
+        stream_printf(&out, ",\"most_fragmented\":[");
+        for(int k = 0; k < ntop; k++)
+        {
+            stream_printf(&out, k ? ",{\"path\":" : "{\"path\":");
+            json_str(&out, inode_path(top[k]));
+            stream_printf(&out, ",\"extents\":%d}", top_ext[k]);
+        }
+        stream_printf(&out, "]}\n");
+    }
+    else
+    {
+        // 熱度用 log 分級: 灰 = 沒讀寫,藍 -> 青 -> 綠 -> 黃 -> 紅
+        static const char *heat_color[] = { "\033[1;30m", "\033[34m", "\033[36m", "\033[32m", "\033[33m", "\033[31m" };
+        stream_printf(&out, "\n--- Disk Block Map --- (%d blocks, %d per cell)\n", total, per);
+        stream_printf(&out, "Fill: ' ' free  . <25%%  : <50%%  + <75%%  # full     Heat: ");
+        for(int h = 0; h < 6; h++) stream_printf(&out, "%s%s" C_RESET " ", heat_color[h], h == 0 ? "idle" : h == 5 ? "hot" : "#");
+        stream_printf(&out, "\n\n");
+        int last = -1;
+        for(int c = 0; c < cells; c++)
+        {
+            int span = (c == cells - 1) ? total - c * per : per;
+            int fill = used[c] == 0 ? 0 : used[c] * 4 <= span ? 1 : used[c] * 2 <= span ? 2 : used[c] * 4 <= span * 3 ? 3 : 4;
+            long long heat = reads[c] + writes[c];
+            int h = 0;
+            if(heat)
+            {
+                // 以最熱的格子為準,每級差 4 倍
+                h = 5;
+                for(long long lim = max_heat / 4; h > 1 && heat <= lim; lim /= 4) h--;
+            }
+            if(h != last) stream_printf(&out, "%s", heat_color[h]); // 顏色有變才輸出控制碼
+            stream_write(&out, &" .:+#"[fill], 1);
+            last = h;
+            if((c + 1) % MAP_COLS == 0 || c == cells - 1) { stream_printf(&out, C_RESET "\n"); last = -1; }
+        }
+        stream_printf(&out, "\nI/O since mount: %lld block reads, %lld block writes\n", all_reads, all_writes);
+        stream_printf(&out, "Files:       %d, %d fragmented (%.2f extents/file, max %d)\n",
+                      r.files, r.fragmented, r.files ? (double)r.extents / r.files : 0.0, r.max_extents);
+        stream_printf(&out, "Free space:  %d blocks in %d runs, largest %d\n", r.free_blocks, r.free_runs, r.largest_free);
+        stream_printf(&out, "%-12s %10s %10s %12s\n", "Length", "Files", "Free runs", "Free blocks");
+        for(int k = 0; k < FRAG_BUCKETS; k++)
+        {
+            char label[16];
+            if(k == 0) strcpy(label, "1");
+            else if(k == FRAG_BUCKETS - 1) sprintf(label, "%d+", 1 << k);
+            else sprintf(label, "%d-%d", 1 << k, (2 << k) - 1);
+            stream_printf(&out, "%-12s %10d %10d %12d\n", label, r.ext_hist[k], r.free_hist[k], r.free_hist_blocks[k]);
+        }
+        if(ntop)
+        {
+            stream_printf(&out, "Most fragmented:\n");
+            for(int k = 0; k < ntop; k++) stream_printf(&out, "  %4d extents  %s\n", top_ext[k], inode_path(top[k]));
+        }
+    }
+    out_write(out.data, out.len);
+    stream_free(&out);
+    free(used); free(reads); free(writes);
+}
+
+// 時間的單位跟著大小換 (ns / us / ms / s)
+static const char *fmt_ns(char *buf, double ns)
+{
+    if(ns < 1e3) sprintf(buf, "%.0f ns", ns);
+    else if(ns < 1e6) sprintf(buf, "%.1f us", ns / 1e3);
+    else if(ns < 1e9) sprintf(buf, "%.1f ms", ns / 1e6);
+    else sprintf(buf, "%.2f s", ns / 1e9);
+    return buf;
+}
+
+// funtion: stats (每個指令和核心操作的延遲分佈; on = 1 / 0 開關,-1 = 顯示)
+void cmd_stats(int json, int reset, int on)
+{
+    if(on >= 0)
+    {
+        stats_enable(on);
+        out_printf(C_OK "Latency statistics %s.\n" C_RESET, on ? "on" : "off");
+        return;
     }
+    if(reset)
+    {
+        stats_reset();
+        out_printf(C_OK "Latency statistics cleared.\n" C_RESET);
+        return;
+    }
+    StatsRow rows[ST_MAX_OPS];
+    int n = stats_snapshot(rows, ST_MAX_OPS);
+    Stream out;
+    stream_init(&out);
+    if(json)
+    {
+        stream_printf(&out, "{\"enabled\":%s,\"ops\":[", stats_on ? "true" : "false");
+        for(int i = 0; i < n; i++)
+        {
+            StatsRow *r = &rows[i];
+            stream_printf(&out, i ? ",{\"name\":" : "{\"name\":");
+            json_str(&out, r->name);
+            stream_printf(&out, ",\"count\":%lld,\"timed\":%lld,\"bytes\":%lld,\"total_ns\":%.0f,\"mean_ns\":%.1f,"
+                          "\"p50_ns\":%.0f,\"p90_ns\":%.0f,\"p99_ns\":%.0f,\"p999_ns\":%.0f,\"max_ns\":%.0f}",
+                          r->count, r->timed, r->bytes, r->total_ns, r->mean_ns, r->p50_ns, r->p90_ns, r->p99_ns, r->p999_ns, r->max_ns);
+        }
+        stream_printf(&out, "]}\n");
+    }
+    else
+    {
+        char a[16], b[16], c[16], d[16], e[16];
+        int sampled = 0;
+        stream_printf(&out, "\n--- Latency Statistics --- (%s)\n", stats_on ? "on" : "off");
+        stream_printf(&out, "%-20s %10s  %10s %10s %10s %10s %10s\n", "Operation", "Count", "Mean", "p50", "p99", "Max", "Total");
+        for(int i = 0; i < n; i++)
+        {
+            StatsRow *r = &rows[i];
+            if(r->timed < r->count) sampled = 1;
+            stream_printf(&out, "%-20s %10lld%c%10s %10s %10s %10s %10s", r->name, r->count, r->timed < r->count ? '*' : ' ', fmt_ns(a, r->mean_ns),
+                          fmt_ns(b, r->p50_ns), fmt_ns(c, r->p99_ns), fmt_ns(d, r->max_ns), fmt_ns(e, r->total_ns));
+            if(r->bytes >= 65536 && r->total_ns > 0) stream_printf(&out, "  %.1f MiB/s", r->bytes / (r->total_ns / 1e9) / 1048576.0);
+            stream_printf(&out, "\n");
+        }
+        if(!n) stream_printf(&out, "(nothing recorded yet)\n");
+        if(sampled) stream_printf(&out, "* every event is counted, 1 in %d is timed (total is estimated)\n", ST_SAMPLE);
+    }
+    out_write(out.data, out.len);
+    stream_free(&out);
+}
 
-    unsigned char *buf=malloc(inode_table[idx].size);
-    int rem=inode_table[idx].size; int p=0; int b=0;
-    while(rem>0) 
+// funtion: replay report (吞吐量 + 每種操作的延遲百分位數)
+void cmd_replay_report(const char *trace, const WlReport *rep, int json)
+{
+    Stream out;
+    stream_init(&out);
+    double secs = rep->secs > 0 ? rep->secs : 1e-9;
+    if(json)
+    {
+        stream_printf(&out, "{\"trace\":");
+        json_str(&out, trace);
+        stream_printf(&out, ",\"sessions\":%d,\"ops\":%lld,\"errors\":%lld,\"bytes\":%lld,\"secs\":%.6f,\"ops_per_sec\":%.1f,\"mib_per_sec\":%.2f,\"by_op\":[",
+                      rep->sessions, rep->ops, rep->errors, rep->bytes, rep->secs, rep->ops / secs, rep->bytes / secs / 1048576.0);
+        for(int i = 0; i < rep->nrows; i++)
+        {
+            const StatsRow *r = &rep->rows[i];
+            stream_printf(&out, i ? ",{\"name\":" : "{\"name\":");
+            json_str(&out, r->name + 7); // 去掉 "replay_"
+            stream_printf(&out, ",\"count\":%lld,\"bytes\":%lld,\"ops_per_sec\":%.1f,\"mean_ns\":%.1f,\"p50_ns\":%.0f,\"p90_ns\":%.0f,"
+                          "\"p99_ns\":%.0f,\"p999_ns\":%.0f,\"max_ns\":%.0f}",
+                          r->count, r->bytes, r->count / secs, r->mean_ns, r->p50_ns, r->p90_ns, r->p99_ns, r->p999_ns, r->max_ns);
+        }
+        stream_printf(&out, "]}\n");
+    }
+    else
     {
-        int cp=(rem>BLOCK_SIZE)?BLOCK_SIZE:rem;
-        memcpy(buf+p, data_blocks[inode_table[idx].blocks[b]].data, cp);
-        p+=cp; rem-=cp; b++;
+        char a[16], b[16], c[16], d[16], e[16], f[16];
+        stream_printf(&out, "Replayed '%s' with %d session%s: %lld ops in %.3f s (%.0f ops/sec, %.1f MiB/s), errors: %lld\n",
+                      trace, rep->sessions, rep->sessions > 1 ? "s" : "", rep->ops, rep->secs, rep->ops / secs, rep->bytes / secs / 1048576.0, rep->errors);
+        if(rep->first_error_line)
+            stream_printf(&out, C_WARN "First error at line %d: %s\n" C_RESET, rep->first_error_line, myfs_strerror(rep->first_error));
+        stream_printf(&out, "%-8s %10s %10s %10s %10s %10s %10s %10s %10s\n", "Op", "Count", "ops/sec", "Mean", "p50", "p90", "p99", "p99.9", "Max");
+        for(int i = 0; i < rep->nrows; i++)
+        {
+            const StatsRow *r = &rep->rows[i];
+            stream_printf(&out, "%-8s %10lld %10.0f %10s %10s %10s %10s %10s %10s\n", r->name + 7, r->count, r->count / secs, fmt_ns(a, r->mean_ns),
+                          fmt_ns(b, r->p50_ns), fmt_ns(c, r->p90_ns), fmt_ns(d, r->p99_ns), fmt_ns(e, r->p999_ns), fmt_ns(f, r->max_ns));
+        }
     }
-    printf("Hex Dump of %s:\n", name);
+    out_write(out.data, out.len);
+    stream_free(&out);
+}
 
-    for(int i=0; i<inode_table[idx].size; i+=16) 
+// funtion: hexdump
+void cmd_hexdump(char *name) 
+{
+    // !!權限檢查!! 必須有 Read (4) 權限 (myfs_open 會檢查)
+    int size;
+    unsigned char *buf=(unsigned char*)read_whole(name, &size);
+    if(!buf) return;
+    out_printf("Hex Dump of %s:\n", name);
+
+    for(int i=0; i<size; i+=16) 
     {
-        printf("%04x  ", i); // Offset
+        out_printf("%04x  ", i); // Offset
         // 印出 Hex
         for(int j=0; j<16; j++) 
         {
-            if(i+j<inode_table[idx].size) printf("%02x ", buf[i+j]); else printf("   ");
-            if(j==7) printf(" ");
+            if(i+j<size) out_printf("%02x ", buf[i+j]); else out_printf("   ");
+            if(j==7) out_printf(" ");
         }
-        printf(" |");
+        out_printf(" |");
 
         for(int j=0; j<16; j++) 
         {
-            if(i+j<inode_table[idx].size) 
+            if(i+j<size) 
             {
                 unsigned char c=buf[i+j];
-                printf("%c", (c>=32&&c<=126)?c:'.');
+                out_printf("%c", (c>=32&&c<=126)?c:'.');
             }
         }
-        printf("|\n");
+        out_printf("|\n");
     }
     free(buf);
 }
@@ -583,19 +1128,22 @@ void cmd_hexdump(char *name)
 // function: run
 void cmd_run(char *name) 
 {
-    int idx=find_inode_by_name(name, current_dir_id);
-    if(idx==-1 || inode_table[idx].is_dir) 
+    myfs_stat_t st;
+    if(myfs_stat(name, &st)<0 || st.is_dir) 
     { 
-        printf("Not executable.\n"); return; 
+        out_printf("Not executable.\n"); return; 
     }
 
     // !!權限檢查!! 必須有 Exec 權限
-    if ( !(inode_table[idx].permission & 1) ) 
+    if ( !(st.permission & 1) ) 
     { 
-        printf(C_ERR "Error: Permission denied (Not executable).\n" C_RESET);
+        out_printf(C_ERR "Error: Permission denied (Not executable).\n" C_RESET);
         return; 
     }
 
+    int fd=myfs_open(name, MYFS_O_RDONLY);
+    if(fd<0) { report(name, fd); return; }
+
     // 將 FS 中的內容匯出到暫存實體檔案
     char tpath[64];
     #ifdef _WIN32
@@ -604,23 +1152,18 @@ void cmd_run(char *name)
     sprintf(tpath, "./._temp_exec");
     #endif
     
-    FILE *fp=fopen(tpath, "wb"); if(!fp) return;
-
-    int rem=inode_table[idx].size; int b=0;
-    while(rem>0) 
-    {
-        int cp=(rem>BLOCK_SIZE)?BLOCK_SIZE:rem;
-        fwrite(data_blocks[inode_table[idx].blocks[b]].data, 1, cp, fp);
-        rem-=cp; b++;
-    }
+    FILE *fp=fopen(tpath, "wb"); if(!fp) { myfs_close(fd); return; }
 
+    char buf[BLOCK_SIZE]; int n;
+    while((n=myfs_read(fd, buf, sizeof(buf))) > 0) fwrite(buf, 1, n, fp);
     fclose(fp);
+    myfs_close(fd);
 
     // 透過 system() 呼叫 OS 執行該暫存檔
     #ifndef _WIN32
     chmod(tpath, 0755);
     #endif
-    printf(C_DIR "Running %s...\n" C_RESET, name);
+    out_printf(C_DIR "Running %s...\n" C_RESET, name);
     system(tpath);
     remove(tpath); 
 }
@@ -628,67 +1171,97 @@ void cmd_run(char *name)
 // function: cd
 void cmd_cd(char *name) 
 {
-    // 處理 ".."
-    if(strcmp(name, "..")==0) 
+    // 支援多層路徑 (cd /a/b, cd ../x),current_path 由 Inode 反查完整路徑
+    int r=myfs_chdir(name);
+    if(r<0) report(name, r);
+}
+
+// funtion: writeback (off = 停掉背景 thread; 有給條件 = 開始/換設定; 都沒有 = 只顯示狀態)
+void cmd_writeback(int off, int interval_ms, int dirty_blocks)
+{
+    if(off) myfs_writeback(0, 0);
+    else if(interval_ms > 0 || dirty_blocks > 0)
     {
-        current_dir_id=inode_table[current_dir_id].parent_id;
-        if(current_dir_id==0) strcpy(current_path, "/"); else strcpy(current_path, "/...");
-        return;
+        int r = myfs_writeback(interval_ms, dirty_blocks);
+        if(r != MYFS_OK) { out_printf(C_ERR "Error: %s\n" C_RESET, myfs_strerror(r)); return; }
     }
-    
-    int idx=find_inode_by_name(name, current_dir_id);
-    if(idx!=-1 && inode_table[idx].is_dir) 
+    WbStats st;
+    wb_stats(&st);
+    if(!st.running) out_printf("Writeback: off\n");
+    else
     {
-        current_dir_id=idx; strcat(current_path, name); strcat(current_path, "/");
+        out_printf("Writeback: every ");
+        if(st.interval_ms > 0) out_printf("%d ms", st.interval_ms);
+        if(st.interval_ms > 0 && st.dirty_limit > 0) out_printf(" or ");
+        if(st.dirty_limit > 0) out_printf("%d dirty blocks", st.dirty_limit);
+        out_printf("\n");
     }
+    out_printf("Checkpoints:  %lld (%lld bytes written: %lld blocks, %lld inodes)\n",
+               st.checkpoints, st.bytes, st.blocks, st.inodes);
+    out_printf("Last:         %.2f ms total, %.3f ms frozen (max %.3f ms), %lld COW copies\n",
+               st.last_ms, st.last_freeze_ms, st.max_freeze_ms, st.cow_copies);
+    out_printf("Flush lag:    %.0f ms, %u generations, %d dirty blocks\n", st.lag_ms, st.gens_behind, st.dirty_blocks);
 }
 
 // funtion: help
 void cmd_help() 
 {
-    printf("\n--- MyFS Command List ---\n");
-
-    printf(" [Navigation]\n");
-    printf("  ls        : List directory content\n");
-    printf("  ll or ls -l: List detailed content (Mode/Size/Date)\n");
-    printf("  cd <dir>  : Change directory (.. for parent)\n");
-    printf("  pwd       : Show current path\n");
-    printf("  tree      : Show directory structure recursively\n");
-    printf("  mkdir <d> : Create new directory\n");
-    printf("  rmdir <d> : Remove empty directory\n");
-
-    printf("\n [File Operations]\n");
-    printf("  touch <f> : Create empty file\n"); 
-    printf("  rm <name> : Remove file or directory (supports -r)\n");
-    printf("  mv <s, d> : Move or rename file\n");
-    printf("  cp <s, d> : Copy file\n");
-    printf("  nano <f>  : Open text editor\n");
-    printf("  append    : Append text to file (Usage: append <file> <text>)\n"); 
-
-    printf("\n [View & Search]\n");
-    printf("  cat <f>   : Display file content\n");
-    printf("  hexdump<f>: View file in hexadecimal\n");
-    printf("  grep <k,f>: Search keyword in file\n");
-    printf("  find <n>  : Search file by name (recursive)\n");
-    printf("  stat <f>  : Show inode details (Size, ID, Perm)\n");
-
-    printf("\n [Host I/O]\n");
-    printf("  put <f>   : Import file from Host (Windows) to MyFS\n");
-    printf("  get <f>   : Export file from MyFS to Host\n");
-
-    printf("\n [Security & System]\n");
-    printf("  chmod <m> : Change permission (e.g., chmod 7 file)\n");
-    printf("  encrypt   : Encrypt file with XOR key (Usage: encrypt <file> <key>)\n");
-    printf("  decrypt   : Decrypt file (Same as encrypt)\n"); 
-    printf("  run <f>   : Execute binary file (.exe)\n");
-    printf("  status    : Show system status (Inode/Block usage)\n");
-    printf("  diskmap   : Visualize disk block usage (Heatmap)\n");
-
-    printf("\n [Shell]\n");
-    printf("  help      : Show this help message\n");
-    printf("  exit      : Save disk image and exit\n");
-
-    printf("\n[Features]\n");
-    printf(" * Use Up/Down arrow keys for Command History.\n");
-    printf(" * Use '>' to redirect output (e.g., ls > list.txt).\n");
+    out_printf("\n--- MyFS Command List ---\n");
+
+    out_printf(" [Navigation]\n");
+    out_printf("  ls [dir]  : List directory content\n");
+    out_printf("  ll or ls -l: List detailed content (Mode/Size/Date)\n");
+    out_printf("  ls -S/-t/-r --limit N --offset N : Sort by size/time, reverse, page through\n");
+    out_printf("  cd <path> : Change directory (/a/b, ../x, .. for parent)\n");
+    out_printf("  pwd       : Show current path\n");
+    out_printf("  tree [dir]: Show directory structure recursively\n");
+    out_printf("  mkdir <d..>: Create new directories\n");
+    out_printf("  rmdir <d> : Remove empty directory\n");
+
+    out_printf("\n [File Operations]\n");
+    out_printf("  touch <f..>: Create empty files\n"); 
+    out_printf("  rm <n...> : Remove files or directories (supports -r)\n");
+    out_printf("  mv <s, d> : Move or rename file (mv f1 f2 ... dir moves many)\n");
+    out_printf("  cp <s, d> : Copy file (cp f1 f2 ... dir copies many)\n");
+    out_printf("  nano <f>  : Open text editor\n");
+    out_printf("  append    : Append text to file (Usage: append <file> <text>)\n"); 
+
+    out_printf("\n [View & Search]\n");
+    out_printf("  cat <f>   : Display file content\n");
+    out_printf("  hexdump<f>: View file in hexadecimal\n");
+    out_printf("  grep <k,f>: Search keyword in files (-c count, -n line no., -r dir tree, -E regex)\n");
+    out_printf("  find <n>  : Search file by name (recursive)\n");
+    out_printf("  find [dir] -name <glob> -type f|d -size [+-]N[k] -newer <f> : Search with predicates\n");
+    out_printf("  stat <f>  : Show inode details (Size, ID, Perm)\n");
+
+    out_printf("\n [Host I/O]\n");
+    out_printf("  put <f>   : Import file from Host (Windows) to MyFS\n");
+    out_printf("  get <f>   : Export file from MyFS to Host\n");
+    out_printf("  sync <hf> <f> : Update a VFS file from a Host file, rewriting only changed blocks\n");
+    out_printf("                  (blocks are matched at 1 KiB boundaries: inserting or deleting a\n");
+    out_printf("                   non-multiple of 1 KiB rewrites every block after the edit)\n");
+    out_printf("  backup [--since G] <hf> : Write a full (or incremental since generation G) backup to Host\n");
+    out_printf("  restore <hf> : Apply a backup onto the current image\n");
+
+    out_printf("\n [Security & System]\n");
+    out_printf("  chmod <m> : Change permission (e.g., chmod 7 file)\n");
+    out_printf("  encrypt   : Encrypt file with XOR key (Usage: encrypt <file> <key>)\n");
+    out_printf("  decrypt   : Decrypt file (Same as encrypt)\n"); 
+    out_printf("  run <f>   : Execute binary file (.exe)\n");
+    out_printf("  status    : Show system status (Inode/Block usage)\n");
+    out_printf("  defrag    : Defragment fragmented files in place (defrag [--budget 50ms] [--blocks N])\n");
+    out_printf("  diskmap   : Block usage/access heatmap and fragmentation (diskmap [--json] [--reset])\n");
+    out_printf("  stats     : Latency percentiles per command and core operation (stats [--json] [--reset] | stats on|off)\n");
+    out_printf("  index     : Trigram index so grep can skip files (index on|off|status)\n");
+
+    out_printf("\n [Shell]\n");
+    out_printf("  help      : Show this help message\n");
+    out_printf("  exit      : Save disk image and exit\n");
+
+    out_printf("\n[Features]\n");
+    out_printf(" * Use Up/Down arrow keys for Command History.\n");
+    out_printf(" * Use '>' to redirect output (e.g., ls > list.txt), '>>' to append.\n");
+    out_printf(" * File arguments accept absolute or relative paths (e.g., cat /logs/app.log, cp ../a.txt .).\n");
+    out_printf(" * Quote arguments containing spaces (e.g., append notes.txt \"hello world\").\n");
+    out_printf(" * Use '|' to pipe output into the next command (e.g., cat log | grep ERROR > hits).\n");
 }
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include <string.h>
+#include "defrag.h"
+#include "fs.h"
+#include "inode.h"
+#include "bitmap.h"
+#include "gen.h"
+#include "writeback.h"
+#include "bcache.h"
+#include "utils.h"
+
+static int cursor = 0; // 下一個要檢查的 Inode
+
+void defrag_reset() { cursor = 0; }
+
+int file_extents(int idx)
+{
+    Inode *ino = &inode_table[idx];
+    if(!ino->is_used || ino->is_dir || ino->size <= 0) return 0;
+    int n = FILE_BLOCKS(ino->size), ext = 1;
+    for(int b = 1; b < n; b++) if(ino->blocks[b] != ino->blocks[b - 1] + 1) ext++;
+    return ext;
+}
+
+int frag_bucket(int n)
+{
+    int k = 0;
+    while(n > 1 && k < FRAG_BUCKETS - 1) { n >>= 1; k++; }
+    return k;
+}
+
+void frag_report(FragReport *r)
+{
+    memset(r, 0, sizeof(*r));
+    for(int i = 0; i < sb->total_inodes; i++)
+    {
+        int ext = file_extents(i);
+        if(!ext) continue;
+        r->files++;
+        r->extents += ext;
+        if(ext > 1) r->fragmented++;
+        if(ext > r->max_extents) r->max_extents = ext;
+        r->ext_hist[frag_bucket(ext)]++;
+    }
+    int run = 0;
+    for(int b = 0; b <= sb->total_blocks; b++)
+    {
+        if(b < sb->total_blocks && !get_bit(b)) { run++; continue; }
+        if(run)
+        {
+            r->free_runs++;
+            r->free_blocks += run;
+            if(run > r->largest_free) r->largest_free = run;
+            r->free_hist[frag_bucket(run)]++;
+            r->free_hist_blocks[frag_bucket(run)] += run;
+        }
+        run = 0;
+    }
+}
+
+// 把整個檔案搬到一段連續的空 Block,失敗 (沒有夠長的空段) 回傳 0
+static int move_file(int idx)
+{
+    static char tmp[MAX_FILE_SIZE];
+    Inode *ino = &inode_table[idx];
+    int n = FILE_BLOCKS(ino->size);
+    int dst = alloc_run(n);
+    if(dst >= 0)
+    {
+        for(int b = 0; b < n; b++)
+        {
+            wb_cow(dst + b);
+            memcpy(blk_get(dst + b, BLK_NEW), blk_get(ino->blocks[b], BLK_READ), BLOCK_SIZE);
+            blk_put(ino->blocks[b], BLK_READ);
+            blk_put(dst + b, BLK_NEW);
+            free_block(ino->blocks[b]);
+        }
+    }
+    else
+    {
+        // 空間很滿時: 先把檔案自己的 Block 放掉再找一次 (釋放的 Block 可能剛好把空段接起來)
+        for(int b = 0; b < n; b++)
+        {
+            memcpy(tmp + b * BLOCK_SIZE, blk_get(ino->blocks[b], BLK_READ), BLOCK_SIZE);
+            blk_put(ino->blocks[b], BLK_READ);
+            free_block(ino->blocks[b]);
+        }
+        dst = alloc_run(n);
+        if(dst < 0)
+        {
+            // 還是不行: 原本的 Block 拿回來,資料沒動過
+            for(int b = 0; b < n; b++) claim_block(ino->blocks[b]);
+            return 0;
+        }
+        for(int b = 0; b < n; b++)
+        {
+            wb_cow(dst + b);
+            memcpy(blk_get(dst + b, BLK_NEW), tmp + b * BLOCK_SIZE, BLOCK_SIZE);
+            blk_put(dst + b, BLK_NEW);
+        }
+    }
+    for(int b = 0; b < n; b++)
+    {
+        ino->blocks[b] = dst + b;
+        gen_block(dst + b);
+    }
+    gen_inode(idx); // Block 位置變了,備份時要重新匯出
+    return n;
+}
+
+void defrag_step(int64_t budget_ns, int max_blocks, DefragStats *st)
+{
+    memset(st, 0, sizeof(*st));
+    uint64_t t0 = now_ns();
+    if(cursor >= sb->total_inodes) cursor = 0;
+    while(cursor < sb->total_inodes)
+    {
+        if(budget_ns > 0 && (int64_t)(now_ns() - t0) >= budget_ns) break;
+        if(max_blocks > 0 && st->moved_blocks >= max_blocks) break;
+        int idx = cursor;
+        if(file_extents(idx) <= 1) { cursor++; continue; }
+        // 檔案是整個搬的: 剩下的 Block 數不夠就停在這個檔案 (下次從它開始),整個 budget 都不夠的跳過
+        int n = FILE_BLOCKS(inode_table[idx].size);
+        if(max_blocks > 0 && st->moved_blocks + n > max_blocks)
+        {
+            if(n <= max_blocks) break;
+            cursor++; st->over_budget++; continue;
+        }
+        cursor++;
+        int moved = move_file(idx);
+        if(moved) { st->moved_files++; st->moved_blocks += moved; }
+        else st->skipped++;
+    }
+    if(cursor >= sb->total_inodes) { cursor = 0; st->done = 1; }
+    st->cursor = cursor;
+}
@@ -0,0 +1,515 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dispatch.h"
+#include "commands.h"
+#include "editor.h"
+#include "fs.h"
+#include "myfs.h"
+#include "search.h"
+#include "stream.h"
+#include "utils.h"
+#include "gen.h"
+#include "stats.h"
+
+int batch_mode = 0;
+
+// 切割參數 (空白分隔,"..." 內的空白保留),直接在 line 上改寫
+int split_args(char *line, char **argv, int max)
+{
+    int argc = 0;
+    char *p = line;
+    while(*p && argc < max)
+    {
+        while(*p == ' ' || *p == '\t') p++;
+        if(!*p) break;
+        if(*p == '"')
+        {
+            p++;
+            argv[argc++] = p;
+            while(*p && *p != '"') p++;
+        }
+        else
+        {
+            argv[argc++] = p;
+            while(*p && *p != ' ' && *p != '\t') p++;
+        }
+        if(*p) *p++ = 0;
+    }
+    return argc;
+}
+
+// ---- Handlers (argv[0] 是指令名稱) ----
+
+// ls [-l] [-S|-t] [-r] [--limit N] [--offset N] [dir]
+static int ls_args(int argc, char **argv, int lflag)
+{
+    int sort = MYFS_SORT_NAME, offset = 0, limit = -1;
+    char *dir = NULL;
+    for(int i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "--limit") == 0 || strcmp(argv[i], "--offset") == 0) && i + 1 < argc)
+        {
+            int v = atoi(argv[i + 1]);
+            if(v < 0) { out_printf("ls: %s must be >= 0\n", argv[i]); return 0; }
+            if(argv[i][2] == 'l') limit = v; else offset = v;
+            i++;
+        }
+        else if(argv[i][0] == '-' && argv[i][1] && argv[i][1] != '-')
+        {
+            for(char *f = argv[i] + 1; *f; f++)
+            {
+                if(*f == 'l') lflag = 1;
+                else if(*f == 'S') sort = (sort & MYFS_SORT_REVERSE) | MYFS_SORT_SIZE;
+                else if(*f == 't') sort = (sort & MYFS_SORT_REVERSE) | MYFS_SORT_TIME;
+                else if(*f == 'r') sort |= MYFS_SORT_REVERSE;
+                else { out_printf("ls: unknown option -%c\n", *f); return 0; }
+            }
+        }
+        else if(!dir && argv[i][0] != '-') dir = argv[i];
+        else { out_printf("Usage: ls [-l] [-S|-t] [-r] [--limit N] [--offset N] [dir]\n"); return 0; }
+    }
+    if(lflag) cmd_ll(dir, sort, offset, limit);
+    else cmd_ls(dir, sort, offset, limit);
+    return 0;
+}
+
+static int h_ls(int argc, char **argv)    { return ls_args(argc, argv, 0); }
+static int h_ll(int argc, char **argv)    { return ls_args(argc, argv, 1); }
+static int h_pwd(int argc, char **argv)   { cmd_pwd(); return 0; }
+static int h_tree(int argc, char **argv)  { cmd_tree(argc > 1 ? argv[1] : NULL); return 0; }
+static int h_status(int argc, char **argv){ cmd_status(); return 0; }
+static int h_diskmap(int argc, char **argv)
+{
+    int json = 0, reset = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--json") == 0) json = 1;
+        else if(strcmp(argv[i], "--reset") == 0) reset = 1;
+        else { out_printf("Usage: diskmap [--json] [--reset]\n"); return 0; }
+    }
+    cmd_diskmap(json, reset);
+    return 0;
+}
+static int h_stats(int argc, char **argv)
+{
+    // stats [--json] [--reset] | stats on|off
+    if(argc == 2 && (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "off") == 0)) { cmd_stats(0, 0, argv[1][1] == 'n' ? 1 : 0); return 0; }
+    int json = 0, reset = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--json") == 0) json = 1;
+        else if(strcmp(argv[i], "--reset") == 0) reset = 1;
+        else { out_printf("Usage: stats [--json] [--reset] | stats on|off\n"); return 0; }
+    }
+    cmd_stats(json, reset, -1);
+    return 0;
+}
+static int h_index(int argc, char **argv) { cmd_index(argc > 1 ? argv[1] : NULL); return 0; }
+static int h_help(int argc, char **argv)  { cmd_help(); return 0; }
+static int h_cd(int argc, char **argv)    { cmd_cd(argv[1]); return 0; }
+static int h_put(int argc, char **argv)   { for(int i=1; i<argc; i++) cmd_put(argv[i]); return 0; }
+static int h_get(int argc, char **argv)   { for(int i=1; i<argc; i++) cmd_get(argv[i]); return 0; }
+static int h_stat(int argc, char **argv)  { for(int i=1; i<argc; i++) cmd_stat(argv[i]); return 0; }
+static int h_rmdir(int argc, char **argv) { for(int i=1; i<argc; i++) cmd_rmdir(argv[i]); return 0; }
+static int h_hexdump(int argc, char **argv){ for(int i=1; i<argc; i++) cmd_hexdump(argv[i]); return 0; }
+static int h_run(int argc, char **argv)   { cmd_run(argv[1]); return 0; }
+static int h_mkdir(int argc, char **argv) { cmd_mkdir_list(argc-1, argv+1); return 0; }
+static int h_touch(int argc, char **argv) { cmd_touch_list(argc-1, argv+1); return 0; }
+static int h_encrypt(int argc, char **argv){ cmd_encrypt(argv[1], argv[2]); return 0; } // 解密其實就是再加密一次
+
+static int h_rm(int argc, char **argv)
+{
+    // rm -r 跟 rm 一樣會遞迴刪除
+    int first = (strcmp(argv[1], "-r") == 0) ? 2 : 1;
+    if(first >= argc) { out_printf("Usage: rm [-r] <name...>\n"); return 0; }
+    cmd_rm_list(argc-first, argv+first);
+    return 0;
+}
+
+static int h_cp(int argc, char **argv)
+{
+    if(argc == 3) cmd_cp(argv[1], argv[2]);
+    else cmd_cp_into(argc-2, argv+1, argv[argc-1]); // cp f1 f2 ... dir
+    return 0;
+}
+
+static int h_mv(int argc, char **argv)
+{
+    if(argc == 3) cmd_mv(argv[1], argv[2]);
+    else cmd_mv_into(argc-2, argv+1, argv[argc-1]); // mv f1 f2 ... dir
+    return 0;
+}
+
+static int h_cat(int argc, char **argv)
+{
+    if(argc == 1) cmd_cat(NULL); // 讀 Pipe 的輸入
+    for(int i=1; i<argc; i++) cmd_cat(argv[i]);
+    return 0;
+}
+
+static int h_grep(int argc, char **argv)
+{
+    // grep [-c] [-n] [-r] [-E] <keyword> [file/dir...]
+    int flags = 0, i = 1;
+    for(; i < argc && argv[i][0] == '-' && argv[i][1]; i++)
+    {
+        for(char *f = argv[i] + 1; *f; f++)
+        {
+            if(*f == 'c') flags |= GREP_COUNT;
+            else if(*f == 'n') flags |= GREP_LINENO;
+            else if(*f == 'r') flags |= GREP_RECURSE;
+            else if(*f == 'E') flags |= GREP_REGEX;
+            else { out_printf("grep: unknown option -%c\n", *f); return 0; }
+        }
+    }
+    if(i >= argc) { out_printf("Usage: grep [-c] [-n] [-r] [-E] <keyword> [file/dir...]\n"); return 0; }
+    cmd_grep(flags, argv[i], argc - i - 1, argv + i + 1);
+    return 0;
+}
+
+// -size 的參數: [+|-]N[c|k|M] (沒有單位時是 bytes),+ 是大於,- 是小於,沒有符號是等於 (以單位無條件進位)
+static int parse_size(const char *arg, FindQuery *q)
+{
+    char sign = (*arg == '+' || *arg == '-') ? *arg++ : 0;
+    char *end;
+    long long n = strtoll(arg, &end, 10);
+    long long unit = 1;
+    if(*end == 'k') unit = 1024, end++;
+    else if(*end == 'M') unit = 1024 * 1024, end++;
+    else if(*end == 'c') end++;
+    if(end == arg || *end || n < 0) return -1;
+    if(sign == '+') q->min_size = n * unit + 1;
+    else if(sign == '-')
+    {
+        if(n == 0) { q->min_size = 1; q->max_size = 0; } // 小於 0: 不可能符合
+        else q->max_size = n * unit - 1;
+    }
+    else { q->min_size = n ? (n - 1) * unit + 1 : 0; q->max_size = n * unit; }
+    return 0;
+}
+
+static int h_find(int argc, char **argv)
+{
+    // find <name>: 舊的用法,整個檔案系統找名稱包含 name 的檔案 (name 有萬用字元時當 glob)
+    // find [dir] [-name glob] [-type f|d] [-size [+-]N[k|M]] [-newer file]
+    FindQuery q;
+    find_query_init(&q);
+    char *dir = ".", *newer = NULL;
+    char legacy[MAX_CMD_LEN];
+    int i = 1;
+    if(argc == 2 && argv[1][0] != '-')
+    {
+        if(strpbrk(argv[1], "*?[")) q.name = argv[1];
+        else { snprintf(legacy, sizeof(legacy), "*%s*", argv[1]); q.name = legacy; }
+        cmd_find("/", &q, NULL);
+        return 0;
+    }
+    if(i < argc && argv[i][0] != '-') dir = argv[i++];
+    for(; i < argc; i += 2)
+    {
+        if(i + 1 >= argc) { out_printf("find: missing argument to %s\n", argv[i]); return 0; }
+        if(strcmp(argv[i], "-name") == 0) q.name = argv[i + 1];
+        else if(strcmp(argv[i], "-newer") == 0) newer = argv[i + 1];
+        else if(strcmp(argv[i], "-type") == 0)
+        {
+            if(strcmp(argv[i + 1], "f") && strcmp(argv[i + 1], "d")) { out_printf("find: -type must be f or d\n"); return 0; }
+            q.type = argv[i + 1][0];
+        }
+        else if(strcmp(argv[i], "-size") == 0)
+        {
+            if(parse_size(argv[i + 1], &q) < 0) { out_printf("find: bad size '%s'\n", argv[i + 1]); return 0; }
+        }
+        else { out_printf("find: unknown predicate %s\n", argv[i]); return 0; }
+    }
+    cmd_find(dir, &q, newer);
+    return 0;
+}
+
+static int h_backup(int argc, char **argv)
+{
+    // backup [--since G] <hostfile>
+    if(argc == 4 && strcmp(argv[1], "--since") == 0)
+    {
+        char *end;
+        unsigned long g = strtoul(argv[2], &end, 10);
+        if(end == argv[2] || *end) { out_printf("backup: bad generation '%s'\n", argv[2]); return 0; }
+        cmd_backup((uint32_t)g, argv[3]);
+    }
+    else if(argc == 2) cmd_backup(0, argv[1]);
+    else out_printf("Usage: backup [--since G] <hostfile>\n");
+    return 0;
+}
+
+static int h_sync(int argc, char **argv)   { cmd_sync(argv[1], argv[2]); return 0; }
+static int h_restore(int argc, char **argv) { cmd_restore(argv[1]); return 0; }
+
+static int h_defrag(int argc, char **argv)
+{
+    // defrag [--budget N[ms|s]] [--blocks N]: 時間或搬移量用完就停,下次再執行會接著做
+    int64_t budget = 0; int blocks = 0;
+    for(int i = 1; i < argc; i += 2)
+    {
+        char *end = NULL;
+        double v = (i + 1 < argc) ? strtod(argv[i + 1], &end) : -1;
+        if(v <= 0 || end == argv[i + 1]) { out_printf("Usage: defrag [--budget N[ms|s]] [--blocks N]\n"); return 0; }
+        if(strcmp(argv[i], "--budget") == 0 && (!*end || strcmp(end, "ms") == 0)) budget = (int64_t)(v * 1e6);
+        else if(strcmp(argv[i], "--budget") == 0 && strcmp(end, "s") == 0) budget = (int64_t)(v * 1e9);
+        else if(strcmp(argv[i], "--blocks") == 0 && !*end) blocks = (int)v;
+        else { out_printf("Usage: defrag [--budget N[ms|s]] [--blocks N]\n"); return 0; }
+    }
+    cmd_defrag(budget, blocks);
+    return 0;
+}
+
+static int h_writeback(int argc, char **argv)
+{
+    // writeback [--interval N[ms|s]] [--dirty N] | writeback off; 沒有參數 = 顯示狀態
+    if(argc == 2 && strcmp(argv[1], "off") == 0) { cmd_writeback(1, 0, 0); return 0; }
+    int interval = 0, dirty = 0;
+    for(int i = 1; i < argc; i += 2)
+    {
+        char *end = NULL;
+        double v = (i + 1 < argc) ? strtod(argv[i + 1], &end) : -1;
+        if(v <= 0 || end == argv[i + 1]) { out_printf("Usage: writeback [--interval N[ms|s]] [--dirty N] | writeback off\n"); return 0; }
+        if(strcmp(argv[i], "--interval") == 0 && (!*end || strcmp(end, "ms") == 0)) interval = (int)v;
+        else if(strcmp(argv[i], "--interval") == 0 && strcmp(end, "s") == 0) interval = (int)(v * 1000);
+        else if(strcmp(argv[i], "--dirty") == 0 && !*end) dirty = (int)v;
+        else { out_printf("Usage: writeback [--interval N[ms|s]] [--dirty N] | writeback off\n"); return 0; }
+    }
+    cmd_writeback(0, interval, dirty);
+    return 0;
+}
+
+static int h_chmod(int argc, char **argv)
+{
+    for(int i=2; i<argc; i++) cmd_chmod(argv[1], argv[i]);
+    return 0;
+}
+
+static int h_append(int argc, char **argv)
+{
+    // 之後的參數全部用空白接起來當作內容
+    char text[MAX_CMD_LEN * 2] = "";
+    for(int i=2; i<argc; i++)
+    {
+        if(i > 2) strncat(text, " ", sizeof(text)-strlen(text)-1);
+        strncat(text, argv[i], sizeof(text)-strlen(text)-1);
+    }
+    cmd_append(argv[1], text);
+    return 0;
+}
+
+static int h_nano(int argc, char **argv)
+{
+    if(batch_mode) out_printf(C_ERR "nano is not available in batch mode.\n" C_RESET);
+    else cmd_nano(argv[1]);
+    return 0;
+}
+
+static int h_exit(int argc, char **argv)
+{
+    save_fs(image_path);
+    return CMD_EXIT;
+}
+
+// 指令表: 必須依名稱排序 (lookup_command 用二分搜尋)
+static const CommandEntry commands[] =
+{
+    { "append",  2, -1, h_append,  "append <file> <text...>" },
+    { "backup",  1,  3, h_backup,  "backup [--since G] <hostfile>" },
+    { "cat",     0, -1, h_cat,     "cat <file...>" },
+    { "cd",      1,  1, h_cd,      "cd <dir>" },
+    { "chmod",   2, -1, h_chmod,   "chmod <mode> <file...>" },
+    { "cp",      2, -1, h_cp,      "cp <src> <dest> | cp <f1> <f2...> <dir>" },
+    { "decrypt", 2,  2, h_encrypt, "decrypt <file> <key>" },
+    { "defrag",  0,  4, h_defrag,  "defrag [--budget N[ms|s]] [--blocks N]" },
+    { "diskmap", 0,  2, h_diskmap, "diskmap [--json] [--reset]" },
+    { "encrypt", 2,  2, h_encrypt, "encrypt <file> <key>" },
+    { "exit",    0,  0, h_exit,    "exit" },
+    { "find",    0, -1, h_find,    "find <name> | find [dir] [-name glob] [-type f|d] [-size [+-]N[k|M]] [-newer file]" },
+    { "get",     1, -1, h_get,     "get <file...>" },
+    { "grep",    1, -1, h_grep,    "grep [-c] [-n] [-r] [-E] <keyword> [file/dir...]" },
+    { "help",    0,  0, h_help,    "help" },
+    { "hexdump", 1, -1, h_hexdump, "hexdump <file...>" },
+    { "index",   0,  1, h_index,   "index [on|off|status]" },
+    { "ll",      0, -1, h_ll,      "ll [-S|-t] [-r] [--limit N] [--offset N] [dir]" },
+    { "ls",      0, -1, h_ls,      "ls [-l] [-S|-t] [-r] [--limit N] [--offset N] [dir]" },
+    { "mkdir",   1, -1, h_mkdir,   "mkdir <dir...>" },
+    { "mv",      2, -1, h_mv,      "mv <src> <dest> | mv <f1> <f2...> <dir>" },
+    { "nano",    1,  1, h_nano,    "nano <file>" },
+    { "put",     1, -1, h_put,     "put <hostfile...>" },
+    { "pwd",     0,  0, h_pwd,     "pwd" },
+    { "restore", 1,  1, h_restore, "restore <hostfile>" },
+    { "rm",      1, -1, h_rm,      "rm [-r] <name...>" },
+    { "rmdir",   1, -1, h_rmdir,   "rmdir <dir...>" },
+    { "run",     1,  1, h_run,     "run <file>" },
+    { "stat",    1, -1, h_stat,    "stat <file...>" },
+    { "stats",   0,  2, h_stats,   "stats [--json] [--reset] | stats on|off" },
+    { "status",  0,  0, h_status,  "status" },
+    { "sync",    2,  2, h_sync,    "sync <hostfile> <file>" },
+    { "touch",   1, -1, h_touch,   "touch <file...>" },
+    { "tree",    0,  1, h_tree,    "tree [dir]" },
+    { "writeback", 0, 4, h_writeback, "writeback [--interval N[ms|s]] [--dirty N] | writeback off" },
+};
+#define NUM_COMMANDS (int)(sizeof(commands)/sizeof(commands[0]))
+static int cmd_stat_id[NUM_COMMANDS]; // 每個指令的延遲統計編號 (第一次執行時註冊,0 = 還沒)
+
+const CommandEntry *lookup_command(const char *name)
+{
+    int lo = 0, hi = NUM_COMMANDS - 1;
+    while(lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        int c = strcmp(name, commands[mid].name);
+        if(c == 0) return &commands[mid];
+        if(c < 0) hi = mid - 1; else lo = mid + 1;
+    }
+    return NULL;
+}
+
+// ---- 錄製 (--record): 執行過的指令換成 trace 的操作 (格式見 workload.h),不能重播的寫成註解 ----
+
+static FILE *record_fp;
+
+int record_open(const char *path)
+{
+    record_fp = fopen(path, "a");
+    if(!record_fp) return -1;
+    setvbuf(record_fp, NULL, _IOLBF, 0); // 當掉也留得下來
+    fprintf(record_fp, "# myfs trace: recorded shell session\n");
+    return 0;
+}
+
+// 名稱有空白或 # 的要加引號
+static void record_name(const char *name)
+{
+    if(strpbrk(name, " \t#")) fprintf(record_fp, " \"%s\"", name);
+    else fprintf(record_fp, " %s", name);
+}
+
+static void record_op(const char *op, const char *a, const char *b)
+{
+    fputs(op, record_fp);
+    if(a) record_name(a);
+    if(b) record_name(b);
+    fputc('\n', record_fp);
+}
+
+static void record_size(const char *op, const char *name, int size)
+{
+    fputs(op, record_fp);
+    record_name(name);
+    fprintf(record_fp, " %d\n", size);
+}
+
+static int file_size(const char *name)
+{
+    myfs_stat_t st;
+    return myfs_stat(name, &st) == MYFS_OK && !st.is_dir ? st.size : -1;
+}
+
+static const char *base_name(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+void record_write(const char *file, int len, int append)
+{
+    if(record_fp) record_size(append ? "append" : "write", file, len);
+}
+
+// is_dir: 執行前每個參數是不是目錄 (cp / mv 到目錄裡的時候要補上檔名)
+static void record_command(int argc, char **argv, const int *is_dir)
+{
+    const char *cmd = argv[0];
+    char path[512];
+    if(strcmp(cmd, "cd") == 0) record_op("cd", argv[1], NULL);
+    else if(strcmp(cmd, "mkdir") == 0 || strcmp(cmd, "touch") == 0 || strcmp(cmd, "stat") == 0)
+        for(int i = 1; i < argc; i++) record_op(cmd, argv[i], NULL);
+    else if(strcmp(cmd, "rmdir") == 0) for(int i = 1; i < argc; i++) record_op("rmdir", argv[i], NULL);
+    else if(strcmp(cmd, "rm") == 0)
+        for(int i = strcmp(argv[1], "-r") == 0 ? 2 : 1; i < argc; i++) record_op("rm", argv[i], NULL);
+    else if((strcmp(cmd, "cat") == 0 && argc > 1) || strcmp(cmd, "get") == 0 || strcmp(cmd, "hexdump") == 0)
+        for(int i = 1; i < argc; i++) record_op("read", argv[i], NULL);
+    else if(strcmp(cmd, "put") == 0)
+    {
+        // put 用檔名存在目前目錄
+        for(int i = 1; i < argc; i++)
+        {
+            const char *name = base_name(argv[i]);
+            int size = file_size(name);
+            if(size >= 0) record_size("write", name, size);
+        }
+    }
+    else if(strcmp(cmd, "append") == 0)
+    {
+        int len = 0; // h_append 用空白把參數接起來
+        for(int i = 2; i < argc; i++) len += (int)strlen(argv[i]) + (i > 2);
+        record_size("append", argv[1], len);
+    }
+    else if(strcmp(cmd, "cp") == 0 && argc == 3)
+    {
+        int size = file_size(argv[1]);
+        const char *dest = argv[2];
+        if(is_dir[2]) { snprintf(path, sizeof(path), "%s/%s", argv[2], base_name(argv[1])); dest = path; }
+        record_op("read", argv[1], NULL);
+        if(size >= 0) record_size("write", dest, size);
+    }
+    else if(strcmp(cmd, "mv") == 0 && argc == 3)
+    {
+        const char *dest = argv[2];
+        if(is_dir[2]) { snprintf(path, sizeof(path), "%s/%s", argv[2], base_name(argv[1])); dest = path; }
+        record_op("mv", argv[1], dest);
+    }
+    else if(strcmp(cmd, "ls") == 0 || strcmp(cmd, "ll") == 0)
+    {
+        const char *dir = ".";
+        for(int i = 1; i < argc; i++)
+        {
+            if(strcmp(argv[i], "--limit") == 0 || strcmp(argv[i], "--offset") == 0) i++;
+            else if(argv[i][0] != '-') dir = argv[i];
+        }
+        record_op("ls", dir, NULL);
+    }
+    else
+    {
+        fputc('#', record_fp);
+        for(int i = 0; i < argc; i++) record_name(argv[i]);
+        fputc('\n', record_fp);
+    }
+}
+
+int dispatch_line(char *line)
+{
+    char *argv[MAX_ARGS + 1];
+    int argc = split_args(line, argv, MAX_ARGS);
+    if(argc == 0) return 0;
+    argv[argc] = NULL;
+
+    const CommandEntry *c = lookup_command(argv[0]);
+    if(!c)
+    {
+        out_printf("Unknown command: %s\n", argv[0]); return 0;
+    }
+    int n = argc - 1;
+    if(n < c->min_args || (c->max_args >= 0 && n > c->max_args))
+    {
+        out_printf("Usage: %s\n", c->usage); return 0;
+    }
+    gen_bump(); // 每個指令一個 generation (backup --since 用)
+    int i = (int)(c - commands);
+    if(!cmd_stat_id[i]) cmd_stat_id[i] = stats_register(c->name);
+    int is_dir[MAX_ARGS + 1] = { 0 };
+    if(record_fp && (c->fn == h_cp || c->fn == h_mv))
+    {
+        myfs_stat_t st;
+        for(int k = 1; k < argc; k++) is_dir[k] = myfs_stat(argv[k], &st) == MYFS_OK && st.is_dir;
+    }
+    uint64_t t0 = stats_begin();
+    int r = c->fn(argc, argv);
+    stats_end(cmd_stat_id[i], t0, 0);
+    if(record_fp) record_command(argc, argv, is_dir);
+    return r;
+}
@@ -5,9 +5,8 @@
 #include <errno.h>
 #include "editor.h"
 #include "fs.h"
-#include "inode.h"
-#include "bitmap.h"
 #include "utils.h"
+#include "myfs.h"
 
 // 根據作業系統選擇不同的標頭檔和函式
 #ifdef _WIN32
@@ -41,7 +40,7 @@ struct EditorConfig
     int file_idx;           // 游標在 buffer 中的索引位置
     char buffer[MAX_BUFFER_SIZE]; // 檔案內容buffer
     int len;                // 目前檔案內容長度
-    char filename[32]; 
+    char filename[256]; 
     char status_msg[80];
     #ifndef _WIN32
     struct termios orig_termios; // Linux: 儲存原始終端機設定 
@@ -187,39 +186,23 @@ void editorDelChar()
 
 void editorSave() 
 {
-    int idx = find_inode_by_name(E.filename, current_dir_id);
-    if(idx != -1) 
-    {
-        if( !(inode_table[idx].permission & 2) ) 
-        {
-            strcpy(E.status_msg, "Error: Permission denied (Write protected)");
-            return;
-        }
+    // 存在的檔案會檢查 Write 權限,不存在就建立
+    int fd = myfs_open(E.filename, MYFS_O_WRONLY|MYFS_O_CREAT|MYFS_O_TRUNC);
+    if(fd == MYFS_EACCES) 
+    { 
+        strcpy(E.status_msg, "Error: Permission denied (Write protected)"); return; 
     }
-
-    if(idx==-1) 
-    {
-        idx=find_free_inode(); if(idx==-1) 
-        { 
-            strcpy(E.status_msg,"Error: No Inodes"); return; 
-        }
-        inode_table[idx].is_used=1; inode_table[idx].is_dir=0; inode_table[idx].permission=7;
-        strcpy(inode_table[idx].name, E.filename); inode_table[idx].parent_id=current_dir_id; sb->used_inodes++;
-        int bid=find_free_block(); if(bid==-1) 
-        { 
-            strcpy(E.status_msg,"Error: Disk Full"); return; 
-        }
-        inode_table[idx].blocks[0]=bid;
+    if(fd < 0) 
+    { 
+        snprintf(E.status_msg, sizeof(E.status_msg), "Error: %s", myfs_strerror(fd)); return; 
     }
 
     // 將 Buffer 資料寫入 Blocks
-    inode_table[idx].size = E.len;
-    int needs = (E.len + BLOCK_SIZE - 1)/BLOCK_SIZE;
-    for(int i=0; i<needs; i++) 
-    {
-        int bid; if(inode_table[idx].blocks[i]>0) bid = inode_table[idx].blocks[i]; else { bid=find_free_block(); inode_table[idx].blocks[i]=bid; }
-        int w_size = (E.len-(i*BLOCK_SIZE)>BLOCK_SIZE) ? BLOCK_SIZE : (E.len-(i*BLOCK_SIZE));
-        memcpy(data_blocks[bid].data, E.buffer+(i*BLOCK_SIZE), w_size);
+    int w = myfs_write(fd, E.buffer, E.len);
+    myfs_close(fd);
+    if(w < E.len) 
+    { 
+        strcpy(E.status_msg, "Error: Disk Full"); return; 
     }
     strcpy(E.status_msg, "File Saved.");
 }
@@ -249,17 +232,14 @@ void editorRefreshScreen()
 // 
 void cmd_nano(char *name) 
 {
-    E.cx=0; E.cy=0; E.file_idx=0; E.len=0; strcpy(E.filename, name); strcpy(E.status_msg, "Ready"); memset(E.buffer, 0, MAX_BUFFER_SIZE);
+    E.cx=0; E.cy=0; E.file_idx=0; E.len=0; snprintf(E.filename, sizeof(E.filename), "%s", name); strcpy(E.status_msg, "Ready"); memset(E.buffer, 0, MAX_BUFFER_SIZE);
     
-    int idx = find_inode_by_name(name, current_dir_id);
-    if(idx!=-1 && !inode_table[idx].is_dir) 
+    int fd = myfs_open(name, MYFS_O_RDONLY);
+    if(fd >= 0) 
     {
-        int rem=inode_table[idx].size; int b=0; int p=0;
-        while(rem>0) 
-        { 
-            int cp=(rem>BLOCK_SIZE)?BLOCK_SIZE:rem; int bid=inode_table[idx].blocks[b]; memcpy(E.buffer+p, data_blocks[bid].data, cp); p+=cp; rem-=cp; b++; 
-        }
-        E.len=p;
+        int n = myfs_read(fd, E.buffer, MAX_BUFFER_SIZE-1);
+        if(n > 0) E.len = n;
+        myfs_close(fd);
     }
     
     enableRawMode(); 
@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "find.h"
+#include "fs.h"
+#include "inode.h"
+#include "path.h"
+
+void find_query_init(FindQuery *q)
+{
+    memset(q, 0, sizeof(FindQuery));
+    q->max_size = -1;
+}
+
+// p 指向 '[' 的下一個字元,回傳 ']' 的下一個字元 (沒有對應的 ']' 回傳 NULL,'[' 當一般字元)
+static const char *glob_class(const char *p, unsigned char c, int *hit)
+{
+    int neg = (*p == '!' || *p == '^');
+    if(neg) p++;
+    const char *start = p;
+    int m = 0;
+    while(*p && (*p != ']' || p == start)) // 緊接在 '[' 後面的 ']' 是一般字元
+    {
+        unsigned char lo = *p, hi = lo;
+        if(p[1] == '-' && p[2] && p[2] != ']') { hi = p[2]; p += 2; }
+        if(c >= lo && c <= hi) m = 1;
+        p++;
+    }
+    if(*p != ']') return NULL;
+    *hit = m ^ neg;
+    return p + 1;
+}
+
+int glob_match(const char *pat, const char *s)
+{
+    // 只記住最後一個 '*' 的位置,失敗時讓它多吃一個字元 (不會指數爆炸)
+    const char *star = NULL, *resume = NULL;
+    while(*s)
+    {
+        if(*pat == '*') { star = ++pat; resume = s; continue; }
+        int hit = 0;
+        const char *next = NULL;
+        if(*pat == '?') { hit = 1; next = pat + 1; }
+        else if(*pat == '[' && (next = glob_class(pat + 1, *s, &hit))) {}
+        else if(*pat) { hit = (*pat == *s); next = pat + 1; }
+        if(hit) { pat = next; s++; continue; }
+        if(!star) return 0;
+        pat = star; s = ++resume;
+    }
+    while(*pat == '*') pat++;
+    return *pat == 0;
+}
+
+static int under_dir(int i, int dir)
+{
+    int p = inode_table[i].parent_id;
+    while(p != dir && p != 0) p = inode_table[p].parent_id;
+    return p == dir;
+}
+
+static int find_match(int i, int dir, const FindQuery *q)
+{
+    Inode *ino = &inode_table[i];
+    if(!ino->is_used || i == 0) return 0;
+    if(q->type == 'f' && ino->is_dir) return 0;
+    if(q->type == 'd' && !ino->is_dir) return 0;
+    if(ino->size < q->min_size || (q->max_size >= 0 && ino->size > q->max_size)) return 0;
+    if(q->newer && ino->mtime <= q->newer) return 0;
+    if(q->name && !glob_match(q->name, ino->name)) return 0;
+    return under_dir(i, dir);
+}
+
+// 每個 worker 負責 Inode Table 的一段,結果各自存
+typedef struct
+{
+    const FindQuery *q;
+    int dir;
+    int lo, hi;
+    int *out;
+    int n, cap;
+} FindPart;
+
+static void part_push(FindPart *p, int idx)
+{
+    if(p->n == p->cap)
+    {
+        p->cap = p->cap ? p->cap * 2 : 64;
+        p->out = realloc(p->out, sizeof(int) * p->cap);
+    }
+    p->out[p->n++] = idx;
+}
+
+static void *find_worker(void *arg)
+{
+    FindPart *p = arg;
+    for(int i = p->lo; i < p->hi; i++) if(find_match(i, p->dir, p->q)) part_push(p, i);
+    return NULL;
+}
+
+static void index_hit(void *ctx, int idx)
+{
+    FindPart *p = ctx;
+    if(find_match(idx, p->dir, p->q)) part_push(p, idx);
+}
+
+typedef struct
+{
+    const char *path;
+    int idx;
+} FindHit;
+
+static int cmp_hit(const void *a, const void *b)
+{
+    return strcmp(((const FindHit*)a)->path, ((const FindHit*)b)->path);
+}
+
+int find_run(int dir, const FindQuery *q, int nthreads, int **out)
+{
+    int n = 0;
+    int *res = NULL;
+
+    if(q->name)
+    {
+        // 1) 有名稱條件: 查 Name Index,只有名稱符合的 Inode 才檢查其他條件
+        FindPart p = { q, dir, 0, 0, NULL, 0, 0 };
+        names_glob(q->name, index_hit, &p);
+        res = p.out; n = p.n;
+    }
+    else
+    {
+        // 2) 只有其他條件: 平行掃描 Inode Table (worker 0 就是呼叫者自己)
+        int total = sb->total_inodes;
+        if(nthreads > total / 4096 + 1) nthreads = total / 4096 + 1; // 太小的表不值得開 thread
+        if(nthreads < 1) nthreads = 1;
+        FindPart *parts = calloc(nthreads, sizeof(FindPart));
+        pthread_t *tids = malloc(sizeof(pthread_t) * nthreads);
+        for(int w = 0; w < nthreads; w++)
+        {
+            parts[w].q = q; parts[w].dir = dir;
+            parts[w].lo = (int)((long long)total * w / nthreads);
+            parts[w].hi = (int)((long long)total * (w + 1) / nthreads);
+        }
+        for(int w = 1; w < nthreads; w++) pthread_create(&tids[w], NULL, find_worker, &parts[w]);
+        find_worker(&parts[0]);
+        for(int w = 1; w < nthreads; w++) pthread_join(tids[w], NULL);
+
+        for(int w = 0; w < nthreads; w++) n += parts[w].n;
+        res = malloc(sizeof(int) * (n ? n : 1));
+        n = 0;
+        for(int w = 0; w < nthreads; w++)
+        {
+            memcpy(res + n, parts[w].out, sizeof(int) * parts[w].n);
+            n += parts[w].n;
+            free(parts[w].out);
+        }
+        free(parts); free(tids);
+    }
+
+    // 依路徑排序 (path cache 不是 thread-safe,在這裡才算)
+    FindHit *hits = malloc(sizeof(FindHit) * (n ? n : 1));
+    for(int k = 0; k < n; k++) { hits[k].idx = res[k]; hits[k].path = inode_path(res[k]); }
+    qsort(hits, n, sizeof(FindHit), cmp_hit);
+    for(int k = 0; k < n; k++) res[k] = hits[k].idx;
+    free(hits);
+    *out = res;
+    return n;
+}
@@ -1,159 +1,240 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "fs.h"
 #include "security.h"
 #include "bitmap.h"
 #include "utils.h"
+#include "myfs.h"
+#include "path.h"
+#include "trigram.h"
+#include "gen.h"
+#include "defrag.h"
+#include "heat.h"
+#include "lock.h"
+#include "writeback.h"
+#include "bcache.h"
+#include "stats.h"
+#include "hostsync.h"
 
 Superblock *sb;
 Inode *inode_table;
 DiskBlock *data_blocks;
 uint8_t *block_bitmap;
-int current_dir_id = 0;
-char current_path[256] = "/";
+Session default_session = { 0, "/" };
+__thread Session *cur_session;
+char image_path[256] = "my_fs.dump";
+int format_inodes; // 0 = 依大小決定
 
-// Initialize
-void init_fs(int size, int load_from_file) 
+// 讀取映像檔 (不會結束程式,失敗回傳錯誤碼)
+int load_fs(const char *path) 
 {
-    if (load_from_file) 
-    {
-        FILE *fp = fopen("my_fs.dump", "rb");
-        if (!fp) 
-        { 
-            printf(C_ERR "Error: Cannot open dump.\n" C_RESET); exit(1); 
-        }
-        
-        // Step 1: read Superblock
-        sb = (Superblock*)malloc(sizeof(Superblock));
-        fread(sb, sizeof(Superblock), 1, fp);
+    uint64_t t0 = stats_begin();
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return MYFS_ENOENT;
+    
+    // Step 1: read Superblock
+    Superblock *nsb = (Superblock*)malloc(sizeof(Superblock));
+    if (fread(nsb, sizeof(Superblock), 1, fp) != 1 || nsb->total_inodes <= 0) 
+    { 
+        fclose(fp); free(nsb); return MYFS_EIO; 
+    }
 
-        // Step 2: Password
-        if (!check_password(sb->password)) 
-        { 
-            fclose(fp); free(sb); exit(1); 
-        }
+    // Step 2: Password
+    if (!check_password(nsb->password)) 
+    { 
+        fclose(fp); free(nsb); return MYFS_EACCES; 
+    }
+    free_fs();
+    sb = nsb;
 
-        // Step 3: read Inode Table (encrypted data now)
-        inode_table = (Inode*)malloc(sizeof(Inode) * MAX_FILES);
-        fread(inode_table, sizeof(Inode), MAX_FILES, fp);
-        
-        // Step 4: read Data Blocks
+    // Step 3: read Inode Table (encrypted data now),數量記錄在 Superblock
+    inode_table = (Inode*)malloc(sizeof(Inode) * sb->total_inodes);
+    fread(inode_table, sizeof(Inode), sb->total_inodes, fp);
+    
+    // Step 4: read Data Blocks (out-of-core 模式: 留在映像檔裡,用到才透過 Block 快取讀進來)
+    if(bc_configured()) fseek64(fp, (long long)sizeof(DiskBlock) * sb->total_blocks, SEEK_CUR);
+    else
+    {
         data_blocks = (DiskBlock*)malloc(sizeof(DiskBlock) * sb->total_blocks);
         fread(data_blocks, sizeof(DiskBlock), sb->total_blocks, fp);
+    }
 
-        // Step 5: read Bitmap
-        int b_size = (sb->total_blocks + 7) / 8;
-        block_bitmap = (uint8_t*)malloc(b_size);
-        fread(block_bitmap, 1, b_size, fp);
-        fclose(fp);
-
-        // Step 6: decrypted data
-        if (strlen(sb->password)>0) 
-        {
-            xor_cipher(inode_table, sizeof(Inode)*MAX_FILES, sb->password);
-            xor_cipher(data_blocks, sizeof(DiskBlock)*sb->total_blocks, sb->password);
-        }
-        printf(C_OK "FS Loaded.\n" C_RESET);
+    // Step 5: read Bitmap
+    int b_size = (sb->total_blocks + 7) / 8;
+    block_bitmap = (uint8_t*)malloc(b_size);
+    fread(block_bitmap, 1, b_size, fp);
+
+    // Step 6: 可選的區段 (Trigram 索引、Generation),舊映像檔沒有; 每段開頭是 4-byte 的標籤
+    gen_reset();
+    heat_reset();
+    sync_reset();
+    locks_reset();
+    char tag[4];
+    while(fread(tag, 1, 4, fp) == 4)
+    {
+        if(memcmp(tag, TRI_SECTION, 4) == 0) { if(tri_load(fp, sb->password) < 0) break; }
+        else if(memcmp(tag, GEN_SECTION, 4) == 0) { if(gen_load(fp) < 0) break; }
+        else break;
+    }
+    long long bytes = ftell64(fp);
+    fclose(fp);
+    if(!data_blocks && bc_open(path, 0, 0) < 0) { free_fs(); return MYFS_EIO; }
 
+    // Step 7: decrypted data
+    if (strlen(sb->password)>0) 
+    {
+        xor_cipher(inode_table, sizeof(Inode)*sb->total_inodes, sb->password);
+        if(data_blocks) xor_cipher(data_blocks, sizeof(DiskBlock)*sb->total_blocks, sb->password);
+    }
+    alloc_reset();
+    dcache_reset();
+    defrag_reset();
+    wb_reset(0);
+    current_dir_id = 0; strcpy(current_path, "/");
+    stats_end(ST_LOAD, t0, bytes);
+    return MYFS_OK;
+}
+
+// 建立新的分割區 (只在記憶體中,save_fs 時才寫出; out-of-core 模式要馬上建立映像檔,資料 Block 放在裡面)
+int format_fs(long long size) 
+{
+    // 每 BLOCKS_PER_INODE 個 Block 配一個 Inode (有指定 format_inodes 就照指定的),但至少 MIN_INODES 個
+    long long num_inodes = format_inodes > 0 ? format_inodes : (size - (long long)sizeof(Superblock)) / (BLOCK_SIZE * BLOCKS_PER_INODE + (long long)sizeof(Inode));
+    if(num_inodes < MIN_INODES) num_inodes = MIN_INODES;
+    if((long long)sizeof(Inode) * num_inodes >= size) return MYFS_EINVAL; // 指定的 Inode 太多
+    long long meta = sizeof(Superblock) + (long long)sizeof(Inode) * num_inodes;
+    long long num_blocks = (size - meta) / BLOCK_SIZE; // 計算可用的 Block 數量
+    if(num_blocks <= 0) return MYFS_EINVAL;
+    if(num_blocks > FS_MAX_BLOCKS || num_inodes > INT_MAX) return MYFS_EFBIG; // 超過 FS_MAX_BLOCKS 不截斷,直接拒絕
+
+    // 分配記憶體
+    free_fs();
+    sb = (Superblock*)calloc(1, sizeof(Superblock));
+    inode_table = (Inode*)calloc(num_inodes, sizeof(Inode));
+    if(!bc_configured()) data_blocks = (DiskBlock*)malloc(sizeof(DiskBlock)*num_blocks);
+    block_bitmap = (uint8_t*)calloc((num_blocks+7)/8, 1);
+    if(!inode_table || !block_bitmap || (!bc_configured() && !data_blocks)) { free_fs(); return MYFS_EFBIG; } // 記憶體放不下 (可以改用 --cache)
+
+    // Initialize Superblock (total_size 只是記錄用,超過 int 就存 INT_MAX; 實際大小由 fs_total_size 依配置算)
+    sb->total_size = size > INT_MAX ? INT_MAX : (int)size; sb->block_size = BLOCK_SIZE;
+    sb->total_inodes = num_inodes; sb->used_inodes = 1;
+    sb->total_blocks = num_blocks; sb->used_blocks = 0;
+    alloc_reset();
+    gen_reset();
+    heat_reset();
+    sync_reset();
+    locks_reset();
+    
+    set_new_password(sb->password, 32);
+    if(!data_blocks && bc_open(image_path, 1, meta + (long long)num_blocks * BLOCK_SIZE + (num_blocks+7)/8) < 0)
+    {
+        free_fs(); return MYFS_EIO;
+    }
+
+    // Create Root 
+    inode_table[0].is_used=1; inode_table[0].is_dir=1;
+    inode_table[0].permission=7; strcpy(inode_table[0].name, "root");
+    inode_table[0].parent_id=0;
+    dcache_reset();
+    defrag_reset();
+    wb_reset(1); // 映像檔還不存在
+    current_dir_id = 0; strcpy(current_path, "/");
+    return MYFS_OK;
+}
+
+void free_fs() 
+{
+    wb_stop();
+    wb_free();
+    bc_close();
+    tri_disable();
+    gen_free();
+    heat_free();
+    sync_free();
+    locks_free();
+    alloc_free();
+    free(sb); free(inode_table); free(data_blocks); free(block_bitmap);
+    sb = NULL; inode_table = NULL; data_blocks = NULL; block_bitmap = NULL;
+}
+
+// 分割區大小 (bytes): 舊映像檔和 2 GiB 以下照 Superblock 記錄的,超過的由 Inode / Block 數算回來
+long long fs_total_size(void)
+{
+    if(sb->total_size < INT_MAX) return sb->total_size;
+    return sizeof(Superblock) + (long long)sizeof(Inode) * sb->total_inodes + (long long)BLOCK_SIZE * sb->total_blocks;
+}
+
+// Initialize (shell 用: 失敗就結束程式)
+void init_fs(long long size, int load_from_file) 
+{
+    if (load_from_file) 
+    {
+        int r = load_fs(image_path);
+        if (r == MYFS_ENOENT) printf(C_ERR "Error: Cannot open dump.\n" C_RESET);
+        if (r != MYFS_OK) exit(1);
+        printf(C_OK "FS Loaded.\n" C_RESET);
     } 
     else 
     {
-        // Create Mode
-        int meta = sizeof(Superblock) + (sizeof(Inode)*MAX_FILES);
-        int num_blocks = (size - meta) / BLOCK_SIZE; // 計算可用的 Block 數量
-        if(num_blocks <= 0) 
+        int r = format_fs(size);
+        if (r != MYFS_OK) 
         { 
-            printf(C_ERR "Size too small.\n" C_RESET); exit(1); 
+            printf(C_ERR "%s\n" C_RESET, r == MYFS_EFBIG ? "Size too large." : "Size too small."); exit(1); 
         }
-
-        // 分配記憶體
-        sb = (Superblock*)malloc(sizeof(Superblock));
-        inode_table = (Inode*)malloc(sizeof(Inode)*MAX_FILES);
-        data_blocks = (DiskBlock*)malloc(sizeof(DiskBlock)*num_blocks);
-        block_bitmap = (uint8_t*)calloc((num_blocks+7)/8, 1);
-
-        // Initialize Superblock
-        sb->total_size = size; sb->block_size = BLOCK_SIZE;
-        sb->total_inodes = MAX_FILES; sb->used_inodes = 1;
-        sb->total_blocks = num_blocks; sb->used_blocks = 0;
-        
-        set_new_password(sb->password, 32);
-
-        // Initialize Inode
-        for(int i=0; i<MAX_FILES; i++) inode_table[i].is_used=0;
-        
-        // Create Root 
-        inode_table[0].is_used=1; inode_table[0].is_dir=1;
-        inode_table[0].permission=7; strcpy(inode_table[0].name, "root");
-        inode_table[0].parent_id=0;
-        
         printf(C_OK "Partition created.\n" C_RESET);
     }
 }
 
 // 存檔成dump
-void save_fs(const char *filename) 
+int save_fs(const char *filename) 
 {
-    FILE *fp = fopen(filename, "wb");
-    if(!fp) return;
+    // out-of-core 模式: 資料 Block 只在映像檔裡,不能存到別的地方,也不能截斷,metadata 原地覆寫
+    if(!data_blocks && strcmp(filename, image_path) != 0) return MYFS_EINVAL;
+    uint64_t t0 = stats_begin();
+    wb_image_lock(); // 背景 checkpoint 寫到一半時先等它寫完
+    FILE *fp = fopen(filename, data_blocks ? "wb" : "r+b");
+    if(!fp) { wb_image_unlock(); return MYFS_EIO; }
+    int err = 0;
     
-    // Step 1: 寫入 Superblock
+    // Step 1: 寫入 Superblock (使用量以各配置群組的計數為準)
+    sb->used_blocks = blocks_used();
     fwrite(sb, sizeof(Superblock), 1, fp);
 
     // Step 2: Encrypt
     if(strlen(sb->password)>0) 
     {
-        xor_cipher(inode_table, sizeof(Inode)*MAX_FILES, sb->password);
-        xor_cipher(data_blocks, sizeof(DiskBlock)*sb->total_blocks, sb->password);
+        xor_cipher(inode_table, sizeof(Inode)*sb->total_inodes, sb->password);
+        if(data_blocks) xor_cipher(data_blocks, sizeof(DiskBlock)*sb->total_blocks, sb->password);
     }
 
-    // Step 3: 寫入加密後的資料
-    fwrite(inode_table, sizeof(Inode), MAX_FILES, fp);
-    fwrite(data_blocks, sizeof(DiskBlock), sb->total_blocks, fp);
+    // Step 3: 寫入加密後的資料 (out-of-core: 快取裡的髒 Block 寫回去,其他的本來就在映像檔裡)
+    fwrite(inode_table, sizeof(Inode), sb->total_inodes, fp);
+    if(data_blocks) fwrite(data_blocks, sizeof(DiskBlock), sb->total_blocks, fp);
+    else
+    {
+        err |= bc_flush() < 0;
+        fseek64(fp, (long long)sizeof(DiskBlock) * sb->total_blocks, SEEK_CUR);
+    }
     int b_size = (sb->total_blocks + 7) / 8;
     fwrite(block_bitmap, 1, b_size, fp);
 
     // Step 4: Decrypt
     if(strlen(sb->password)>0) 
     {
-        xor_cipher(inode_table, sizeof(Inode)*MAX_FILES, sb->password);
-        xor_cipher(data_blocks, sizeof(DiskBlock)*sb->total_blocks, sb->password);
+        xor_cipher(inode_table, sizeof(Inode)*sb->total_inodes, sb->password);
+        if(data_blocks) xor_cipher(data_blocks, sizeof(DiskBlock)*sb->total_blocks, sb->password);
     }
-    fclose(fp);
-}
-
-// 磁碟重組 (Defrag),將分散的 Used Blocks 全部搬移到陣列的前端
-void defrag_system() 
-{
-    printf("Defragging...\n");
-    int w_ptr = 0; // 寫入指標，指向新的緊湊空間
-    
-    // 建立新的暫存區
-    DiskBlock *new_blks = malloc(sizeof(DiskBlock)*sb->total_blocks);
-    uint8_t *new_map = calloc((sb->total_blocks+7)/8, 1);
-    int used_cnt = 0;
 
-    for(int i=0; i<MAX_FILES; i++) 
-    {
-        if(inode_table[i].is_used && !inode_table[i].is_dir && inode_table[i].size > 0) 
-        {
-            int needs = (inode_table[i].size + BLOCK_SIZE - 1)/BLOCK_SIZE;
-            for(int b=0; b<needs; b++) 
-            {
-                int old = inode_table[i].blocks[b];
-                // copy資料到新位置
-                memcpy(new_blks[w_ptr].data, data_blocks[old].data, BLOCK_SIZE);
-                // renew Inode 指標
-                inode_table[i].blocks[b] = w_ptr;
-                // renew 新 Bitmap
-                new_map[w_ptr/8] |= (1<<(w_ptr%8));
-                w_ptr++; used_cnt++;
-            }
-        }
-    }
-    free(data_blocks); free(block_bitmap);
-    data_blocks = new_blks; block_bitmap = new_map;
-    sb->used_blocks = used_cnt;
-    printf(C_OK "Defrag Done.\n" C_RESET);
-}
\ No newline at end of file
+    // Step 5: 可選的區段 (Trigram 索引要看 Inode Table,所以放在解密之後)
+    tri_save(fp, sb->password);
+    gen_save(fp);
+    if(!data_blocks) fwrite("\0\0\0\0", 1, 4, fp); // 沒有截斷: 結尾標記,後面殘留的舊區段不會被讀到
+    long long bytes = ftell64(fp);
+    err |= fclose(fp) != 0;
+    if(!err && strcmp(filename, image_path) == 0) wb_saved();
+    wb_image_unlock();
+    stats_end(ST_SAVE, t0, bytes);
+    return err ? MYFS_EIO : MYFS_OK;
+}
@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <string.h>
+#include "gen.h"
+#include "fs.h"
+#include "utils.h"
+
+uint32_t fs_generation = 1;
+uint64_t fs_id;
+uint32_t *inode_gen;
+uint32_t *block_gen;
+uint32_t gen_checkpoint;
+int gen_dirty;
+
+void gen_reset()
+{
+    gen_free();
+    inode_gen = calloc(sb->total_inodes, sizeof(uint32_t));
+    block_gen = calloc(sb->total_blocks, sizeof(uint32_t));
+    fs_generation = 1;
+    // 沒有好的亂數來源,混合時鐘和位址就夠分辨不同的檔案系統了
+    fs_id = now_ns() ^ ((uint64_t)(uintptr_t)inode_gen << 16) ^ ((uint64_t)time(NULL) << 32);
+}
+
+void gen_free()
+{
+    free(inode_gen); free(block_gen);
+    inode_gen = NULL; block_gen = NULL;
+}
+
+void gen_bump()
+{
+    fs_generation++;
+}
+
+// 格式: "GEN1", fs_id, generation, Inode 數, Block 數, 每個 Inode 的 generation, 每個 Block 的 generation
+void gen_save(FILE *fp)
+{
+    fwrite(GEN_SECTION, 1, 4, fp);
+    fwrite(&fs_id, sizeof(fs_id), 1, fp);
+    fwrite(&fs_generation, sizeof(fs_generation), 1, fp);
+    fwrite(&sb->total_inodes, sizeof(int), 1, fp);
+    fwrite(&sb->total_blocks, sizeof(int), 1, fp);
+    fwrite(inode_gen, sizeof(uint32_t), sb->total_inodes, fp);
+    fwrite(block_gen, sizeof(uint32_t), sb->total_blocks, fp);
+}
+
+int gen_load(FILE *fp)
+{
+    uint64_t id;
+    uint32_t g;
+    int ni, nb;
+    if(fread(&id, sizeof(id), 1, fp) != 1 || fread(&g, sizeof(g), 1, fp) != 1 ||
+       fread(&ni, sizeof(int), 1, fp) != 1 || fread(&nb, sizeof(int), 1, fp) != 1 ||
+       ni != sb->total_inodes || nb != sb->total_blocks) return -1;
+    if(fread(inode_gen, sizeof(uint32_t), ni, fp) != (size_t)ni ||
+       fread(block_gen, sizeof(uint32_t), nb, fp) != (size_t)nb)
+    {
+        // 讀到一半壞掉: 全部當作 generation 0 (下一次備份要從 0 開始)
+        memset(inode_gen, 0, sizeof(uint32_t) * ni);
+        memset(block_gen, 0, sizeof(uint32_t) * nb);
+        return -1;
+    }
+    fs_id = id;
+    fs_generation = g;
+    return 0;
+}
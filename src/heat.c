@@ -0,0 +1,19 @@
+#include <stdlib.h>
+#include "heat.h"
+#include "fs.h"
+
+uint32_t *block_reads;
+uint32_t *block_writes;
+
+void heat_reset()
+{
+    heat_free();
+    block_reads = calloc(sb->total_blocks, sizeof(uint32_t));
+    block_writes = calloc(sb->total_blocks, sizeof(uint32_t));
+}
+
+void heat_free()
+{
+    free(block_reads); free(block_writes);
+    block_reads = NULL; block_writes = NULL;
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "hostsync.h"
+#include "fs.h"
+#include "inode.h"
+#include "bitmap.h"
+#include "gen.h"
+#include "heat.h"
+#include "writeback.h"
+#include "bcache.h"
+#include "trigram.h"
+#include "myfs.h"
+#include "lock.h"
+
+// Adler-32 (rsync 的 weak checksum)
+static uint32_t weak_hash(const unsigned char *p, int n)
+{
+    uint32_t a = 1, b = 0;
+    for(int i = 0; i < n; i++) { a += p[i]; b += a; }
+    return ((b % 65521) << 16) | (a % 65521);
+}
+
+// FNV-1a 64-bit,weak hash 相同時才算
+static uint64_t strong_hash(const unsigned char *p, int n)
+{
+    uint64_t h = 1469598103934665603ull;
+    for(int i = 0; i < n; i++) { h ^= p[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+typedef struct
+{
+    uint32_t weak;
+    uint64_t strong;
+    int next; // 同一個 bucket 的下一個舊 Block (-1 結束)
+} BlockSig;
+
+#define SIG_BUCKETS 256 // 2 的次方,單檔最多 MAX_BLOCKS_PER_FILE 個 Block
+
+uint32_t *sync_mtime;
+
+void sync_reset()
+{
+    sync_free();
+    sync_mtime = calloc(sb->total_inodes, sizeof(uint32_t));
+}
+
+void sync_free()
+{
+    free(sync_mtime);
+    sync_mtime = NULL;
+}
+
+// 比對並重寫 (呼叫者拿著 Inode 的 write lock,比對到寫完之間別人不能改 size 和 Block)
+static int sync_locked(const char *host_path, const struct stat *hs, uint32_t started, int idx, SyncStats *st)
+{
+    Inode *ino = &inode_table[idx];
+    int size = (int)hs->st_size;
+    st->size = size;
+    st->blocks = FILE_BLOCKS(size);
+    uint32_t hmtime = (uint32_t)hs->st_mtime;
+    if(ino->size == size && ino->mtime == hmtime && sync_mtime && sync_mtime[idx] == hmtime) { st->skipped = 1; return MYFS_OK; }
+
+    // 新內容整個讀進來 (最多 MAX_FILE_SIZE)
+    FILE *fp = fopen(host_path, "rb");
+    if(!fp) return MYFS_EIO;
+    unsigned char *data = malloc(size ? size : 1);
+    if(!data) { fclose(fp); return MYFS_ENOMEM; }
+    int got = (int)fread(data, 1, size, fp);
+    fclose(fp);
+    if(got != size) { free(data); return MYFS_EIO; }
+
+    int n_old = FILE_BLOCKS(ino->size), n_new = FILE_BLOCKS(size);
+
+    // 舊的完整 Block 的簽章
+    BlockSig sigs[MAX_BLOCKS_PER_FILE];
+    int head[SIG_BUCKETS];
+    memset(head, -1, sizeof(head));
+    if(!data_blocks) bc_readahead(ino->blocks, n_old);
+    for(int j = 0; j < ino->size / BLOCK_SIZE; j++)
+    {
+        sigs[j].weak = weak_hash((const unsigned char *)blk_get(ino->blocks[j], BLK_READ), BLOCK_SIZE);
+        blk_put(ino->blocks[j], BLK_READ);
+        sigs[j].strong = 0; // 用到時才算
+        sigs[j].next = head[sigs[j].weak & (SIG_BUCKETS - 1)];
+        head[sigs[j].weak & (SIG_BUCKETS - 1)] = j;
+    }
+
+    int newblk[MAX_BLOCKS_PER_FILE];
+    char used[MAX_BLOCKS_PER_FILE] = {0};
+    int pending = 0;
+
+    // 1) 同位置內容相同: 不動 (最後一個 Block 只比對有效的部分)
+    for(int k = 0; k < n_new; k++)
+    {
+        newblk[k] = -1;
+        int len = (k == n_new - 1 && size % BLOCK_SIZE) ? size % BLOCK_SIZE : BLOCK_SIZE;
+        int same = k < n_old && memcmp(blk_get(ino->blocks[k], BLK_READ), data + k * BLOCK_SIZE, len) == 0;
+        if(k < n_old) blk_put(ino->blocks[k], BLK_READ);
+        if(same)
+        {
+            newblk[k] = ino->blocks[k]; used[k] = 1; st->unchanged++;
+        }
+        else pending++;
+    }
+
+    // 2) 整個 Block 搬了位置 (前面插入或刪掉整數個 Block): 查簽章,只改指標
+    for(int k = 0; k < n_new && pending; k++)
+    {
+        if(newblk[k] != -1 || (k + 1) * BLOCK_SIZE > size) continue;
+        const unsigned char *p = data + k * BLOCK_SIZE;
+        uint32_t w = weak_hash(p, BLOCK_SIZE);
+        uint64_t s = 0;
+        for(int j = head[w & (SIG_BUCKETS - 1)]; j != -1; j = sigs[j].next)
+        {
+            if(used[j] || sigs[j].weak != w) continue;
+            if(!s) s = strong_hash(p, BLOCK_SIZE);
+            const char *old = blk_get(ino->blocks[j], BLK_READ);
+            if(!sigs[j].strong) sigs[j].strong = strong_hash((const unsigned char *)old, BLOCK_SIZE);
+            int same = sigs[j].strong == s && memcmp(old, p, BLOCK_SIZE) == 0;
+            blk_put(ino->blocks[j], BLK_READ);
+            if(!same) continue;
+            newblk[k] = ino->blocks[j]; used[j] = 1; st->moved++; pending--;
+            break;
+        }
+    }
+
+    // 3) 其他的重寫: 先用沒用到的舊 Block,不夠再配新的
+    // 新的 Block 先全部配好 (別的 thread 也在配),配不到就什麼都還沒改,直接回傳
+    int spares = 0, extra[MAX_BLOCKS_PER_FILE], n_extra = 0;
+    for(int j = 0; j < n_old; j++) if(!used[j]) spares++;
+    for(int k = 0; k < n_new; k++) if(newblk[k] == -1 && spares-- <= 0)
+    {
+        int goal = n_extra ? extra[n_extra-1]+1 : n_old ? ino->blocks[n_old-1]+1 : ag_goal(ino->parent_id);
+        if((extra[n_extra] = alloc_block(goal)) < 0)
+        {
+            while(n_extra > 0) free_block(extra[--n_extra]);
+            free(data); return MYFS_ENOSPC;
+        }
+        n_extra++;
+    }
+    int spare = 0, e = 0;
+    for(int k = 0; k < n_new; k++)
+    {
+        if(newblk[k] != -1) continue;
+        while(spare < n_old && used[spare]) spare++;
+        int bid;
+        if(spare < n_old) { bid = ino->blocks[spare]; used[spare] = 1; }
+        else bid = extra[e++];
+        int len = (k == n_new - 1 && size % BLOCK_SIZE) ? size % BLOCK_SIZE : BLOCK_SIZE;
+        wb_cow(bid);
+        char *dst = blk_get(bid, BLK_NEW);
+        memcpy(dst, data + k * BLOCK_SIZE, len);
+        if(len < BLOCK_SIZE) memset(dst + len, 0, BLOCK_SIZE - len);
+        blk_put(bid, BLK_NEW);
+        gen_block(bid);
+        heat_write(bid);
+        newblk[k] = bid; st->written++;
+    }
+    for(int j = 0; j < n_old; j++) if(!used[j]) { free_block(ino->blocks[j]); st->freed++; }
+    free(data);
+
+    int changed = st->moved || st->written || st->freed || ino->size != size;
+    memcpy(ino->blocks, newblk, sizeof(int) * n_new);
+    ino->size = size;
+    if(changed)
+    {
+        inode_modified(idx);
+        tri_clear(idx);
+        tri_add(idx, 0, size);
+    }
+    ino->mtime = hmtime;
+    if(sync_mtime) sync_mtime[idx] = hmtime < started ? hmtime : 0; // 下次可以用大小 + mtime 直接跳過
+    gen_inode(idx);
+    return MYFS_OK;
+}
+
+int host_sync(const char *host_path, const char *vfs_path, SyncStats *st)
+{
+    memset(st, 0, sizeof(*st));
+    uint32_t started = (uint32_t)time(NULL);
+    struct stat hs;
+    if(stat(host_path, &hs) != 0) return MYFS_ENOENT;
+    if(hs.st_size > MAX_FILE_SIZE) return MYFS_EFBIG;
+
+    // fd 開著到寫完: 權限檢查、不存在時建立,鎖也透過 fd 拿 (確認還是同一個檔案)
+    int fd = myfs_open(vfs_path, MYFS_O_WRONLY | MYFS_O_CREAT);
+    if(fd < 0) return fd;
+    int idx = fd_lock_inode(fd, 1);
+    int r = idx < 0 ? idx : sync_locked(host_path, &hs, started, idx, st);
+    if(idx >= 0) inode_unlock(idx);
+    myfs_close(fd);
+    return r;
+}
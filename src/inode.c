@@ -1,25 +1,47 @@
 #include "inode.h"
 #include "bitmap.h"
+#include "fs.h"
+#include "path.h"
+#include "trigram.h"
+#include "gen.h"
+#include "heat.h"
+#include "writeback.h"
+#include "bcache.h"
+#include "stats.h"
+#include "hostsync.h"
 #include <string.h>
 #include <stdio.h>
 
 int find_free_inode() 
 {
-    for(int i=0; i<MAX_FILES; i++) 
+    return find_free_inode_from(0);
+}
+
+int find_free_inode_from(int start) 
+{
+    for(int i=start; i<sb->total_inodes; i++) 
         if(!inode_table[i].is_used) return i;
     return -1;
 }
 
-// 根據檔名和目錄 ID 尋找 Inode
-int find_inode_by_name(char *name, int dir_id) 
+// 根據檔名和目錄 ID 尋找 Inode (先查 Dentry Cache,沒有才掃 Inode Table)
+int find_inode_by_name(const char *name, int dir_id) 
 {
-    for(int i=0; i<MAX_FILES; i++) 
+    uint64_t t0 = stats_begin_sampled();
+    int hit = dcache_lookup(dir_id, name);
+    for(int i=0; hit == -1 && i<sb->total_inodes; i++) 
     {
         // 必須是被使用的 + 父目錄 ID 符合 + 檔名相同才是我們要找的
         if(inode_table[i].is_used && inode_table[i].parent_id == dir_id &&
-           strcmp(inode_table[i].name, name)==0) return i;
+           strcmp(inode_table[i].name, name)==0) 
+        {
+            if(dir_id==0 && i==0) continue; // root 不是自己的子目錄
+            dcache_insert(dir_id, name, i);
+            hit = i;
+        }
     }
-    return -1;
+    stats_end(ST_LOOKUP, t0, 0);
+    return hit;
 }
 
 // Check Permission
@@ -37,7 +59,7 @@ void recursive_delete(int inode_idx)
     if(inode_table[inode_idx].is_dir) 
     {
         // 如果是目錄，先遞迴刪除所有子檔案
-        for(int i=0; i<MAX_FILES; i++) 
+        for(int i=0; i<sb->total_inodes; i++) 
         {
             if(inode_table[i].is_used && inode_table[i].parent_id == inode_idx)
                 recursive_delete(i);
@@ -52,6 +74,192 @@ void recursive_delete(int inode_idx)
     }
     
     // 最後release Inode
+    dcache_invalidate(inode_idx);
+    tri_clear(inode_idx);
     inode_table[inode_idx].is_used = 0;
     sb->used_inodes--;
-}
\ No newline at end of file
+}
+
+// 建立新的 Inode (不預先配置 Block)
+int inode_create(int parent_id, const char *name, int is_dir, int start) 
+{
+    int idx=find_free_inode_from(start); if(idx==-1) return -1;
+    memset(&inode_table[idx], 0, sizeof(Inode));
+    inode_table[idx].id=idx; inode_table[idx].is_used=1; inode_table[idx].is_dir=is_dir;
+    inode_table[idx].permission=7; inode_table[idx].parent_id=parent_id;
+    strncpy(inode_table[idx].name, name, MAX_FILENAME-1);
+    inode_table[idx].crtime=inode_table[idx].mtime=inode_table[idx].ctime=inode_table[idx].atime=(uint32_t)time(NULL);
+    tri_clear(idx);
+    sync_forget(idx);
+    names_touch(idx);
+    gen_inode(idx);
+    dir_changed(parent_id);
+    sb->used_inodes++;
+    return idx;
+}
+
+int inode_read(int idx, void *buf, int n, int off) 
+{
+    Inode *ino=&inode_table[idx];
+    if(off >= ino->size || n <= 0) return 0;
+    if(n > ino->size-off) n = ino->size-off;
+    if(!data_blocks) bc_sequential(idx, ino->blocks, FILE_BLOCKS(ino->size), off/BLOCK_SIZE, (off+n-1)/BLOCK_SIZE);
+    uint64_t t0 = stats_begin_sampled();
+
+    // 只落在一個 Block 內 (最常見的小讀取): 一次 memcpy 就好
+    // (寫成比較 Block 編號,GCC 不會把 memcpy 展開成啟動很慢的 rep movs)
+    if(off/BLOCK_SIZE == (off+n-1)/BLOCK_SIZE)
+    {
+        int bid=ino->blocks[off/BLOCK_SIZE];
+        memcpy(buf, blk_get(bid, BLK_READ)+off%BLOCK_SIZE, n);
+        blk_put(bid, BLK_READ);
+        heat_read(bid);
+        stats_end(ST_BLOCK_READ, t0, n);
+        return n;
+    }
+
+    int done=0;
+    while(done < n) 
+    {
+        int pos=off+done;
+        int b_off=pos%BLOCK_SIZE;
+        int cp=BLOCK_SIZE-b_off; if(cp > n-done) cp=n-done;
+        int bid=ino->blocks[pos/BLOCK_SIZE];
+        memcpy((char*)buf+done, blk_get(bid, BLK_READ)+b_off, cp);
+        blk_put(bid, BLK_READ);
+        heat_read(bid);
+        done+=cp;
+    }
+    stats_end(ST_BLOCK_READ, t0, done);
+    return done;
+}
+
+// 新 Block 的位置: 接在檔案前一個 Block 後面,空檔案則放在所在目錄的 home group
+static int block_goal(Inode *ino, int b) 
+{
+    return b > 0 ? ino->blocks[b-1]+1 : ag_goal(ino->parent_id);
+}
+
+// 確保檔案擁有前 want 個 Blocks,新配的 Block 先清成 0
+static int grow_blocks(Inode *ino, int want) 
+{
+    for(int b=FILE_BLOCKS(ino->size); b<want; b++) 
+    {
+        int bid=alloc_block(block_goal(ino, b));
+        if(bid==-1) return b; // 只配到 b 個
+        wb_cow(bid); // 剛釋放的 Block 可能還在等 checkpoint 寫出
+        memset(blk_get(bid, BLK_NEW), 0, BLOCK_SIZE);
+        blk_put(bid, BLK_NEW);
+        gen_block(bid);
+        ino->blocks[b]=bid;
+    }
+    return want;
+}
+
+int inode_write(int idx, const void *buf, int n, int off) 
+{
+    Inode *ino=&inode_table[idx];
+    if(n <= 0) return 0;
+    if(off > MAX_FILE_SIZE) return 0;
+    if(n > MAX_FILE_SIZE-off) n = MAX_FILE_SIZE-off;
+
+    // 若寫入位置超過檔尾,先把最後一個 Block 裡舊 size 之後的殘留資料清掉
+    if(off > ino->size && ino->size%BLOCK_SIZE) 
+    {
+        int last=ino->blocks[ino->size/BLOCK_SIZE];
+        wb_cow(last);
+        memset(blk_get(last, BLK_WRITE)+ino->size%BLOCK_SIZE, 0, BLOCK_SIZE-ino->size%BLOCK_SIZE);
+        blk_put(last, BLK_WRITE);
+        gen_block(last);
+    }
+
+    int held=FILE_BLOCKS(ino->size);
+    int old_size=ino->size;
+    int got=grow_blocks(ino, FILE_BLOCKS(off+n));
+    if(got < FILE_BLOCKS(off+n)) 
+    {
+        // 空間不足: 只寫到配得到的地方
+        int cap=got*BLOCK_SIZE;
+        if(cap <= off) 
+        { 
+            for(int b=held; b<got; b++) free_block(ino->blocks[b]);
+            return -1; 
+        }
+        n=cap-off;
+    }
+
+    uint64_t t0 = stats_begin_sampled();
+    int done=0;
+    while(done < n) 
+    {
+        int pos=off+done;
+        int b_off=pos%BLOCK_SIZE;
+        int cp=BLOCK_SIZE-b_off; if(cp > n-done) cp=n-done;
+        int bid=ino->blocks[pos/BLOCK_SIZE];
+        int mode=(b_off==0 && cp==BLOCK_SIZE) ? BLK_NEW : BLK_WRITE; // 整個 Block 覆寫就不用先讀
+        wb_cow(bid);
+        memcpy(blk_get(bid, mode)+b_off, (const char*)buf+done, cp);
+        blk_put(bid, mode);
+        gen_block(bid);
+        heat_write(bid);
+        done+=cp;
+    }
+    stats_end(ST_BLOCK_WRITE, t0, done);
+    if(off+done > ino->size) ino->size=off+done;
+    inode_modified(idx);
+    // Trigram 索引: 新內容 (含補的 0) 加上前面 2 bytes,跨越接縫的 trigram 才不會漏掉
+    tri_add(idx, (off < old_size ? off : old_size)-2, off+done);
+    return done;
+}
+
+int inode_truncate(int idx, int size) 
+{
+    Inode *ino=&inode_table[idx];
+    if(size < 0 || size > MAX_FILE_SIZE) return -1;
+    if(size > ino->size) 
+    {
+        // 變大: 用 0 補滿
+        static const char zeros[BLOCK_SIZE];
+        while(ino->size < size) 
+        {
+            int cp=size-ino->size; if(cp > BLOCK_SIZE) cp=BLOCK_SIZE;
+            if(inode_write(idx, zeros, cp, ino->size) <= 0) return -1;
+        }
+        return 0;
+    }
+    // 變小: 釋放多出來的 Blocks
+    for(int b=FILE_BLOCKS(size); b<FILE_BLOCKS(ino->size); b++) free_block(ino->blocks[b]);
+    ino->size=size;
+    inode_modified(idx);
+    if(size==0) tri_clear(idx); // 清空時順便把舊的 bit 清掉 (> 或 nano 存檔都會先清空)
+    return 0;
+}
+
+
+void inode_modified(int idx) 
+{
+    Inode *ino=&inode_table[idx];
+    ino->mtime=ino->ctime=(uint32_t)time(NULL);
+    sync_forget(idx);
+    gen_inode(idx);
+    dir_data_changed(ino->parent_id); // ls -S / -t 的排序要重做
+}
+
+void inode_changed(int idx) 
+{
+    inode_table[idx].ctime=(uint32_t)time(NULL);
+    gen_inode(idx);
+}
+
+void inode_accessed(int idx) 
+{
+    Inode *ino=&inode_table[idx];
+    uint32_t now=(uint32_t)time(NULL);
+    // 讀取只拿 read lock,多個 thread 可能同時更新 atime (寫的值都差不多,用 atomic 避免 data race)
+    uint32_t at=__atomic_load_n(&ino->atime, __ATOMIC_RELAXED);
+    if(at <= ino->mtime || at <= ino->ctime || now - at >= 24*60*60) 
+    {
+        __atomic_store_n(&ino->atime, now, __ATOMIC_RELAXED);
+        gen_inode(idx);
+    }
+}
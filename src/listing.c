@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "listing.h"
+#include "fs.h"
+#include "path.h"
+
+#define LS_CACHE 8 // 最多快取幾個排序結果 (LRU)
+
+typedef struct
+{
+    int dir, sort; // sort 不含 LS_REVERSE (反向就是倒著讀)
+    unsigned gen, data_gen;
+    int *ids;
+    int n;
+    unsigned long long used; // LRU
+} ListView;
+
+static ListView views[LS_CACHE];
+static unsigned long long ls_clock; // 換了映像檔後目錄版本號都是新的,舊的結果自然不會再被用到
+static pthread_mutex_t ls_lock = PTHREAD_MUTEX_INITIALIZER; // 多個 thread 同時 listdir
+
+static int cmp_name(const void *a, const void *b)
+{
+    return strcmp(inode_table[*(const int*)a].name, inode_table[*(const int*)b].name);
+}
+
+static int cmp_size(const void *a, const void *b)
+{
+    const Inode *x = &inode_table[*(const int*)a], *y = &inode_table[*(const int*)b];
+    if(x->size != y->size) return x->size > y->size ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+static int cmp_time(const void *a, const void *b)
+{
+    const Inode *x = &inode_table[*(const int*)a], *y = &inode_table[*(const int*)b];
+    if(x->mtime != y->mtime) return x->mtime > y->mtime ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+// 名稱排序只跟目錄內容有關,大小/時間排序還要看子檔案的資料版本
+static int view_valid(const ListView *v, int dir, int sort)
+{
+    if(!v->ids || v->dir != dir || v->sort != sort || v->gen != dir_gen(dir)) return 0;
+    return sort == LS_BY_NAME || v->data_gen == dir_data_gen(dir);
+}
+
+static ListView *get_view(int dir, int sort)
+{
+    ListView *v = &views[0];
+    for(int i = 0; i < LS_CACHE; i++)
+    {
+        if(view_valid(&views[i], dir, sort)) { views[i].used = ++ls_clock; return &views[i]; }
+        if(views[i].used < v->used) v = &views[i];
+    }
+
+    // 沒有可用的: 換掉最久沒用的那個,掃一次 Inode Table 重新排序
+    int n = 0, cap = 64;
+    int *ids = malloc(sizeof(int) * cap);
+    for(int i = 0; i < sb->total_inodes; i++)
+    {
+        if(!inode_table[i].is_used || inode_table[i].parent_id != dir || i == 0) continue;
+        if(n == cap) { cap *= 2; ids = realloc(ids, sizeof(int) * cap); }
+        ids[n++] = i;
+    }
+    qsort(ids, n, sizeof(int), sort == LS_BY_SIZE ? cmp_size : sort == LS_BY_TIME ? cmp_time : cmp_name);
+
+    free(v->ids);
+    v->dir = dir; v->sort = sort;
+    v->gen = dir_gen(dir); v->data_gen = dir_data_gen(dir);
+    v->ids = ids; v->n = n;
+    v->used = ++ls_clock;
+    return v;
+}
+
+int dir_list(int dir, int sort, int offset, int limit, int *out, int *total)
+{
+    pthread_mutex_lock(&ls_lock);
+    ListView *v = get_view(dir, sort & ~LS_REVERSE);
+    *total = v->n;
+    if(offset < 0) offset = 0;
+    int cnt = (!out || offset >= v->n) ? 0 : v->n - offset;
+    if(limit >= 0 && cnt > limit) cnt = limit;
+    if(sort & LS_REVERSE) for(int k = 0; k < cnt; k++) out[k] = v->ids[v->n - 1 - offset - k];
+    else if(cnt) memcpy(out, v->ids + offset, sizeof(int) * cnt);
+    pthread_mutex_unlock(&ls_lock);
+    return cnt;
+}
@@ -0,0 +1,48 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "lock.h"
+#include "fs.h"
+
+static pthread_mutex_t shell_cmd_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t ns_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_rwlock_t *inode_locks;
+static int nlocks;
+
+void locks_reset()
+{
+    locks_free();
+    nlocks = sb->total_inodes;
+    inode_locks = malloc(sizeof(pthread_rwlock_t) * nlocks);
+    for(int i = 0; i < nlocks; i++) pthread_rwlock_init(&inode_locks[i], NULL);
+}
+
+void locks_free()
+{
+    for(int i = 0; i < nlocks; i++) pthread_rwlock_destroy(&inode_locks[i]);
+    free(inode_locks);
+    inode_locks = NULL; nlocks = 0;
+}
+
+void cmd_lock() { pthread_mutex_lock(&shell_cmd_lock); }
+void cmd_unlock() { pthread_mutex_unlock(&shell_cmd_lock); }
+int cmd_trylock() { return pthread_mutex_trylock(&shell_cmd_lock) == 0; }
+
+void ns_rdlock() { pthread_rwlock_rdlock(&ns_lock); }
+void ns_wrlock() { pthread_rwlock_wrlock(&ns_lock); }
+void ns_unlock() { pthread_rwlock_unlock(&ns_lock); }
+
+void inode_rdlock(int idx) { pthread_rwlock_rdlock(&inode_locks[idx]); }
+void inode_wrlock(int idx) { pthread_rwlock_wrlock(&inode_locks[idx]); }
+void inode_unlock(int idx) { pthread_rwlock_unlock(&inode_locks[idx]); }
+
+void locks_all()
+{
+    ns_wrlock();
+    for(int i = 0; i < nlocks; i++) pthread_rwlock_wrlock(&inode_locks[i]);
+}
+
+void unlock_all()
+{
+    for(int i = 0; i < nlocks; i++) pthread_rwlock_unlock(&inode_locks[i]);
+    ns_unlock();
+}
@@ -2,23 +2,31 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include "fs.h"
 #include "commands.h"
 #include "editor.h"
 #include "utils.h"
+#include "stream.h"
+#include "security.h"
+#include "dispatch.h"
+#include "myfs.h"
+#include "server.h"
+#include "lock.h"
+#include "workload.h"
+#include <signal.h>
 
 // 平台相容性設定
 #ifdef _WIN32
     #include <conio.h>    // _getch()
     #include <windows.h>  // Console API
-    #include <io.h>       // _dup, _fileno
-    #define STDOUT_FILENO 1
 
     #ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
     #define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
     #endif
 #else
-    #include <unistd.h>   // read, write, dup2
+    #include <unistd.h>
     #include <termios.h>  // 終端機設定
 #endif
 
@@ -28,6 +36,7 @@
 char history[HIST_MAX][CMD_LEN]; 
 int h_cnt = 0;           // 目前History的數量
 
+
 // 取代 scanf/fgets,實作一個支援「方向鍵」與「歷史紀錄」的 Line Editor
 int get_input(char *buf) 
 {
@@ -164,9 +173,372 @@ int get_input(char *buf)
     return len;
 }
 
-int main() 
+// 執行一行: cmd1 | cmd2 | ... [> file | >> file]
+// 指令之間用記憶體中的 Stream 傳遞,不經過 Host 的暫存檔
+// 找不在 "..." 裡面的字元 (ex: grep -E "a|b" 的 '|' 不是 Pipe)
+static char *find_unquoted(char *s, char c) 
+{
+    int quoted = 0;
+    for(; *s; s++) 
+    {
+        if(*s == '"') quoted = !quoted;
+        else if(*s == c && !quoted) return s;
+    }
+    return NULL;
+}
+
+static int run_pipeline(char *input) 
+{
+    // 重導向處理
+    char *rfile = NULL; 
+    int append = 0;
+    char *redir = find_unquoted(input, '>'); 
+    if(redir) 
+    {
+        // 解析目標檔名
+        if(redir[1] == '>') { append = 1; rfile = redir + 2; }
+        else rfile = redir + 1;
+        *redir = 0; // 將 '>' 替換為字串結束符,切斷指令
+        while(*rfile == ' ') rfile++; // 跳過空白
+        rfile[strcspn(rfile, " \n")] = 0; // 去除換行
+        if(*rfile == 0) 
+        { 
+            printf(C_ERR "Error: Missing redirect target.\n" C_RESET); return 0; 
+        }
+    }
+
+    Stream prev, cur;
+    stream_init(&prev); stream_init(&cur);
+    int quit = 0;
+    char *seg = input;
+
+    while(seg) 
+    {
+        char *bar = find_unquoted(seg, '|');
+        if(bar) *bar = 0;
+
+        // 最後一段且沒有重導向才直接印到畫面,其餘都存進 Stream
+        int capture = (bar != NULL) || (rfile != NULL);
+        if(capture) out_capture(&cur);
+        if(seg != input) { pipe_in = prev.data ? prev.data : ""; pipe_in_len = prev.len; }
+
+        quit = dispatch_line(seg);
+
+        out_capture(NULL);
+        pipe_in = NULL; pipe_in_len = 0;
+        stream_free(&prev);
+        prev = cur; stream_init(&cur);
+
+        if(quit) break;
+        seg = bar ? bar + 1 : NULL;
+    }
+
+    // 將輸出直接寫進 VFS Blocks
+    if(rfile && !quit) 
+    {
+        if(write_file_data(rfile, prev.data, prev.len, append) >= 0)
+        {
+            out_printf("Redirected to '%s'\n", rfile);
+            record_write(rfile, prev.len, append);
+        }
+    }
+    stream_free(&prev);
+    return quit;
+}
+
+// 一整行 (包含 pipe 和重導向) 執行時,背景 writeback 不會凍結到一半
+int run_line(char *input) 
+{
+    cmd_lock();
+    int quit = run_pipeline(input);
+    cmd_unlock();
+    return quit;
+}
+
+// 一次讀入整個 script (或 stdin) 到記憶體
+static char *read_all(FILE *fp, int *out_len) 
+{
+    Stream st; stream_init(&st);
+    char chunk[65536];
+    size_t n;
+    while((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) stream_write(&st, chunk, (int)n);
+    *out_len = st.len;
+    return st.data;
+}
+
+// 非互動模式: 不經過 Line Editor,整批解析指令,最後 (或每 N 個指令) 才存檔
+int run_batch(const char *script, int checkpoint, int timing) 
+{
+    FILE *fp = script ? fopen(script, "rb") : stdin;
+    if(!fp) 
+    { 
+        fprintf(stderr, C_ERR "Error: Cannot open script '%s'.\n" C_RESET, script); return 1; 
+    }
+    int len = 0;
+    char *buf = read_all(fp, &len);
+    if(script) fclose(fp);
+    if(!buf) { save_fs(image_path); return 0; }
+
+    long ops = 0; int quit = 0;
+    char echo[CMD_LEN];
+    uint64_t t_start = now_ns();
+    char *line = buf, *end = buf + len;
+
+    while(line < end && !quit) 
+    {
+        char *nl = memchr(line, '\n', end - line);
+        if(nl) *nl = 0;
+        char *next = nl ? nl + 1 : end;
+        line[strcspn(line, "\r")] = 0;
+
+        while(*line == ' ' || *line == '\t') line++;
+        if(*line && *line != '#') // 空行和註解略過
+        {
+            if(timing) { strncpy(echo, line, CMD_LEN-1); echo[CMD_LEN-1] = 0; }
+            uint64_t t0 = now_ns();
+            quit = run_line(line);
+            ops++;
+            if(timing) fprintf(stderr, "[%10.1f us] %s\n", (now_ns() - t0) / 1000.0, echo);
+            if(checkpoint > 0 && ops % checkpoint == 0) save_fs(image_path);
+        }
+        line = next;
+    }
+    free(buf);
+    if(!quit) save_fs(image_path); // exit 已經存過了
+
+    double sec = (now_ns() - t_start) / 1e9;
+    fprintf(stderr, "%ld commands in %.3f s (%.0f ops/sec)\n", ops, sec, sec > 0 ? ops / sec : 0.0);
+    return 0;
+}
+
+static void usage(const char *prog) 
 {
-    int ch, sz; char input[CMD_LEN]; char *cmd, *a1, *a2; char tmp_buf[32];
+    printf("Usage: %s [--image <file>] [--new <size> [--inodes <N>]] [--password <pwd>]\n"
+           "          [--script <file> | --batch] [--checkpoint <N>] [--timing] [--quiet] [--writeback <ms>] [--cache <size>]\n"
+           "          [--io <backend>] [--io-depth <N>] [--record <file>]\n"
+           "       %s serve --image <file> --socket <path> [--password <pwd>] [--workers <N>] [--writeback <ms>] [--cache <size>]\n"
+           "          [--io <backend>] [--io-depth <N>]\n"
+           "       %s gen [--ops <N>] [--files <N>] [--fanout <N>] [--depth <N>] [--sessions <N>] [--sizes <dist>]\n"
+           "          [--mix <op=weight,...>] [--zipf <s>] [--seed <N>] [--out <file>]\n"
+           "       %s replay --image <file> [--new <size> [--inodes <N>]] [--password <pwd>] [--sessions <N>] [--save] [--json]\n"
+           "          [--cache <size>] [--io <backend>] [--io-depth <N>] <trace>\n"
+           "  --image      Disk image to load or create (default: my_fs.dump)\n"
+           "  --new        Create a fresh partition of <size> bytes (K/M/G suffixes, at most 1 TiB of data) instead of loading\n"
+           "  --inodes     Number of inodes for --new (default: one per 4 blocks, at least 100)\n"
+           "  --password   Password for the image (no prompt)\n"
+           "  --script     Run commands from <file> without the interactive shell\n"
+           "  --batch      Run commands from stdin without the interactive shell\n"
+           "  --checkpoint Save the image every <N> commands (default: only at the end)\n"
+           "  --timing     Print per-command latency to stderr\n"
+           "  --quiet      Discard command output\n"
+           "  --writeback  Write changed blocks back to the image in the background every <ms>\n"
+           "  --cache      Keep only metadata in memory and cache at most <size> (e.g. 64M) of data blocks\n"
+           "  --io         Batched block I/O backend: uring, threads, sync or auto (default)\n"
+           "  --io-depth   Number of block reads/writes in flight at once (default: 32)\n"
+           "  --record     Append the commands that were run to <file> as a replayable trace\n"
+           "  serve        Keep the image in memory and serve clients (myfsc) on a Unix socket;\n"
+           "               the image is saved when the server stops (Ctrl+C / SIGTERM)\n"
+           "  gen          Write a synthetic workload trace (default 100000 ops on 1000 files, 10 directories,\n"
+           "               sizes lognormal:4K,1, zipf 0.99, mix read=60,write=10,append=5,create=5,rm=5,stat=10,ls=5)\n"
+           "               --sizes is fixed:<n>, uniform:<min>-<max> or lognormal:<median>,<sigma> (K/M suffixes)\n"
+           "  replay       Run a trace through libmyfs at full speed and report throughput and latency percentiles;\n"
+           "               the image is only saved with --save\n", prog, prog, prog, prog);
+}
+
+// --cache 的大小 (bytes,可以加 K/M/G) 換成 Block 數
+static int cache_blocks(const char *s)
+{
+    char *end;
+    double v = strtod(s, &end);
+    if(*end == 'K' || *end == 'k') v *= 1024;
+    else if(*end == 'M' || *end == 'm') v *= 1024 * 1024;
+    else if(*end == 'G' || *end == 'g') v *= 1024.0 * 1024 * 1024;
+    return v > 0 ? (int)(v / BLOCK_SIZE) : 0;
+}
+
+// --new 的大小 (bytes,可以加 K/M/G),用 64-bit 算; 不是正數、後面有別的字或溢位就回傳 -1 (不要繞成負數)
+static long long image_size(const char *s)
+{
+    char *end;
+    errno = 0;
+    long long v = strtoll(s, &end, 10), mul = 1;
+    if(*end == 'K' || *end == 'k') { mul = 1024; end++; }
+    else if(*end == 'M' || *end == 'm') { mul = 1024 * 1024; end++; }
+    else if(*end == 'G' || *end == 'g') { mul = 1024LL * 1024 * 1024; end++; }
+    while(isspace((unsigned char)*end)) end++;
+    if(errno || end == s || *end || v <= 0 || v > LLONG_MAX / mul) return -1;
+    return v * mul;
+}
+
+static void on_stop(int sig) 
+{
+    (void)sig;
+    myfs_serve_stop();
+}
+
+// serve 模式: 映像檔常駐在記憶體,多個 client 同時透過 socket 存取
+static int run_serve(int argc, char **argv) 
+{
+    const char *image = NULL, *sock = NULL, *pwd = "";
+    int workers = cpu_count() > 4 ? cpu_count() : 4, wb_ms = 0;
+    for(int i = 2; i < argc; i++) 
+    {
+        if(strcmp(argv[i], "--image") == 0 && i+1 < argc)         image = argv[++i];
+        else if(strcmp(argv[i], "--socket") == 0 && i+1 < argc)   sock = argv[++i];
+        else if(strcmp(argv[i], "--password") == 0 && i+1 < argc) pwd = argv[++i];
+        else if(strcmp(argv[i], "--workers") == 0 && i+1 < argc)  workers = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--writeback") == 0 && i+1 < argc) wb_ms = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--cache") == 0 && i+1 < argc)    myfs_set_cache(cache_blocks(argv[++i]));
+        else if(strcmp(argv[i], "--io") == 0 && i+1 < argc)       { if(myfs_set_io(argv[++i], 0) != MYFS_OK) { usage(argv[0]); return 1; } }
+        else if(strcmp(argv[i], "--io-depth") == 0 && i+1 < argc) myfs_set_io(NULL, atoi(argv[++i]));
+        else { usage(argv[0]); return 1; }
+    }
+    if(!image || !sock) { usage(argv[0]); return 1; }
+
+    int r = myfs_mount(image, pwd);
+    if(r != MYFS_OK) 
+    { 
+        fprintf(stderr, C_ERR "Error: Cannot mount '%s': %s\n" C_RESET, image, myfs_strerror(r)); return 1; 
+    }
+    if(wb_ms > 0) myfs_writeback(wb_ms, 0);
+    signal(SIGINT, on_stop);
+    signal(SIGTERM, on_stop);
+    printf("Serving '%s' on %s (%d workers)\n", image, sock, workers);
+    r = myfs_serve(sock, workers);
+    if(r != MYFS_OK) 
+    { 
+        fprintf(stderr, C_ERR "Error: Cannot serve on '%s': %s\n" C_RESET, sock, myfs_strerror(r)); return 1; 
+    }
+    r = myfs_sync();
+    printf("Stopped, image %s.\n", r == MYFS_OK ? "saved" : "NOT saved");
+    cmd_stats(0, 0, -1); // 每種請求的延遲
+    return r != MYFS_OK;
+}
+
+// gen: 合成的 trace 寫到 stdout (或 --out)
+static int run_gen(int argc, char **argv)
+{
+    WlGenOpts o;
+    wl_gen_defaults(&o);
+    const char *out = NULL;
+    int ok = 1;
+    for(int i = 2; i < argc && ok; i++)
+    {
+        if(strcmp(argv[i], "--ops") == 0 && i+1 < argc)           o.ops = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--files") == 0 && i+1 < argc)    o.files = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--fanout") == 0 && i+1 < argc)   o.fanout = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--depth") == 0 && i+1 < argc)    o.depth = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--sessions") == 0 && i+1 < argc) o.sessions = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--sizes") == 0 && i+1 < argc)    ok = wl_parse_sizes(argv[++i], &o) == MYFS_OK;
+        else if(strcmp(argv[i], "--mix") == 0 && i+1 < argc)      ok = wl_parse_mix(argv[++i], &o) == MYFS_OK;
+        else if(strcmp(argv[i], "--zipf") == 0 && i+1 < argc)     o.zipf = atof(argv[++i]);
+        else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc)     o.seed = (unsigned)strtoul(argv[++i], NULL, 10);
+        else if(strcmp(argv[i], "--out") == 0 && i+1 < argc)      out = argv[++i];
+        else ok = 0;
+    }
+    if(!ok) { usage(argv[0]); return 1; }
+    FILE *fp = out ? fopen(out, "w") : stdout;
+    if(!fp) { fprintf(stderr, C_ERR "Error: Cannot open '%s'.\n" C_RESET, out); return 1; }
+    int r = wl_generate(&o, fp);
+    if(out) fclose(fp);
+    if(r != MYFS_OK) { fprintf(stderr, C_ERR "Error: %s\n" C_RESET, myfs_strerror(r)); return 1; }
+    return 0;
+}
+
+// replay: 掛載 (或建立) 映像檔,trace 用 N 個 session 全速重播
+static int run_replay(int argc, char **argv)
+{
+    const char *image = NULL, *pwd = "", *trace = NULL;
+    long long new_size = 0;
+    int sessions = 1, save = 0, json = 0;
+    for(int i = 2; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--image") == 0 && i+1 < argc)         image = argv[++i];
+        else if(strcmp(argv[i], "--new") == 0 && i+1 < argc)
+        {
+            if((new_size = image_size(argv[++i])) < 0) { fprintf(stderr, C_ERR "Error: Invalid size '%s'.\n" C_RESET, argv[i]); return 1; }
+        }
+        else if(strcmp(argv[i], "--inodes") == 0 && i+1 < argc)   myfs_set_inodes(atoi(argv[++i]));
+        else if(strcmp(argv[i], "--password") == 0 && i+1 < argc) pwd = argv[++i];
+        else if(strcmp(argv[i], "--sessions") == 0 && i+1 < argc) sessions = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--save") == 0)                   save = 1;
+        else if(strcmp(argv[i], "--json") == 0)                   json = 1;
+        else if(strcmp(argv[i], "--cache") == 0 && i+1 < argc)    myfs_set_cache(cache_blocks(argv[++i]));
+        else if(strcmp(argv[i], "--io") == 0 && i+1 < argc)       { if(myfs_set_io(argv[++i], 0) != MYFS_OK) { usage(argv[0]); return 1; } }
+        else if(strcmp(argv[i], "--io-depth") == 0 && i+1 < argc) myfs_set_io(NULL, atoi(argv[++i]));
+        else if(argv[i][0] != '-' && !trace)                      trace = argv[i];
+        else { usage(argv[0]); return 1; }
+    }
+    if(!image || !trace) { usage(argv[0]); return 1; }
+
+    int r = new_size > 0 ? myfs_format(image, new_size, pwd) : myfs_mount(image, pwd);
+    if(r != MYFS_OK)
+    {
+        fprintf(stderr, C_ERR "Error: Cannot %s '%s': %s\n" C_RESET, new_size > 0 ? "create" : "mount", image, myfs_strerror(r)); return 1;
+    }
+    WlReport rep;
+    r = wl_replay(trace, sessions, &rep);
+    if(r != MYFS_OK)
+    {
+        if(rep.first_error_line) fprintf(stderr, C_ERR "Error: %s:%d: not a valid trace line\n" C_RESET, trace, rep.first_error_line);
+        else fprintf(stderr, C_ERR "Error: Cannot replay '%s': %s\n" C_RESET, trace, myfs_strerror(r));
+        return 1;
+    }
+    cmd_replay_report(trace, &rep, json);
+    if(save && (r = myfs_sync()) != MYFS_OK) { fprintf(stderr, C_ERR "Error: Cannot save '%s': %s\n" C_RESET, image, myfs_strerror(r)); return 1; }
+    myfs_unmount();
+    return rep.errors != 0;
+}
+
+int main(int argc, char **argv) 
+{
+    int ch; long long sz, new_size = 0; char input[CMD_LEN]; char tmp_buf[32];
+    int have_image = 0, checkpoint = 0, timing = 0, quiet = 0, wb_ms = 0;
+    const char *script = NULL;
+
+    myfs_set_stats(1); // stats 指令: shell 和 serve 預設記錄延遲
+    if(argc > 1 && strcmp(argv[1], "serve") == 0) return run_serve(argc, argv);
+    if(argc > 1 && strcmp(argv[1], "gen") == 0) return run_gen(argc, argv);
+    if(argc > 1 && strcmp(argv[1], "replay") == 0) return run_replay(argc, argv);
+
+    // 命令列參數
+    for(int i = 1; i < argc; i++) 
+    {
+        if(strcmp(argv[i], "--image") == 0 && i+1 < argc) 
+        { 
+            strncpy(image_path, argv[++i], sizeof(image_path)-1); have_image = 1; 
+        }
+        else if(strcmp(argv[i], "--new") == 0 && i+1 < argc)
+        {
+            if((new_size = image_size(argv[++i])) < 0) { fprintf(stderr, C_ERR "Error: Invalid size '%s'.\n" C_RESET, argv[i]); return 1; }
+        }
+        else if(strcmp(argv[i], "--inodes") == 0 && i+1 < argc)     myfs_set_inodes(atoi(argv[++i]));
+        else if(strcmp(argv[i], "--password") == 0 && i+1 < argc)   preset_password = argv[++i];
+        else if(strcmp(argv[i], "--script") == 0 && i+1 < argc)     { script = argv[++i]; batch_mode = 1; }
+        else if(strcmp(argv[i], "--batch") == 0)                    batch_mode = 1;
+        else if(strcmp(argv[i], "--checkpoint") == 0 && i+1 < argc) checkpoint = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--timing") == 0)                   timing = 1;
+        else if(strcmp(argv[i], "--quiet") == 0)                    quiet = 1;
+        else if(strcmp(argv[i], "--writeback") == 0 && i+1 < argc)  wb_ms = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--cache") == 0 && i+1 < argc)      myfs_set_cache(cache_blocks(argv[++i]));
+        else if(strcmp(argv[i], "--io") == 0 && i+1 < argc)         { if(myfs_set_io(argv[++i], 0) != MYFS_OK) { usage(argv[0]); return 1; } }
+        else if(strcmp(argv[i], "--io-depth") == 0 && i+1 < argc)   myfs_set_io(NULL, atoi(argv[++i]));
+        else if(strcmp(argv[i], "--record") == 0 && i+1 < argc)
+        {
+            if(record_open(argv[++i]) != 0) { fprintf(stderr, C_ERR "Error: Cannot open '%s'.\n" C_RESET, argv[i]); return 1; }
+        }
+        else { usage(argv[0]); return 1; }
+    }
+
+    if(batch_mode) 
+    {
+        // 沒指定密碼就當作沒有密碼,不要卡在 prompt
+        if(!preset_password) preset_password = "";
+        if(new_size > 0) init_fs(new_size, 0); else init_fs(0, 1);
+        if(wb_ms > 0) myfs_writeback(wb_ms, 0);
+        out_discard(quiet);
+        return run_batch(script, checkpoint, timing);
+    }
     
     setvbuf(stdout, NULL, _IONBF, 0); 
 
@@ -179,133 +551,29 @@ int main()
     SetConsoleMode(hOut, dwMode);
     #endif
 
-    printf("1. Load\n2. New Partition\nOption: "); 
-    fgets(tmp_buf, sizeof(tmp_buf), stdin); ch = atoi(tmp_buf);
-    if(ch == 1) init_fs(0, 1); 
+    if(new_size > 0) init_fs(new_size, 0);
+    else if(have_image) init_fs(0, 1);
     else 
-    { 
-        printf("Size (e.g., 2048000): "); fgets(tmp_buf, sizeof(tmp_buf), stdin); sz = atoi(tmp_buf);
-        init_fs(sz, 0); 
+    {
+        printf("1. Load\n2. New Partition\nOption: "); 
+        fgets(tmp_buf, sizeof(tmp_buf), stdin); ch = atoi(tmp_buf);
+        if(ch == 1) init_fs(0, 1); 
+        else 
+        { 
+            printf("Size (e.g., 2048000 or 64M): "); fgets(tmp_buf, sizeof(tmp_buf), stdin); sz = image_size(tmp_buf);
+            init_fs(sz, 0); 
+        }
     }
 
+    if(wb_ms > 0) myfs_writeback(wb_ms, 0);
+
     while(1) 
     {
         // 顯示 Prompt
         printf("%s $ ", current_path);
         
         if(get_input(input) == 0) continue;
-
-        // 重導向處理
-        char *redir = strchr(input, '>'); 
-        char *rfile = NULL; 
-        int is_redirecting = 0;
-        char tmpf[] = "temp_output.dat"; 
-
-        #ifndef _WIN32
-        int sav_out = -1; // Linux 用來儲存原本的 stdout
-        #endif
-
-        if(redir) 
-        {
-            // 解析目標檔名
-            *redir = 0; // 將 '>' 替換為字串結束符,切斷指令
-            rfile = redir + 1; while(*rfile == ' ') rfile++; // 跳過空白
-            rfile[strcspn(rfile, "\n")] = 0; // 去除換行
-            
-            fflush(stdout); 
-            
-            // 將 stdout 重導向到暫存檔 "temp_output.dat"
-            // 這樣所有 cmd_xxx 的 printf 都會寫到這個檔案裡
-            #ifdef _WIN32
-                if (freopen(tmpf, "w", stdout) != NULL) 
-                {
-                    is_redirecting = 1;
-                }
-            #else
-                // [Linux 解法] 使用 dup2
-                sav_out = dup(STDOUT_FILENO);
-                FILE *f = fopen(tmpf, "w");
-                if(f) 
-                { 
-                    dup2(fileno(f), STDOUT_FILENO); fclose(f); is_redirecting = 1; 
-                }
-            #endif
-        }
-
-        // 切割字串 (Command, Arg1, Arg2)
-        cmd = strtok(input, " "); a1 = strtok(NULL, " "); a2 = strtok(NULL, " ");
-        
-        if(!cmd) 
-        { 
-            // 如果有開啟重導向,必須還原 stdout,否則terminal will crash
-            if(is_redirecting) 
-            {
-                #ifdef _WIN32
-                freopen("CON", "w", stdout);
-                #else
-                dup2(sav_out, STDOUT_FILENO); close(sav_out);
-                #endif
-            }
-            continue; 
-        }
-
-        if(strcmp(cmd, "ls") == 0) 
-        {
-            if(a1 && strcmp(a1, "-l") == 0) cmd_ll(); 
-            else cmd_ls();
-        }
-        else if(strcmp(cmd, "ll") == 0)   cmd_ll();
-        else if(strcmp(cmd, "mkdir") == 0 && a1) cmd_mkdir(a1);
-        else if(strcmp(cmd, "cd") == 0 && a1)    cmd_cd(a1);
-        else if(strcmp(cmd, "pwd") == 0)         cmd_pwd();
-        else if(strcmp(cmd, "touch") == 0 && a1) cmd_touch(a1);
-        else if(strcmp(cmd, "rmdir") == 0 && a1) cmd_rmdir(a1);
-        else if(strcmp(cmd, "rm") == 0 && a1)    cmd_rm(a1);
-        else if(strcmp(cmd, "cp") == 0 && a1 && a2) cmd_cp(a1, a2);
-        else if(strcmp(cmd, "mv") == 0 && a1 && a2) cmd_mv(a1, a2);
-        else if(strcmp(cmd, "cat") == 0 && a1)   cmd_cat(a1);
-        else if(strcmp(cmd, "put") == 0 && a1)   cmd_put(a1);
-        else if(strcmp(cmd, "get") == 0 && a1)   cmd_get(a1);
-        else if(strcmp(cmd, "append") == 0 && a1 && a2) cmd_append(a1, a2);
-        else if(strcmp(cmd, "nano") == 0 && a1)  cmd_nano(a1);
-        else if(strcmp(cmd, "grep") == 0 && a1 && a2) cmd_grep(a1, a2);
-        else if(strcmp(cmd, "tree") == 0)        cmd_tree();
-        else if(strcmp(cmd, "stat") == 0 && a1)  cmd_stat(a1);
-        else if(strcmp(cmd, "find") == 0 && a1)  cmd_find(a1);
-        else if(strcmp(cmd, "encrypt") == 0 && a1 && a2) cmd_encrypt(a1, a2);
-        else if(strcmp(cmd, "decrypt") == 0 && a1 && a2) cmd_encrypt(a1, a2); // 解密其實就是再加密一次
-        else if(strcmp(cmd, "chmod") == 0 && a1 && a2) cmd_chmod(a1, a2);
-        else if(strcmp(cmd, "status") == 0)      cmd_status();
-        else if(strcmp(cmd, "diskmap") == 0)     cmd_diskmap();
-        else if(strcmp(cmd, "hexdump") == 0 && a1) cmd_hexdump(a1);
-        else if(strcmp(cmd, "run") == 0 && a1)   cmd_run(a1);
-        else if(strcmp(cmd, "defrag") == 0)      defrag_system();
-        else if(strcmp(cmd, "help") == 0)        cmd_help();
-        else if(strcmp(cmd, "exit") == 0) 
-        { 
-            save_fs("my_fs.dump"); break; 
-        } 
-        else printf("Unknown command: %s\n", cmd);
-
-        if(is_redirecting) 
-        {
-            fflush(stdout); 
-
-            // 1. 還原 stdout 到控制台
-            #ifdef _WIN32
-                freopen("CON", "w", stdout);
-            #else
-                dup2(sav_out, STDOUT_FILENO);
-                close(sav_out);
-            #endif
-            
-            // 2. 將暫存檔內容匯入到 VFS
-            // 先輸出到 Host 實體檔案,再用 put 的邏輯吸進來
-            import_host_file(tmpf, rfile); 
-            
-            remove(tmpf); 
-            printf("Redirected to '%s'\n", rfile);
-        }
+        if(run_line(input)) break;
     }
     return 0;
-}
\ No newline at end of file
+}
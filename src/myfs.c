@@ -0,0 +1,605 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "myfs.h"
+#include "fs.h"
+#include "inode.h"
+#include "security.h"
+#include "path.h"
+#include "listing.h"
+#include "gen.h"
+#include "lock.h"
+#include "writeback.h"
+#include "bcache.h"
+#include "bio.h"
+#include "stats.h"
+
+// 開啟中的檔案
+typedef struct
+{
+    int used;
+    int ino;
+    int offset;
+    int flags;
+    unsigned gen; // 每次關掉加一: 等鎖的時候 fd 被關掉又開在同一個檔案上也認得出來
+} OpenFile;
+
+// fd 表: 每 FD_CHUNK 個一塊,用到才配置,配置後不會搬動 (查 fd 不用拿鎖)
+#define FD_CHUNK 256
+static OpenFile *fd_chunks[MYFS_MAX_OPEN / FD_CHUNK];
+static int fd_hint; // 比它小的 fd 都在用 (找空位從這裡開始)
+static pthread_mutex_t fd_lock = PTHREAD_MUTEX_INITIALIZER; // 配置/釋放 fd
+
+// fd 的位置 (那一塊還沒配置 = NULL)
+static OpenFile *fd_slot(int fd)
+{
+    if(fd < 0 || fd >= MYFS_MAX_OPEN) return NULL;
+    OpenFile *chunk = __atomic_load_n(&fd_chunks[fd / FD_CHUNK], __ATOMIC_ACQUIRE);
+    return chunk ? &chunk[fd % FD_CHUNK] : NULL;
+}
+
+static OpenFile *get_file(int fd)
+{
+    OpenFile *f = fd_slot(fd);
+    return f && f->used ? f : NULL;
+}
+
+// 最小的空 fd,全部用完回傳 MYFS_EMFILE (呼叫者要拿著 fd_lock)
+static int fd_alloc()
+{
+    for(int fd = fd_hint; fd < MYFS_MAX_OPEN; fd++)
+    {
+        OpenFile **chunk = &fd_chunks[fd / FD_CHUNK];
+        if(!*chunk)
+        {
+            OpenFile *c = calloc(FD_CHUNK, sizeof(OpenFile));
+            if(!c) break;
+            __atomic_store_n(chunk, c, __ATOMIC_RELEASE);
+        }
+        if(!(*chunk)[fd % FD_CHUNK].used) { fd_hint = fd + 1; return fd; }
+    }
+    return MYFS_EMFILE;
+}
+
+static void fd_free(OpenFile *f, int fd)
+{
+    f->used = 0;
+    __atomic_store_n(&f->gen, f->gen + 1, __ATOMIC_RELEASE);
+    if(fd < fd_hint) fd_hint = fd;
+}
+
+// mount / format / unmount: 全部關掉 (配置的塊留著,generation 接著加)
+static void fd_reset()
+{
+    pthread_mutex_lock(&fd_lock);
+    for(int c = 0; c < MYFS_MAX_OPEN / FD_CHUNK; c++)
+        for(int k = 0; fd_chunks[c] && k < FD_CHUNK; k++) if(fd_chunks[c][k].used) fd_free(&fd_chunks[c][k], c * FD_CHUNK + k);
+    fd_hint = 0;
+    pthread_mutex_unlock(&fd_lock);
+}
+
+// 拿到 Inode 的鎖之後再確認一次 fd 還是同一次 open (等鎖的時候 fd 可能被關掉,甚至又開在同一個 Inode 上)
+static int lock_file(int fd, int write, OpenFile **out)
+{
+    OpenFile *f = fd_slot(fd);
+    if(!f) return -1;
+    unsigned gen = __atomic_load_n(&f->gen, __ATOMIC_ACQUIRE);
+    if(!f->used) return -1;
+    int ino = f->ino;
+    if(write) inode_wrlock(ino); else inode_rdlock(ino);
+    if(!f->used || __atomic_load_n(&f->gen, __ATOMIC_ACQUIRE) != gen || f->ino != ino) { inode_unlock(ino); return -1; }
+    *out = f;
+    return ino;
+}
+
+int fd_lock_inode(int fd, int write)
+{
+    OpenFile *f;
+    int ino = lock_file(fd, write, &f);
+    return ino < 0 ? MYFS_EBADF : ino;
+}
+
+// 相對路徑從目前目錄開始解析 (呼叫者要拿著 ns_lock)
+static int resolve(const char *path, int *parent, char *leaf)
+{
+    return path_resolve(path, current_dir_id, parent, leaf);
+}
+
+int myfs_mount(const char *image, const char *password)
+{
+    strncpy(image_path, image, sizeof(image_path)-1);
+    const char *saved = preset_password;
+    preset_password = password ? password : "";
+    int r = load_fs(image_path);
+    preset_password = saved;
+    if(r == MYFS_OK) fd_reset();
+    return r;
+}
+
+int myfs_format(const char *image, long long size, const char *password)
+{
+    strncpy(image_path, image, sizeof(image_path)-1);
+    const char *saved = preset_password;
+    preset_password = password ? password : "";
+    int r = format_fs(size);
+    preset_password = saved;
+    if(r == MYFS_OK) fd_reset();
+    return r;
+}
+
+int myfs_sync(void)
+{
+    if(!sb) return MYFS_EINVAL;
+    locks_all(); // save_fs 會暫時把 Inode Table 加密
+    int r = save_fs(image_path);
+    gen_bump(); // 存檔之後的修改屬於新的 generation
+    unlock_all();
+    return r;
+}
+
+int myfs_writeback(int interval_ms, int dirty_blocks)
+{
+    if(interval_ms <= 0 && dirty_blocks <= 0) { wb_stop(); return MYFS_OK; }
+    return wb_start(interval_ms, dirty_blocks);
+}
+
+void myfs_set_cache(int blocks)
+{
+    bc_configure(blocks);
+}
+
+int myfs_set_io(const char *backend, int depth)
+{
+    int b = backend ? bio_parse(backend) : bio_backend();
+    if(b < 0 || depth < 0) return MYFS_EINVAL;
+    bio_configure(b, depth);
+    return MYFS_OK;
+}
+
+void myfs_set_inodes(int count)
+{
+    format_inodes = count > 0 ? count : 0;
+}
+
+void myfs_set_stats(int on)
+{
+    stats_enable(on);
+}
+
+void myfs_unmount(void)
+{
+    fd_reset();
+    free_fs();
+    bio_shutdown(); // I/O thread 下次用到再開
+}
+
+int myfs_open(const char *path, int flags)
+{
+    int parent; char leaf[MAX_FILENAME];
+    int acc = flags & MYFS_O_ACCMODE;
+    int wr = 0;
+
+    ns_rdlock();
+    int idx = resolve(path, &parent, leaf);
+    if(idx == MYFS_ENOENT && (flags & MYFS_O_CREAT) && parent >= 0)
+    {
+        // 要建立檔案: 換成 write lock 再解析一次 (中間可能已經被別人建立了)
+        ns_unlock(); ns_wrlock(); wr = 1;
+        idx = resolve(path, &parent, leaf);
+    }
+
+    if(idx >= 0)
+    {
+        int err = 0;
+        if((flags & MYFS_O_CREAT) && (flags & MYFS_O_EXCL)) err = MYFS_EEXIST;
+        else if(inode_table[idx].is_dir) err = MYFS_EISDIR;
+        // !!權限檢查!! 讀要 R(4),寫要 W(2)
+        else if(acc != MYFS_O_WRONLY && !(inode_table[idx].permission & 4)) err = MYFS_EACCES;
+        else if(acc != MYFS_O_RDONLY && !(inode_table[idx].permission & 2)) err = MYFS_EACCES;
+        if(err) { ns_unlock(); return err; }
+    }
+    else
+    {
+        if(!wr || idx != MYFS_ENOENT || parent < 0) { ns_unlock(); return idx; }
+        idx = inode_create(parent, leaf, 0, 0);
+        if(idx == -1) { ns_unlock(); return MYFS_ENOSPC; }
+    }
+
+    pthread_mutex_lock(&fd_lock);
+    int fd = fd_alloc();
+    if(fd < 0) { pthread_mutex_unlock(&fd_lock); ns_unlock(); return fd; }
+    OpenFile *f = fd_slot(fd);
+    f->ino = idx; f->offset = 0; f->flags = flags;
+    f->used = 1;
+    pthread_mutex_unlock(&fd_lock);
+
+    if((flags & MYFS_O_TRUNC) && acc != MYFS_O_RDONLY)
+    {
+        inode_wrlock(idx);
+        inode_truncate(idx, 0);
+        inode_unlock(idx);
+    }
+    ns_unlock();
+    return fd;
+}
+
+int myfs_close(int fd)
+{
+    pthread_mutex_lock(&fd_lock);
+    OpenFile *f = get_file(fd);
+    if(f) fd_free(f, fd);
+    pthread_mutex_unlock(&fd_lock);
+    return f ? MYFS_OK : MYFS_EBADF;
+}
+
+int myfs_pread(int fd, void *buf, int n, int offset)
+{
+    OpenFile *f;
+    if(n < 0 || offset < 0) return get_file(fd) ? MYFS_EINVAL : MYFS_EBADF;
+    int ino = lock_file(fd, 0, &f);
+    if(ino < 0) return MYFS_EBADF;
+    if((f->flags & MYFS_O_ACCMODE) == MYFS_O_WRONLY) { inode_unlock(ino); return MYFS_EBADF; }
+    inode_accessed(ino);
+    int r = inode_read(ino, buf, n, offset);
+    inode_unlock(ino);
+    return r;
+}
+
+// offset < 0: 接在檔尾 (O_APPEND,要在鎖裡面讀 size)
+static int file_write(int fd, const void *buf, int n, int offset)
+{
+    OpenFile *f;
+    int ino = lock_file(fd, 1, &f);
+    if(ino < 0) return MYFS_EBADF;
+    int r;
+    if((f->flags & MYFS_O_ACCMODE) == MYFS_O_RDONLY) r = MYFS_EBADF;
+    else
+    {
+        if(offset < 0) offset = inode_table[ino].size;
+        if(n == 0) r = 0;
+        else if(offset >= MAX_FILE_SIZE) r = MYFS_EFBIG;
+        else
+        {
+            r = inode_write(ino, buf, n, offset);
+            if(r < 0) r = MYFS_ENOSPC;
+            else if(f->flags & MYFS_O_APPEND) f->offset = offset + r;
+        }
+    }
+    inode_unlock(ino);
+    return r;
+}
+
+int myfs_pwrite(int fd, const void *buf, int n, int offset)
+{
+    if(n < 0 || offset < 0) return get_file(fd) ? MYFS_EINVAL : MYFS_EBADF;
+    return file_write(fd, buf, n, offset);
+}
+
+int myfs_read(int fd, void *buf, int n)
+{
+    OpenFile *f = get_file(fd);
+    if(!f) return MYFS_EBADF;
+    int r = myfs_pread(fd, buf, n, f->offset);
+    if(r > 0) f->offset += r;
+    return r;
+}
+
+int myfs_write(int fd, const void *buf, int n)
+{
+    OpenFile *f = get_file(fd);
+    if(!f) return MYFS_EBADF;
+    if(n < 0) return MYFS_EINVAL;
+    if(f->flags & MYFS_O_APPEND) return file_write(fd, buf, n, -1); // offset 在鎖裡面更新
+    int w = file_write(fd, buf, n, f->offset);
+    if(w > 0) f->offset += w;
+    return w;
+}
+
+int myfs_lseek(int fd, int offset, int whence)
+{
+    OpenFile *f;
+    int ino = lock_file(fd, 0, &f);
+    if(ino < 0) return MYFS_EBADF;
+    int base = -1;
+    switch(whence)
+    {
+        case MYFS_SEEK_SET: base = 0; break;
+        case MYFS_SEEK_CUR: base = f->offset; break;
+        case MYFS_SEEK_END: base = inode_table[ino].size; break;
+    }
+    inode_unlock(ino);
+    if(base < 0 || base + offset < 0) return MYFS_EINVAL;
+    f->offset = base + offset;
+    return f->offset;
+}
+
+int myfs_ftruncate(int fd, int size)
+{
+    if(size < 0) return get_file(fd) ? MYFS_EINVAL : MYFS_EBADF;
+    OpenFile *f;
+    int ino = lock_file(fd, 1, &f);
+    if(ino < 0) return MYFS_EBADF;
+    int r;
+    if((f->flags & MYFS_O_ACCMODE) == MYFS_O_RDONLY) r = MYFS_EBADF;
+    else if(size > MAX_FILE_SIZE) r = MYFS_EFBIG;
+    else r = inode_truncate(ino, size) == 0 ? MYFS_OK : MYFS_ENOSPC;
+    inode_unlock(ino);
+    return r;
+}
+
+int myfs_lookup(const char *path)
+{
+    ns_rdlock();
+    int r = resolve(path, NULL, NULL);
+    ns_unlock();
+    return r;
+}
+
+static void fill_stat(int idx, myfs_stat_t *st)
+{
+    Inode *ino = &inode_table[idx];
+    st->ino = idx; st->is_dir = ino->is_dir; st->size = ino->size;
+    st->blocks = ino->is_dir ? 0 : FILE_BLOCKS(ino->size);
+    st->permission = ino->permission; st->parent = ino->parent_id;
+    st->mtime = ino->mtime; st->ctime = ino->ctime; st->crtime = ino->crtime;
+    st->atime = __atomic_load_n(&ino->atime, __ATOMIC_RELAXED); // 其他 reader 可能正在更新 (inode_accessed)
+}
+
+int myfs_stat(const char *path, myfs_stat_t *st)
+{
+    ns_rdlock();
+    int idx = resolve(path, NULL, NULL);
+    if(idx >= 0)
+    {
+        inode_rdlock(idx);
+        fill_stat(idx, st);
+        inode_unlock(idx);
+    }
+    ns_unlock();
+    return idx < 0 ? idx : MYFS_OK;
+}
+
+int myfs_fstat(int fd, myfs_stat_t *st)
+{
+    OpenFile *f;
+    int ino = lock_file(fd, 0, &f);
+    if(ino < 0) return MYFS_EBADF;
+    fill_stat(ino, st);
+    inode_unlock(ino);
+    return MYFS_OK;
+}
+
+int myfs_readdir(const char *path, int *cookie, myfs_dirent_t *ent)
+{
+    ns_rdlock();
+    int dir = resolve(path, NULL, NULL);
+    if(dir < 0 || !inode_table[dir].is_dir) { ns_unlock(); return dir < 0 ? dir : MYFS_ENOTDIR; }
+
+    // cookie = 下一個要檢查的 Inode 編號
+    int r = 0;
+    int i;
+    for(i = *cookie; i < sb->total_inodes; i++)
+    {
+        if(!inode_table[i].is_used || inode_table[i].parent_id != dir) continue;
+        if(dir == 0 && i == 0) continue; // 跳過 root 自己
+        ent->ino = i; ent->is_dir = inode_table[i].is_dir;
+        inode_rdlock(i); // 大小和時間會被寫入的 thread 改 (只拿 Inode 的鎖)
+        ent->size = inode_table[i].size; ent->permission = inode_table[i].permission;
+        ent->mtime = inode_table[i].mtime;
+        inode_unlock(i);
+        strcpy(ent->name, inode_table[i].name);
+        r = 1;
+        break;
+    }
+    *cookie = r ? i + 1 : sb->total_inodes;
+    ns_unlock();
+    return r;
+}
+
+int myfs_listdir(const char *path, int sort, int offset, int limit, myfs_dirent_t *ents, int *total)
+{
+    if(offset < 0 || limit < 0) return MYFS_EINVAL;
+    ns_rdlock();
+    int dir = resolve(path, NULL, NULL);
+    if(dir < 0 || !inode_table[dir].is_dir) { ns_unlock(); return dir < 0 ? dir : MYFS_ENOTDIR; }
+
+    int *ids = malloc(sizeof(int) * (limit ? limit : 1));
+    int n = dir_list(dir, sort, offset, limit, ids, total);
+    for(int k = 0; k < n; k++)
+    {
+        Inode *ino = &inode_table[ids[k]];
+        ents[k].ino = ids[k]; ents[k].is_dir = ino->is_dir;
+        inode_rdlock(ids[k]);
+        ents[k].size = ino->size; ents[k].permission = ino->permission;
+        ents[k].mtime = ino->mtime;
+        inode_unlock(ids[k]);
+        strcpy(ents[k].name, ino->name);
+    }
+    ns_unlock();
+    free(ids);
+    return n;
+}
+
+int myfs_mkdir(const char *path)
+{
+    int parent; char leaf[MAX_FILENAME];
+    ns_wrlock();
+    int idx = resolve(path, &parent, leaf);
+    int r;
+    if(idx >= 0) r = MYFS_EEXIST;
+    else if(idx != MYFS_ENOENT || parent < 0) r = idx;
+    else r = inode_create(parent, leaf, 1, 0) == -1 ? MYFS_ENOSPC : MYFS_OK;
+    ns_unlock();
+    return r;
+}
+
+int myfs_unlink(const char *path)
+{
+    ns_wrlock();
+    int idx = resolve(path, NULL, NULL);
+    int r = MYFS_OK;
+    if(idx < 0) r = idx;
+    else if(inode_table[idx].is_dir) r = MYFS_EISDIR;
+    else if(!(inode_table[idx].permission & 2)) r = MYFS_EACCES;
+    else
+    {
+        inode_wrlock(idx); // 等正在讀寫這個檔案的 thread 做完
+        pthread_mutex_lock(&fd_lock);
+        for(int fd = 0; fd < MYFS_MAX_OPEN; fd += FD_CHUNK) // 還開著的 handle 直接失效
+        {
+            OpenFile *chunk = fd_chunks[fd / FD_CHUNK];
+            for(int k = 0; chunk && k < FD_CHUNK; k++)
+                if(chunk[k].used && chunk[k].ino == idx) fd_free(&chunk[k], fd + k);
+        }
+        pthread_mutex_unlock(&fd_lock);
+        recursive_delete(idx);
+        inode_unlock(idx);
+    }
+    ns_unlock();
+    return r;
+}
+
+int myfs_rmdir(const char *path)
+{
+    ns_wrlock();
+    int idx = resolve(path, NULL, NULL);
+    int r = MYFS_OK;
+    if(idx < 0) r = idx;
+    else if(!inode_table[idx].is_dir) r = MYFS_ENOTDIR;
+    else if(idx == 0) r = MYFS_EINVAL;
+    else
+    {
+        for(int i = 0; i < sb->total_inodes; i++)
+            if(inode_table[i].is_used && inode_table[i].parent_id == idx) { r = MYFS_ENOTEMPTY; break; }
+        if(r == MYFS_OK)
+        {
+            dcache_invalidate(idx);
+            inode_table[idx].is_used = 0; sb->used_inodes--;
+        }
+    }
+    ns_unlock();
+    return r;
+}
+
+static int do_rename(const char *src, const char *dest)
+{
+    int s = resolve(src, NULL, NULL);
+    if(s < 0) return s;
+    if(s == 0) return MYFS_EINVAL;
+
+    int parent; char leaf[MAX_FILENAME];
+    int d = resolve(dest, &parent, leaf);
+    if(d >= 0)
+    {
+        // 目標是已存在的目錄就移進去,否則不覆蓋
+        if(!inode_table[d].is_dir) return MYFS_EEXIST;
+        if(find_inode_by_name(inode_table[s].name, d) != -1) return MYFS_EEXIST;
+        parent = d; strcpy(leaf, inode_table[s].name);
+    }
+    else if(d != MYFS_ENOENT || parent < 0) return d;
+
+    // 不能把目錄搬進自己底下
+    for(int p = parent; p != 0; p = inode_table[p].parent_id)
+        if(p == s) return MYFS_EINVAL;
+
+    inode_wrlock(s); // 寫入時會用到 parent_id (更新目錄的資料版本)
+    dcache_invalidate(s);
+    inode_table[s].parent_id = parent;
+    strcpy(inode_table[s].name, leaf);
+    inode_changed(s);
+    inode_unlock(s);
+    dir_changed(parent);
+    return MYFS_OK;
+}
+
+int myfs_rename(const char *src, const char *dest)
+{
+    ns_wrlock();
+    int r = do_rename(src, dest);
+    ns_unlock();
+    return r;
+}
+
+int myfs_chmod(const char *path, int mode)
+{
+    if(mode < 0 || mode > 7) return MYFS_EINVAL;
+    ns_wrlock(); // permission 在 open 時 (拿著 ns_lock) 檢查
+    int idx = resolve(path, NULL, NULL);
+    if(idx >= 0)
+    {
+        inode_table[idx].permission = mode;
+        inode_changed(idx);
+    }
+    ns_unlock();
+    return idx < 0 ? idx : MYFS_OK;
+}
+
+int myfs_chdir(const char *path)
+{
+    ns_rdlock();
+    int idx = resolve(path, NULL, NULL);
+    int r = MYFS_OK;
+    if(idx < 0) r = idx;
+    else if(!inode_table[idx].is_dir) r = MYFS_ENOTDIR;
+    else
+    {
+        current_dir_id = idx;
+        strncpy(current_path, inode_path(idx), sizeof(current_path)-1);
+        current_path[sizeof(current_path)-1] = 0;
+    }
+    ns_unlock();
+    return r;
+}
+
+int myfs_getcwd(char *buf, int size)
+{
+    ns_rdlock();
+    const char *p = inode_path(current_dir_id);
+    int r = MYFS_OK;
+    if((int)strlen(p) >= size) r = MYFS_EINVAL;
+    else strcpy(buf, p);
+    ns_unlock();
+    return r;
+}
+
+myfs_session_t *myfs_session_new(void)
+{
+    myfs_session_t *s = calloc(1, sizeof(myfs_session_t));
+    if(s) strcpy(s->path, "/");
+    return s;
+}
+
+void myfs_session_free(myfs_session_t *s)
+{
+    if(cur_session == s) cur_session = NULL;
+    free(s);
+}
+
+void myfs_session_use(myfs_session_t *s)
+{
+    cur_session = s;
+}
+
+const char *myfs_strerror(int err)
+{
+    switch(err)
+    {
+        case MYFS_OK:           return "Success";
+        case MYFS_ENOENT:       return "No such file or directory";
+        case MYFS_EIO:          return "I/O error";
+        case MYFS_EBADF:        return "Bad file handle";
+        case MYFS_ENOMEM:       return "Out of memory";
+        case MYFS_EACCES:       return "Permission denied";
+        case MYFS_EEXIST:       return "File exists";
+        case MYFS_ENOTDIR:      return "Not a directory";
+        case MYFS_EISDIR:       return "Is a directory";
+        case MYFS_EINVAL:       return "Invalid argument";
+        case MYFS_EMFILE:       return "Too many open files";
+        case MYFS_EFBIG:        return "File too large";
+        case MYFS_ENOSPC:       return "No space left on device";
+        case MYFS_ENAMETOOLONG: return "File name too long";
+        case MYFS_ENOTEMPTY:    return "Directory not empty";
+    }
+    return "Unknown error";
+}
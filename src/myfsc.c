@@ -0,0 +1,121 @@
+// myfsc: myfs serve 的命令列 client
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "myfs_client.h"
+
+#define CHUNK (64 * 1024)
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s --socket <path> <command> [args]\n"
+           "  ls [dir]                List a directory (default: /)\n"
+           "  stat <path>             Show inode information\n"
+           "  cat <file>              Print a file\n"
+           "  put <hostfile> <file>   Copy a host file into the image\n"
+           "  get <file> <hostfile>   Copy a file out of the image\n"
+           "  mkdir <dir>             Create a directory\n"
+           "  rm <file>               Delete a file\n"
+           "  sync                    Save the image on the server\n", prog);
+}
+
+static int fail(int r)
+{
+    fprintf(stderr, "Error: %s\n", myfs_strerror(r));
+    return 1;
+}
+
+static int do_ls(myfsc_t *c, const char *dir)
+{
+    myfs_dirent_t ents[256];
+    int off = 0, total = 0;
+    do
+    {
+        int n = myfsc_listdir(c, dir, off, 256, ents, &total);
+        if(n < 0) return fail(n);
+        if(n == 0) break;
+        for(int i = 0; i < n; i++)
+            printf("%c %o %8d  %s%s\n", ents[i].is_dir ? 'd' : '-', ents[i].permission, ents[i].size,
+                   ents[i].name, ents[i].is_dir ? "/" : "");
+        off += n;
+    } while(off < total);
+    return 0;
+}
+
+static int do_stat(myfsc_t *c, const char *path)
+{
+    myfs_stat_t st;
+    int r = myfsc_stat(c, path, &st);
+    if(r < 0) return fail(r);
+    printf("Inode: %d  Type: %s  Size: %d  Blocks: %d  Perm: %o  Parent: %d\n",
+           st.ino, st.is_dir ? "dir" : "file", st.size, st.blocks, st.permission, st.parent);
+    return 0;
+}
+
+// 檔案內容寫到 out (cat: stdout, get: host 檔案)
+static int copy_out(myfsc_t *c, const char *path, FILE *out)
+{
+    int fd = myfsc_open(c, path, MYFS_O_RDONLY);
+    if(fd < 0) return fail(fd);
+    char *buf = malloc(CHUNK);
+    int off = 0, n;
+    while((n = myfsc_pread(c, fd, buf, CHUNK, off)) > 0)
+    {
+        fwrite(buf, 1, n, out);
+        off += n;
+    }
+    free(buf);
+    myfsc_close(c, fd);
+    return n < 0 ? fail(n) : 0;
+}
+
+static int do_put(myfsc_t *c, const char *host, const char *path)
+{
+    FILE *fp = fopen(host, "rb");
+    if(!fp) { fprintf(stderr, "Error: Cannot open '%s'.\n", host); return 1; }
+    int fd = myfsc_open(c, path, MYFS_O_WRONLY | MYFS_O_CREAT | MYFS_O_TRUNC);
+    if(fd < 0) { fclose(fp); return fail(fd); }
+    char *buf = malloc(CHUNK);
+    int off = 0, r = 0, n;
+    while(r >= 0 && (n = (int)fread(buf, 1, CHUNK, fp)) > 0)
+    {
+        r = myfsc_pwrite(c, fd, buf, n, off);
+        if(r >= 0 && r < n) r = MYFS_EFBIG; // 超過單檔上限
+        off += n;
+    }
+    free(buf);
+    fclose(fp);
+    myfsc_close(c, fd);
+    return r < 0 ? fail(r) : 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *sock = NULL;
+    int i = 1;
+    if(i + 1 < argc && strcmp(argv[i], "--socket") == 0) { sock = argv[i + 1]; i += 2; }
+    if(!sock || i >= argc) { usage(argv[0]); return 1; }
+    const char *cmd = argv[i];
+    const char *a1 = i + 1 < argc ? argv[i + 1] : NULL;
+    const char *a2 = i + 2 < argc ? argv[i + 2] : NULL;
+
+    myfsc_t *c = myfsc_connect(sock);
+    if(!c) { fprintf(stderr, "Error: Cannot connect to '%s'.\n", sock); return 1; }
+    int rc;
+    if(strcmp(cmd, "ls") == 0) rc = do_ls(c, a1 ? a1 : "/");
+    else if(strcmp(cmd, "stat") == 0 && a1) rc = do_stat(c, a1);
+    else if(strcmp(cmd, "cat") == 0 && a1) rc = copy_out(c, a1, stdout);
+    else if(strcmp(cmd, "put") == 0 && a2) rc = do_put(c, a1, a2);
+    else if(strcmp(cmd, "get") == 0 && a2)
+    {
+        FILE *fp = fopen(a2, "wb");
+        if(!fp) { fprintf(stderr, "Error: Cannot create '%s'.\n", a2); rc = 1; }
+        else { rc = copy_out(c, a1, fp); fclose(fp); }
+    }
+    else if(strcmp(cmd, "mkdir") == 0 && a1) { int r = myfsc_mkdir(c, a1); rc = r < 0 ? fail(r) : 0; }
+    else if(strcmp(cmd, "rm") == 0 && a1) { int r = myfsc_unlink(c, a1); rc = r < 0 ? fail(r) : 0; }
+    else if(strcmp(cmd, "sync") == 0) { int r = myfsc_sync(c); rc = r < 0 ? fail(r) : 0; }
+    else { usage(argv[0]); rc = 1; }
+    myfsc_disconnect(c);
+    return rc;
+}
@@ -0,0 +1,307 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "path.h"
+#include "fs.h"
+#include "inode.h"
+#include "myfs.h"
+#include "find.h"
+#include "gen.h"
+
+// Direct-mapped 的 Dentry Cache,碰撞時直接覆蓋
+#define DCACHE_SIZE 8192
+
+typedef struct
+{
+    int parent_id;
+    int idx; // -1 = 空的
+    char name[MAX_FILENAME];
+} Dentry;
+
+static Dentry dcache[DCACHE_SIZE];
+// 多個 thread 拿著 ns_lock (read) 同時查詢/填入,依 bucket 分段上鎖
+#define DCACHE_LOCKS 64
+static pthread_mutex_t dcache_locks[DCACHE_LOCKS];
+static pthread_once_t dcache_once = PTHREAD_ONCE_INIT;
+static void dcache_init_locks() { for(int i = 0; i < DCACHE_LOCKS; i++) pthread_mutex_init(&dcache_locks[i], NULL); }
+#define DLOCK(h) (&dcache_locks[(h) & (DCACHE_LOCKS - 1)])
+
+// Inode -> 完整路徑的 cache
+// path_gen 變動時 (目錄被搬移或刪除) 所有路徑一起失效
+static char **path_cache;
+static unsigned *path_cache_gen;
+static int path_cache_n;
+static unsigned path_gen = 1;
+static pthread_mutex_t path_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Name index: 依名稱排序的 (name, Inode) 陣列 + 還沒合併進去的 Inode 清單
+typedef struct
+{
+    const char *name; // 指向 name_arena
+    int idx;
+} NameEntry;
+
+static NameEntry *name_sorted;
+static int name_nsorted;
+static char *name_arena;
+static int *name_pending;
+static int name_npending, name_pcap;
+static unsigned char *name_where; // 0 = 不在索引, 1 = 排序陣列裡的那筆有效, 2 = 在待處理清單
+static void names_reset();
+
+// 目錄版本號: 每次改變都拿一個新的全域序號,重新載入後也不會跟舊的相同
+static unsigned *dir_gens, *dir_data_gens;
+static unsigned gen_clock; // 寫不同檔案的 thread 會同時更新,用 atomic
+
+static unsigned dhash(int parent_id, const char *name)
+{
+    // FNV-1a
+    unsigned h = 2166136261u ^ (unsigned)parent_id * 16777619u;
+    while(*name) { h ^= (unsigned char)*name++; h *= 16777619u; }
+    return h & (DCACHE_SIZE - 1);
+}
+
+void dcache_reset()
+{
+    pthread_once(&dcache_once, dcache_init_locks);
+    for(int i = 0; i < DCACHE_SIZE; i++) dcache[i].idx = -1;
+    for(int i = 0; i < path_cache_n; i++) free(path_cache[i]);
+    free(path_cache); free(path_cache_gen);
+    // 大小跟著目前映像檔的 Inode 數量
+    path_cache_n = sb ? sb->total_inodes : 0;
+    path_cache = calloc(path_cache_n ? path_cache_n : 1, sizeof(char*));
+    path_cache_gen = calloc(path_cache_n ? path_cache_n : 1, sizeof(unsigned));
+    path_gen++;
+    names_reset();
+
+    free(dir_gens); free(dir_data_gens);
+    dir_gens = malloc(sizeof(unsigned) * (path_cache_n ? path_cache_n : 1));
+    dir_data_gens = malloc(sizeof(unsigned) * (path_cache_n ? path_cache_n : 1));
+    gen_clock++;
+    for(int i = 0; i < path_cache_n; i++) dir_gens[i] = dir_data_gens[i] = gen_clock;
+}
+
+int dcache_lookup(int parent_id, const char *name)
+{
+    unsigned h = dhash(parent_id, name);
+    Dentry *d = &dcache[h];
+    int r = -1;
+    pthread_mutex_lock(DLOCK(h));
+    if(d->idx >= 0 && d->parent_id == parent_id && strcmp(d->name, name) == 0)
+    {
+        // 再確認一次 Inode 還是同一個 (漏掉的失效也不會回傳錯的結果)
+        Inode *ino = &inode_table[d->idx];
+        if(!ino->is_used || ino->parent_id != parent_id || strcmp(ino->name, name) != 0) d->idx = -1;
+        else r = d->idx;
+    }
+    pthread_mutex_unlock(DLOCK(h));
+    return r;
+}
+
+void dcache_insert(int parent_id, const char *name, int idx)
+{
+    unsigned h = dhash(parent_id, name);
+    Dentry *d = &dcache[h];
+    pthread_mutex_lock(DLOCK(h));
+    d->parent_id = parent_id; d->idx = idx;
+    strncpy(d->name, name, MAX_FILENAME - 1); d->name[MAX_FILENAME - 1] = 0;
+    pthread_mutex_unlock(DLOCK(h));
+}
+
+void dcache_invalidate(int idx)
+{
+    Inode *ino = &inode_table[idx];
+    unsigned h = dhash(ino->parent_id, ino->name);
+    pthread_mutex_lock(DLOCK(h));
+    if(dcache[h].idx == idx) dcache[h].idx = -1;
+    pthread_mutex_unlock(DLOCK(h));
+
+    names_touch(idx);
+    gen_inode(idx); // 改名、搬移、刪除
+    dir_changed(ino->parent_id);
+
+    // 目錄的路徑變了,底下所有檔案的路徑也跟著變
+    pthread_mutex_lock(&path_lock);
+    if(ino->is_dir) path_gen++;
+    else { free(path_cache[idx]); path_cache[idx] = NULL; }
+    pthread_mutex_unlock(&path_lock);
+}
+
+int path_resolve(const char *path, int base, int *parent, char *leaf)
+{
+    if(!path || !*path) return MYFS_ENOENT;
+    int cur = (path[0] == '/') ? 0 : base;
+    const char *p = path;
+
+    if(parent) *parent = -1;
+    while(*p)
+    {
+        while(*p == '/') p++;
+        if(!*p) break;
+
+        // 取出一層名稱
+        char name[MAX_FILENAME];
+        int len = strcspn(p, "/");
+        if(len >= MAX_FILENAME) return MYFS_ENAMETOOLONG;
+        memcpy(name, p, len); name[len] = 0;
+        p += len;
+        while(*p == '/') p++;
+        int last = (*p == 0);
+
+        if(!inode_table[cur].is_dir) return MYFS_ENOTDIR;
+        if(strcmp(name, ".") == 0) continue;
+        if(strcmp(name, "..") == 0) { cur = inode_table[cur].parent_id; continue; }
+
+        int next = find_inode_by_name(name, cur); // 先查 Dentry Cache
+        if(next == -1)
+        {
+            if(last && parent) { *parent = cur; strcpy(leaf, name); }
+            return MYFS_ENOENT;
+        }
+        cur = next;
+    }
+    return cur;
+}
+
+void dir_changed(int dir)
+{
+    __atomic_store_n(&dir_gens[dir], __atomic_add_fetch(&gen_clock, 1, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    inode_table[dir].mtime = inode_table[dir].ctime = (uint32_t)time(NULL); // 目錄的內容就是它的子項目
+    gen_inode(dir);
+}
+void dir_data_changed(int dir)
+{
+    __atomic_store_n(&dir_data_gens[dir], __atomic_add_fetch(&gen_clock, 1, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+unsigned dir_gen(int dir) { return __atomic_load_n(&dir_gens[dir], __ATOMIC_RELAXED); }
+unsigned dir_data_gen(int dir) { return __atomic_load_n(&dir_data_gens[dir], __ATOMIC_RELAXED); }
+
+static const char *path_of(int idx)
+{
+    if(idx == 0) return "/";
+    if(path_cache[idx] && path_cache_gen[idx] == path_gen) return path_cache[idx];
+
+    // 沿著 parent 往上組出路徑 (父目錄的路徑也會順便被 cache)
+    const char *pp = path_of(inode_table[idx].parent_id);
+    int plen = strlen(pp);
+    int nlen = strlen(inode_table[idx].name);
+    char *full = malloc(plen + nlen + 2);
+    memcpy(full, pp, plen);
+    if(plen > 1) full[plen++] = '/';
+    memcpy(full + plen, inode_table[idx].name, nlen + 1);
+
+    free(path_cache[idx]);
+    path_cache[idx] = full;
+    path_cache_gen[idx] = path_gen;
+    return full;
+}
+
+// 回傳的字串在命名空間改變 (ns_lock 的 write) 之前都有效
+const char *inode_path(int idx)
+{
+    pthread_mutex_lock(&path_lock);
+    const char *p = path_of(idx);
+    pthread_mutex_unlock(&path_lock);
+    return p;
+}
+
+
+// ---- Name index ----
+
+static void names_reset()
+{
+    free(name_sorted); free(name_arena); free(name_pending); free(name_where);
+    name_sorted = NULL; name_arena = NULL; name_nsorted = 0;
+    name_pending = NULL; name_npending = name_pcap = 0;
+    name_where = calloc(path_cache_n ? path_cache_n : 1, 1);
+    // 一開始全部都是待處理,第一次查詢時才排序
+    for(int i = 1; i < path_cache_n; i++) if(inode_table[i].is_used) names_touch(i);
+}
+
+void names_touch(int idx)
+{
+    if(name_where[idx] == 2) return; // 已經在清單裡 (查詢時才看目前的名稱)
+    if(name_npending == name_pcap)
+    {
+        name_pcap = name_pcap ? name_pcap * 2 : 256;
+        name_pending = realloc(name_pending, sizeof(int) * name_pcap);
+    }
+    name_pending[name_npending++] = idx;
+    name_where[idx] = 2;
+}
+
+static int cmp_pending(const void *a, const void *b)
+{
+    return strcmp(inode_table[*(const int*)a].name, inode_table[*(const int*)b].name);
+}
+
+// 把待處理清單排序後跟排序陣列合併 (O(N + P log P))
+static void names_merge()
+{
+    int live = 0;
+    for(int k = 0; k < name_npending; k++)
+    {
+        int i = name_pending[k];
+        name_where[i] = 0;
+        if(inode_table[i].is_used) name_pending[live++] = i;
+    }
+    qsort(name_pending, live, sizeof(int), cmp_pending);
+
+    int total = live;
+    size_t bytes = 0;
+    for(int k = 0; k < name_nsorted; k++)
+        if(name_where[name_sorted[k].idx] == 1) { total++; bytes += strlen(name_sorted[k].name) + 1; }
+    for(int k = 0; k < live; k++) bytes += strlen(inode_table[name_pending[k]].name) + 1;
+
+    NameEntry *out = malloc(sizeof(NameEntry) * (total ? total : 1));
+    char *arena = malloc(bytes ? bytes : 1), *ap = arena;
+    int a = 0, b = 0, n = 0;
+    while(a < name_nsorted || b < live)
+    {
+        if(a < name_nsorted && name_where[name_sorted[a].idx] != 1) { a++; continue; } // 已經改過,以清單裡的為準
+        const char *nm; int idx;
+        if(b >= live || (a < name_nsorted && strcmp(name_sorted[a].name, inode_table[name_pending[b]].name) <= 0))
+        {
+            nm = name_sorted[a].name; idx = name_sorted[a++].idx;
+        }
+        else
+        {
+            idx = name_pending[b++]; nm = inode_table[idx].name;
+        }
+        int len = strlen(nm) + 1;
+        memcpy(ap, nm, len);
+        out[n].name = ap; out[n].idx = idx; n++;
+        ap += len;
+    }
+    for(int k = 0; k < n; k++) name_where[out[k].idx] = 1;
+
+    free(name_sorted); free(name_arena);
+    name_sorted = out; name_arena = arena; name_nsorted = n;
+    name_npending = 0;
+}
+
+void names_glob(const char *pat, void (*cb)(void *ctx, int idx), void *ctx)
+{
+    // 待處理的太多時查詢會變慢,先合併
+    if(name_npending > 1024 + name_nsorted / 64) names_merge();
+
+    // 第一個萬用字元之前的固定開頭: 二分搜尋找出範圍
+    char prefix[MAX_FILENAME];
+    int plen = strcspn(pat, "*?[");
+    if(plen >= MAX_FILENAME) return; // 檔名不可能這麼長
+    memcpy(prefix, pat, plen); prefix[plen] = 0;
+    int lo = 0, hi = name_nsorted;
+    while(lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if(strcmp(name_sorted[mid].name, prefix) < 0) lo = mid + 1; else hi = mid;
+    }
+    for(int k = lo; k < name_nsorted && strncmp(name_sorted[k].name, prefix, plen) == 0; k++)
+        if(name_where[name_sorted[k].idx] == 1 && glob_match(pat, name_sorted[k].name)) cb(ctx, name_sorted[k].idx);
+
+    for(int k = 0; k < name_npending; k++)
+    {
+        int i = name_pending[k];
+        if(inode_table[i].is_used && glob_match(pat, inode_table[i].name)) cb(ctx, i);
+    }
+}
@@ -0,0 +1,686 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "rx.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define RX_MAX_NFA 20000     // NFA 狀態上限 (避免 a{255}{255} 這種 pattern 吃光記憶體)
+#define RX_MAX_REPEAT 255    // {m,n} 的上限
+#define RX_CACHE_STATES 256  // DFA cache 最多幾個狀態,滿了就全部清掉
+#define RX_MAX_LITERAL 64
+
+// ---- AST ----
+
+enum { A_LIT, A_CAT, A_ALT, A_STAR, A_PLUS, A_QUEST, A_REPEAT, A_BOL, A_EOL, A_EMPTY };
+
+typedef struct
+{
+    int type;
+    int cls;      // A_LIT: 字元集合
+    int a, b;     // 子節點
+    int min, max; // A_REPEAT (max = -1 表示無上限)
+} ANode;
+
+typedef struct
+{
+    uint32_t bits[8];
+} CharSet;
+
+// ---- NFA ----
+
+enum { N_CHAR, N_SPLIT, N_BOL, N_EOL, N_MATCH };
+
+typedef struct
+{
+    int type;
+    int cls;
+    int out, out1;
+} NState;
+
+// ---- DFA (lazy) ----
+
+typedef struct
+{
+    int *set;      // 對應的 NFA 狀態 (排序過)
+    int n;
+    int match;     // 已經走到 N_MATCH
+    int eol_match; // 在行尾的話會符合 ($)
+} DState;
+
+#define RX_UNKNOWN -2 // 轉移表: 還沒算過
+
+struct Regex
+{
+    // parser
+    const char *src;
+    int pos;
+    char *err;
+    int errlen;
+    int failed;
+
+    ANode *ast; int nast, cast;
+    CharSet *cls; int ncls, ccls;
+    NState *nfa; int nnfa, cnfa;
+    int start;
+
+    char lit[RX_MAX_LITERAL + 1];
+    int litlen;
+
+    // DFA cache
+    DState *ds; int nds;
+    int *trans;    // 轉移表 trans[row + c],row = 狀態編號 * 256 (對外的 state 就是 row);
+                   // 下一個狀態是符合的話直接存 RX_MATCHED
+    int *hash; int hcap;
+    int start_bol;
+    int mid_row;   // 行中間、還沒開始符合任何東西時的狀態 (-1 = 還沒建立)
+    unsigned flushes;
+
+    // 可以開始一個符合的字元 (最多 3 個);停在 mid_row 時直接跳到下一個這種字元
+    unsigned char first[3];
+    int nfirst;   // 0 = 太多種,不跳
+
+    // 計算 closure 用的暫存
+    unsigned *mark; unsigned markgen;
+    int *stack, *tmp, *seeds;
+};
+
+static void fail(Regex *rx, const char *msg)
+{
+    if(rx->failed) return;
+    rx->failed = 1;
+    snprintf(rx->err, rx->errlen, "%s (at offset %d)", msg, rx->pos);
+}
+
+// ---- Parser: alt := cat ('|' cat)*, cat := repeat*, repeat := atom ('*'|'+'|'?'|{m,n})* ----
+
+static int new_node(Regex *rx, int type, int a, int b)
+{
+    if(rx->nast == rx->cast)
+    {
+        rx->cast = rx->cast ? rx->cast * 2 : 64;
+        rx->ast = realloc(rx->ast, sizeof(ANode) * rx->cast);
+    }
+    ANode *n = &rx->ast[rx->nast];
+    memset(n, 0, sizeof(ANode));
+    n->type = type; n->a = a; n->b = b;
+    return rx->nast++;
+}
+
+static int new_class(Regex *rx)
+{
+    if(rx->ncls == rx->ccls)
+    {
+        rx->ccls = rx->ccls ? rx->ccls * 2 : 16;
+        rx->cls = realloc(rx->cls, sizeof(CharSet) * rx->ccls);
+    }
+    memset(&rx->cls[rx->ncls], 0, sizeof(CharSet));
+    return rx->ncls++;
+}
+
+static void cls_add(CharSet *c, int ch) { c->bits[ch >> 5] |= 1u << (ch & 31); }
+static int cls_has(const CharSet *c, int ch) { return (c->bits[ch >> 5] >> (ch & 31)) & 1; }
+
+static void cls_add_range(CharSet *c, int lo, int hi)
+{
+    for(int ch = lo; ch <= hi; ch++) cls_add(c, ch);
+}
+
+// \d \w \s (大寫為反向),回傳 0 表示不是這類跳脫
+static int cls_add_escape(CharSet *c, int e)
+{
+    CharSet t; memset(&t, 0, sizeof(t));
+    switch(e | 0x20)
+    {
+        case 'd': cls_add_range(&t, '0', '9'); break;
+        case 'w': cls_add_range(&t, 'a', 'z'); cls_add_range(&t, 'A', 'Z'); cls_add_range(&t, '0', '9'); cls_add(&t, '_'); break;
+        case 's': cls_add(&t, ' '); cls_add(&t, '\t'); cls_add(&t, '\r'); cls_add(&t, '\v'); cls_add(&t, '\f'); break;
+        default: return 0;
+    }
+    int neg = (e >= 'A' && e <= 'Z');
+    for(int i = 0; i < 8; i++) c->bits[i] |= neg ? ~t.bits[i] : t.bits[i];
+    return 1;
+}
+
+static int escape_char(int e)
+{
+    switch(e)
+    {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+    }
+    return e;
+}
+
+static int parse_alt(Regex *rx);
+
+static int lit_node(Regex *rx, int cls)
+{
+    int n = new_node(rx, A_LIT, -1, -1);
+    rx->ast[n].cls = cls;
+    return n;
+}
+
+static int parse_class(Regex *rx)
+{
+    const char *s = rx->src;
+    int c = new_class(rx);
+    int neg = 0;
+    if(s[rx->pos] == '^') { neg = 1; rx->pos++; }
+    int first = 1;
+    while(s[rx->pos] && (s[rx->pos] != ']' || first))
+    {
+        first = 0;
+        int lo = (unsigned char)s[rx->pos++];
+        if(lo == '\\' && s[rx->pos])
+        {
+            int e = (unsigned char)s[rx->pos++];
+            if(cls_add_escape(&rx->cls[c], e)) continue;
+            lo = escape_char(e);
+        }
+        if(s[rx->pos] == '-' && s[rx->pos + 1] && s[rx->pos + 1] != ']')
+        {
+            rx->pos++;
+            int hi = (unsigned char)s[rx->pos++];
+            if(hi == '\\' && s[rx->pos]) hi = escape_char((unsigned char)s[rx->pos++]);
+            if(hi < lo) { fail(rx, "invalid range in []"); return -1; }
+            cls_add_range(&rx->cls[c], lo, hi);
+        }
+        else cls_add(&rx->cls[c], lo);
+    }
+    if(s[rx->pos] != ']') { fail(rx, "missing ]"); return -1; }
+    rx->pos++;
+    if(neg) for(int i = 0; i < 8; i++) rx->cls[c].bits[i] = ~rx->cls[c].bits[i];
+    return lit_node(rx, c);
+}
+
+static int parse_atom(Regex *rx)
+{
+    const char *s = rx->src;
+    int ch = (unsigned char)s[rx->pos++];
+    switch(ch)
+    {
+        case '(':
+        {
+            int n = (s[rx->pos] == ')') ? new_node(rx, A_EMPTY, -1, -1) : parse_alt(rx);
+            if(s[rx->pos] != ')') { fail(rx, "missing )"); return -1; }
+            rx->pos++;
+            return n;
+        }
+        case '[': return parse_class(rx);
+        case '^': return new_node(rx, A_BOL, -1, -1);
+        case '$': return new_node(rx, A_EOL, -1, -1);
+        case '.':
+        {
+            int c = new_class(rx);
+            cls_add_range(&rx->cls[c], 0, 255);
+            rx->cls[c].bits['\n' >> 5] &= ~(1u << ('\n' & 31));
+            return lit_node(rx, c);
+        }
+        case '*': case '+': case '?':
+            rx->pos--; fail(rx, "nothing to repeat"); return -1;
+        case '\\':
+        {
+            if(!s[rx->pos]) { fail(rx, "trailing \\"); return -1; }
+            int e = (unsigned char)s[rx->pos++];
+            int c = new_class(rx);
+            if(!cls_add_escape(&rx->cls[c], e)) cls_add(&rx->cls[c], escape_char(e));
+            return lit_node(rx, c);
+        }
+    }
+    int c = new_class(rx);
+    cls_add(&rx->cls[c], ch);
+    return lit_node(rx, c);
+}
+
+// {m} {m,} {m,n};格式不對時 '{' 當作一般字元 (跟 GNU grep 一樣)
+static int parse_brace(Regex *rx, int *min, int *max)
+{
+    const char *s = rx->src;
+    int p = rx->pos + 1;
+    if(s[p] < '0' || s[p] > '9') return 0;
+    int m = 0, n;
+    while(s[p] >= '0' && s[p] <= '9') m = m * 10 + (s[p++] - '0');
+    n = m;
+    if(s[p] == ',')
+    {
+        p++;
+        if(s[p] == '}') n = -1;
+        else
+        {
+            if(s[p] < '0' || s[p] > '9') return 0;
+            n = 0;
+            while(s[p] >= '0' && s[p] <= '9') n = n * 10 + (s[p++] - '0');
+        }
+    }
+    if(s[p] != '}') return 0;
+    if(m > RX_MAX_REPEAT || n > RX_MAX_REPEAT || (n >= 0 && n < m)) { fail(rx, "invalid {m,n}"); return 0; }
+    rx->pos = p + 1;
+    *min = m; *max = n;
+    return 1;
+}
+
+static int parse_repeat(Regex *rx)
+{
+    int n = parse_atom(rx);
+    while(!rx->failed)
+    {
+        char c = rx->src[rx->pos];
+        int min, max;
+        if(c == '*') { rx->pos++; n = new_node(rx, A_STAR, n, -1); }
+        else if(c == '+') { rx->pos++; n = new_node(rx, A_PLUS, n, -1); }
+        else if(c == '?') { rx->pos++; n = new_node(rx, A_QUEST, n, -1); }
+        else if(c == '{' && parse_brace(rx, &min, &max))
+        {
+            n = new_node(rx, A_REPEAT, n, -1);
+            rx->ast[n].min = min; rx->ast[n].max = max;
+        }
+        else break;
+    }
+    return n;
+}
+
+static int parse_cat(Regex *rx)
+{
+    int n = -1;
+    while(!rx->failed && rx->src[rx->pos] && rx->src[rx->pos] != '|' && rx->src[rx->pos] != ')')
+    {
+        int r = parse_repeat(rx);
+        n = (n < 0) ? r : new_node(rx, A_CAT, n, r);
+    }
+    return n < 0 ? new_node(rx, A_EMPTY, -1, -1) : n;
+}
+
+static int parse_alt(Regex *rx)
+{
+    int n = parse_cat(rx);
+    while(!rx->failed && rx->src[rx->pos] == '|')
+    {
+        rx->pos++;
+        n = new_node(rx, A_ALT, n, parse_cat(rx));
+    }
+    return n;
+}
+
+// ---- AST -> NFA (從後面往前建: compile(node, next) 回傳入口) ----
+
+static int new_state(Regex *rx, int type, int cls, int out, int out1)
+{
+    if(rx->nnfa >= RX_MAX_NFA) { fail(rx, "pattern too large"); return 0; }
+    if(rx->nnfa == rx->cnfa)
+    {
+        rx->cnfa = rx->cnfa ? rx->cnfa * 2 : 64;
+        rx->nfa = realloc(rx->nfa, sizeof(NState) * rx->cnfa);
+    }
+    NState *s = &rx->nfa[rx->nnfa];
+    s->type = type; s->cls = cls; s->out = out; s->out1 = out1;
+    return rx->nnfa++;
+}
+
+static int compile_node(Regex *rx, int n, int next)
+{
+    if(rx->failed) return 0;
+    ANode *a = &rx->ast[n];
+    switch(a->type)
+    {
+        case A_LIT:   return new_state(rx, N_CHAR, a->cls, next, -1);
+        case A_BOL:   return new_state(rx, N_BOL, 0, next, -1);
+        case A_EOL:   return new_state(rx, N_EOL, 0, next, -1);
+        case A_EMPTY: return next;
+        case A_CAT:   return compile_node(rx, a->a, compile_node(rx, a->b, next));
+        case A_ALT:
+        {
+            int l = compile_node(rx, a->a, next);
+            int r = compile_node(rx, a->b, next);
+            return new_state(rx, N_SPLIT, 0, l, r);
+        }
+        case A_QUEST: return new_state(rx, N_SPLIT, 0, compile_node(rx, a->a, next), next);
+        case A_STAR:
+        case A_PLUS:
+        {
+            int s = new_state(rx, N_SPLIT, 0, -1, next);
+            int body = compile_node(rx, rx->ast[n].a, s);
+            if(rx->failed) return 0;
+            rx->nfa[s].out = body;
+            return (rx->ast[n].type == A_STAR) ? s : body;
+        }
+        case A_REPEAT:
+        {
+            int min = a->min, max = a->max, x = a->a;
+            int t = next;
+            if(max < 0)
+            {
+                // x{m,} = x x ... x x*
+                int s = new_state(rx, N_SPLIT, 0, -1, next);
+                int body = compile_node(rx, x, s);
+                if(rx->failed) return 0;
+                rx->nfa[s].out = body;
+                t = s;
+            }
+            else
+            {
+                // 選擇性的部分: (x(x(x)?)?)?
+                for(int k = 0; k < max - min && !rx->failed; k++)
+                    t = new_state(rx, N_SPLIT, 0, compile_node(rx, x, t), next);
+            }
+            for(int k = 0; k < min && !rx->failed; k++) t = compile_node(rx, x, t);
+            return t;
+        }
+    }
+    return next;
+}
+
+// ---- 必要字串 (prefilter) ----
+
+// 只包含一個字元的集合 -> 那個字元,否則 -1
+static int single_char(const CharSet *c)
+{
+    int found = -1;
+    for(int i = 0; i < 8; i++)
+    {
+        if(!c->bits[i]) continue;
+        if(found >= 0 || (c->bits[i] & (c->bits[i] - 1))) return -1;
+        found = i * 32 + __builtin_ctz(c->bits[i]);
+    }
+    return found;
+}
+
+static void flatten_cat(Regex *rx, int n, int *list, int *cnt)
+{
+    if(rx->ast[n].type == A_CAT)
+    {
+        flatten_cat(rx, rx->ast[n].a, list, cnt);
+        flatten_cat(rx, rx->ast[n].b, list, cnt);
+    }
+    else list[(*cnt)++] = n;
+}
+
+// 找出 node 的每個符合都一定包含的最長連續字元,寫進 buf
+static int required_literal(Regex *rx, int n, char *buf)
+{
+    ANode *a = &rx->ast[n];
+    switch(a->type)
+    {
+        case A_LIT:
+        {
+            int ch = single_char(&rx->cls[a->cls]);
+            if(ch < 0) return 0;
+            buf[0] = (char)ch;
+            return 1;
+        }
+        case A_PLUS: return required_literal(rx, a->a, buf);
+        case A_REPEAT: return a->min > 0 ? required_literal(rx, a->a, buf) : 0;
+        case A_CAT:
+        {
+            int *list = malloc(sizeof(int) * rx->nast);
+            int cnt = 0, best = 0, run = 0;
+            char cur[RX_MAX_LITERAL], sub[RX_MAX_LITERAL];
+            flatten_cat(rx, n, list, &cnt);
+            for(int i = 0; i <= cnt; i++)
+            {
+                int ch = -1;
+                if(i < cnt && rx->ast[list[i]].type == A_LIT) ch = single_char(&rx->cls[rx->ast[list[i]].cls]);
+                else if(i < cnt && (rx->ast[list[i]].type == A_BOL || rx->ast[list[i]].type == A_EOL)) continue;
+                if(ch >= 0 && run < RX_MAX_LITERAL) { cur[run++] = (char)ch; continue; }
+
+                // 連續字元中斷: 記下目前最長的,再看看子節點本身有沒有更長的
+                if(run > best) { best = run; memcpy(buf, cur, run); }
+                run = 0;
+                if(ch >= 0) { cur[run++] = (char)ch; continue; } // 超過長度上限,重新開始
+                if(i < cnt)
+                {
+                    int l = required_literal(rx, list[i], sub);
+                    if(l > best) { best = l; memcpy(buf, sub, l); }
+                }
+            }
+            free(list);
+            return best;
+        }
+    }
+    return 0; // ALT, STAR, QUEST 都可能不出現
+}
+
+// ---- DFA ----
+
+// 從 seeds 出發的 epsilon closure,只留下 N_CHAR / N_MATCH / N_EOL,結果排序後放在 out
+static int closure(Regex *rx, const int *seeds, int ns, int bol, int *out)
+{
+    if(++rx->markgen == 0) { memset(rx->mark, 0, sizeof(unsigned) * rx->nnfa); rx->markgen = 1; }
+    int sp = 0, n = 0;
+    for(int i = 0; i < ns; i++) rx->stack[sp++] = seeds[i];
+    while(sp > 0)
+    {
+        int s = rx->stack[--sp];
+        if(s < 0 || rx->mark[s] == rx->markgen) continue;
+        rx->mark[s] = rx->markgen;
+        NState *st = &rx->nfa[s];
+        switch(st->type)
+        {
+            case N_SPLIT: rx->stack[sp++] = st->out1; rx->stack[sp++] = st->out; break;
+            case N_BOL:   if(bol) rx->stack[sp++] = st->out; break;
+            default:      out[n++] = s; break;
+        }
+    }
+    // 插入排序 (通常只有幾個狀態)
+    for(int i = 1; i < n; i++)
+    {
+        int v = out[i], j = i - 1;
+        while(j >= 0 && out[j] > v) { out[j + 1] = out[j]; j--; }
+        out[j + 1] = v;
+    }
+    return n;
+}
+
+static unsigned set_hash(const int *set, int n)
+{
+    unsigned h = 2166136261u;
+    for(int i = 0; i < n; i++) { h ^= (unsigned)set[i]; h *= 16777619u; }
+    return h;
+}
+
+static void flush_cache(Regex *rx)
+{
+    for(int i = 0; i < rx->nds; i++) free(rx->ds[i].set);
+    rx->nds = 0;
+    for(int i = 0; i < rx->hcap; i++) rx->hash[i] = -1;
+    rx->start_bol = -1;
+    rx->mid_row = -1;
+    rx->flushes++;
+}
+
+// 找到 (或建立) 這個 NFA 集合對應的 DFA 狀態
+static int dstate_get(Regex *rx, const int *set, int n)
+{
+    unsigned h = set_hash(set, n);
+    for(unsigned i = h & (rx->hcap - 1); rx->hash[i] >= 0; i = (i + 1) & (rx->hcap - 1))
+    {
+        DState *d = &rx->ds[rx->hash[i]];
+        if(d->n == n && memcmp(d->set, set, sizeof(int) * n) == 0) return rx->hash[i];
+    }
+    if(rx->nds == RX_CACHE_STATES) flush_cache(rx); // cache 滿了: 全部丟掉重建
+
+    int idx = rx->nds++;
+    DState *d = &rx->ds[idx];
+    d->set = malloc(sizeof(int) * (n ? n : 1));
+    memcpy(d->set, set, sizeof(int) * n);
+    d->n = n;
+    d->match = 0; d->eol_match = 0;
+    for(int c = 0; c < 256; c++) rx->trans[idx * 256 + c] = RX_UNKNOWN;
+
+    int ne = 0;
+    for(int i = 0; i < n; i++)
+    {
+        if(rx->nfa[d->set[i]].type == N_MATCH) d->match = 1;
+        if(rx->nfa[d->set[i]].type == N_EOL) rx->seeds[ne++] = rx->nfa[d->set[i]].out;
+    }
+    if(ne)
+    {
+        int m = closure(rx, rx->seeds, ne, 0, rx->tmp);
+        for(int i = 0; i < m; i++) if(rx->nfa[rx->tmp[i]].type == N_MATCH) d->eol_match = 1;
+    }
+
+    unsigned i = h & (rx->hcap - 1);
+    while(rx->hash[i] >= 0) i = (i + 1) & (rx->hcap - 1);
+    rx->hash[i] = idx;
+    return idx;
+}
+
+// 算出 row 吃掉字元 c 之後的狀態 (每一步都可以從 pattern 開頭重新開始)
+static int compute_next(Regex *rx, int row, int c)
+{
+    DState *d = &rx->ds[row >> 8];
+    int ns = 0;
+    for(int i = 0; i < d->n; i++)
+    {
+        NState *st = &rx->nfa[d->set[i]];
+        if(st->type == N_CHAR && cls_has(&rx->cls[st->cls], c)) rx->seeds[ns++] = st->out;
+    }
+    rx->seeds[ns++] = rx->start;
+    int n = closure(rx, rx->seeds, ns, 0, rx->tmp);
+    unsigned before = rx->flushes;
+    int next = dstate_get(rx, rx->tmp, n);
+    next = rx->ds[next].match ? RX_MATCHED : next << 8;
+    if(rx->flushes == before) rx->trans[row + c] = next; // 被清掉的話 row 已經不存在了
+    return next;
+}
+
+Regex *rx_compile(const char *pattern, char *err, int errlen)
+{
+    Regex *rx = calloc(1, sizeof(Regex));
+    rx->src = pattern; rx->err = err; rx->errlen = errlen;
+
+    int root = parse_alt(rx);
+    if(!rx->failed && rx->src[rx->pos] == ')') fail(rx, "unmatched )");
+    if(!rx->failed)
+    {
+        int match = new_state(rx, N_MATCH, 0, -1, -1);
+        rx->start = compile_node(rx, root, match);
+    }
+    if(rx->failed) { rx_free(rx); return NULL; }
+
+    rx->litlen = required_literal(rx, root, rx->lit);
+    rx->lit[rx->litlen] = 0;
+
+    rx->mark = calloc(rx->nnfa, sizeof(unsigned));
+    rx->stack = malloc(sizeof(int) * (rx->nnfa * 3 + 4)); // seeds + 每個狀態最多兩條邊
+    rx->tmp = malloc(sizeof(int) * (rx->nnfa + 1));
+    rx->seeds = malloc(sizeof(int) * (rx->nnfa + 1));
+    rx->ds = malloc(sizeof(DState) * RX_CACHE_STATES);
+    rx->trans = malloc(sizeof(int) * RX_CACHE_STATES * 256);
+    rx->hcap = RX_CACHE_STATES * 2;
+    rx->hash = malloc(sizeof(int) * rx->hcap);
+    rx->nds = 0;
+    flush_cache(rx);
+
+    // 從行中間開始時第一個字元可以是哪些
+    CharSet fs; memset(&fs, 0, sizeof(fs));
+    int n = closure(rx, &rx->start, 1, 0, rx->tmp);
+    for(int i = 0; i < n; i++)
+    {
+        NState *st = &rx->nfa[rx->tmp[i]];
+        if(st->type == N_CHAR) for(int k = 0; k < 8; k++) fs.bits[k] |= rx->cls[st->cls].bits[k];
+    }
+    for(int c = 0; c < 256 && rx->nfirst >= 0; c++)
+    {
+        if(!cls_has(&fs, c)) continue;
+        if(rx->nfirst == 3) rx->nfirst = -1;
+        else rx->first[rx->nfirst++] = (unsigned char)c;
+    }
+    if(rx->nfirst < 0) rx->nfirst = 0;
+    return rx;
+}
+
+void rx_free(Regex *rx)
+{
+    if(!rx) return;
+    for(int i = 0; i < rx->nds; i++) free(rx->ds[i].set);
+    free(rx->ds); free(rx->trans); free(rx->hash);
+    free(rx->ast); free(rx->cls); free(rx->nfa);
+    free(rx->mark); free(rx->stack); free(rx->tmp); free(rx->seeds);
+    free(rx);
+}
+
+const char *rx_literal(const Regex *rx, int *len)
+{
+    *len = rx->litlen;
+    return rx->lit;
+}
+
+int rx_begin(Regex *rx)
+{
+    if(rx->start_bol < 0 || rx->mid_row < 0)
+    {
+        int n = closure(rx, &rx->start, 1, 0, rx->tmp);
+        int mid = dstate_get(rx, rx->tmp, n);
+        n = closure(rx, &rx->start, 1, 1, rx->tmp);
+        unsigned before = rx->flushes;
+        int s = dstate_get(rx, rx->tmp, n);
+        rx->start_bol = s;
+        rx->mid_row = (rx->flushes == before) ? mid << 8 : -1;
+    }
+    return rx->ds[rx->start_bol].match ? RX_MATCHED : rx->start_bol << 8;
+}
+
+// 從 i 開始找下一個可能開始符合的字元,沒有就回傳 n
+static int skip_to(const Regex *rx, const unsigned char *s, int i, int n)
+{
+    if(rx->nfirst == 1)
+    {
+        const unsigned char *p = memchr(s + i, rx->first[0], n - i);
+        return p ? (int)(p - s) : n;
+    }
+#ifdef __SSE2__
+    __m128i a = _mm_set1_epi8((char)rx->first[0]);
+    __m128i b = _mm_set1_epi8((char)rx->first[1]);
+    __m128i c = _mm_set1_epi8((char)rx->first[rx->nfirst - 1]);
+    for(; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, a), _mm_cmpeq_epi8(v, b)), _mm_cmpeq_epi8(v, c));
+        unsigned mask = _mm_movemask_epi8(eq);
+        if(mask) return i + __builtin_ctz(mask);
+    }
+#endif
+    for(; i < n; i++)
+        if(s[i] == rx->first[0] || s[i] == rx->first[1] || s[i] == rx->first[rx->nfirst - 1]) return i;
+    return n;
+}
+
+int rx_step(Regex *rx, int state, const char *p, int n)
+{
+    if(state == RX_MATCHED) return RX_MATCHED;
+    const unsigned char *s = (const unsigned char*)p;
+    const int *trans = rx->trans;
+    for(int i = 0; i < n; i++)
+    {
+        if(state == rx->mid_row && rx->nfirst)
+        {
+            i = skip_to(rx, s, i, n);
+            if(i == n) break;
+        }
+        // 每個 byte 只有一次查表 + 一次判斷
+        int next = trans[state + s[i]];
+        if(next < 0)
+        {
+            if(next == RX_UNKNOWN) next = compute_next(rx, state, s[i]);
+            if(next == RX_MATCHED) return RX_MATCHED;
+        }
+        state = next;
+    }
+    return state;
+}
+
+int rx_end(Regex *rx, int state)
+{
+    if(state == RX_MATCHED) return 1;
+    return rx->ds[state >> 8].eol_match;
+}
+
+int rx_match(Regex *rx, const char *line, int n)
+{
+    return rx_end(rx, rx_step(rx, rx_begin(rx), line, n));
+}
@@ -0,0 +1,482 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "search.h"
+#include "fs.h"
+#include "inode.h"
+#include "path.h"
+#include "rx.h"
+#include "trigram.h"
+#include "heat.h"
+#include "bcache.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// ---- 子字串搜尋 kernel ----
+
+// Boyer-Moore-Horspool: 依照視窗最後一個字元決定可以跳多遠
+static const char *bmh_find(const char *hay, int n, const char *needle, int m)
+{
+    if(m > n) return NULL;
+    int skip[256];
+    for(int i = 0; i < 256; i++) skip[i] = m;
+    for(int i = 0; i < m - 1; i++) skip[(unsigned char)needle[i]] = m - 1 - i;
+
+    unsigned char last = (unsigned char)needle[m - 1];
+    for(int i = 0; i <= n - m; )
+    {
+        unsigned char c = (unsigned char)hay[i + m - 1];
+        if(c == last && memcmp(hay + i, needle, m - 1) == 0) return hay + i;
+        i += skip[c];
+    }
+    return NULL;
+}
+
+const char *find_substr(const char *hay, int n, const char *needle, int m)
+{
+    if(m <= 0) return hay;
+    if(m > n) return NULL;
+    if(m == 1) return memchr(hay, needle[0], n); // libc 的 memchr 本身就是向量化的
+
+#ifdef __SSE2__
+    // 一次檢查多個候選位置: 第一個字元和最後一個字元都相同才做 memcmp
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+    int i = 0;
+    for(; i + m - 1 + 32 <= n; i += 32) // 每次 32 個位置 (兩組 16 bytes),減少迴圈的負擔
+    {
+        __m128i f0 = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(hay + i)));
+        __m128i f1 = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(hay + i + 16)));
+        __m128i l0 = _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i*)(hay + i + m - 1)));
+        __m128i l1 = _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i*)(hay + i + m - 1 + 16)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(f0, l0))
+                      | ((unsigned)_mm_movemask_epi8(_mm_and_si128(f1, l1)) << 16);
+        while(mask)
+        {
+            int bit = __builtin_ctz(mask);
+            if(memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0) return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    // 剩下不滿 32 個位置
+    return bmh_find(hay + i, n - i, needle, m);
+#else
+    return bmh_find(hay, n, needle, m);
+#endif
+}
+
+// ---- 檔案 = 多段實體連續的記憶體 (Extent) ----
+
+typedef struct
+{
+    int off;       // 在檔案中的位置
+    int len;
+    const char *p; // 直接指向 Block 資料
+} Extent;
+
+typedef struct
+{
+    Extent *e;
+    int n;
+    int size;
+} Span;
+
+// 把實體上相鄰的 Block 合併成一段,搜尋時整段一次掃
+static void build_span(int idx, Span *sp)
+{
+    Inode *ino = &inode_table[idx];
+    int nb = FILE_BLOCKS(ino->size);
+    sp->n = 0; sp->size = ino->size;
+    if(!data_blocks)
+    {
+        // out-of-core (bcache.h): Block 不一定在記憶體,整個檔案讀出來當成一段 (放在 Extent 後面,一起 free)
+        sp->e = malloc(sizeof(Extent) + (ino->size ? ino->size : 1));
+        char *copy = (char *)(sp->e + 1);
+        if(ino->size > 0)
+        {
+            sp->e[0].off = 0; sp->e[0].len = inode_read(idx, copy, ino->size, 0); sp->e[0].p = copy;
+            sp->n = 1;
+        }
+        return;
+    }
+    sp->e = malloc(sizeof(Extent) * (nb ? nb : 1));
+    for(int b = 0; b < nb; b++)
+    {
+        const char *p = data_blocks[ino->blocks[b]].data;
+        heat_read(ino->blocks[b]);
+        int len = (ino->size - b * BLOCK_SIZE > BLOCK_SIZE) ? BLOCK_SIZE : ino->size - b * BLOCK_SIZE;
+        Extent *last = sp->n ? &sp->e[sp->n - 1] : NULL;
+        if(last && last->p + last->len == p) last->len += len;
+        else { sp->e[sp->n].off = b * BLOCK_SIZE; sp->e[sp->n].len = len; sp->e[sp->n].p = p; sp->n++; }
+    }
+}
+
+// 找出 off 所在的 Extent (從 hint 開始往後找,掃描是單調往前的)
+static int extent_of(const Span *sp, int off, int hint)
+{
+    int i = hint;
+    while(i + 1 < sp->n && sp->e[i].off + sp->e[i].len <= off) i++;
+    while(i > 0 && sp->e[i].off > off) i--;
+    return i;
+}
+
+// 把檔案的 [from, from+len) 複製到 dst (只用在跨 Extent 的少量資料)
+static void copy_range(const Span *sp, int from, int len, char *dst)
+{
+    int i = extent_of(sp, from, 0);
+    while(len > 0 && i < sp->n)
+    {
+        const Extent *e = &sp->e[i];
+        int o = from - e->off;
+        int cp = e->len - o; if(cp > len) cp = len;
+        memcpy(dst, e->p + o, cp);
+        dst += cp; from += cp; len -= cp; i++;
+    }
+}
+
+// 從 off 開始找下一個符合的位置 (可能橫跨兩個 Extent),找不到回傳 -1
+static int find_next(const Span *sp, int off, const char *key, int m, char *stitch, int *hint)
+{
+    for(int i = extent_of(sp, off, *hint); i < sp->n; i++)
+    {
+        const Extent *e = &sp->e[i];
+        int end = e->off + e->len;
+        int start = off > e->off ? off : e->off;
+        if(start >= end) continue;
+
+        // Extent 內部
+        const char *hit = find_substr(e->p + (start - e->off), end - start, key, m);
+        if(hit) { *hint = i; return e->off + (int)(hit - e->p); }
+
+        // 跨 Extent 的部分: 取前一段的尾巴 + 下一段的開頭
+        if(m > 1 && end < sp->size)
+        {
+            int s0 = end - (m - 1); if(s0 < start) s0 = start;
+            int tail = end - s0;
+            int total = tail + (m - 1); if(s0 + total > sp->size) total = sp->size - s0;
+            copy_range(sp, s0, total, stitch);
+            hit = find_substr(stitch, total, key, m);
+            if(hit && hit - stitch < tail) { *hint = i; return s0 + (int)(hit - stitch); }
+        }
+    }
+    return -1;
+}
+
+// 往回找這一行的開頭
+static int line_start(const Span *sp, int pos, int hint)
+{
+    int i = extent_of(sp, pos, hint);
+    while(i >= 0)
+    {
+        const Extent *e = &sp->e[i];
+        for(int k = pos - e->off - 1; k >= 0; k--)
+            if(e->p[k] == '\n') return e->off + k + 1;
+        pos = e->off; i--;
+    }
+    return 0;
+}
+
+// 往後找這一行的結尾 ('\n' 的位置或檔尾)
+static int line_end(const Span *sp, int pos, int hint)
+{
+    for(int i = extent_of(sp, pos, hint); i < sp->n; i++)
+    {
+        const Extent *e = &sp->e[i];
+        int o = pos > e->off ? pos - e->off : 0;
+        const char *nl = memchr(e->p + o, '\n', e->len - o);
+        if(nl) return e->off + (int)(nl - e->p);
+    }
+    return sp->size;
+}
+
+// 計算 [from, to) 之間有幾個 '\n' (for -n)
+static int count_lines(const Span *sp, int from, int to, int hint)
+{
+    int cnt = 0;
+    for(int i = extent_of(sp, from, hint); i < sp->n && from < to; i++)
+    {
+        const Extent *e = &sp->e[i];
+        const char *p = e->p + (from - e->off);
+        const char *stop = e->p + ((to < e->off + e->len) ? to - e->off : e->len);
+        while(p < stop && (p = memchr(p, '\n', stop - p))) { cnt++; p++; }
+        from = e->off + e->len;
+    }
+    return cnt;
+}
+
+// 搜尋條件: 一般字串,或編譯好的 regex (加上它的必要字串當 prefilter)
+typedef struct
+{
+    const char *key;
+    int m;
+    Regex *rx;
+} Pattern;
+
+static int pattern_init(Pattern *pt, const char *key, int flags)
+{
+    pt->rx = NULL; pt->key = key; pt->m = strlen(key);
+    if(!(flags & GREP_REGEX)) return 0;
+    char err[128];
+    pt->rx = rx_compile(key, err, sizeof(err));
+    if(!pt->rx) return -1;
+    pt->key = rx_literal(pt->rx, &pt->m);
+    return 0;
+}
+
+// 用 DFA 跑過 [ls, le) 這一行 (可能跨好幾個 Extent,不用複製)
+static int rx_line(const Span *sp, Regex *rx, int ls, int le, int hint)
+{
+    int st = rx_begin(rx);
+    for(int i = extent_of(sp, ls, hint); i < sp->n && ls < le && st != RX_MATCHED; i++)
+    {
+        const Extent *e = &sp->e[i];
+        int end = (le < e->off + e->len) ? le : e->off + e->len;
+        st = rx_step(rx, st, e->p + (ls - e->off), end - ls);
+        ls = end;
+    }
+    return rx_end(rx, st);
+}
+
+static int grep_span(const Span *sp, const Pattern *pt, int flags, grep_line_cb cb, void *ctx)
+{
+    const char *key = pt->key;
+    int m = pt->m;
+    char *stitch = malloc(2 * m + 1);
+    char *linebuf = NULL; int linecap = 0;
+    int off = 0, hint = 0, matches = 0;
+    int lineno = 1, counted_to = 0;
+
+    while(off < sp->size)
+    {
+        int ls, le;
+        if(m > 0 || !pt->rx)
+        {
+            // 先找字串 (regex 時是 prefilter: 沒有這個字串的區域整段跳過)
+            int pos = find_next(sp, off, key, m, stitch, &hint);
+            if(pos < 0) break;
+            ls = line_start(sp, pos, hint);
+            le = line_end(sp, pos + (m ? m - 1 : 0), hint);
+        }
+        else
+        {
+            // 沒有必要字串的 regex: 每一行都要跑
+            ls = off;
+            hint = extent_of(sp, ls, hint);
+            le = line_end(sp, ls, hint);
+        }
+        off = le + 1; // 同一行只算一次
+        if(pt->rx && !rx_line(sp, pt->rx, ls, le, hint)) continue;
+        matches++;
+
+        if(!(flags & GREP_COUNT) && cb)
+        {
+            if(flags & GREP_LINENO) { lineno += count_lines(sp, counted_to, ls, 0); counted_to = ls; }
+            int i = extent_of(sp, ls, hint);
+            const Extent *e = &sp->e[i];
+            if(le <= e->off + e->len) cb(ctx, lineno, e->p + (ls - e->off), le - ls); // 同一段內: 不複製
+            else
+            {
+                if(le - ls > linecap) { linecap = le - ls; linebuf = realloc(linebuf, linecap); }
+                copy_range(sp, ls, le - ls, linebuf);
+                cb(ctx, lineno, linebuf, le - ls);
+            }
+        }
+    }
+    free(stitch); free(linebuf);
+    return matches;
+}
+
+int grep_inode(int idx, const char *key, int flags, grep_line_cb cb, void *ctx)
+{
+    Pattern pt;
+    if(pattern_init(&pt, key, flags) < 0) return -1;
+    if(!tri_may_contain(idx, pt.key, pt.m)) { rx_free(pt.rx); return 0; } // 索引說一定沒有
+    inode_accessed(idx);
+    Span sp;
+    build_span(idx, &sp);
+    int r = grep_span(&sp, &pt, flags, cb, ctx);
+    free(sp.e);
+    rx_free(pt.rx);
+    return r;
+}
+
+int grep_memory(const char *buf, int len, const char *key, int flags, grep_line_cb cb, void *ctx)
+{
+    Pattern pt;
+    if(pattern_init(&pt, key, flags) < 0) return -1;
+    Extent e = { 0, len, buf };
+    Span sp = { &e, len > 0 ? 1 : 0, len };
+    int r = grep_span(&sp, &pt, flags, cb, ctx);
+    rx_free(pt.rx);
+    return r;
+}
+
+// ---- grep -r: 多個 worker 平行掃描整個目錄樹 ----
+
+static void result_append(GrepResult *r, const char *s, int n)
+{
+    if(r->len + n > r->cap)
+    {
+        r->cap = (r->len + n) * 2;
+        r->out = realloc(r->out, r->cap);
+    }
+    memcpy(r->out + r->len, s, n);
+    r->len += n;
+}
+
+// 每一行格式化成 "path:[lineno:]line\n",存在該檔案自己的結果裡
+static void tree_line(void *ctx, int lineno, const char *line, int len)
+{
+    GrepResult *r = ctx;
+    char head[MAX_PATH_LEN + 16];
+    int h = (r->flags & GREP_LINENO) ? snprintf(head, sizeof(head), "%s:%d:", r->path, lineno)
+                                     : snprintf(head, sizeof(head), "%s:", r->path);
+    if(h >= (int)sizeof(head)) h = sizeof(head) - 1;
+    result_append(r, head, h);
+    result_append(r, line, len);
+    result_append(r, "\n", 1);
+}
+
+// 每個 worker 負責一段檔案 [lo, hi),自己從 lo 拿,別人從 hi 那端偷
+typedef struct
+{
+    int lo, hi;
+    pthread_mutex_t lock;
+} WorkRange;
+
+typedef struct
+{
+    GrepResult *res;
+    WorkRange *ranges;
+    int nworkers;
+    const char *key;
+    int flags;
+} TreeJob;
+
+typedef struct
+{
+    TreeJob *job;
+    int id;
+} Worker;
+
+static int take_own(WorkRange *w)
+{
+    int i = -1;
+    pthread_mutex_lock(&w->lock);
+    if(w->lo < w->hi) i = w->lo++;
+    pthread_mutex_unlock(&w->lock);
+    return i;
+}
+
+// 自己的做完了: 從別的 worker 偷後半段過來
+static int steal(TreeJob *job, int self)
+{
+    for(int k = 1; k < job->nworkers; k++)
+    {
+        WorkRange *v = &job->ranges[(self + k) % job->nworkers];
+        int lo = 0, hi = 0;
+        pthread_mutex_lock(&v->lock);
+        if(v->lo < v->hi)
+        {
+            int mid = v->hi - (v->hi - v->lo + 1) / 2;
+            lo = mid; hi = v->hi; v->hi = mid;
+        }
+        pthread_mutex_unlock(&v->lock);
+        if(lo < hi)
+        {
+            WorkRange *me = &job->ranges[self];
+            pthread_mutex_lock(&me->lock);
+            me->lo = lo + 1; me->hi = hi;
+            pthread_mutex_unlock(&me->lock);
+            return lo;
+        }
+    }
+    return -1; // 全部都做完了 (不會再產生新工作)
+}
+
+static void *tree_worker(void *arg)
+{
+    Worker *w = arg;
+    TreeJob *job = w->job;
+    Pattern pt; // 每個 worker 自己編譯一份 (DFA cache 不能共用)
+    if(pattern_init(&pt, job->key, job->flags) < 0) return NULL;
+    for(;;)
+    {
+        int i = take_own(&job->ranges[w->id]);
+        if(i < 0) i = steal(job, w->id);
+        if(i < 0) break;
+        GrepResult *r = &job->res[i];
+        if(!tri_may_contain(r->ino, pt.key, pt.m)) continue; // matches 維持 0
+        Span sp;
+        build_span(r->ino, &sp);
+        r->matches = grep_span(&sp, &pt, r->flags, tree_line, r);
+        free(sp.e);
+    }
+    rx_free(pt.rx);
+    return NULL;
+}
+
+static int cmp_result(const void *a, const void *b)
+{
+    return strcmp(((const GrepResult*)a)->path, ((const GrepResult*)b)->path);
+}
+
+int grep_tree(int dir, const char *key, int flags, int nthreads, GrepResult **out)
+{
+    // 1) 掃一次 Inode Table 找出 dir 底下所有可讀的檔案,路徑在這裡先算好 (path cache 不是 thread-safe)
+    //    有 Trigram 索引時,一定不含 key 的檔案直接略過 (-c 還是要列出 0,交給 worker 判斷)
+    Pattern pt;
+    int filter = !(flags & GREP_COUNT) && tri_enabled() && pattern_init(&pt, key, flags) == 0;
+    int n = 0, cap = 64;
+    GrepResult *res = malloc(sizeof(GrepResult) * cap);
+    for(int i = 0; i < sb->total_inodes; i++)
+    {
+        Inode *ino = &inode_table[i];
+        if(!ino->is_used || ino->is_dir || !(ino->permission & 4)) continue;
+        int p = ino->parent_id;
+        while(p != dir && p != 0) p = inode_table[p].parent_id;
+        if(p != dir) continue;
+        if(filter && !tri_may_contain(i, pt.key, pt.m)) continue;
+
+        if(n == cap) { cap *= 2; res = realloc(res, sizeof(GrepResult) * cap); }
+        memset(&res[n], 0, sizeof(GrepResult));
+        res[n].ino = i; res[n].flags = flags;
+        res[n].path = strdup(inode_path(i));
+        n++;
+    }
+    if(filter) rx_free(pt.rx);
+    qsort(res, n, sizeof(GrepResult), cmp_result); // 輸出順序固定: 依路徑排序
+
+    // 2) 平分給 worker,做完的去偷別人的
+    if(nthreads > n) nthreads = n;
+    if(nthreads < 1) nthreads = 1;
+    TreeJob job = { res, malloc(sizeof(WorkRange) * nthreads), nthreads, key, flags };
+    Worker *ws = malloc(sizeof(Worker) * nthreads);
+    pthread_t *tids = malloc(sizeof(pthread_t) * nthreads);
+    for(int w = 0; w < nthreads; w++)
+    {
+        job.ranges[w].lo = (int)((long long)n * w / nthreads);
+        job.ranges[w].hi = (int)((long long)n * (w + 1) / nthreads);
+        pthread_mutex_init(&job.ranges[w].lock, NULL);
+        ws[w].job = &job; ws[w].id = w;
+    }
+    // worker 0 就是呼叫者自己
+    for(int w = 1; w < nthreads; w++) pthread_create(&tids[w], NULL, tree_worker, &ws[w]);
+    tree_worker(&ws[0]);
+    for(int w = 1; w < nthreads; w++) pthread_join(tids[w], NULL);
+
+    for(int w = 0; w < nthreads; w++) pthread_mutex_destroy(&job.ranges[w].lock);
+    for(int i = 0; i < n; i++) inode_accessed(res[i].ino); // atime 在這裡才更新 (worker 只讀 Inode)
+    free(job.ranges); free(ws); free(tids);
+    *out = res;
+    return n;
+}
+
+void grep_tree_free(GrepResult *res, int n)
+{
+    for(int i = 0; i < n; i++) { free(res[i].path); free(res[i].out); }
+    free(res);
+}
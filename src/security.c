@@ -3,25 +3,47 @@
 #include "security.h"
 #include "utils.h"
 
+const char *preset_password = NULL;
+
 // XOR Function
-void xor_cipher(void *data, int size, const char *key) 
+void xor_cipher(void *data, long long size, const char *key) 
 {
     if (!key || strlen(key) == 0) return; // 無密碼不處理
     char *ptr = (char *)data;
     int klen = strlen(key);
-    for(int i=0; i<size; i++) 
+    for(long long i=0; i<size; i++) 
     {
         // 對每個 byte 做 XOR
         ptr[i] ^= key[i % klen];
     }
 }
 
+void xor_cipher_at(void *data, int size, const char *key, long long pos) 
+{
+    if (!key || strlen(key) == 0) return;
+    char *ptr = (char *)data;
+    int klen = strlen(key);
+    int k = (int)(pos % klen);
+    for(int i=0; i<size; i++) 
+    {
+        ptr[i] ^= key[k];
+        if(++k == klen) k = 0;
+    }
+}
+
 // Check Password
 int check_password(const char *stored_pwd) 
 {
     // if no password,pass
     if (strlen(stored_pwd) == 0) return 1;
     
+    if (preset_password) 
+    {
+        if (strcmp(preset_password, stored_pwd) == 0) return 1;
+        fprintf(stderr, C_ERR "Wrong password!\n" C_RESET);
+        return 0;
+    }
+
     char input[32];
     printf("Enter password: ");
     scanf("%31s", input);
@@ -41,6 +63,12 @@ int check_password(const char *stored_pwd)
 // Set Password
 void set_new_password(char *buffer, int max_len) 
 {
+    if (preset_password) 
+    {
+        strncpy(buffer, preset_password, max_len-1); buffer[max_len-1] = 0;
+        return;
+    }
+
     char pwd[32];
     printf("Set password (Enter for none): ");
     if(fgets(pwd, sizeof(pwd), stdin)) 
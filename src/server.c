@@ -0,0 +1,451 @@
+#ifdef __linux__
+#define _GNU_SOURCE // accept4
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "myfs.h"
+#include "proto.h"
+#include "server.h"
+#include "stats.h"
+
+static int stop_flag;
+
+void myfs_serve_stop(void)
+{
+    __atomic_store_n(&stop_flag, 1, __ATOMIC_RELAXED);
+}
+
+#ifdef __linux__
+#include <pthread.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+#define READ_CHUNK (64 * 1024)
+#define SEND_TIMEOUT_MS 5000 // client 一直不讀回應就斷線,不要卡住 worker
+#define CONN_MAX_OPEN 1024   // 每個連線最多同時開幾個檔案 (fd 表是大家共用的,不讓一個 client 用光)
+
+typedef struct
+{
+    char *data;
+    int len, cap;
+} Buf;
+
+typedef struct Conn
+{
+    int sock;
+    int hello;              // 已經收到 PROTO_MAGIC
+    int armed;              // 在 epoll 裡等資料 (worker 重新 arm 時設成 1,event loop 交出去時清掉)
+    pthread_mutex_t lock;   // armed 和重新 arm 的 epoll_ctl 一起做: worker arm 完放開之前,event loop 不會把連線交給別人 (別人可能關掉、free)
+    uint64_t *fds;          // 這個連線開的 fd (一個 bit 一個,依最大的 fd 長大)
+    int fd_words, nfds;
+    myfs_session_t *session;
+    Buf in, out;
+    struct Conn *next;      // 工作佇列
+    struct Conn *prev_all, *next_all; // 所有連線 (結束時全部關掉)
+} Conn;
+
+static int epfd = -1;
+
+// 工作佇列: event loop 放進來,worker 拿出去
+// EPOLLONESHOT: 一個連線同時只會在一個 worker 手上,處理完才重新 arm
+static pthread_mutex_t q_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t q_cond = PTHREAD_COND_INITIALIZER;
+static Conn *q_head, *q_tail;
+static int q_stop;
+
+static pthread_mutex_t all_lock = PTHREAD_MUTEX_INITIALIZER;
+static Conn *all_conns;
+
+// 記憶體不足回傳 NULL (buffer 原封不動)
+static char *buf_reserve(Buf *b, int n)
+{
+    if(b->len + n > b->cap)
+    {
+        int cap = b->cap ? b->cap : 4096;
+        while(cap < b->len + n) cap *= 2;
+        char *data = realloc(b->data, cap);
+        if(!data) return NULL;
+        b->data = data;
+        b->cap = cap;
+    }
+    char *p = b->data + b->len;
+    b->len += n;
+    return p;
+}
+
+static int buf_put(Buf *b, const void *p, int n)
+{
+    char *dst = buf_reserve(b, n);
+    if(!dst) return MYFS_ENOMEM;
+    memcpy(dst, p, n);
+    return MYFS_OK;
+}
+
+static void queue_push(Conn *c)
+{
+    pthread_mutex_lock(&q_lock);
+    c->next = NULL;
+    if(q_tail) q_tail->next = c; else q_head = c;
+    q_tail = c;
+    pthread_cond_signal(&q_cond);
+    pthread_mutex_unlock(&q_lock);
+}
+
+static Conn *queue_pop()
+{
+    pthread_mutex_lock(&q_lock);
+    while(!q_head && !q_stop) pthread_cond_wait(&q_cond, &q_lock);
+    Conn *c = q_head;
+    if(c) { q_head = c->next; if(!q_head) q_tail = NULL; }
+    pthread_mutex_unlock(&q_lock);
+    return c;
+}
+
+static void conn_close(Conn *c)
+{
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->sock, NULL);
+    close(c->sock);
+    for(int fd = 0; fd < c->fd_words * 64; fd++) if(c->fds[fd / 64] & (1ull << fd % 64)) myfs_close(fd);
+    free(c->fds);
+    myfs_session_free(c->session);
+    pthread_mutex_lock(&all_lock);
+    if(c->prev_all) c->prev_all->next_all = c->next_all; else all_conns = c->next_all;
+    if(c->next_all) c->next_all->prev_all = c->prev_all;
+    pthread_mutex_unlock(&all_lock);
+    free(c->in.data); free(c->out.data);
+    pthread_mutex_destroy(&c->lock);
+    free(c);
+}
+
+static int owns(Conn *c, int fd) { return fd >= 0 && fd < c->fd_words * 64 && (c->fds[fd / 64] & (1ull << fd % 64)); }
+
+static int own_add(Conn *c, int fd)
+{
+    if(fd >= c->fd_words * 64)
+    {
+        int words = c->fd_words ? c->fd_words : 1;
+        while(fd >= words * 64) words *= 2;
+        uint64_t *fds = realloc(c->fds, sizeof(uint64_t) * words);
+        if(!fds) return MYFS_ENOMEM;
+        memset(fds + c->fd_words, 0, sizeof(uint64_t) * (words - c->fd_words));
+        c->fds = fds;
+        c->fd_words = words;
+    }
+    c->fds[fd / 64] |= 1ull << fd % 64;
+    c->nfds++;
+    return MYFS_OK;
+}
+
+static void own_del(Conn *c, int fd)
+{
+    c->fds[fd / 64] &= ~(1ull << fd % 64);
+    c->nfds--;
+}
+
+// payload 轉成 C 字串
+static int get_path(const MsgReq *r, const char *payload, char *path)
+{
+    if(r->len == 0 || r->len > 255) return MYFS_ENAMETOOLONG;
+    memcpy(path, payload, r->len);
+    path[r->len] = 0;
+    return MYFS_OK;
+}
+
+// 處理一個請求,回應接在 out 後面 (連回應的 header 都放不下就回傳 -1,關掉連線)
+// 每種請求的延遲統計 (myfs_serve 開始時註冊)
+static int rpc_stat[OP_MAX + 1];
+static const char *rpc_names[OP_MAX + 1] =
+{
+    NULL, "rpc_lookup", "rpc_stat", "rpc_open", "rpc_close", "rpc_read", "rpc_write",
+    "rpc_readdir", "rpc_mkdir", "rpc_unlink", "rpc_sync", "rpc_batch"
+};
+
+static int handle(Conn *c, const MsgReq *r, const char *payload, int nested)
+{
+    uint64_t t0 = stats_begin();
+    int at = c->out.len;
+    if(!buf_reserve(&c->out, sizeof(MsgResp))) return -1;
+    int status = MYFS_OK;
+    char path[256];
+    int path_ok = get_path(r, payload, path);
+
+    switch(r->op)
+    {
+    case OP_LOOKUP:
+        status = path_ok < 0 ? path_ok : myfs_lookup(path);
+        break;
+    case OP_STAT:
+    {
+        myfs_stat_t st;
+        status = path_ok < 0 ? path_ok : myfs_stat(path, &st);
+        if(status >= 0 && buf_put(&c->out, &st, sizeof(st)) < 0) status = MYFS_ENOMEM;
+        break;
+    }
+    case OP_OPEN:
+        if(c->nfds >= CONN_MAX_OPEN) { status = MYFS_EMFILE; break; }
+        status = path_ok < 0 ? path_ok : myfs_open(path, r->n);
+        if(status >= 0 && own_add(c, status) < 0) { myfs_close(status); status = MYFS_ENOMEM; }
+        break;
+    case OP_CLOSE:
+        if(!owns(c, r->fd)) { status = MYFS_EBADF; break; }
+        status = myfs_close(r->fd);
+        own_del(c, r->fd);
+        break;
+    case OP_READ:
+    {
+        if(!owns(c, r->fd)) { status = MYFS_EBADF; break; }
+        int n = r->n < 0 ? 0 : (r->n > PROTO_MAX_PAYLOAD ? PROTO_MAX_PAYLOAD : r->n);
+        char *dst = buf_reserve(&c->out, n);
+        if(!dst) { status = MYFS_ENOMEM; break; }
+        status = myfs_pread(r->fd, dst, n, r->off);
+        c->out.len -= n - (status > 0 ? status : 0); // 直接讀進回應,沒讀滿的部分還回去
+        break;
+    }
+    case OP_WRITE:
+        status = owns(c, r->fd) ? myfs_pwrite(r->fd, payload, r->len, r->off) : MYFS_EBADF;
+        break;
+    case OP_READDIR:
+    {
+        if(path_ok < 0) { status = path_ok; break; }
+        int max = (PROTO_MAX_PAYLOAD - (int)sizeof(int)) / (int)sizeof(myfs_dirent_t);
+        int n = r->n < 0 ? 0 : (r->n > max ? max : r->n);
+        int total = 0;
+        int total_at = c->out.len;
+        if(!buf_reserve(&c->out, sizeof(int))) { status = MYFS_ENOMEM; break; }
+        myfs_dirent_t *ents = (myfs_dirent_t *)buf_reserve(&c->out, n * sizeof(myfs_dirent_t));
+        if(!ents) { c->out.len = total_at; status = MYFS_ENOMEM; break; }
+        status = myfs_listdir(path, MYFS_SORT_NAME, r->off, n, ents, &total);
+        if(status < 0) { c->out.len = total_at; break; }
+        memcpy(c->out.data + total_at, &total, sizeof(int)); // reserve 可能搬過 buffer,用位置寫
+        c->out.len = total_at + sizeof(int) + status * sizeof(myfs_dirent_t);
+        break;
+    }
+    case OP_MKDIR:
+        status = path_ok < 0 ? path_ok : myfs_mkdir(path);
+        break;
+    case OP_UNLINK:
+        status = path_ok < 0 ? path_ok : myfs_unlink(path);
+        break;
+    case OP_SYNC:
+        status = myfs_sync();
+        break;
+    case OP_BATCH:
+    {
+        if(nested) { status = MYFS_EINVAL; break; }
+        // 子請求一個接一個,回應也一個接一個; status = 處理了幾個
+        uint32_t off = 0;
+        int count = 0;
+        while(off + sizeof(MsgReq) <= r->len)
+        {
+            MsgReq sub;
+            memcpy(&sub, payload + off, sizeof(sub));
+            if(sub.len > r->len - off - sizeof(MsgReq)) break;
+            if(handle(c, &sub, payload + off + sizeof(MsgReq), 1) < 0) return -1;
+            off += sizeof(MsgReq) + sub.len;
+            count++;
+        }
+        status = off == r->len ? count : MYFS_EINVAL;
+        break;
+    }
+    default:
+        status = MYFS_EINVAL;
+    }
+
+    MsgResp resp;
+    resp.len = c->out.len - at - sizeof(MsgResp);
+    resp.tag = r->tag;
+    resp.status = status;
+    memcpy(c->out.data + at, &resp, sizeof(resp));
+    if(r->op > 0 && r->op <= OP_MAX) stats_end(rpc_stat[r->op], t0, r->len + resp.len);
+    return 0;
+}
+
+// 回應全部送出去,client 太久不讀就放棄 (回傳 -1)
+static int flush_out(Conn *c)
+{
+    int off = 0;
+    while(off < c->out.len)
+    {
+        ssize_t n = send(c->sock, c->out.data + off, c->out.len - off, MSG_NOSIGNAL);
+        if(n > 0) { off += n; continue; }
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            struct pollfd p = { c->sock, POLLOUT, 0 };
+            if(poll(&p, 1, SEND_TIMEOUT_MS) > 0) continue;
+        }
+        return -1;
+    }
+    c->out.len = 0;
+    return 0;
+}
+
+// 讀進目前有的資料,處理完整的請求 (一次最多讀 1 MiB,剩下的等下一輪,不讓一個連線佔住 worker)
+// 回傳 -1 = 關掉連線
+static int serve_conn(Conn *c)
+{
+    int eof = 0;
+    for(int got = 0; got < 16 * READ_CHUNK; )
+    {
+        char *dst = buf_reserve(&c->in, READ_CHUNK);
+        if(!dst) return -1; // 記憶體不足: 關掉連線
+        ssize_t n = recv(c->sock, dst, READ_CHUNK, 0);
+        c->in.len -= READ_CHUNK - (n > 0 ? n : 0);
+        if(n > 0) { got += n; continue; }
+        if(n == 0) eof = 1;
+        else if(errno == EINTR) continue;
+        else if(errno != EAGAIN && errno != EWOULDBLOCK) eof = 1;
+        break;
+    }
+
+    int pos = 0;
+    if(!c->hello && c->in.len >= 4)
+    {
+        uint32_t magic;
+        memcpy(&magic, c->in.data, 4);
+        if(magic != PROTO_MAGIC) return -1;
+        c->hello = 1;
+        pos = 4;
+    }
+    while(c->hello && c->in.len - pos >= (int)sizeof(MsgReq))
+    {
+        MsgReq r;
+        memcpy(&r, c->in.data + pos, sizeof(r));
+        if(r.len > PROTO_MAX_PAYLOAD || r.op == 0 || r.op > OP_MAX) return -1; // 格式錯誤,不知道下一個請求在哪
+        if(c->in.len - pos - (int)sizeof(MsgReq) < (int)r.len) break;
+        if(handle(c, &r, c->in.data + pos + sizeof(MsgReq), 0) < 0) return -1;
+        pos += sizeof(MsgReq) + r.len;
+        if(c->out.len >= 4 * READ_CHUNK && flush_out(c) < 0) return -1;
+    }
+    memmove(c->in.data, c->in.data + pos, c->in.len - pos);
+    c->in.len -= pos;
+    if(flush_out(c) < 0) return -1;
+    return eof ? -1 : 0;
+}
+
+static void *worker(void *arg)
+{
+    (void)arg;
+    Conn *c;
+    while((c = queue_pop()) != NULL)
+    {
+        myfs_session_use(c->session);
+        int r = serve_conn(c);
+        myfs_session_use(NULL);
+        if(r < 0) { conn_close(c); continue; } // 關連線只在 worker 手上做 (連線不在 epoll 裡,沒有別人拿得到)
+        // 在連線的鎖裡重新 arm: 事件可能在 epoll_ctl 回來之前就到了,event loop 要等這裡放開鎖才能把連線交出去,
+        // 所以下一個 worker 關掉、free 的時候這裡已經不會再碰 c
+        pthread_mutex_lock(&c->lock);
+        c->armed = 1;
+        struct epoll_event ev = { EPOLLIN | EPOLLRDHUP | EPOLLONESHOT, { .ptr = c } };
+        epoll_ctl(epfd, EPOLL_CTL_MOD, c->sock, &ev);
+        pthread_mutex_unlock(&c->lock);
+    }
+    return NULL;
+}
+
+static int listen_on(const char *path)
+{
+    struct sockaddr_un addr;
+    if(strlen(path) >= sizeof(addr.sun_path)) return MYFS_ENAMETOOLONG;
+    // 上次沒清掉的 socket 檔可以刪,其他東西 (一般檔案、目錄) 不能動
+    struct stat st;
+    if(lstat(path, &st) == 0)
+    {
+        if(!S_ISSOCK(st.st_mode)) return MYFS_EEXIST;
+        unlink(path);
+    }
+    int s = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(s < 0) return MYFS_EIO;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    // 只有自己可以連 (映像檔可能有密碼)
+    mode_t old = umask(0077);
+    int r = bind(s, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old);
+    if(r < 0 || listen(s, 128) < 0) { close(s); return MYFS_EIO; }
+    return s;
+}
+
+int myfs_serve(const char *socket_path, int workers)
+{
+    if(workers <= 0) workers = 4;
+    for(int op = 1; op <= OP_MAX; op++) rpc_stat[op] = stats_register(rpc_names[op]);
+    int ls = listen_on(socket_path);
+    if(ls < 0) return ls;
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { EPOLLIN, { .ptr = NULL } }; // ptr = NULL: 監聽的 socket
+    epoll_ctl(epfd, EPOLL_CTL_ADD, ls, &ev);
+
+    __atomic_store_n(&stop_flag, 0, __ATOMIC_RELAXED);
+    q_stop = 0;
+    pthread_t *tids = malloc(sizeof(pthread_t) * workers);
+    for(int i = 0; i < workers; i++) pthread_create(&tids[i], NULL, worker, NULL);
+
+    struct epoll_event evs[64];
+    while(!__atomic_load_n(&stop_flag, __ATOMIC_RELAXED))
+    {
+        int n = epoll_wait(epfd, evs, 64, 200); // timeout: 定期檢查 stop_flag
+        for(int i = 0; i < n; i++)
+        {
+            Conn *c = evs[i].data.ptr;
+            if(c)
+            {
+                pthread_mutex_lock(&c->lock);
+                int mine = c->armed;
+                c->armed = 0;
+                pthread_mutex_unlock(&c->lock);
+                if(mine) queue_push(c);
+                continue;
+            }
+            int s;
+            while((s = accept4(ls, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+            {
+                c = calloc(1, sizeof(Conn));
+                c->sock = s;
+                c->session = myfs_session_new();
+                pthread_mutex_init(&c->lock, NULL);
+                c->armed = 1;
+                pthread_mutex_lock(&all_lock);
+                c->next_all = all_conns;
+                if(all_conns) all_conns->prev_all = c;
+                all_conns = c;
+                pthread_mutex_unlock(&all_lock);
+                struct epoll_event cev = { EPOLLIN | EPOLLRDHUP | EPOLLONESHOT, { .ptr = c } };
+                epoll_ctl(epfd, EPOLL_CTL_ADD, s, &cev);
+            }
+        }
+    }
+
+    // 等 worker 處理完手上的連線,再把剩下的全部關掉
+    pthread_mutex_lock(&q_lock);
+    q_stop = 1;
+    q_head = q_tail = NULL; // 還在佇列裡的連線在 all_conns 裡,下面會關
+    pthread_cond_broadcast(&q_cond);
+    pthread_mutex_unlock(&q_lock);
+    for(int i = 0; i < workers; i++) pthread_join(tids[i], NULL);
+    free(tids);
+    while(all_conns) conn_close(all_conns);
+    close(ls);
+    unlink(socket_path);
+    close(epfd);
+    epfd = -1;
+    return MYFS_OK;
+}
+
+#else
+
+int myfs_serve(const char *socket_path, int workers)
+{
+    (void)socket_path; (void)workers;
+    return MYFS_EINVAL; // 需要 epoll
+}
+
+#endif
@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "stats.h"
+
+int stats_on;
+__thread StShard *st_shard;
+
+static StShard *shards;                 // 所有 thread 的那一份 (不釋放,thread 結束後給新的 thread 用)
+static const char *names[ST_MAX_OPS] = { "find_inode_by_name", "alloc_block", "block_read", "block_write", "save_fs", "load_fs" };
+static int nops = ST_FIXED;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t key;
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static uint64_t cal_tick, cal_ns;       // 換算 tick -> ns 的起點
+
+static void shard_release(void *p)
+{
+    pthread_mutex_lock(&lock);
+    ((StShard *)p)->free = 1;
+    pthread_mutex_unlock(&lock);
+}
+
+static void init_key()
+{
+    pthread_key_create(&key, shard_release);
+    cal_tick = st_clock();
+    cal_ns = now_ns();
+}
+
+void stats_enable(int on)
+{
+    pthread_once(&once, init_key);
+    __atomic_store_n(&stats_on, on, __ATOMIC_RELAXED);
+}
+
+StShard *stats_shard_new()
+{
+    pthread_once(&once, init_key);
+    pthread_mutex_lock(&lock);
+    StShard *s = shards;
+    while(s && !s->free) s = s->next;
+    if(s) s->free = 0;
+    else
+    {
+        s = calloc(1, sizeof(StShard));
+        s->next = shards;
+        shards = s;
+    }
+    pthread_mutex_unlock(&lock);
+    pthread_setspecific(key, s);
+    return st_shard = s;
+}
+
+int stats_register(const char *name)
+{
+    pthread_mutex_lock(&lock);
+    int id = -1;
+    for(int i = 0; i < nops; i++) if(strcmp(names[i], name) == 0) id = i;
+    if(id < 0 && nops < ST_MAX_OPS) { names[nops] = name; id = nops++; }
+    pthread_mutex_unlock(&lock);
+    return id;
+}
+
+void stats_reset()
+{
+    pthread_mutex_lock(&lock);
+    for(StShard *s = shards; s; s = s->next)
+    {
+        // 擁有的 thread 同時在加的話,那一筆可能留下來 (不影響其他的)
+        for(int op = 0; op < nops; op++)
+        {
+            StOp *o = &s->ops[op];
+            if(!__atomic_load_n(&o->count, __ATOMIC_RELAXED)) continue;
+            __atomic_store_n(&o->count, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&o->timed, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&o->sum, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&o->max, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&o->bytes, 0, __ATOMIC_RELAXED);
+            for(int b = 0; b < ST_BUCKETS; b++) __atomic_store_n(&o->hist[b], 0, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+// 每個 tick 幾 ns: 用第一次啟用到現在的 TSC 和單調時鐘算 (太短就等到 10 ms)
+static double ns_per_tick()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    pthread_once(&once, init_key);
+    while(now_ns() - cal_ns < 10000000) ;
+    return (double)(now_ns() - cal_ns) / (double)(st_clock() - cal_tick);
+#else
+    return 1.0;
+#endif
+}
+
+// 第 b 格的中間值 (tick)
+static double bucket_mid(int b)
+{
+    if(b < (1 << ST_SUB_BITS)) return b;
+    int e = (b >> ST_SUB_BITS) + ST_SUB_BITS - 1;
+    int sub = b & ((1 << ST_SUB_BITS) - 1);
+    double width = (double)(1ull << (e - ST_SUB_BITS));
+    return ((1 << ST_SUB_BITS) + sub) * width + width / 2;
+}
+
+static double percentile(const uint64_t *hist, uint64_t count, uint64_t max, double q)
+{
+    uint64_t want = (uint64_t)(q * count + 0.5), seen = 0;
+    if(want < 1) want = 1;
+    for(int b = 0; b < ST_BUCKETS; b++)
+    {
+        seen += hist[b];
+        if(seen >= want)
+        {
+            double v = bucket_mid(b);
+            return v < max ? v : max;
+        }
+    }
+    return max;
+}
+
+int stats_snapshot(StatsRow *rows, int max_rows)
+{
+    double k = ns_per_tick();
+    StOp *sum = malloc(sizeof(StOp));
+    int n = 0;
+    pthread_mutex_lock(&lock);
+    for(int op = 0; op < nops && n < max_rows; op++)
+    {
+        memset(sum, 0, sizeof(StOp));
+        for(StShard *s = shards; s; s = s->next)
+        {
+            StOp *o = &s->ops[op];
+            uint64_t c = __atomic_load_n(&o->count, __ATOMIC_RELAXED);
+            if(!c) continue;
+            sum->count += c;
+            sum->timed += __atomic_load_n(&o->timed, __ATOMIC_RELAXED);
+            sum->sum += __atomic_load_n(&o->sum, __ATOMIC_RELAXED);
+            sum->bytes += __atomic_load_n(&o->bytes, __ATOMIC_RELAXED);
+            uint64_t m = __atomic_load_n(&o->max, __ATOMIC_RELAXED);
+            if(m > sum->max) sum->max = m;
+            for(int b = 0; b < ST_BUCKETS; b++) sum->hist[b] += __atomic_load_n(&o->hist[b], __ATOMIC_RELAXED);
+        }
+        if(!sum->count) continue;
+        // 直方圖和 count 不是同一瞬間讀的: 百分位數用直方圖自己的總數
+        uint64_t in_hist = 0;
+        for(int b = 0; b < ST_BUCKETS; b++) in_hist += sum->hist[b];
+        StatsRow *r = &rows[n++];
+        r->name = names[op];
+        r->count = (long long)sum->count;
+        r->bytes = (long long)sum->bytes;
+        r->timed = (long long)sum->timed;
+        // 抽樣的操作: 總時間 = 平均 x 全部次數 (估計值)
+        r->mean_ns = sum->timed ? sum->sum * k / sum->timed : 0;
+        r->total_ns = r->mean_ns * sum->count;
+        r->p50_ns = percentile(sum->hist, in_hist, sum->max, 0.50) * k;
+        r->p90_ns = percentile(sum->hist, in_hist, sum->max, 0.90) * k;
+        r->p99_ns = percentile(sum->hist, in_hist, sum->max, 0.99) * k;
+        r->p999_ns = percentile(sum->hist, in_hist, sum->max, 0.999) * k;
+        r->max_ns = sum->max * k;
+    }
+    pthread_mutex_unlock(&lock);
+    free(sum);
+    return n;
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "stream.h"
+
+static Stream *out_target = NULL; // NULL 代表直接輸出到 stdout
+static int out_quiet = 0;
+const char *pipe_in = NULL;
+int pipe_in_len = 0;
+
+void stream_init(Stream *s)
+{
+    s->data = NULL; s->len = 0; s->cap = 0;
+}
+
+void stream_free(Stream *s)
+{
+    free(s->data);
+    stream_init(s);
+}
+
+void stream_write(Stream *s, const void *buf, int n)
+{
+    if(n <= 0) return;
+    if(s->len + n + 1 > s->cap)
+    {
+        // 容量不夠就倍增,避免每次寫入都 realloc
+        int ncap = s->cap ? s->cap : 4096;
+        while(ncap < s->len + n + 1) ncap *= 2;
+        char *p = realloc(s->data, ncap);
+        if(!p) return;
+        s->data = p; s->cap = ncap;
+    }
+    memcpy(s->data + s->len, buf, n);
+    s->len += n;
+    s->data[s->len] = 0; // 保持可以當字串用
+}
+
+void stream_printf(Stream *s, const char *fmt, ...)
+{
+    char small[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(small, sizeof(small), fmt, ap);
+    va_end(ap);
+    if(n < 0) return;
+    if(n < (int)sizeof(small)) { stream_write(s, small, n); return; }
+    char *big = malloc(n + 1);
+    if(!big) return;
+    va_start(ap, fmt); vsnprintf(big, n + 1, fmt, ap); va_end(ap);
+    stream_write(s, big, n);
+    free(big);
+}
+
+void out_capture(Stream *s)
+{
+    out_target = s;
+}
+
+void out_discard(int on)
+{
+    out_quiet = on;
+}
+
+void out_write(const void *buf, int n)
+{
+    if(!out_target && out_quiet) return;
+    if(out_target) stream_write(out_target, buf, n);
+    else fwrite(buf, 1, n, stdout);
+}
+
+void out_printf(const char *fmt, ...)
+{
+    va_list ap;
+    if(!out_target && out_quiet) return;
+    if(!out_target)
+    {
+        va_start(ap, fmt); vprintf(fmt, ap); va_end(ap);
+        return;
+    }
+
+    // 先試著印進小 buffer,放不下再配置剛好的大小
+    char small[512];
+    va_start(ap, fmt);
+    int n = vsnprintf(small, sizeof(small), fmt, ap);
+    va_end(ap);
+    if(n < 0) return;
+    if(n < (int)sizeof(small))
+    {
+        stream_write(out_target, small, n);
+        return;
+    }
+    char *big = malloc(n + 1);
+    if(!big) return;
+    va_start(ap, fmt); vsnprintf(big, n + 1, fmt, ap); va_end(ap);
+    stream_write(out_target, big, n);
+    free(big);
+}
@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <string.h>
+#include "trigram.h"
+#include "fs.h"
+#include "inode.h"
+#include "security.h"
+#include "bcache.h"
+
+static uint8_t *sigs = NULL; // sb->total_inodes 個 signature,NULL = 沒有啟用
+
+#define SIG(idx) (sigs + (size_t)(idx) * TRI_SIG_BYTES)
+
+// 3 個 byte (放在低 24 bits) -> signature 裡的 bit 位置
+static inline unsigned tri_hash(uint32_t t)
+{
+    return (t * 2654435761u) >> (32 - 12); // 4096 bits
+}
+
+int tri_enabled() { return sigs != NULL; }
+
+void tri_enable()
+{
+    if(sigs) return;
+    sigs = calloc(sb->total_inodes, TRI_SIG_BYTES);
+    for(int i = 0; i < sb->total_inodes; i++)
+        if(inode_table[i].is_used && !inode_table[i].is_dir) tri_add(i, 0, inode_table[i].size);
+}
+
+void tri_disable()
+{
+    free(sigs);
+    sigs = NULL;
+}
+
+void tri_clear(int idx)
+{
+    if(sigs) memset(SIG(idx), 0, TRI_SIG_BYTES);
+}
+
+void tri_add(int idx, int from, int to)
+{
+    if(!sigs) return;
+    Inode *ino = &inode_table[idx];
+    if(from < 0) from = 0;
+    if(to > ino->size) to = ino->size;
+    uint8_t *sig = SIG(idx);
+    uint32_t t = 0;
+    int have = 0;
+    // 直接在 Block 上跑,一次處理一個 Block 內的部分
+    while(from < to)
+    {
+        int b_off = from % BLOCK_SIZE;
+        int cp = BLOCK_SIZE - b_off; if(cp > to - from) cp = to - from;
+        int bid = ino->blocks[from / BLOCK_SIZE];
+        const unsigned char *p = (const unsigned char*)blk_get(bid, BLK_READ) + b_off;
+        for(int k = 0; k < cp; k++)
+        {
+            t = (t << 8 | p[k]) & 0xFFFFFF;
+            if(++have >= 3)
+            {
+                unsigned h = tri_hash(t);
+                sig[h >> 3] |= 1 << (h & 7);
+            }
+        }
+        blk_put(bid, BLK_READ);
+        from += cp;
+    }
+}
+
+int tri_may_contain(int idx, const char *key, int m)
+{
+    if(!sigs || m < 3) return 1;
+    const uint8_t *sig = SIG(idx);
+    const unsigned char *p = (const unsigned char*)key;
+    for(int i = 0; i + 3 <= m; i++)
+    {
+        unsigned h = tri_hash((uint32_t)p[i] << 16 | p[i + 1] << 8 | p[i + 2]);
+        if(!(sig[h >> 3] & (1 << (h & 7)))) return 0;
+    }
+    return 1;
+}
+
+void tri_stats(int *files, long long *bytes, double *fill)
+{
+    int n = 0; long long bits = 0;
+    if(sigs)
+    {
+        for(int i = 0; i < sb->total_inodes; i++)
+        {
+            if(!inode_table[i].is_used || inode_table[i].is_dir) continue;
+            n++;
+            for(int k = 0; k < TRI_SIG_BYTES; k++) bits += __builtin_popcount(SIG(i)[k]);
+        }
+    }
+    *files = n;
+    *bytes = (long long)n * (TRI_SIG_BYTES + sizeof(int));
+    *fill = n ? 100.0 * bits / ((double)n * TRI_SIG_BYTES * 8) : 0;
+}
+
+// 格式: "TRI1", signature 大小, 筆數, 然後每筆是 (Inode 編號, signature),只存使用中的檔案
+void tri_save(FILE *fp, const char *password)
+{
+    if(!sigs) return;
+    int sz = TRI_SIG_BYTES, cnt = 0;
+    for(int i = 0; i < sb->total_inodes; i++) if(inode_table[i].is_used && !inode_table[i].is_dir) cnt++;
+    fwrite(TRI_SECTION, 1, 4, fp);
+    fwrite(&sz, sizeof(int), 1, fp);
+    fwrite(&cnt, sizeof(int), 1, fp);
+    uint8_t buf[TRI_SIG_BYTES];
+    for(int i = 0; i < sb->total_inodes; i++)
+    {
+        if(!inode_table[i].is_used || inode_table[i].is_dir) continue;
+        memcpy(buf, SIG(i), TRI_SIG_BYTES);
+        if(strlen(password) > 0) xor_cipher(buf, TRI_SIG_BYTES, password);
+        fwrite(&i, sizeof(int), 1, fp);
+        fwrite(buf, 1, TRI_SIG_BYTES, fp);
+    }
+}
+
+int tri_load(FILE *fp, const char *password)
+{
+    tri_disable();
+    int sz, cnt;
+    if(fread(&sz, sizeof(int), 1, fp) != 1 || sz != TRI_SIG_BYTES) return -1;
+    if(fread(&cnt, sizeof(int), 1, fp) != 1) return -1;
+    sigs = calloc(sb->total_inodes, TRI_SIG_BYTES);
+    for(int k = 0; k < cnt; k++)
+    {
+        int i;
+        if(fread(&i, sizeof(int), 1, fp) != 1 || i < 0 || i >= sb->total_inodes ||
+           fread(SIG(i), 1, TRI_SIG_BYTES, fp) != TRI_SIG_BYTES)
+        {
+            tri_disable(); // 索引壞掉: 當作沒有索引 (用錯的索引會漏掉結果)
+            return -1;
+        }
+        if(strlen(password) > 0) xor_cipher(SIG(i), TRI_SIG_BYTES, password);
+    }
+    return 0;
+}
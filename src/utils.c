@@ -5,6 +5,10 @@
 // Windows 需要這個標頭檔才有 _mkdir
 #ifdef _WIN32
 #include <direct.h>
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
 #endif
 
 // 建立 Host 電腦上的目錄
@@ -20,4 +24,33 @@ void create_host_dir(const char *path)
             mkdir(path, 0700); // Linux
         #endif
     }
-}
\ No newline at end of file
+}
+
+// 取得單調時鐘,不受系統時間調整影響
+uint64_t now_ns() 
+{
+    #ifdef _WIN32
+        static LARGE_INTEGER freq;
+        LARGE_INTEGER t;
+        if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+        QueryPerformanceCounter(&t);
+        return (uint64_t)((double)t.QuadPart * 1e9 / (double)freq.QuadPart);
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    #endif
+}
+
+// CPU 核心數 (平行處理時決定 worker 數量)
+int cpu_count() 
+{
+    #ifdef _WIN32
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        return (int)si.dwNumberOfProcessors;
+    #else
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        return n > 0 ? (int)n : 1;
+    #endif
+}
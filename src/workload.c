@@ -0,0 +1,522 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "workload.h"
+#include "myfs.h"
+#include "utils.h"
+
+#define MAX_FILE (128 * 1024) // 單檔上限 (MAX_BLOCKS_PER_FILE 個 Block)
+#define MAX_DIRS 100000
+#define MAX_SESSIONS 256
+#define MAX_DEPTH 8
+
+static const char *op_names[WL_OPS] = { "mkdir", "rmdir", "cd", "touch", "rm", "mv", "write", "append", "read", "stat", "ls", "barrier" };
+static const char *stat_names[WL_OPS] = { "replay_mkdir", "replay_rmdir", "replay_cd", "replay_touch", "replay_rm", "replay_mv",
+                                          "replay_write", "replay_append", "replay_read", "replay_stat", "replay_ls", NULL };
+static const char *mix_names[WL_MIX] = { "read", "write", "append", "create", "rm", "stat", "ls" };
+
+// ---- 產生 ----
+
+typedef struct { uint64_t s; } Rng;
+
+static uint64_t rng_next(Rng *r)
+{
+    // xorshift64*
+    r->s ^= r->s >> 12; r->s ^= r->s << 25; r->s ^= r->s >> 27;
+    return r->s * 2685821657736338717ull;
+}
+static double rng_unit(Rng *r) { return (rng_next(r) >> 11) * (1.0 / 9007199254740992.0); } // [0, 1)
+static int rng_int(Rng *r, int n) { return (int)(rng_unit(r) * n); }
+
+// 4K / 1.5M 之類的大小
+static int parse_bytes(const char *s, double *v)
+{
+    char *end;
+    *v = strtod(s, &end);
+    if(end == s) return 0;
+    if(*end == 'K' || *end == 'k') { *v *= 1024; end++; }
+    else if(*end == 'M' || *end == 'm') { *v *= 1024 * 1024; end++; }
+    return *end == 0 || *end == ',' || *end == '-';
+}
+
+void wl_gen_defaults(WlGenOpts *o)
+{
+    memset(o, 0, sizeof(*o));
+    o->ops = 100000;
+    o->files = 1000;
+    o->fanout = 10;
+    o->depth = 1;
+    o->sessions = 1;
+    o->size_kind = WL_SIZE_LOGNORMAL;
+    o->size_a = 4096;
+    o->size_b = 1.0;
+    int mix[WL_MIX] = { 60, 10, 5, 5, 5, 10, 5 };
+    memcpy(o->mix, mix, sizeof(mix));
+    o->zipf = 0.99;
+    o->seed = 1;
+}
+
+int wl_parse_sizes(const char *spec, WlGenOpts *o)
+{
+    const char *arg = strchr(spec, ':');
+    if(!arg) return MYFS_EINVAL;
+    arg++;
+    double a, b = 0;
+    if(!parse_bytes(arg, &a) || a < 0) return MYFS_EINVAL;
+    if(strncmp(spec, "fixed:", 6) == 0) o->size_kind = WL_SIZE_FIXED;
+    else if(strncmp(spec, "uniform:", 8) == 0)
+    {
+        const char *dash = strchr(arg, '-');
+        if(!dash || !parse_bytes(dash + 1, &b) || b < a) return MYFS_EINVAL;
+        o->size_kind = WL_SIZE_UNIFORM;
+    }
+    else if(strncmp(spec, "lognormal:", 10) == 0)
+    {
+        const char *comma = strchr(arg, ',');
+        if(!comma || (b = atof(comma + 1)) < 0 || a < 1) return MYFS_EINVAL;
+        o->size_kind = WL_SIZE_LOGNORMAL;
+    }
+    else return MYFS_EINVAL;
+    o->size_a = a;
+    o->size_b = b;
+    return MYFS_OK;
+}
+
+int wl_parse_mix(const char *spec, WlGenOpts *o)
+{
+    int mix[WL_MIX] = { 0 }, total = 0;
+    char buf[256];
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = 0;
+    for(char *tok = strtok(buf, ","); tok; tok = strtok(NULL, ","))
+    {
+        char *eq = strchr(tok, '=');
+        if(!eq) return MYFS_EINVAL;
+        *eq = 0;
+        int k = 0;
+        while(k < WL_MIX && strcmp(tok, mix_names[k])) k++;
+        if(k == WL_MIX || atoi(eq + 1) < 0) return MYFS_EINVAL;
+        mix[k] = atoi(eq + 1);
+        total += mix[k];
+    }
+    if(total <= 0) return MYFS_EINVAL;
+    memcpy(o->mix, mix, sizeof(mix));
+    return MYFS_OK;
+}
+
+static int gen_size(const WlGenOpts *o, Rng *r)
+{
+    double v;
+    if(o->size_kind == WL_SIZE_FIXED) v = o->size_a;
+    else if(o->size_kind == WL_SIZE_UNIFORM) v = o->size_a + rng_unit(r) * (o->size_b - o->size_a + 1);
+    else
+    {
+        // Box-Muller
+        double u1 = 1.0 - rng_unit(r), u2 = rng_unit(r);
+        v = o->size_a * exp(o->size_b * sqrt(-2 * log(u1)) * cos(6.283185307179586 * u2));
+    }
+    return v < 0 ? 0 : v > MAX_FILE ? MAX_FILE : (int)v;
+}
+
+// Zipf: 第 k 名 (0 起) 的機率跟 1 / (k+1)^s 成正比,cdf 先算好,挑的時候二分搜尋
+static int zipf_pick(const double *cdf, int n, Rng *r)
+{
+    double u = rng_unit(r) * cdf[n - 1];
+    int lo = 0, hi = n - 1;
+    while(lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if(cdf[mid] > u) hi = mid; else lo = mid + 1;
+    }
+    return lo;
+}
+
+// session 自己建立的檔案 (append / rm 只動自己的,不會跟其他 session 衝突)
+typedef struct
+{
+    int *ids, *sizes;
+    int n, cap, next;
+} OwnFiles;
+
+static void own_path(char *out, int size, char (*leaves)[64], int nleaves, int sid, int id)
+{
+    snprintf(out, size, "%s/s%d_%d", leaves[id % nleaves], sid, id);
+}
+
+int wl_generate(const WlGenOpts *o, FILE *out)
+{
+    int weights = 0;
+    for(int k = 0; k < WL_MIX; k++) weights += o->mix[k];
+    if(o->ops < 0 || o->files < 1 || o->fanout < 1 || o->depth < 0 || o->depth > MAX_DEPTH || o->sessions < 1 || o->sessions > MAX_SESSIONS || weights <= 0)
+        return MYFS_EINVAL;
+
+    // 目錄樹: 一層一層展開,最後一層是放檔案的地方
+    int ndirs = 0, nleaves = 1;
+    for(int d = 0; d < o->depth; d++)
+    {
+        if((long long)nleaves * o->fanout + ndirs > MAX_DIRS) return MYFS_EINVAL;
+        nleaves *= o->fanout;
+        ndirs += nleaves;
+    }
+    char (*leaves)[64] = malloc(sizeof(*leaves) * nleaves);
+    int *order = malloc(sizeof(int) * o->files);
+    double *cdf = malloc(sizeof(double) * o->files);
+    OwnFiles *own = calloc(o->sessions, sizeof(OwnFiles));
+    if(!leaves || !order || !cdf || !own) { free(leaves); free(order); free(cdf); free(own); return MYFS_EINVAL; }
+    Rng rng = { o->seed * 0x9E3779B97F4A7C15ull + 1 };
+
+    static const char *kinds[] = { "fixed", "uniform", "lognormal" };
+    fprintf(out, "# myfs trace: ops=%d files=%d fanout=%d depth=%d sessions=%d sizes=%s:%g,%g zipf=%g seed=%u\n",
+            o->ops, o->files, o->fanout, o->depth, o->sessions, kinds[o->size_kind], o->size_a, o->size_b, o->zipf, o->seed);
+    fprintf(out, "# mix:");
+    for(int k = 0; k < WL_MIX; k++) fprintf(out, " %s=%d", mix_names[k], o->mix[k]);
+    fprintf(out, "\n# setup: %d directories, %d files\n", ndirs, o->files);
+
+    // setup: mkdir 由上往下 (leaves 暫時當作每一層的 buffer)
+    strcpy(leaves[0], "");
+    for(int d = 0, width = 1; d < o->depth; d++, width *= o->fanout)
+    {
+        for(int i = width - 1; i >= 0; i--)
+            for(int f = o->fanout - 1; f >= 0; f--)
+            {
+                char path[64];
+                snprintf(path, sizeof(path), "%s/d%d", leaves[i], f);
+                strcpy(leaves[i * o->fanout + f], path);
+            }
+        for(int i = 0; i < width * o->fanout; i++) fprintf(out, "mkdir %s\n", leaves[i]);
+    }
+    for(int f = 0; f < o->files; f++) fprintf(out, "write %s/f%d %d\n", leaves[f % nleaves], f, gen_size(o, &rng));
+
+    // 熱門程度: 名次 -> 檔案 (打亂,熱門的檔案不會集中在同一個目錄)
+    double acc = 0;
+    for(int f = 0; f < o->files; f++)
+    {
+        order[f] = f;
+        acc += 1.0 / pow(f + 1, o->zipf);
+        cdf[f] = acc;
+    }
+    for(int f = o->files - 1; f > 0; f--)
+    {
+        int j = rng_int(&rng, f + 1), t = order[f];
+        order[f] = order[j]; order[j] = t;
+    }
+
+    fprintf(out, "barrier\n");
+    char path[96];
+    for(int i = 0; i < o->ops; i++)
+    {
+        int sid = i % o->sessions, pick = rng_int(&rng, weights), k = 0;
+        while(pick >= o->mix[k]) pick -= o->mix[k++];
+        OwnFiles *ow = &own[sid];
+        if((k == WL_MIX_APPEND || k == WL_MIX_RM) && ow->n == 0) k = WL_MIX_CREATE; // 還沒有自己的檔案
+        int f = order[zipf_pick(cdf, o->files, &rng)];
+        if(o->sessions > 1) fprintf(out, "@%d ", sid);
+        switch(k)
+        {
+            case WL_MIX_READ:  fprintf(out, "read %s/f%d\n", leaves[f % nleaves], f); break;
+            case WL_MIX_STAT:  fprintf(out, "stat %s/f%d\n", leaves[f % nleaves], f); break;
+            case WL_MIX_WRITE: fprintf(out, "write %s/f%d %d\n", leaves[f % nleaves], f, gen_size(o, &rng)); break;
+            case WL_MIX_LS:    fprintf(out, "ls %s\n", o->depth ? leaves[rng_int(&rng, nleaves)] : "/"); break;
+            case WL_MIX_CREATE:
+                if(ow->n == ow->cap)
+                {
+                    ow->cap = ow->cap ? ow->cap * 2 : 64;
+                    ow->ids = realloc(ow->ids, sizeof(int) * ow->cap);
+                    ow->sizes = realloc(ow->sizes, sizeof(int) * ow->cap);
+                }
+                ow->ids[ow->n] = ow->next++;
+                ow->sizes[ow->n] = gen_size(o, &rng);
+                own_path(path, sizeof(path), leaves, nleaves, sid, ow->ids[ow->n]);
+                fprintf(out, "write %s %d\n", path, ow->sizes[ow->n]);
+                ow->n++;
+                break;
+            case WL_MIX_APPEND:
+            {
+                int j = rng_int(&rng, ow->n), n = gen_size(o, &rng);
+                own_path(path, sizeof(path), leaves, nleaves, sid, ow->ids[j]);
+                // 超過單檔上限就從頭寫 (像 log rotate)
+                if(ow->sizes[j] + n > MAX_FILE) { ow->sizes[j] = n; fprintf(out, "write %s %d\n", path, n); }
+                else { ow->sizes[j] += n; fprintf(out, "append %s %d\n", path, n); }
+                break;
+            }
+            case WL_MIX_RM:
+            {
+                int j = rng_int(&rng, ow->n);
+                own_path(path, sizeof(path), leaves, nleaves, sid, ow->ids[j]);
+                fprintf(out, "rm %s\n", path);
+                ow->ids[j] = ow->ids[ow->n - 1];
+                ow->sizes[j] = ow->sizes[ow->n - 1];
+                ow->n--;
+                break;
+            }
+        }
+    }
+    for(int s = 0; s < o->sessions; s++) { free(own[s].ids); free(own[s].sizes); }
+    free(own); free(cdf); free(order); free(leaves);
+    return ferror(out) ? MYFS_EIO : MYFS_OK;
+}
+
+// ---- 重播 ----
+
+typedef struct
+{
+    int op, sid, line, size;
+    char *a, *b;
+} WlLine;
+
+// 下一個參數 (可以用 "..." 包起來),原地切開
+static char *next_arg(char **p)
+{
+    char *s = *p;
+    while(*s == ' ' || *s == '\t') s++;
+    if(*s == '#') s += strlen(s); // 引號外、token 開頭的 # 是註解 (引號裡的 # 是檔名的一部分)
+    if(!*s) { *p = s; return NULL; }
+    char *start = s;
+    if(*s == '"')
+    {
+        start = ++s;
+        while(*s && *s != '"') s++;
+    }
+    else while(*s && *s != ' ' && *s != '\t') s++;
+    if(*s) *s++ = 0;
+    *p = s;
+    return start;
+}
+
+// 整個 trace 讀進來切成 WlLine,錯誤時 *bad_line = 行號
+static WlLine *parse_trace(const char *path, char **text, int *count, int *bad_line)
+{
+    FILE *fp = fopen(path, "rb");
+    if(!fp) return NULL;
+    size_t len = 0, cap = 65536;
+    char *buf = malloc(cap + 1);
+    size_t n;
+    while(buf && (n = fread(buf + len, 1, cap - len, fp)) > 0)
+    {
+        len += n;
+        if(len == cap) { cap *= 2; buf = realloc(buf, cap + 1); }
+    }
+    fclose(fp);
+    if(!buf) return NULL;
+    buf[len] = 0;
+
+    int lines = 1;
+    for(size_t i = 0; i < len; i++) if(buf[i] == '\n') lines++;
+    WlLine *v = malloc(sizeof(WlLine) * lines);
+    int nv = 0, lineno = 0;
+    for(char *line = buf; line && v; )
+    {
+        char *nl = strchr(line, '\n');
+        if(nl) *nl = 0;
+        char *next = nl ? nl + 1 : NULL;
+        line[strcspn(line, "\r")] = 0; // 註解在 next_arg 處理
+        lineno++;
+        char *p = line, *word = next_arg(&p);
+        if(word)
+        {
+            WlLine *l = &v[nv];
+            memset(l, 0, sizeof(*l));
+            l->line = lineno;
+            if(*word == '@') { l->sid = atoi(word + 1); word = next_arg(&p); }
+            l->op = 0;
+            while(word && l->op < WL_OPS && strcmp(word, op_names[l->op])) l->op++;
+            l->a = next_arg(&p);
+            l->b = next_arg(&p);
+            int need = l->op == WL_BARRIER ? 0 : l->op == WL_MV || l->op == WL_WRITE || l->op == WL_APPEND ? 2 : 1;
+            int given = (l->a != NULL) + (l->b != NULL);
+            if(!word || l->op == WL_OPS || given != need || next_arg(&p) || l->sid < 0)
+            {
+                *bad_line = lineno; free(v); free(buf); return NULL;
+            }
+            if(l->op == WL_WRITE || l->op == WL_APPEND) l->size = atoi(l->b);
+            nv++;
+        }
+        line = next;
+    }
+    *text = buf;
+    *count = nv;
+    return v;
+}
+
+typedef struct
+{
+    WlLine *lines;
+    int nlines, id, nsessions;
+    long long ops, errors, bytes;
+    int first_error_line, first_error;
+} Player;
+
+static int stat_id[WL_OPS];
+static pthread_mutex_t bar_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bar_cond = PTHREAD_COND_INITIALIZER;
+static int bar_waiting, bar_round;
+static uint64_t t_start;
+
+// 所有 session 到齊: 最後一個到的重設統計和開始時間
+static void barrier(Player *s)
+{
+    pthread_mutex_lock(&bar_lock);
+    int round = bar_round;
+    if(++bar_waiting == s->nsessions)
+    {
+        bar_waiting = 0;
+        bar_round++;
+        stats_reset();
+        t_start = now_ns();
+        pthread_cond_broadcast(&bar_cond);
+    }
+    else while(round == bar_round) pthread_cond_wait(&bar_cond, &bar_lock);
+    pthread_mutex_unlock(&bar_lock);
+    s->ops = s->errors = s->bytes = 0;
+    s->first_error_line = s->first_error = 0;
+}
+
+static int write_bytes(const char *path, int flags, int size, char *buf)
+{
+    int fd = myfs_open(path, MYFS_O_WRONLY | MYFS_O_CREAT | flags);
+    if(fd < 0) return fd;
+    int r = size > 0 ? myfs_write(fd, buf, size) : 0;
+    myfs_close(fd);
+    return r;
+}
+
+static int read_all(const char *path, char *buf)
+{
+    int fd = myfs_open(path, MYFS_O_RDONLY);
+    if(fd < 0) return fd;
+    int total = 0, n;
+    while((n = myfs_read(fd, buf, MAX_FILE)) > 0) total += n;
+    myfs_close(fd);
+    return n < 0 ? n : total;
+}
+
+static int list_dir(const char *path)
+{
+    myfs_dirent_t ent;
+    int cookie = 0, n = 0, r;
+    while((r = myfs_readdir(path, &cookie, &ent)) == 1) n++;
+    return r < 0 ? r : n;
+}
+
+// rm 跟 shell 一樣: 目錄整個刪掉 (先收集名稱,刪除會改變 readdir 的位置)
+static int remove_path(const char *path)
+{
+    int r = myfs_unlink(path);
+    if(r != MYFS_EISDIR) return r;
+    myfs_dirent_t ent;
+    int cookie = 0, n = 0, cap = 16;
+    char (*names)[MYFS_NAME_MAX] = malloc(sizeof(*names) * cap);
+    while(names && myfs_readdir(path, &cookie, &ent) == 1)
+    {
+        if(n == cap) names = realloc(names, sizeof(*names) * (cap *= 2));
+        if(names) memcpy(names[n++], ent.name, MYFS_NAME_MAX);
+    }
+    char child[512];
+    for(int i = 0; i < n; i++)
+    {
+        snprintf(child, sizeof(child), "%s/%s", path, names[i]);
+        remove_path(child);
+    }
+    free(names);
+    return myfs_rmdir(path);
+}
+
+static int run_op(const WlLine *l, char *buf)
+{
+    switch(l->op)
+    {
+        case WL_MKDIR:  { int r = myfs_mkdir(l->a); return r == MYFS_EEXIST ? 0 : r; }
+        case WL_RMDIR:  return myfs_rmdir(l->a);
+        case WL_CD:     return myfs_chdir(l->a);
+        case WL_TOUCH:  return write_bytes(l->a, 0, 0, buf);
+        case WL_RM:     return remove_path(l->a);
+        case WL_MV:     return myfs_rename(l->a, l->b);
+        case WL_WRITE:  return write_bytes(l->a, MYFS_O_TRUNC, l->size, buf);
+        case WL_APPEND: return write_bytes(l->a, MYFS_O_APPEND, l->size, buf);
+        case WL_READ:   return read_all(l->a, buf);
+        case WL_STAT:   { myfs_stat_t st; return myfs_stat(l->a, &st); }
+        case WL_LS:     return list_dir(l->a);
+    }
+    return MYFS_EINVAL;
+}
+
+static void *session_main(void *arg)
+{
+    Player *s = arg;
+    myfs_session_t *sess = myfs_session_new();
+    myfs_session_use(sess);
+    char *buf = malloc(MAX_FILE);
+    memset(buf, 'w', MAX_FILE);
+    barrier(s); // 一起開始
+    for(int i = 0; i < s->nlines; i++)
+    {
+        const WlLine *l = &s->lines[i];
+        if(l->op == WL_BARRIER) { barrier(s); continue; }
+        if(l->sid % s->nsessions != s->id) continue;
+        uint64_t t0 = stats_begin();
+        int r = run_op(l, buf);
+        stats_end(stat_id[l->op], t0, r > 0 && (l->op == WL_READ || l->op == WL_WRITE || l->op == WL_APPEND) ? r : 0);
+        s->ops++;
+        if(r < 0)
+        {
+            if(!s->errors++) { s->first_error_line = l->line; s->first_error = r; }
+        }
+        else if(l->op == WL_READ || l->op == WL_WRITE || l->op == WL_APPEND) s->bytes += r;
+    }
+    free(buf);
+    myfs_session_use(NULL);
+    myfs_session_free(sess);
+    return NULL;
+}
+
+int wl_replay(const char *trace, int sessions, WlReport *rep)
+{
+    memset(rep, 0, sizeof(*rep));
+    if(sessions < 1 || sessions > MAX_SESSIONS) return MYFS_EINVAL;
+    char *text = NULL;
+    int nlines = 0, bad = 0;
+    WlLine *lines = parse_trace(trace, &text, &nlines, &bad);
+    if(!lines)
+    {
+        rep->first_error_line = bad;
+        return bad ? MYFS_EINVAL : MYFS_ENOENT;
+    }
+    for(int op = 0; op < WL_BARRIER; op++) stat_id[op] = stats_register(stat_names[op]);
+    stats_enable(1);
+
+    Player *ss = calloc(sessions, sizeof(Player));
+    pthread_t *th = malloc(sizeof(pthread_t) * sessions);
+    for(int i = 0; i < sessions; i++)
+    {
+        ss[i].lines = lines;
+        ss[i].nlines = nlines;
+        ss[i].id = i;
+        ss[i].nsessions = sessions;
+        pthread_create(&th[i], NULL, session_main, &ss[i]);
+    }
+    for(int i = 0; i < sessions; i++) pthread_join(th[i], NULL);
+    rep->secs = (now_ns() - t_start) / 1e9;
+
+    rep->sessions = sessions;
+    for(int i = 0; i < sessions; i++)
+    {
+        rep->ops += ss[i].ops;
+        rep->bytes += ss[i].bytes;
+        rep->errors += ss[i].errors;
+        // 行號最前面的那一個
+        if(ss[i].first_error_line && (!rep->first_error_line || ss[i].first_error_line < rep->first_error_line))
+        {
+            rep->first_error_line = ss[i].first_error_line;
+            rep->first_error = ss[i].first_error;
+        }
+    }
+    StatsRow *rows = malloc(sizeof(StatsRow) * ST_MAX_OPS);
+    int n = stats_snapshot(rows, ST_MAX_OPS);
+    for(int op = 0; op < WL_BARRIER; op++)
+        for(int i = 0; i < n; i++)
+            if(strcmp(rows[i].name, stat_names[op]) == 0) rep->rows[rep->nrows++] = rows[i];
+    free(rows); free(th); free(ss); free(lines); free(text);
+    return MYFS_OK;
+}
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "writeback.h"
+#include "fs.h"
+#include "gen.h"
+#include "lock.h"
+#include "bitmap.h"
+#include "trigram.h"
+#include "security.h"
+#include "myfs.h"
+#include "utils.h"
+#include "bcache.h"
+#include "bio.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#define sleep_ms(ms) Sleep(ms)
+#define fsync_file(fp) _commit(_fileno(fp))
+#else
+#include <unistd.h>
+#define sleep_ms(ms) usleep((ms) * 1000)
+#define fsync_file(fp) fsync(fileno(fp))
+#endif
+
+#define RUN_MAX 64   // 連續的 Block 一次寫出
+#define RUN_BATCH 16 // 一次交給 bio_run 的段數 (最多 1 MiB)
+#define COW_LOCKS 64
+
+uint8_t *wb_pending;               // 1 = 這次 checkpoint 要寫,還沒複製
+static DiskBlock **shadow;         // 寫入前被修改的 Block 的舊內容
+static pthread_mutex_t cow_locks[COW_LOCKS];
+static pthread_once_t cow_once = PTHREAD_ONCE_INIT;
+static void cow_init_locks() { for(int i = 0; i < COW_LOCKS; i++) pthread_mutex_init(&cow_locks[i], NULL); }
+#define CLOCK_OF(b) (&cow_locks[(b) & (COW_LOCKS - 1)])
+
+static pthread_mutex_t image_lock = PTHREAD_MUTEX_INITIALIZER; // 映像檔同時只有一個人在寫
+static pthread_mutex_t ctl_lock = PTHREAD_MUTEX_INITIALIZER;   // start / stop
+
+// 凍結時複製下來的東西 (大小跟著 Inode / Block 數,reset 時配置)
+static int *plist;        // 要寫的 Block
+static int *ino_idx;
+static Inode *ino_copy;
+static uint8_t *bitmap_copy;
+
+static uint32_t flushed_gen;   // 映像檔裡是這個 generation 的內容
+static uint64_t flushed_at;    // 那次 checkpoint 凍結的時間
+static int full;               // 下次要整個寫 (映像檔還不存在或內容被換掉)
+
+static pthread_t thread;
+static int running, stop_flag;
+static int interval_ms, dirty_limit;
+static WbStats stats;          // image_lock 保護
+static long long cow_count;
+
+void wb_image_lock() { pthread_mutex_lock(&image_lock); }
+void wb_image_unlock() { pthread_mutex_unlock(&image_lock); }
+
+void wb_free()
+{
+    free(wb_pending); free(shadow); free(plist); free(ino_idx); free(ino_copy); free(bitmap_copy);
+    wb_pending = NULL; shadow = NULL; plist = NULL; ino_idx = NULL; ino_copy = NULL; bitmap_copy = NULL;
+}
+
+void wb_reset(int need_full)
+{
+    pthread_once(&cow_once, cow_init_locks);
+    wb_free();
+    // out-of-core 模式 (bcache.h): 資料 Block 由快取寫回,不用 copy-on-write
+    if(data_blocks)
+    {
+        wb_pending = calloc(sb->total_blocks, 1);
+        shadow = calloc(sb->total_blocks, sizeof(DiskBlock *));
+        plist = malloc(sizeof(int) * sb->total_blocks);
+    }
+    ino_idx = malloc(sizeof(int) * sb->total_inodes);
+    ino_copy = malloc(sizeof(Inode) * sb->total_inodes);
+    bitmap_copy = malloc((sb->total_blocks + 7) / 8);
+    full = need_full;
+    flushed_gen = fs_generation;
+    flushed_at = now_ns();
+    __atomic_store_n(&gen_checkpoint, fs_generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&gen_dirty, 0, __ATOMIC_RELAXED);
+}
+
+void wb_invalidate()
+{
+    pthread_mutex_lock(&image_lock);
+    full = 1;
+    pthread_mutex_unlock(&image_lock);
+}
+
+void wb_saved()
+{
+    full = 0;
+    flushed_gen = fs_generation;
+    flushed_at = now_ns();
+    __atomic_store_n(&gen_checkpoint, fs_generation, __ATOMIC_RELAXED);
+    __atomic_store_n(&gen_dirty, 0, __ATOMIC_RELAXED);
+}
+
+void wb_cow_slow(int bid)
+{
+    pthread_mutex_lock(CLOCK_OF(bid));
+    if(wb_pending[bid])
+    {
+        shadow[bid] = malloc(sizeof(DiskBlock));
+        memcpy(shadow[bid], &data_blocks[bid], sizeof(DiskBlock));
+        __atomic_store_n(&wb_pending[bid], 0, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&cow_count, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(CLOCK_OF(bid));
+}
+
+// 凍結那一刻的 Block 內容: 還沒被改過就直接複製,改過就拿 shadow
+static void take_block(int bid, char *dst)
+{
+    pthread_mutex_lock(CLOCK_OF(bid));
+    if(shadow[bid])
+    {
+        memcpy(dst, shadow[bid], BLOCK_SIZE);
+        free(shadow[bid]);
+        shadow[bid] = NULL;
+    }
+    else memcpy(dst, data_blocks[bid].data, BLOCK_SIZE);
+    __atomic_store_n(&wb_pending[bid], 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(CLOCK_OF(bid));
+}
+
+// 映像檔的位置: Superblock, Inode Table, Data Blocks, Bitmap, 可選的區段
+static long long inode_pos(int i) { return (long long)sizeof(Superblock) + (long long)i * sizeof(Inode); }
+static long long block_pos(int b) { return inode_pos(sb->total_inodes) + (long long)b * BLOCK_SIZE; }
+
+static void put_at(FILE *fp, long long pos, const void *p, int n)
+{
+    fseek64(fp, pos, SEEK_SET);
+    fwrite(p, 1, n, fp);
+    stats.last_bytes += n;
+}
+
+// 有沒有東西要寫 (不凍結,只是決定要不要做 checkpoint)
+static int anything_dirty()
+{
+    if(full || __atomic_load_n(&gen_dirty, __ATOMIC_RELAXED) > 0) return 1;
+    for(int i = 0; i < sb->total_inodes; i++) if(__atomic_load_n(&inode_gen[i], __ATOMIC_RELAXED) > flushed_gen) return 1;
+    return 0;
+}
+
+// bg = 背景 thread: 等 cmd_lock 時要能被 wb_stop 叫停 (shell 的 writeback off 拿著 cmd_lock 在等它結束)
+static int checkpoint_locked_out(int bg)
+{
+    // 1) 凍結: 順序跟 shell 指令 (cmd_lock -> ...) 和 myfs_sync (locks_all -> save_fs) 一樣
+    uint64_t t0 = now_ns();
+    if(!bg) cmd_lock();
+    else while(!cmd_trylock())
+    {
+        if(__atomic_load_n(&stop_flag, __ATOMIC_RELAXED)) return MYFS_OK;
+        sleep_ms(1);
+    }
+    locks_all();
+    pthread_mutex_lock(&image_lock);
+    uint64_t tf = now_ns(); // 拿到鎖才開始算凍結 (等鎖的時候前景還在跑)
+
+    // 映像檔不見了或比固定區段短: 整個寫 (已經存在的映像檔不截斷,原地覆寫)
+    FILE *fp = fopen(image_path, "r+b");
+    if(fp) { fseek64(fp, 0, SEEK_END); if(ftell64(fp) < block_pos(sb->total_blocks)) full = 1; }
+    else { fp = fopen(image_path, "w+b"); full = 1; }
+    if(!fp)
+    {
+        pthread_mutex_unlock(&image_lock);
+        unlock_all(); cmd_unlock();
+        return MYFS_EIO;
+    }
+    int all = full;
+    uint32_t g = fs_generation;
+    stats.last_bytes = 0;
+
+    int ninodes = 0, nblocks = 0;
+    for(int i = 0; i < sb->total_inodes; i++)
+    {
+        if(!all && inode_gen[i] <= flushed_gen) continue;
+        ino_idx[ninodes] = i;
+        ino_copy[ninodes++] = inode_table[i];
+    }
+    for(int b = 0; data_blocks && b < sb->total_blocks; b++)
+    {
+        if(!all && block_gen[b] <= flushed_gen) continue;
+        plist[nblocks++] = b;
+        wb_pending[b] = 1;
+    }
+    int bsize = (sb->total_blocks + 7) / 8;
+    memcpy(bitmap_copy, block_bitmap, bsize);
+    Superblock sbc = *sb;
+    sbc.used_blocks = blocks_used();
+
+    // 尾端的區段 (Trigram 索引、Generation) 要看整個 Inode Table,凍結時直接寫
+    // 最後補 4 個 0 當作結尾 (比上次短的時候,後面殘留的舊資料不會被當成區段)
+    fseek64(fp, block_pos(sb->total_blocks) + bsize, SEEK_SET);
+    long long tail0 = ftell64(fp);
+    tri_save(fp, sb->password);
+    gen_save(fp);
+    fwrite("\0\0\0\0", 1, 4, fp);
+    stats.last_bytes += ftell64(fp) - tail0;
+
+    gen_bump(); // 凍結之後的修改屬於新的 generation,留到下一次
+    __atomic_store_n(&gen_checkpoint, g, __ATOMIC_RELAXED);
+    __atomic_store_n(&gen_dirty, 0, __ATOMIC_RELAXED);
+    unlock_all();
+    cmd_unlock();
+    uint64_t t1 = now_ns();
+
+    // 2) 寫入: 前景照常執行,pending 的 Block 由 take_block / wb_cow 保證是凍結時的內容
+    // out-of-core 模式直接把快取裡的髒 Block 寫回 (寫的是當下的內容,不是凍結時的)
+    int err = 0;
+    if(!data_blocks)
+    {
+        nblocks = bc_flush();
+        if(nblocks < 0) { err = 1; nblocks = 0; }
+        stats.last_bytes += (long long)nblocks * BLOCK_SIZE;
+    }
+    // 連續的 Block 合成一段,湊滿 RUN_BATCH 段一起交給 bio_run (這些區域跟 fp 緩衝的 metadata 不重疊)
+    static char run[RUN_BATCH * RUN_MAX * BLOCK_SIZE];
+    BioReq reqs[RUN_BATCH];
+    err |= fflush(fp) != 0;
+    for(int k = 0; data_blocks && k < nblocks; )
+    {
+        int nreq = 0, used = 0;
+        while(k < nblocks && nreq < RUN_BATCH)
+        {
+            char *dst = run + (size_t)used * BLOCK_SIZE;
+            int n = 0;
+            while(k + n < nblocks && n < RUN_MAX && plist[k + n] == plist[k] + n)
+            {
+                take_block(plist[k + n], dst + n * BLOCK_SIZE);
+                n++;
+            }
+            xor_cipher_at(dst, n * BLOCK_SIZE, sb->password, (long long)plist[k] * BLOCK_SIZE);
+            reqs[nreq].write = 1;
+            reqs[nreq].buf = dst;
+            reqs[nreq].len = n * BLOCK_SIZE;
+            reqs[nreq].pos = block_pos(plist[k]);
+            nreq++;
+            used += n;
+            k += n;
+        }
+        if(bio_run(fileno(fp), reqs, nreq)) err = 1;
+        stats.last_bytes += (long long)used * BLOCK_SIZE;
+    }
+    for(int k = 0; k < ninodes; k++)
+    {
+        xor_cipher_at(&ino_copy[k], sizeof(Inode), sb->password, (long long)ino_idx[k] * sizeof(Inode));
+        put_at(fp, inode_pos(ino_idx[k]), &ino_copy[k], sizeof(Inode));
+    }
+    put_at(fp, block_pos(sb->total_blocks), bitmap_copy, bsize);
+    put_at(fp, 0, &sbc, sizeof(sbc)); // Superblock 最後寫
+    err |= fflush(fp) != 0;
+    fsync_file(fp);
+    err |= fclose(fp) != 0;
+
+    uint64_t t2 = now_ns();
+    if(!err)
+    {
+        full = 0;
+        flushed_gen = g;
+        flushed_at = t0;
+    }
+    stats.checkpoints++;
+    stats.bytes += stats.last_bytes;
+    stats.blocks += nblocks;
+    stats.inodes += ninodes;
+    stats.last_ms = (t2 - t0) / 1e6;
+    stats.last_freeze_ms = (t1 - tf) / 1e6;
+    if(stats.last_freeze_ms > stats.max_freeze_ms) stats.max_freeze_ms = stats.last_freeze_ms;
+    pthread_mutex_unlock(&image_lock);
+    return err ? MYFS_EIO : MYFS_OK;
+}
+
+int wb_checkpoint()
+{
+    if(!sb || !ino_copy) return MYFS_EINVAL;
+    return checkpoint_locked_out(0);
+}
+
+static void *flusher(void *arg)
+{
+    (void)arg;
+    uint64_t last = now_ns();
+    while(!__atomic_load_n(&stop_flag, __ATOMIC_RELAXED))
+    {
+        sleep_ms(10);
+        int iv = __atomic_load_n(&interval_ms, __ATOMIC_RELAXED), lim = __atomic_load_n(&dirty_limit, __ATOMIC_RELAXED);
+        int due = iv > 0 && now_ns() - last >= (uint64_t)iv * 1000000;
+        int over = lim > 0 && __atomic_load_n(&gen_dirty, __ATOMIC_RELAXED) >= lim;
+        if(!due && !over) continue;
+        last = now_ns();
+        pthread_mutex_lock(&image_lock); // full / flushed_gen
+        int dirty = anything_dirty();
+        pthread_mutex_unlock(&image_lock);
+        if(dirty) checkpoint_locked_out(1);
+    }
+    return NULL;
+}
+
+int wb_start(int iv, int lim)
+{
+    if(!sb || !ino_copy || (iv <= 0 && lim <= 0)) return MYFS_EINVAL;
+    pthread_mutex_lock(&ctl_lock);
+    __atomic_store_n(&interval_ms, iv, __ATOMIC_RELAXED);
+    __atomic_store_n(&dirty_limit, lim, __ATOMIC_RELAXED);
+    if(!running)
+    {
+        __atomic_store_n(&stop_flag, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&running, pthread_create(&thread, NULL, flusher, NULL) == 0, __ATOMIC_RELAXED);
+    }
+    int ok = running;
+    pthread_mutex_unlock(&ctl_lock);
+    return ok ? MYFS_OK : MYFS_EINVAL;
+}
+
+void wb_stop()
+{
+    pthread_mutex_lock(&ctl_lock);
+    if(running)
+    {
+        __atomic_store_n(&stop_flag, 1, __ATOMIC_RELAXED);
+        pthread_join(thread, NULL);
+        __atomic_store_n(&running, 0, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&ctl_lock);
+}
+
+void wb_stats(WbStats *st)
+{
+    pthread_mutex_lock(&image_lock);
+    *st = stats;
+    st->cow_copies = __atomic_load_n(&cow_count, __ATOMIC_RELAXED);
+    st->running = __atomic_load_n(&running, __ATOMIC_RELAXED);
+    st->interval_ms = interval_ms;
+    st->dirty_limit = dirty_limit;
+    st->dirty_blocks = __atomic_load_n(&gen_dirty, __ATOMIC_RELAXED);
+    st->gens_behind = fs_generation - flushed_gen;
+    st->lag_ms = sb && anything_dirty() ? (now_ns() - flushed_at) / 1e6 : 0;
+    pthread_mutex_unlock(&image_lock);
+}